@@ -0,0 +1,130 @@
+/**
+ ******************************************************************************
+ * @addtogroup TauLabsModules Tau Labs Modules
+ * @{
+ * @addtogroup Logging Logging Module
+ * @{
+ *
+ * @file       logcompact.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @brief      Compact encoding of the logged updates
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef LOGCOMPACT_H
+#define LOGCOMPACT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * A compact log starts with the 4 bytes "TLCL" and a version byte, followed
+ * by records. Each record is LOGCOMPACT_SYNC, a tag byte and its contents,
+ * then the CRC-8 of the tag and the contents, so that a decoder skips a
+ * damaged record up to the next sync byte starting a record with a valid CRC:
+ *
+ * - LOGCOMPACT_TAG_DEFINE, index of the object (1 byte, from 1), object id
+ *   (4 bytes), data length (2 bytes), flags (1 byte, LOGCOMPACT_FLAG_*), all
+ *   little endian: the definition of the object, repeated every
+ *   LOGCOMPACT_KEYFRAME_INTERVAL updates of the object
+ * - The index of the object, with LOGCOMPACT_TAG_INSTANCE set if the instance
+ *   id follows and LOGCOMPACT_TAG_KEYFRAME set for a keyframe: an update of
+ *   the object, followed by the time in ms as a varint, then the instance id
+ *   as a varint, then the data XORed with the previous data of the same
+ *   instance. The XORed data is stored as a mask of its non zero bytes, one
+ *   bit per byte starting from the lowest bit, followed by the non zero bytes.
+ *   A keyframe holds the time since boot and the data XORed with zeros, the
+ *   other updates the time since the previous update of any object. Each
+ *   instance has a keyframe every LOGCOMPACT_KEYFRAME_INTERVAL updates, where
+ *   a decoder which skipped a record picks the instance up again.
+ * - LOGCOMPACT_TAG_END: the end of the log, what follows is padding
+ *
+ * Varints are stored 7 bits per byte, lowest bits first, with the highest
+ * bit set in all the bytes but the last.
+ */
+#define LOGCOMPACT_MAGIC "TLCL"
+#define LOGCOMPACT_VERSION 2
+#define LOGCOMPACT_SYNC 0xA5
+#define LOGCOMPACT_TAG_END 0x00
+#define LOGCOMPACT_TAG_DEFINE 0x7F
+#define LOGCOMPACT_TAG_KEYFRAME 0x40
+#define LOGCOMPACT_TAG_INSTANCE 0x80
+#define LOGCOMPACT_TAG_INDEX 0x3F
+#define LOGCOMPACT_FLAG_SINGLE_INSTANCE 0x01
+
+//! Most objects in a log, their indexes are below LOGCOMPACT_TAG_INDEX
+#define LOGCOMPACT_MAX_OBJECTS 16
+//! Most instances of all the objects in a log
+#define LOGCOMPACT_MAX_INSTANCES 32
+//! Largest object logged
+#define LOGCOMPACT_MAX_LENGTH 256
+//! Previous data of all the instances of a log
+#define LOGCOMPACT_DATA_SIZE 1024
+//! Updates of an instance between its keyframes
+#define LOGCOMPACT_KEYFRAME_INTERVAL 64
+//! Largest record: sync, tag, time, instance id, mask, data and CRC
+#define LOGCOMPACT_MAX_RECORD (1 + 1 + 5 + 3 + LOGCOMPACT_MAX_LENGTH / 8 + LOGCOMPACT_MAX_LENGTH + 1)
+
+/**
+ * Writes a record to the log
+ * @return number of bytes written, or -1 on error
+ */
+typedef int32_t (*logcompact_write_t)(uint8_t *data, int32_t length);
+
+struct logcompact {
+	logcompact_write_t write;
+
+	uint32_t obj_id[LOGCOMPACT_MAX_OBJECTS];
+	uint16_t length[LOGCOMPACT_MAX_OBJECTS];
+	uint8_t flags[LOGCOMPACT_MAX_OBJECTS];
+	//! Updates of each object before its definition is repeated
+	uint8_t define_countdown[LOGCOMPACT_MAX_OBJECTS];
+	uint8_t num_objects;
+
+	//! Object index and id of each instance
+	uint8_t inst_object[LOGCOMPACT_MAX_INSTANCES];
+	uint16_t inst_id[LOGCOMPACT_MAX_INSTANCES];
+	//! Offset of the previous data of each instance in data
+	uint16_t inst_offset[LOGCOMPACT_MAX_INSTANCES];
+	//! Updates of each instance before its next keyframe
+	uint8_t keyframe_countdown[LOGCOMPACT_MAX_INSTANCES];
+	uint8_t num_instances;
+
+	uint16_t data_used;
+	uint32_t last_time;
+
+	//! Updates left out, of objects or instances which do not fit
+	uint32_t dropped;
+
+	uint8_t data[LOGCOMPACT_DATA_SIZE];
+	uint8_t record[LOGCOMPACT_MAX_RECORD];
+};
+
+int32_t logcompact_start(struct logcompact *log, logcompact_write_t write);
+int32_t logcompact_update(struct logcompact *log, uint32_t obj_id, uint16_t inst_id, bool single_instance,
+		uint32_t now, const uint8_t *data, uint16_t length);
+int32_t logcompact_end(struct logcompact *log);
+
+#endif /* LOGCOMPACT_H */
+
+/**
+ * @}
+ * @}
+ */
@@ -0,0 +1,67 @@
+/**
+ ******************************************************************************
+ * @addtogroup TauLabsModules Tau Labs Modules
+ * @{
+ * @addtogroup Logging Logging Module
+ * @{
+ *
+ * @file       lograte.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @brief      Limit the rate each object is logged at
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef LOGRATE_H
+#define LOGRATE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//! Most objects logged, the size of LoggingSettings.LogObject
+#define LOGRATE_MAX_OBJECTS 12
+
+/**
+ * The objects logged and the credit of time each one has to be logged again.
+ * An object is logged when it has a whole period of credit, and the credit is
+ * capped to two periods so that an update arriving a little early after a
+ * late one is not dropped.
+ */
+struct lograte {
+	uint32_t obj_id[LOGRATE_MAX_OBJECTS];
+	uint16_t period_ms[LOGRATE_MAX_OBJECTS];
+	uint16_t credit_ms[LOGRATE_MAX_OBJECTS];
+	uint32_t last_ms[LOGRATE_MAX_OBJECTS];
+	uint8_t num_objects;
+
+	//! Updates seen and updates logged, of all the objects
+	uint32_t produced;
+	uint32_t captured;
+};
+
+void lograte_init(struct lograte *rate);
+int32_t lograte_add(struct lograte *rate, uint32_t obj_id, uint16_t max_rate);
+bool lograte_accept(struct lograte *rate, uint32_t obj_id, uint32_t now);
+
+#endif /* LOGRATE_H */
+
+/**
+ * @}
+ * @}
+ */
@@ -0,0 +1,95 @@
+/**
+ ******************************************************************************
+ * @addtogroup TauLabsModules Tau Labs Modules
+ * @{
+ * @addtogroup Logging Logging Module
+ * @{
+ *
+ * @file       logwindow.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @brief      Sliding window of sectors for the log download
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef LOGWINDOW_H
+#define LOGWINDOW_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//! Size of a sector, the size of LoggingStats.FileSector
+#define LOGWINDOW_SECTOR_SIZE 128
+//! Most sectors kept for retransmission
+#define LOGWINDOW_MAX_SECTORS 16
+
+//! Retransmission timeout before the round trip time is measured
+#define LOGWINDOW_INITIAL_TIMEOUT_MS 1000
+#define LOGWINDOW_MIN_TIMEOUT_MS 100
+#define LOGWINDOW_MAX_TIMEOUT_MS 5000
+
+/**
+ * Reads the next sector of the file
+ * @return number of bytes read, less than a sector at the end of the file,
+ * or -1 on error
+ */
+typedef int32_t (*logwindow_read_t)(uint8_t *data, uint16_t len);
+
+/**
+ * Sectors read ahead from the file and not yet acknowledged. Sector n is held
+ * in slot n % LOGWINDOW_MAX_SECTORS.
+ */
+struct logwindow {
+	uint8_t data[LOGWINDOW_MAX_SECTORS][LOGWINDOW_SECTOR_SIZE];
+	uint32_t sent_time[LOGWINDOW_MAX_SECTORS];
+	bool sent[LOGWINDOW_MAX_SECTORS];
+	bool lost[LOGWINDOW_MAX_SECTORS];
+	bool retransmitted[LOGWINDOW_MAX_SECTORS];
+	bool acked[LOGWINDOW_MAX_SECTORS];
+
+	//! Sectors which may be sent ahead of the oldest unacknowledged one
+	uint16_t size;
+	//! Oldest unacknowledged sector
+	int32_t base;
+	//! Next sector to read from the file
+	int32_t next_read;
+	//! Last sector of the file, -1 until it is read
+	int32_t last_sector;
+
+	//! Smoothed round trip time and its variation, in ms
+	uint32_t srtt;
+	uint32_t rttvar;
+	uint32_t timeout;
+	//! Time of the last send, sends are spread over the round trip time
+	uint32_t last_send;
+};
+
+void logwindow_init(struct logwindow *window, uint16_t size);
+void logwindow_set_size(struct logwindow *window, uint16_t size);
+void logwindow_ack(struct logwindow *window, uint16_t ack, uint32_t mask, uint32_t now);
+int32_t logwindow_fill(struct logwindow *window, logwindow_read_t read);
+int32_t logwindow_next(struct logwindow *window, uint32_t now, const uint8_t **data, bool *last);
+bool logwindow_done(const struct logwindow *window);
+
+#endif /* LOGWINDOW_H */
+
+/**
+ * @}
+ * @}
+ */
@@ -0,0 +1,264 @@
+/**
+ ******************************************************************************
+ * @addtogroup TauLabsModules Tau Labs Modules
+ * @{
+ * @addtogroup Logging Logging Module
+ * @{
+ *
+ * @file       logcompact.c
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @brief      Compact encoding of the logged updates
+ *
+ * UAVTalk frames cost 11 bytes of header, timestamp and checksum on top of
+ * each update, and consecutive updates of the sensors differ in a few bytes.
+ * Here the objects are named by an index, the times are stored as varint
+ * deltas and the data as the bytes which changed since the previous update
+ * of the instance, with periodic keyframes to recover from damaged records.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <string.h>
+#include "pios.h"
+#include "logcompact.h"
+
+// Private functions
+static int32_t find_object(const struct logcompact *log, uint32_t obj_id);
+static int32_t add_object(struct logcompact *log, uint32_t obj_id, bool single_instance, uint16_t length);
+static int32_t find_instance(const struct logcompact *log, uint8_t index, uint16_t inst_id);
+static int32_t add_instance(struct logcompact *log, uint8_t index, uint16_t inst_id);
+static int32_t write_define(struct logcompact *log, uint8_t index);
+static int32_t write_record(struct logcompact *log, uint32_t length);
+static uint8_t put_varint(uint8_t *buf, uint32_t val);
+
+/**
+ * Start a log, writing its header
+ * @param[in] write Writes the records to the log
+ * @return 0 on success, -1 if the header could not be written
+ */
+int32_t logcompact_start(struct logcompact *log, logcompact_write_t write)
+{
+	memset(log, 0, sizeof(*log));
+	log->write = write;
+
+	memcpy(log->record, LOGCOMPACT_MAGIC, 4);
+	log->record[4] = LOGCOMPACT_VERSION;
+	if (write(log->record, 5) != 5)
+		return -1;
+
+	return 0;
+}
+
+/**
+ * Log an update of an object instance. The object is defined on its first
+ * update and then every LOGCOMPACT_KEYFRAME_INTERVAL updates, and the
+ * instance gets a keyframe as often.
+ * @param[in] now Current time in ms
+ * @return 0 on success, -1 if the object does not fit or the record could not
+ * be written
+ */
+int32_t logcompact_update(struct logcompact *log, uint32_t obj_id, uint16_t inst_id, bool single_instance,
+		uint32_t now, const uint8_t *data, uint16_t length)
+{
+	int32_t index = find_object(log, obj_id);
+	if (index < 0)
+		index = add_object(log, obj_id, single_instance, length);
+	if (index < 0 || length != log->length[index]) {
+		log->dropped++;
+		return -1;
+	}
+
+	int32_t inst = find_instance(log, index, inst_id);
+	if (inst < 0)
+		inst = add_instance(log, index, inst_id);
+	if (inst < 0) {
+		log->dropped++;
+		return -1;
+	}
+
+	if (log->define_countdown[index] == 0) {
+		if (write_define(log, index) != 0)
+			return -1;
+		log->define_countdown[index] = LOGCOMPACT_KEYFRAME_INTERVAL;
+	}
+	log->define_countdown[index]--;
+
+	bool keyframe = log->keyframe_countdown[inst] == 0;
+	uint8_t *record = log->record;
+	uint32_t pos = 1;
+
+	record[pos++] = (index + 1) | (inst_id != 0 ? LOGCOMPACT_TAG_INSTANCE : 0) |
+		(keyframe ? LOGCOMPACT_TAG_KEYFRAME : 0);
+	pos += put_varint(&record[pos], keyframe ? now : now - log->last_time);
+	if (inst_id != 0)
+		pos += put_varint(&record[pos], inst_id);
+
+	// The mask of the changed bytes, then the changed bytes XORed
+	uint8_t *prev = &log->data[log->inst_offset[inst]];
+	uint8_t *mask = &record[pos];
+	uint16_t mask_bytes = (length + 7) / 8;
+	memset(mask, 0, mask_bytes);
+	pos += mask_bytes;
+
+	for (uint16_t i = 0; i < length; i++) {
+		uint8_t diff = keyframe ? data[i] : data[i] ^ prev[i];
+		if (diff != 0) {
+			mask[i / 8] |= 1 << (i % 8);
+			record[pos++] = diff;
+		}
+	}
+
+	if (write_record(log, pos) != 0)
+		return -1;
+
+	log->last_time = now;
+	log->keyframe_countdown[inst] = (keyframe ? LOGCOMPACT_KEYFRAME_INTERVAL : log->keyframe_countdown[inst]) - 1;
+	memcpy(prev, data, length);
+	return 0;
+}
+
+/**
+ * End the log, before closing its file
+ * @return 0 on success, -1 if the record could not be written
+ */
+int32_t logcompact_end(struct logcompact *log)
+{
+	log->record[1] = LOGCOMPACT_TAG_END;
+	return write_record(log, 2);
+}
+
+static int32_t find_object(const struct logcompact *log, uint32_t obj_id)
+{
+	for (int32_t i = 0; i < log->num_objects; i++) {
+		if (log->obj_id[i] == obj_id)
+			return i;
+	}
+
+	return -1;
+}
+
+/**
+ * Give the next index to an object, it is defined in the log on its first
+ * update
+ * @return the index, or -1 if there is no room left for the object
+ */
+static int32_t add_object(struct logcompact *log, uint32_t obj_id, bool single_instance, uint16_t length)
+{
+	if (log->num_objects >= LOGCOMPACT_MAX_OBJECTS || length > LOGCOMPACT_MAX_LENGTH)
+		return -1;
+
+	uint8_t index = log->num_objects++;
+	log->obj_id[index] = obj_id;
+	log->length[index] = length;
+	log->flags[index] = single_instance ? LOGCOMPACT_FLAG_SINGLE_INSTANCE : 0;
+
+	return index;
+}
+
+static int32_t find_instance(const struct logcompact *log, uint8_t index, uint16_t inst_id)
+{
+	for (int32_t i = 0; i < log->num_instances; i++) {
+		if (log->inst_object[i] == index && log->inst_id[i] == inst_id)
+			return i;
+	}
+
+	return -1;
+}
+
+/**
+ * Make room for the previous data of an instance
+ * @return the instance, or -1 if there is no room left for it
+ */
+static int32_t add_instance(struct logcompact *log, uint8_t index, uint16_t inst_id)
+{
+	if (log->num_instances >= LOGCOMPACT_MAX_INSTANCES ||
+	    log->data_used + log->length[index] > LOGCOMPACT_DATA_SIZE)
+		return -1;
+
+	uint8_t inst = log->num_instances++;
+	log->inst_object[inst] = index;
+	log->inst_id[inst] = inst_id;
+	log->inst_offset[inst] = log->data_used;
+	log->data_used += log->length[index];
+
+	return inst;
+}
+
+/**
+ * Write the definition of an object
+ * @return 0 on success, -1 if the record could not be written
+ */
+static int32_t write_define(struct logcompact *log, uint8_t index)
+{
+	uint8_t *record = log->record;
+	uint32_t obj_id = log->obj_id[index];
+	uint16_t length = log->length[index];
+
+	record[1] = LOGCOMPACT_TAG_DEFINE;
+	record[2] = index + 1;
+	record[3] = obj_id;
+	record[4] = obj_id >> 8;
+	record[5] = obj_id >> 16;
+	record[6] = obj_id >> 24;
+	record[7] = length;
+	record[8] = length >> 8;
+	record[9] = log->flags[index];
+
+	return write_record(log, 10);
+}
+
+/**
+ * Frame the record being built and write it
+ * @param[in] length Length of the record from the sync byte, without the CRC
+ * @return 0 on success, -1 if it could not be written
+ */
+static int32_t write_record(struct logcompact *log, uint32_t length)
+{
+	uint8_t *record = log->record;
+
+	record[0] = LOGCOMPACT_SYNC;
+	record[length] = PIOS_CRC_updateCRC(0, &record[1], length - 1);
+	length++;
+
+	if (log->write(record, length) != (int32_t) length)
+		return -1;
+
+	return 0;
+}
+
+/**
+ * Store a varint
+ * @return the number of bytes stored, at most 5
+ */
+static uint8_t put_varint(uint8_t *buf, uint32_t val)
+{
+	uint8_t len = 0;
+	while (val >= 0x80) {
+		buf[len++] = (val & 0x7F) | 0x80;
+		val >>= 7;
+	}
+	buf[len++] = val;
+
+	return len;
+}
+
+/**
+ * @}
+ * @}
+ */
@@ -7,7 +7,8 @@
  *
  * @file       logging.c
  * @author     Tau Labs, http://taulabs.org, Copyright (C) 2014
- * @brief      Forward a set of UAVObjects when updated out a PIOS_COM port
+ * @brief      Forward the UAVObjects set in LoggingSettings out a PIOS_COM
+ *             port as they are updated
  * @see        The GNU Public License (GPL) Version 3
  *
  *****************************************************************************/
@@ -32,36 +33,104 @@
 #include "pios_thread.h"
 
 #include "pios_streamfs.h"
+#include "pios_heap.h"
+#include "pios_queue.h"
+#include "logwindow.h"
+#include "lograte.h"
+#include "logcompact.h"
 
-#include "attitudeactual.h"
 #include "accels.h"
-#include "gyros.h"
+#include "actuatorcommand.h"
+#include "actuatordesired.h"
+#include "airspeedactual.h"
+#include "attitudeactual.h"
 #include "baroaltitude.h"
+#include "flightbatterystate.h"
 #include "flightstatus.h"
 #include "gpsposition.h"
 #include "gpstime.h"
+#include "gpsvelocity.h"
+#include "gyros.h"
 #include "magnetometer.h"
+#include "manualcontrolcommand.h"
+#include "positionactual.h"
+#include "ratedesired.h"
+#include "stabilizationdesired.h"
+#include "velocityactual.h"
+#include "loggingdownloadack.h"
 #include "loggingsettings.h"
 #include "loggingstats.h"
 
 // Private constants
 #define STACK_SIZE_BYTES 1200
 #define TASK_PRIORITY PIOS_THREAD_PRIO_LOW
+//! Period of the task while sending a log with the sliding window
+#define WINDOW_PERIOD_MS 5
+//! Period of the task otherwise, the updates are logged as they come
+#define UPDATE_PERIOD_MS 20
+//! Updates queued while the task is busy, a few ms of the sensors
+#define QUEUE_SIZE 64
+
+#if LOGWINDOW_SECTOR_SIZE != LOGGINGSTATS_FILESECTOR_NUMELEM
+#error "The sectors of the log window must fit LoggingStats.FileSector"
+#endif
+
+#if LOGRATE_MAX_OBJECTS != LOGGINGSETTINGS_LOGOBJECT_NUMELEM
+#error "The objects of the rate limiter must fit LoggingSettings.LogObject"
+#endif
 
 // Private types
 
 // Private variables
 static UAVTalkConnection uavTalkCon;
 static struct pios_thread *loggingTaskHandle;
+static struct pios_queue *queue;
 static bool module_enabled;
+static volatile bool settings_updated;
+
+//! Object ids of the options of LoggingSettings.LogObject
+static const uint32_t log_object_ids[] = {
+	[LOGGINGSETTINGS_LOGOBJECT_NONE] = 0,
+	[LOGGINGSETTINGS_LOGOBJECT_ATTITUDEACTUAL] = ATTITUDEACTUAL_OBJID,
+	[LOGGINGSETTINGS_LOGOBJECT_ACCELS] = ACCELS_OBJID,
+	[LOGGINGSETTINGS_LOGOBJECT_GYROS] = GYROS_OBJID,
+	[LOGGINGSETTINGS_LOGOBJECT_MAGNETOMETER] = MAGNETOMETER_OBJID,
+	[LOGGINGSETTINGS_LOGOBJECT_BAROALTITUDE] = BAROALTITUDE_OBJID,
+	[LOGGINGSETTINGS_LOGOBJECT_AIRSPEEDACTUAL] = AIRSPEEDACTUAL_OBJID,
+	[LOGGINGSETTINGS_LOGOBJECT_GPSPOSITION] = GPSPOSITION_OBJID,
+	[LOGGINGSETTINGS_LOGOBJECT_GPSVELOCITY] = GPSVELOCITY_OBJID,
+	[LOGGINGSETTINGS_LOGOBJECT_GPSTIME] = GPSTIME_OBJID,
+	[LOGGINGSETTINGS_LOGOBJECT_POSITIONACTUAL] = POSITIONACTUAL_OBJID,
+	[LOGGINGSETTINGS_LOGOBJECT_VELOCITYACTUAL] = VELOCITYACTUAL_OBJID,
+	[LOGGINGSETTINGS_LOGOBJECT_MANUALCONTROLCOMMAND] = MANUALCONTROLCOMMAND_OBJID,
+	[LOGGINGSETTINGS_LOGOBJECT_STABILIZATIONDESIRED] = STABILIZATIONDESIRED_OBJID,
+	[LOGGINGSETTINGS_LOGOBJECT_RATEDESIRED] = RATEDESIRED_OBJID,
+	[LOGGINGSETTINGS_LOGOBJECT_ACTUATORDESIRED] = ACTUATORDESIRED_OBJID,
+	[LOGGINGSETTINGS_LOGOBJECT_ACTUATORCOMMAND] = ACTUATORCOMMAND_OBJID,
+	[LOGGINGSETTINGS_LOGOBJECT_FLIGHTSTATUS] = FLIGHTSTATUS_OBJID,
+	[LOGGINGSETTINGS_LOGOBJECT_FLIGHTBATTERYSTATE] = FLIGHTBATTERYSTATE_OBJID,
+};
 
 // Private functions
 static void    loggingTask(void *parameters);
 static int32_t send_data(uint8_t *data, int32_t length);
+static int32_t read_sector(uint8_t *data, uint16_t length);
+static bool window_step(LoggingStatsData *loggingData);
+static void log_update(const UAVObjEvent *ev);
+static bool start_compact();
+static void connect_objects(const LoggingSettingsData *settings);
+static void disconnect_objects();
+static void settingsUpdatedCb(UAVObjEvent * ev);
 
 // Local variables
 static uintptr_t logging_com_id;
 static uint32_t written_bytes;
+static struct logwindow *window;
+static bool window_open;
+static struct lograte rate;
+static struct logcompact *compact;
+static uint8_t *compact_data;
+static bool compact_open;
 
 // External variables
 extern uintptr_t streamfs_id;
@@ -95,7 +164,13 @@ int32_t LoggingInitialize(void)
 		return -1;
 
 	LoggingStatsInitialize();
+	LoggingDownloadAckInitialize();
 	LoggingSettingsInitialize();
+	LoggingSettingsConnectCallback(settingsUpdatedCb);
+
+	queue = PIOS_Queue_Create(QUEUE_SIZE, sizeof(UAVObjEvent));
+	if (queue == NULL)
+		return -1;
 
 	// Initialise UAVTalk
 	uavTalkCon = UAVTalkInitialize(&send_data);
@@ -142,6 +217,7 @@ static void loggingTask(void *parameters)
 	loggingData.MaxFileId = PIOS_STREAMFS_MaxFileId(streamfs_id);
 
 	LoggingSettingsData settings;
+	settings_updated = false;
 	LoggingSettingsGet(&settings);
 
 	if (settings.LogBehavior == LOGGINGSETTINGS_LOGBEHAVIOR_LOGONSTART) {
@@ -158,17 +234,41 @@ static void loggingTask(void *parameters)
 
 	LoggingStatsSet(&loggingData);
 
-	int i = 0;
+	if (write_open) {
+		compact_open = settings.LogFormat == LOGGINGSETTINGS_LOGFORMAT_COMPACT && start_compact();
+		connect_objects(&settings);
+	}
+
+	uint32_t last_update = PIOS_Thread_Systime();
 	// Loop forever
 	while (1) {
 
-		// Do not update anything at more than 40 Hz
-		PIOS_Thread_Sleep(20);
+		// Log the updates as they come. Do not update anything else at more
+		// than 50 Hz, except while sending a log with the sliding window
+		// where each iteration sends a sector.
+		uint32_t period = window_open ? WINDOW_PERIOD_MS : UPDATE_PERIOD_MS;
+		uint32_t elapsed = PIOS_Thread_Systime() - last_update;
+		UAVObjEvent ev;
+		if (PIOS_Queue_Receive(queue, &ev, elapsed < period ? period - elapsed : 0)) {
+			if (write_open && lograte_accept(&rate, UAVObjGetID(ev.obj), PIOS_Thread_Systime()))
+				log_update(&ev);
+			if (PIOS_Thread_Systime() - last_update < period)
+				continue;
+		}
+		last_update = PIOS_Thread_Systime();
 
 		LoggingStatsGet(&loggingData);
 
+		// Follow the objects set while logging, the format is kept until
+		// the next file
+		if (settings_updated) {
+			settings_updated = false;
+			LoggingSettingsGet(&settings);
+			if (write_open)
+				connect_objects(&settings);
+		}
+
 		// Check for change in armed state if logging on armed
-		LoggingSettingsGet(&settings);
 		if (settings.LogBehavior == LOGGINGSETTINGS_LOGBEHAVIOR_LOGONARM) {
 			FlightStatusData flightStatus;
 			FlightStatusGet(&flightStatus);
@@ -185,6 +285,23 @@ static void loggingTask(void *parameters)
 			}
 		}
 
+		// The windowed download keeps going whatever the operation the last
+		// sector set, until the GCS asks for something else
+		if (window_open) {
+			if (loggingData.Operation == LOGGINGSTATS_OPERATION_DOWNLOAD ||
+			    loggingData.Operation == LOGGINGSTATS_OPERATION_COMPLETE) {
+				if (!window_step(&loggingData)) {
+					PIOS_STREAMFS_Close(streamfs_id);
+					read_open = false;
+					window_open = false;
+				}
+				continue;
+			}
+			PIOS_STREAMFS_Close(streamfs_id);
+			read_open = false;
+			window_open = false;
+		}
+
 
 		// If currently downloading a log, close the file
 		if (loggingData.Operation == LOGGINGSTATS_OPERATION_LOGGING && read_open) {
@@ -197,11 +314,17 @@ static void loggingTask(void *parameters)
 				loggingData.Operation = LOGGINGSTATS_OPERATION_ERROR;
 			} else {
 				write_open = true;
+				compact_open = settings.LogFormat == LOGGINGSETTINGS_LOGFORMAT_COMPACT && start_compact();
+				connect_objects(&settings);
 			}
 			loggingData.MinFileId = PIOS_STREAMFS_MinFileId(streamfs_id);
 			loggingData.MaxFileId = PIOS_STREAMFS_MaxFileId(streamfs_id);
 			LoggingStatsSet(&loggingData);
 		} else if (loggingData.Operation != LOGGINGSTATS_OPERATION_LOGGING && write_open) {
+			disconnect_objects();
+			if (compact_open)
+				logcompact_end(compact);
+			compact_open = false;
 			PIOS_STREAMFS_Close(streamfs_id);
 			loggingData.MinFileId = PIOS_STREAMFS_MinFileId(streamfs_id);
 			loggingData.MaxFileId = PIOS_STREAMFS_MaxFileId(streamfs_id);
@@ -214,20 +337,6 @@ static void loggingTask(void *parameters)
 			if (!write_open)
 				continue;
 
-			UAVTalkSendObjectTimestamped(uavTalkCon, AttitudeActualHandle(), 0, false, 0);
-			UAVTalkSendObjectTimestamped(uavTalkCon, AccelsHandle(), 0, false, 0);
-			UAVTalkSendObjectTimestamped(uavTalkCon, GyrosHandle(), 0, false, 0);
-			UAVTalkSendObjectTimestamped(uavTalkCon, MagnetometerHandle(), 0, false, 0);
-
-			if ((i % 10) == 0) {
-				UAVTalkSendObjectTimestamped(uavTalkCon, BaroAltitudeHandle(), 0, false, 0);
-				UAVTalkSendObjectTimestamped(uavTalkCon, GPSPositionHandle(), 0, false, 0);
-			}
-
-			if ((i % 50) == 1) {
-				UAVTalkSendObjectTimestamped(uavTalkCon, GPSTimeHandle(), 0, false, 0);	
-			}
-
 			LoggingStatsBytesLoggedSet(&written_bytes);
 
 			break;
@@ -240,6 +349,25 @@ static void loggingTask(void *parameters)
 				} else {
 					read_open = true;
 					read_sector = -1;
+
+					// Use the sliding window if the GCS set it up before
+					// requesting the file
+					LoggingDownloadAckData ack;
+					LoggingDownloadAckGet(&ack);
+					if (ack.Window > 0 && ack.FileRequest == loggingData.FileRequest) {
+						if (window == NULL)
+							window = PIOS_malloc(sizeof(*window));
+						if (window != NULL) {
+							logwindow_init(window, ack.Window);
+							window_open = true;
+							if (!window_step(&loggingData)) {
+								PIOS_STREAMFS_Close(streamfs_id);
+								read_open = false;
+								window_open = false;
+							}
+							break;
+						}
+					}
 				}
 			}
 
@@ -259,6 +387,12 @@ static void loggingTask(void *parameters)
 
 					// Check it has really run out of bytes by reading again
 					int32_t bytes_read2 = PIOS_COM_ReceiveBuffer(logging_com_id, &read_data[bytes_read], LOGGINGSTATS_FILESECTOR_NUMELEM - bytes_read, 1);
+					if (bytes_read2 < 0)
+						bytes_read2 = 0;
+
+					// Pad the last sector with zeros as the sliding window
+					// does, rather than with the previous sector
+					memset(&read_data[bytes_read + bytes_read2], 0, LOGGINGSTATS_FILESECTOR_NUMELEM - bytes_read - bytes_read2);
 					memcpy(loggingData.FileSector, read_data, LOGGINGSTATS_FILESECTOR_NUMELEM);
 
 					if ((bytes_read + bytes_read2) < LOGGINGSTATS_FILESECTOR_NUMELEM) {
@@ -280,11 +414,141 @@ static void loggingTask(void *parameters)
 			LoggingStatsSet(&loggingData);
 
 		}
+	}
+}
+
+/**
+ * Write an update to the log, in the format chosen when the file was opened
+ */
+static void log_update(const UAVObjEvent *ev)
+{
+	if (!compact_open) {
+		UAVTalkSendObjectTimestamped(uavTalkCon, ev->obj, ev->instId, false, 0);
+		return;
+	}
+
+	uint32_t length = UAVObjGetNumBytes(ev->obj);
+	if (length > LOGCOMPACT_MAX_LENGTH || UAVObjGetInstanceData(ev->obj, ev->instId, compact_data) != 0)
+		return;
+
+	logcompact_update(compact, UAVObjGetID(ev->obj), ev->instId, UAVObjIsSingleInstance(ev->obj),
+			PIOS_Thread_Systime(), compact_data, length);
+}
+
+/**
+ * Start a compact log in the file just opened
+ * \return false if there is no memory for it, the file is then written
+ * with UAVTalk
+ */
+static bool start_compact()
+{
+	if (compact == NULL)
+		compact = PIOS_malloc(sizeof(*compact));
+	if (compact_data == NULL)
+		compact_data = PIOS_malloc(LOGCOMPACT_MAX_LENGTH);
+	if (compact == NULL || compact_data == NULL)
+		return false;
+
+	return logcompact_start(compact, send_data) == 0;
+}
+
+/**
+ * Connect the objects set in LoggingSettings to the queue of the task, in
+ * place of the ones connected before
+ */
+static void connect_objects(const LoggingSettingsData *settings)
+{
+	disconnect_objects();
+
+	for (uint8_t i = 0; i < LOGGINGSETTINGS_LOGOBJECT_NUMELEM; i++) {
+		if (settings->LogObject[i] >= NELEMENTS(log_object_ids))
+			continue;
 
-		i++;
+		// Objects not built for this board are left out
+		UAVObjHandle obj = UAVObjGetByID(log_object_ids[settings->LogObject[i]]);
+		if (obj == NULL || lograte_add(&rate, UAVObjGetID(obj), settings->MaxRate[i]) != 0)
+			continue;
+
+		UAVObjConnectQueue(obj, queue, EV_MASK_ALL_UPDATES);
 	}
 }
 
+/**
+ * Disconnect the logged objects and drop their queued updates
+ */
+static void disconnect_objects()
+{
+	for (uint8_t i = 0; i < rate.num_objects; i++)
+		UAVObjDisconnectQueue(UAVObjGetByID(rate.obj_id[i]), queue);
+	lograte_init(&rate);
+
+	UAVObjEvent ev;
+	while (PIOS_Queue_Receive(queue, &ev, 0))
+		;
+}
+
+/**
+ * Run the sliding window: apply the acknowledgement from the GCS, read ahead
+ * and send at most one sector, as the telemetry sends the current contents
+ * of LoggingStats when it gets to it
+ * \param[in,out] loggingData The current LoggingStats
+ * \return false once the download is over
+ */
+static bool window_step(LoggingStatsData *loggingData)
+{
+	LoggingDownloadAckData ack;
+	LoggingDownloadAckGet(&ack);
+
+	uint32_t now = PIOS_Thread_Systime();
+	if (ack.FileRequest == loggingData->FileRequest) {
+		logwindow_set_size(window, ack.Window);
+		logwindow_ack(window, ack.SectorAck, ack.SectorMask, now);
+	}
+
+	if (logwindow_done(window))
+		return false;
+
+	if (logwindow_fill(window, read_sector) != 0) {
+		loggingData->Operation = LOGGINGSTATS_OPERATION_ERROR;
+		LoggingStatsSet(loggingData);
+		return false;
+	}
+
+	const uint8_t *data;
+	bool last;
+	int32_t sector = logwindow_next(window, now, &data, &last);
+	if (sector >= 0) {
+		loggingData->FileSectorNum = sector;
+		memcpy(loggingData->FileSector, data, LOGGINGSTATS_FILESECTOR_NUMELEM);
+		loggingData->Operation = last ? LOGGINGSTATS_OPERATION_COMPLETE : LOGGINGSTATS_OPERATION_DOWNLOAD;
+		LoggingStatsSet(loggingData);
+	}
+
+	return true;
+}
+
+/**
+ * Read a sector of the file being downloaded
+ * \return number of bytes read, less than length at the end of the file
+ */
+static int32_t read_sector(uint8_t *data, uint16_t length)
+{
+	int32_t bytes_read = PIOS_COM_ReceiveBuffer(logging_com_id, data, length, 1);
+	if (bytes_read < 0 || bytes_read >= length)
+		return bytes_read;
+
+	// Check it has really run out of bytes by reading again
+	int32_t bytes_read2 = PIOS_COM_ReceiveBuffer(logging_com_id, &data[bytes_read], length - bytes_read, 1);
+	if (bytes_read2 < 0)
+		return -1;
+	return bytes_read + bytes_read2;
+}
+
+static void settingsUpdatedCb(UAVObjEvent * ev)
+{
+	settings_updated = true;
+}
+
 /**
  * Forward data from UAVTalk out the serial port
  * \param[in] data Data buffer to send
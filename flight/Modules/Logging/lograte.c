@@ -0,0 +1,115 @@
+/**
+ ******************************************************************************
+ * @addtogroup TauLabsModules Tau Labs Modules
+ * @{
+ * @addtogroup Logging Logging Module
+ * @{
+ *
+ * @file       lograte.c
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @brief      Limit the rate each object is logged at
+ *
+ * The updates of the objects come at the rate of their producer, up to
+ * several hundred Hz for the sensors. Each object is logged at most at the
+ * rate set for it in LoggingSettings, or at every update if it is set to 0.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+
+#include <string.h>
+#include "lograte.h"
+
+// Private functions
+static int32_t find_object(const struct lograte *rate, uint32_t obj_id);
+
+/**
+ * Start with no object logged
+ */
+void lograte_init(struct lograte *rate)
+{
+	memset(rate, 0, sizeof(*rate));
+}
+
+/**
+ * Log an object
+ * @param[in] obj_id The object id
+ * @param[in] max_rate Most updates logged per second, 0 for all of them
+ * @return 0 on success, -1 if there is no room or the object was added before
+ */
+int32_t lograte_add(struct lograte *rate, uint32_t obj_id, uint16_t max_rate)
+{
+	if (rate->num_objects >= LOGRATE_MAX_OBJECTS || find_object(rate, obj_id) >= 0)
+		return -1;
+
+	uint8_t i = rate->num_objects++;
+	rate->obj_id[i] = obj_id;
+	rate->period_ms[i] = max_rate > 0 ? 1000 / max_rate : 0;
+	// The first update is always logged
+	rate->credit_ms[i] = 2 * rate->period_ms[i];
+	rate->last_ms[i] = 0;
+
+	return 0;
+}
+
+/**
+ * Account for an update of an object
+ * @param[in] obj_id The object updated
+ * @param[in] now Current time in ms
+ * @return true if the update should be logged
+ */
+bool lograte_accept(struct lograte *rate, uint32_t obj_id, uint32_t now)
+{
+	int32_t i = find_object(rate, obj_id);
+	if (i < 0)
+		return false;
+
+	rate->produced++;
+
+	uint32_t period = rate->period_ms[i];
+	uint32_t elapsed = now - rate->last_ms[i];
+	uint32_t credit = elapsed < 2 * period ? rate->credit_ms[i] + elapsed : 2 * period;
+	if (credit > 2 * period)
+		credit = 2 * period;
+	rate->last_ms[i] = now;
+
+	if (credit < period) {
+		rate->credit_ms[i] = credit;
+		return false;
+	}
+
+	rate->credit_ms[i] = credit - period;
+	rate->captured++;
+	return true;
+}
+
+static int32_t find_object(const struct lograte *rate, uint32_t obj_id)
+{
+	for (int32_t i = 0; i < rate->num_objects; i++) {
+		if (rate->obj_id[i] == obj_id)
+			return i;
+	}
+
+	return -1;
+}
+
+/**
+ * @}
+ * @}
+ */
@@ -0,0 +1,225 @@
+/**
+ ******************************************************************************
+ * @addtogroup TauLabsModules Tau Labs Modules
+ * @{
+ * @addtogroup Logging Logging Module
+ * @{
+ *
+ * @file       logwindow.c
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @brief      Sliding window of sectors for the log download
+ *
+ * The sectors of the file are read ahead into the window and sent without
+ * waiting for the previous one to be acknowledged. The GCS acknowledges all
+ * the sectors before the first one it misses and, with a bit mask, the ones
+ * it got after it. A sector is sent again when a sector sent after it is
+ * acknowledged first, as the link does not reorder, or when it is not
+ * acknowledged within the retransmission timeout, which follows the measured
+ * round trip time. Once the round trip time is known the sends are spread
+ * over it, so a full window does not go out as a burst the link would drop.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <string.h>
+#include "logwindow.h"
+
+#define SLOT(sector) ((sector) % LOGWINDOW_MAX_SECTORS)
+
+// Private functions
+static void update_timeout(struct logwindow *window, uint32_t rtt);
+
+/**
+ * Start a download
+ * @param[in] size Number of sectors which may be in flight
+ */
+void logwindow_init(struct logwindow *window, uint16_t size)
+{
+	memset(window, 0, sizeof(*window));
+	logwindow_set_size(window, size);
+	window->last_sector = -1;
+	window->timeout = LOGWINDOW_INITIAL_TIMEOUT_MS;
+}
+
+/**
+ * Change the number of sectors which may be in flight. Sectors already sent
+ * beyond a smaller window are still retransmitted until acknowledged.
+ */
+void logwindow_set_size(struct logwindow *window, uint16_t size)
+{
+	if (size < 1)
+		size = 1;
+	if (size > LOGWINDOW_MAX_SECTORS)
+		size = LOGWINDOW_MAX_SECTORS;
+	window->size = size;
+}
+
+/**
+ * Apply an acknowledgement from the GCS. The same acknowledgement may be
+ * applied several times.
+ * @param[in] ack All the sectors before this one were received
+ * @param[in] mask Bit i is set if sector ack + 1 + i was received
+ * @param[in] now Current time in ms
+ */
+void logwindow_ack(struct logwindow *window, uint16_t ack, uint32_t mask, uint32_t now)
+{
+	bool newly_acked = false;
+	uint32_t latest_sent = 0;
+
+	for (int32_t sector = window->base; sector < window->next_read; sector++) {
+		int32_t slot = SLOT(sector);
+		if (window->acked[slot])
+			continue;
+
+		int32_t bit = sector - ack - 1;
+		if (sector >= ack && (bit < 0 || bit >= 32 || (mask & (1u << bit)) == 0))
+			continue;
+		if (!window->sent[slot])
+			continue;
+
+		window->acked[slot] = true;
+		if (!window->retransmitted[slot])
+			update_timeout(window, now - window->sent_time[slot]);
+		if (!newly_acked || (int32_t) (window->sent_time[slot] - latest_sent) > 0)
+			latest_sent = window->sent_time[slot];
+		newly_acked = true;
+	}
+
+	// Anything sent before a sector which got through was lost
+	if (newly_acked) {
+		for (int32_t sector = window->base; sector < window->next_read; sector++) {
+			int32_t slot = SLOT(sector);
+			if (window->sent[slot] && !window->acked[slot] &&
+			    (int32_t) (window->sent_time[slot] - latest_sent) < 0)
+				window->lost[slot] = true;
+		}
+	}
+
+	while (window->base < window->next_read && window->acked[SLOT(window->base)])
+		window->base++;
+}
+
+/**
+ * Read sectors from the file until the window is full or the end of the
+ * file is reached. The last sector is padded with zeros.
+ * @return 0 on success, -1 if the file could not be read
+ */
+int32_t logwindow_fill(struct logwindow *window, logwindow_read_t read)
+{
+	while (window->last_sector < 0 && window->next_read < window->base + LOGWINDOW_MAX_SECTORS) {
+		int32_t slot = SLOT(window->next_read);
+		int32_t bytes_read = read(window->data[slot], LOGWINDOW_SECTOR_SIZE);
+		if (bytes_read < 0 || bytes_read > LOGWINDOW_SECTOR_SIZE)
+			return -1;
+
+		if (bytes_read < LOGWINDOW_SECTOR_SIZE) {
+			memset(&window->data[slot][bytes_read], 0, LOGWINDOW_SECTOR_SIZE - bytes_read);
+			window->last_sector = window->next_read;
+		}
+		window->sent[slot] = false;
+		window->lost[slot] = false;
+		window->retransmitted[slot] = false;
+		window->acked[slot] = false;
+		window->next_read++;
+	}
+
+	return 0;
+}
+
+/**
+ * Get the next sector to send: the oldest lost or timed out sector, otherwise
+ * the next new sector if the window allows it
+ * @param[in] now Current time in ms
+ * @param[out] data The sector data
+ * @param[out] last Set if this is the last sector of the file
+ * @return the sector number, or -1 if there is nothing to send now
+ */
+int32_t logwindow_next(struct logwindow *window, uint32_t now, const uint8_t **data, bool *last)
+{
+	if (window->srtt > 0 && (int32_t) (now - window->last_send) < (int32_t) (window->srtt / window->size))
+		return -1;
+
+	for (int32_t sector = window->base; sector < window->next_read; sector++) {
+		int32_t slot = SLOT(sector);
+		if (window->acked[slot])
+			continue;
+
+		if (window->lost[slot]) {
+			window->lost[slot] = false;
+			window->retransmitted[slot] = true;
+		} else if (window->sent[slot]) {
+			if ((int32_t) (now - window->sent_time[slot]) < (int32_t) window->timeout)
+				continue;
+
+			// Back off when the oldest sector times out
+			if (sector == window->base) {
+				window->timeout *= 2;
+				if (window->timeout > LOGWINDOW_MAX_TIMEOUT_MS)
+					window->timeout = LOGWINDOW_MAX_TIMEOUT_MS;
+			}
+			window->retransmitted[slot] = true;
+		} else if (sector >= window->base + window->size) {
+			return -1;
+		}
+
+		window->sent[slot] = true;
+		window->sent_time[slot] = now;
+		window->last_send = now;
+		*data = window->data[slot];
+		*last = (sector == window->last_sector);
+		return sector;
+	}
+
+	return -1;
+}
+
+/**
+ * Check if every sector up to the end of the file was acknowledged
+ */
+bool logwindow_done(const struct logwindow *window)
+{
+	return window->last_sector >= 0 && window->base > window->last_sector;
+}
+
+/**
+ * Update the retransmission timeout with a round trip time measurement, as
+ * in RFC 6298
+ */
+static void update_timeout(struct logwindow *window, uint32_t rtt)
+{
+	if (window->srtt == 0) {
+		window->srtt = rtt;
+		window->rttvar = rtt / 2;
+	} else {
+		uint32_t delta = (rtt > window->srtt) ? rtt - window->srtt : window->srtt - rtt;
+		window->rttvar = (3 * window->rttvar + delta) / 4;
+		window->srtt = (7 * window->srtt + rtt) / 8;
+	}
+
+	window->timeout = window->srtt + 4 * window->rttvar;
+	if (window->timeout < LOGWINDOW_MIN_TIMEOUT_MS)
+		window->timeout = LOGWINDOW_MIN_TIMEOUT_MS;
+	if (window->timeout > LOGWINDOW_MAX_TIMEOUT_MS)
+		window->timeout = LOGWINDOW_MAX_TIMEOUT_MS;
+}
+
+/**
+ * @}
+ * @}
+ */
@@ -57,6 +57,7 @@
 // Private constants
 #define SYSTEM_UPDATE_PERIOD_MS 1000
 #define LED_BLINK_RATE_HZ 5
+#define SETTINGS_COLLECT_STEPS 16
 
 #ifndef IDLE_COUNTS_PER_SEC_AT_NO_LOAD
 #define IDLE_COUNTS_PER_SEC_AT_NO_LOAD 995998	// calibrated by running tests/test_cpuload.c
@@ -236,6 +237,17 @@ static void systemTask(void *parameters)
 			// If object persistence is updated call the callback
 			objectUpdatedCb(&ev);
 		}
+
+#if defined(PIOS_INCLUDE_LOGFS_SETTINGS)
+		// Collect the garbage of the settings in steps, so that the saves
+		// seldom have to do it at once. Only while disarmed: a step may
+		// erase a sector, which stalls the CPU on the internal flash.
+		extern uintptr_t pios_uavo_settings_fs_id;
+		for (int i = 0; flightStatus.Armed == FLIGHTSTATUS_ARMED_DISARMED && i < SETTINGS_COLLECT_STEPS; i++) {
+			if (PIOS_FLASHFS_Collect(pios_uavo_settings_fs_id) <= 0)
+				break;
+		}
+#endif
 	}
 }
 
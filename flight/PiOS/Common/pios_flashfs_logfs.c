@@ -32,9 +32,13 @@
 
 #include <stdbool.h>
 #include <stddef.h>		/* NULL */
+#include <string.h>		/* memmove */
 
 #define MIN(x,y) ((x) < (y) ? (x) : (y))
 
+/* Slots of the active arena looked at by each step of the garbage collection */
+#define LOGFS_GC_SLOTS_PER_STEP 8
+
 /*
  * Filesystem state data tracked in RAM
  */
@@ -43,6 +47,19 @@ enum pios_flashfs_logfs_dev_magic {
 	PIOS_FLASHFS_LOGFS_DEV_MAGIC = 0x94938201,
 };
 
+/* Active slot of an object instance, as kept in the RAM index */
+struct logfs_index_entry {
+	uint32_t obj_id;
+	uint16_t obj_inst_id;
+	uint16_t slot_id;
+};
+
+enum logfs_gc_state {
+	LOGFS_GC_IDLE,
+	LOGFS_GC_COPYING, /* copying the active slots to the reserved arena */
+	LOGFS_GC_ERASING, /* erasing the next arena a sector at a time, ahead of its collection */
+};
+
 struct logfs_state {
 	enum pios_flashfs_logfs_dev_magic magic;
 	const struct flashfs_logfs_cfg *cfg;
@@ -56,6 +73,19 @@ struct logfs_state {
 	uint16_t num_free_slots;   /* slots in free state */
 	uint16_t num_active_slots; /* slots in active state */
 
+	/* Active slots sorted by object and instance id, NULL if the objects
+	 * are found by scanning the arena
+	 */
+	struct logfs_index_entry *index;
+	uint16_t num_indexed_slots;
+
+	/* Garbage collection done in steps by PIOS_FLASHFS_Collect */
+	enum logfs_gc_state gc_state;
+	uint8_t gc_arena_id;     /* arena the active slots are copied to */
+	uint16_t gc_src_slot_id; /* next slot of the active arena to copy */
+	uint16_t gc_dst_slot_id; /* next slot of the destination arena */
+	uint32_t gc_erase_offset; /* offset in the next arena of the next sector to erase */
+
 	/* Underlying flash partition handle */
 	uintptr_t partition_id;
 	uint32_t partition_size;
@@ -110,19 +140,14 @@ struct arena_header {
  ****************************************/
 
 /**
- * @brief Erases all sectors within the given arena and sets arena to erased state.
+ * @brief Mark an arena whose sectors are all erased as erased
  * @return 0 if success, < 0 on failure
  * @note Must be called while holding the flash transaction lock
  */
-static int32_t logfs_erase_arena(const struct logfs_state *logfs, uint8_t arena_id)
+static int32_t logfs_mark_arena_erased(const struct logfs_state *logfs, uint8_t arena_id)
 {
 	uintptr_t arena_addr = logfs_get_addr (logfs, arena_id, 0);
 
-	/* Erase all of the sectors in the arena */
-	if (PIOS_FLASH_erase_range(logfs->partition_id, arena_addr, logfs->cfg->arena_size) != 0) {
-		return -1;
-	}
-
 	/* Mark this arena as fully erased */
 	struct arena_header arena_hdr = {
 		.magic = logfs->cfg->fs_magic,
@@ -140,6 +165,23 @@ static int32_t logfs_erase_arena(const struct logfs_state *logfs, uint8_t arena_
 	return 0;
 }
 
+/**
+ * @brief Erases all sectors within the given arena and sets arena to erased state.
+ * @return 0 if success, < 0 on failure
+ * @note Must be called while holding the flash transaction lock
+ */
+static int32_t logfs_erase_arena(const struct logfs_state *logfs, uint8_t arena_id)
+{
+	uintptr_t arena_addr = logfs_get_addr (logfs, arena_id, 0);
+
+	/* Erase all of the sectors in the arena */
+	if (PIOS_FLASH_erase_range(logfs->partition_id, arena_addr, logfs->cfg->arena_size) != 0) {
+		return -1;
+	}
+
+	return logfs_mark_arena_erased (logfs, arena_id);
+}
+
 /**
  * @brief Marks the given arena as reserved so it can be filled.
  * @return 0 if success, < 0 on failure
@@ -398,13 +440,98 @@ static bool logfs_log_is_full(const struct logfs_state *logfs)
 	return (logfs->num_free_slots == 0);
 }
 
+/**
+ * @brief Binary search of the RAM index
+ * @return position of the object instance in the index, or where it would
+ * be inserted if it is not indexed
+ */
+static uint16_t logfs_index_search(const struct logfs_state *logfs, uint32_t obj_id, uint16_t obj_inst_id)
+{
+	uint16_t low = 0;
+	uint16_t high = logfs->num_indexed_slots;
+
+	while (low < high) {
+		uint16_t mid = low + (high - low) / 2;
+		const struct logfs_index_entry *entry = &logfs->index[mid];
+		if (entry->obj_id < obj_id ||
+			(entry->obj_id == obj_id && entry->obj_inst_id < obj_inst_id)) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+
+	return low;
+}
+
+/**
+ * @brief Look up the active slot of an object instance in the RAM index
+ * @return true if the object instance is indexed
+ */
+static bool logfs_index_find(const struct logfs_state *logfs, uint32_t obj_id, uint16_t obj_inst_id, uint16_t *slot_id)
+{
+	uint16_t pos = logfs_index_search(logfs, obj_id, obj_inst_id);
+	if (pos == logfs->num_indexed_slots ||
+		logfs->index[pos].obj_id != obj_id ||
+		logfs->index[pos].obj_inst_id != obj_inst_id) {
+		return false;
+	}
+
+	*slot_id = logfs->index[pos].slot_id;
+	return true;
+}
+
+/**
+ * @brief Record the active slot of an object instance in the RAM index
+ * @return 0 if success, -1 if the object instance was already indexed
+ */
+static int32_t logfs_index_insert(struct logfs_state *logfs, uint32_t obj_id, uint16_t obj_inst_id, uint16_t slot_id)
+{
+	uint16_t pos = logfs_index_search(logfs, obj_id, obj_inst_id);
+	if (pos < logfs->num_indexed_slots &&
+		logfs->index[pos].obj_id == obj_id &&
+		logfs->index[pos].obj_inst_id == obj_inst_id) {
+		return -1;
+	}
+
+	/* There is never more than one active slot per slot of the arena */
+	PIOS_Assert(logfs->num_indexed_slots < (logfs->cfg->arena_size / logfs->cfg->slot_size) - 1);
+
+	memmove(&logfs->index[pos + 1], &logfs->index[pos],
+		(logfs->num_indexed_slots - pos) * sizeof(*logfs->index));
+	logfs->index[pos].obj_id      = obj_id;
+	logfs->index[pos].obj_inst_id = obj_inst_id;
+	logfs->index[pos].slot_id     = slot_id;
+	logfs->num_indexed_slots++;
+
+	return 0;
+}
+
+/**
+ * @brief Drop an object instance from the RAM index once its slot is obsoleted
+ */
+static void logfs_index_remove(struct logfs_state *logfs, uint32_t obj_id, uint16_t obj_inst_id)
+{
+	uint16_t pos = logfs_index_search(logfs, obj_id, obj_inst_id);
+	if (pos == logfs->num_indexed_slots ||
+		logfs->index[pos].obj_id != obj_id ||
+		logfs->index[pos].obj_inst_id != obj_inst_id) {
+		return;
+	}
+
+	logfs->num_indexed_slots--;
+	memmove(&logfs->index[pos], &logfs->index[pos + 1],
+		(logfs->num_indexed_slots - pos) * sizeof(*logfs->index));
+}
+
 static int32_t logfs_unmount_log(struct logfs_state *logfs)
 {
 	PIOS_Assert (logfs->mounted);
 
-	logfs->num_active_slots = 0;
-	logfs->num_free_slots   = 0;
-	logfs->mounted          = false;
+	logfs->num_active_slots  = 0;
+	logfs->num_free_slots    = 0;
+	logfs->num_indexed_slots = 0;
+	logfs->mounted           = false;
 
 	return 0;
 }
@@ -413,11 +540,12 @@ static int32_t logfs_mount_log(struct logfs_state *logfs, uint8_t arena_id)
 {
 	PIOS_Assert (!logfs->mounted);
 
-	logfs->num_active_slots = 0;
-	logfs->num_free_slots   = 0;
-	logfs->active_arena_id  = arena_id;
+	logfs->num_active_slots  = 0;
+	logfs->num_free_slots    = 0;
+	logfs->num_indexed_slots = 0;
+	logfs->active_arena_id   = arena_id;
 
-	/* Scan the log to find out how full it is */
+	/* Scan the log to find out how full it is, and index its active slots */
 	for (uint16_t slot_id = 1;
 	     slot_id < (logfs->cfg->arena_size / logfs->cfg->slot_size);
 	     slot_id++) {
@@ -443,6 +571,15 @@ static int32_t logfs_mount_log(struct logfs_state *logfs, uint8_t arena_id)
 			break;
 		case SLOT_STATE_ACTIVE:
 			logfs->num_active_slots++;
+			if (logfs->index &&
+				logfs_index_insert(logfs, slot_hdr.obj_id, slot_hdr.obj_inst_id, slot_id) != 0) {
+				/*
+				 * More than one active slot for an object instance, only
+				 * the scans obsolete all of them on the next save
+				 */
+				PIOS_free(logfs->index);
+				logfs->index = NULL;
+			}
 			break;
 		case SLOT_STATE_RESERVED:
 		case SLOT_STATE_OBSOLETE:
@@ -520,6 +657,15 @@ int32_t PIOS_FLASHFS_Logfs_Init(uintptr_t *fs_id, const struct flashfs_logfs_cfg
 	logfs->partition_id   = partition_id; /* underlying partition */
 	logfs->partition_size = partition_size; /* size of underlying partition */
 	logfs->mounted        = false;
+	logfs->index          = NULL;
+	logfs->gc_state       = LOGFS_GC_IDLE;
+	logfs->gc_erase_offset = 0;
+
+	if (cfg->ram_index) {
+		/* Without the RAM for the index, the objects are found by scanning the arena */
+		logfs->index = (struct logfs_index_entry *)PIOS_malloc(
+			sizeof(*logfs->index) * ((cfg->arena_size / cfg->slot_size) - 1));
+	}
 
 	if (PIOS_FLASH_start_transaction(logfs->partition_id) != 0) {
 		rc = -1;
@@ -580,6 +726,9 @@ int32_t PIOS_FLASHFS_Logfs_Destroy(uintptr_t fs_id)
 		goto out_exit;
 	}
 
+	if (logfs->index) {
+		PIOS_free(logfs->index);
+	}
 	PIOS_FLASHFS_Logfs_free(logfs);
 	rc = 0;
 
@@ -587,72 +736,266 @@ out_exit:
 	return rc;
 }
 
-/* NOTE: Must be called while holding the flash transaction lock */
-static int32_t logfs_garbage_collect (struct logfs_state *logfs) {
-	PIOS_Assert (logfs->mounted);
+/**
+ * @brief Check whether an arena is already erased and ready to be reserved
+ * @return true if the arena is erased, false otherwise or if reading its header failed
+ * @note Must be called while holding the flash transaction lock
+ */
+static bool logfs_arena_is_erased(const struct logfs_state *logfs, uint8_t arena_id)
+{
+	struct arena_header arena_hdr;
+	if (PIOS_FLASH_read_data(logfs->partition_id,
+					logfs_get_addr (logfs, arena_id, 0),
+					(uint8_t *)&arena_hdr,
+					sizeof (arena_hdr)) != 0) {
+		return false;
+	}
 
-	/* Source arena is the active arena */
-	uint8_t src_arena_id = logfs->active_arena_id;
+	/* Slots are only ever written to reserved arenas */
+	return (arena_hdr.state == ARENA_STATE_ERASED) &&
+		(arena_hdr.magic == logfs->cfg->fs_magic);
+}
+
+/*
+ * Is a collection in steps due?
+ * true = a quarter of the arena is left free and collecting would free at least as much
+ * false = the collection can wait, or would not help
+ */
+static bool logfs_gc_is_due(const struct logfs_state *logfs)
+{
+	uint16_t num_slots = (logfs->cfg->arena_size / logfs->cfg->slot_size) - 1;
+	uint16_t num_reclaimable_slots = num_slots - logfs->num_free_slots - logfs->num_active_slots;
+
+	return (logfs->num_free_slots <= num_slots / 4) &&
+		(num_reclaimable_slots >= num_slots / 4);
+}
+
+/**
+ * @brief Start collecting the garbage of the active arena into the next one
+ * @return 0 if success, < 0 on failure
+ * @note Must be called while holding the flash transaction lock
+ */
+static int32_t logfs_gc_start(struct logfs_state *logfs)
+{
+	PIOS_Assert (logfs->mounted);
 
 	/* Compute destination arena */
 	uint8_t dst_arena_id = (logfs->active_arena_id + 1) % (logfs->partition_size / logfs->cfg->arena_size);
 
-	/* Erase destination arena */
-	if (logfs_erase_arena (logfs, dst_arena_id) != 0) {
+	/* Erase destination arena, unless it was erased ahead of time */
+	if (!logfs_arena_is_erased (logfs, dst_arena_id) &&
+		logfs_erase_arena (logfs, dst_arena_id) != 0) {
 		return -1;
 	}
 
-	/* Reserve the destination arena so we can start filling it */
+	/*
+	 * Reserve the destination arena so we can start filling it.  A reserved
+	 * arena is never mounted, a reset during the collection leaves the
+	 * active arena in use.
+	 */
 	if (logfs_reserve_arena (logfs, dst_arena_id) != 0) {
 		/* Unable to reserve the arena */
 		return -2;
 	}
 
-	/* Copy active slots from active arena to destination arena */
-	uint16_t dst_slot_id = 1;
-	for (uint16_t src_slot_id = 1;
-	     src_slot_id < (logfs->cfg->arena_size / logfs->cfg->slot_size);
-	     src_slot_id++) {
+	logfs->gc_state       = LOGFS_GC_COPYING;
+	logfs->gc_arena_id    = dst_arena_id;
+	logfs->gc_src_slot_id = 1;
+	logfs->gc_dst_slot_id = 1;
+
+	return 0;
+}
+
+/**
+ * @brief Copy the active slots among the next max_slots slots of the active
+ * arena to the destination arena
+ * @return 1 if there are more slots to copy, 0 if all the written slots are copied, < 0 on failure
+ * @note Must be called while holding the flash transaction lock
+ */
+static int32_t logfs_gc_copy(struct logfs_state *logfs, uint16_t max_slots)
+{
+	PIOS_Assert (logfs->gc_state == LOGFS_GC_COPYING);
+
+	/* Slots appended meanwhile are copied too, up to the first free slot */
+	uint16_t end_slot_id = (logfs->cfg->arena_size / logfs->cfg->slot_size) - logfs->num_free_slots;
+
+	for (; max_slots > 0 && logfs->gc_src_slot_id < end_slot_id; max_slots--) {
 		struct slot_header slot_hdr;
-		uintptr_t src_addr = logfs_get_addr (logfs, src_arena_id, src_slot_id);
+		uintptr_t src_addr = logfs_get_addr (logfs, logfs->active_arena_id, logfs->gc_src_slot_id);
 		if (PIOS_FLASH_read_data(logfs->partition_id,
 						src_addr,
 						(uint8_t *)&slot_hdr,
 						sizeof (slot_hdr)) != 0) {
-			return -3;
+			return -1;
 		}
 
 		if (slot_hdr.state == SLOT_STATE_ACTIVE) {
-			uintptr_t dst_addr = logfs_get_addr (logfs, dst_arena_id, dst_slot_id);
+			uintptr_t dst_addr = logfs_get_addr (logfs, logfs->gc_arena_id, logfs->gc_dst_slot_id);
 			if (logfs_raw_copy_bytes(logfs,
 							src_addr,
 							sizeof(slot_hdr) + slot_hdr.obj_size,
 							dst_addr) != 0) {
 				/* Failed to copy all bytes */
-				return -4;
+				return -2;
 			}
-			dst_slot_id++;
+			logfs->gc_dst_slot_id++;
+		}
+		logfs->gc_src_slot_id++;
+	}
+
+	return (logfs->gc_src_slot_id < end_slot_id) ? 1 : 0;
+}
+
+/**
+ * @brief Obsolete the copy of a slot of the active arena made by the collection
+ * @return 0 if success or the slot was not copied yet, < 0 on failure
+ * @note Must be called while holding the flash transaction lock
+ */
+static int32_t logfs_gc_obsolete_copy(struct logfs_state *logfs, uint16_t src_slot_id, uint32_t obj_id, uint16_t obj_inst_id)
+{
+	if (logfs->gc_state != LOGFS_GC_COPYING || src_slot_id >= logfs->gc_src_slot_id) {
+		/* The slot was not copied, or not yet */
+		return 0;
+	}
+
+	for (uint16_t slot_id = 1; slot_id < logfs->gc_dst_slot_id; slot_id++) {
+		struct slot_header slot_hdr;
+		uintptr_t slot_addr = logfs_get_addr (logfs, logfs->gc_arena_id, slot_id);
+		if (PIOS_FLASH_read_data(logfs->partition_id,
+						slot_addr,
+						(uint8_t *)&slot_hdr,
+						sizeof (slot_hdr)) != 0) {
+			return -1;
+		}
+		if (slot_hdr.state == SLOT_STATE_ACTIVE &&
+			slot_hdr.obj_id      == obj_id &&
+			slot_hdr.obj_inst_id == obj_inst_id) {
+			slot_hdr.state = SLOT_STATE_OBSOLETE;
+			if (PIOS_FLASH_write_data(logfs->partition_id,
+							slot_addr,
+							(uint8_t *)&slot_hdr,
+							sizeof(slot_hdr)) != 0) {
+				return -2;
+			}
+			return 0;
 		}
 	}
 
-	/* Activate the destination arena */
+	return 0;
+}
+
+/**
+ * @brief Switch to the destination arena once every active slot is copied
+ * @return 0 if success, < 0 on failure
+ * @note Must be called while holding the flash transaction lock
+ */
+static int32_t logfs_gc_finish(struct logfs_state *logfs)
+{
+	PIOS_Assert (logfs->gc_state == LOGFS_GC_COPYING);
+
+	uint8_t src_arena_id = logfs->active_arena_id;
+	uint8_t dst_arena_id = logfs->gc_arena_id;
+
+	/* Whatever happens next, the destination arena must be collected again */
+	logfs->gc_state = LOGFS_GC_IDLE;
+
+	/*
+	 * Activate the destination arena.  Until the source arena is obsoleted,
+	 * both hold the same objects and either may be mounted after a reset.
+	 */
 	if (logfs_activate_arena (logfs, dst_arena_id) != 0) {
-		return -5;
+		return -1;
 	}
 
 	/* Unmount the source arena */
 	if (logfs_unmount_log (logfs) != 0) {
-		return -6;
+		return -2;
 	}
 
 	/* Obsolete the source arena */
 	if (logfs_obsolete_arena (logfs, src_arena_id) != 0) {
-		return -7;
+		return -3;
 	}
 
 	/* Mount the new arena */
 	if (logfs_mount_log (logfs, dst_arena_id) != 0) {
-		return -8;
+		return -4;
+	}
+
+	/* Erase the next destination arena in later steps */
+	logfs->gc_state        = LOGFS_GC_ERASING;
+	logfs->gc_erase_offset = 0;
+	return 0;
+}
+
+/**
+ * @brief Erase the next sector of the arena the next collection will copy
+ * to, so that the collection does not have to erase it
+ * @return 1 if there are more sectors to erase, 0 once the arena is erased, < 0 on failure
+ * @note Must be called while holding the flash transaction lock
+ */
+static int32_t logfs_gc_erase_step(struct logfs_state *logfs)
+{
+	PIOS_Assert (logfs->gc_state == LOGFS_GC_ERASING);
+
+	uint8_t next_arena_id = (logfs->active_arena_id + 1) % (logfs->partition_size / logfs->cfg->arena_size);
+	if (logfs->gc_erase_offset == 0 && logfs_arena_is_erased (logfs, next_arena_id)) {
+		logfs->gc_state = LOGFS_GC_IDLE;
+		return 0;
+	}
+
+	/*
+	 * The arena is marked erased once all its sectors are, a reset in
+	 * between leaves it to be erased again
+	 */
+	uintptr_t sector_addr = logfs_get_addr (logfs, next_arena_id, 0) + logfs->gc_erase_offset;
+	uint32_t sector_size;
+	if (PIOS_FLASH_get_sector_size(logfs->partition_id, sector_addr, &sector_size) != 0 ||
+		PIOS_FLASH_erase_range(logfs->partition_id, sector_addr, sector_size) != 0) {
+		logfs->gc_state = LOGFS_GC_IDLE;
+		return -1;
+	}
+
+	logfs->gc_erase_offset += sector_size;
+	if (logfs->gc_erase_offset < logfs->cfg->arena_size) {
+		return 1;
+	}
+
+	logfs->gc_state = LOGFS_GC_IDLE;
+	if (logfs_mark_arena_erased (logfs, next_arena_id) != 0) {
+		return -2;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Collect the garbage of the active arena at once, completing the
+ * collection in progress if there is one
+ * @return 0 if success, < 0 on failure
+ * @note Must be called while holding the flash transaction lock
+ */
+static int32_t logfs_garbage_collect (struct logfs_state *logfs) {
+	PIOS_Assert (logfs->mounted);
+
+	if (logfs->gc_state != LOGFS_GC_COPYING) {
+		if (logfs_gc_start (logfs) != 0) {
+			return -1;
+		}
+	}
+
+	int32_t rc;
+	do {
+		rc = logfs_gc_copy (logfs, logfs->cfg->arena_size / logfs->cfg->slot_size);
+	} while (rc > 0);
+
+	if (rc != 0) {
+		logfs->gc_state = LOGFS_GC_IDLE;
+		return -2;
+	}
+
+	if (logfs_gc_finish (logfs) != 0) {
+		return -3;
 	}
 
 	return 0;
@@ -695,6 +1038,34 @@ static int16_t logfs_object_find_next (const struct logfs_state *logfs, struct s
 	return -1;
 }
 
+/**
+ * @brief Find the active slot of an object instance, through the RAM index if
+ * there is one or by scanning the arena
+ * @return 0 if found, -1 if not found, -2 if failed to read the slot header
+ * @note Must be called while holding the flash transaction lock
+ */
+static int16_t logfs_object_find (const struct logfs_state *logfs, struct slot_header *slot_hdr, uint16_t *slot_id, uint32_t obj_id, uint16_t obj_inst_id)
+{
+	if (!logfs->index) {
+		*slot_id = 0;
+		return logfs_object_find_next (logfs, slot_hdr, slot_id, obj_id, obj_inst_id);
+	}
+
+	if (!logfs_index_find(logfs, obj_id, obj_inst_id, slot_id)) {
+		return -1;
+	}
+
+	uintptr_t slot_addr = logfs_get_addr (logfs, logfs->active_arena_id, *slot_id);
+	if (PIOS_FLASH_read_data(logfs->partition_id,
+					slot_addr,
+					(uint8_t *)slot_hdr,
+					sizeof (*slot_hdr)) != 0) {
+		return -2;
+	}
+
+	return 0;
+}
+
 /* NOTE: Must be called while holding the flash transaction lock */
 /* OPTIMIZE: could trust that there is at most one active version of every object and terminate the search when we find one */
 static int8_t logfs_delete_object (struct logfs_state *logfs, uint32_t obj_id, uint16_t obj_inst_id)
@@ -705,7 +1076,14 @@ static int8_t logfs_delete_object (struct logfs_state *logfs, uint32_t obj_id, u
 	uint16_t curr_slot_id = 0;
 	do {
 		struct slot_header slot_hdr;
-		switch (logfs_object_find_next (logfs, &slot_hdr, &curr_slot_id, obj_id, obj_inst_id)) {
+		int16_t found;
+		if (logfs->index) {
+			/* The index only holds the one active slot of the object */
+			found = logfs_object_find (logfs, &slot_hdr, &curr_slot_id, obj_id, obj_inst_id);
+		} else {
+			found = logfs_object_find_next (logfs, &slot_hdr, &curr_slot_id, obj_id, obj_inst_id);
+		}
+		switch (found) {
 		case 0:
 			/* Found a matching slot.  Obsolete it. */
 			slot_hdr.state = SLOT_STATE_OBSOLETE;
@@ -718,8 +1096,17 @@ static int8_t logfs_delete_object (struct logfs_state *logfs, uint32_t obj_id, u
 				rc = -2;
 				goto out_exit;
 			}
+			/* So must be its copy if the slot was already collected */
+			if (logfs_gc_obsolete_copy(logfs, curr_slot_id, obj_id, obj_inst_id) != 0) {
+				rc = -3;
+				goto out_exit;
+			}
+
 			/* Object has been successfully obsoleted and is no longer active */
 			logfs->num_active_slots--;
+			if (logfs->index) {
+				logfs_index_remove(logfs, obj_id, obj_inst_id);
+			}
 			break;
 		case -1:
 			/* Search completed, object not found */
@@ -832,6 +1219,10 @@ static int8_t logfs_append_to_log (struct logfs_state *logfs, uint32_t obj_id, u
 
 	/* Object has been successfully written to the slot */
 	logfs->num_active_slots++;
+	if (logfs->index) {
+		/* The previous versions were deleted before the append */
+		logfs_index_insert(logfs, obj_id, obj_inst_id, free_slot_id);
+	}
 	return 0;
 }
 
@@ -901,6 +1292,14 @@ int32_t PIOS_FLASHFS_ObjSave(uintptr_t fs_id, uint32_t obj_id, uint16_t obj_inst
 			rc = -5;
 			goto out_end_trans;
 		}
+		/*
+		 * The slots obsoleted while the collection was done in steps may
+		 * have filled the new arena, collect it once more
+		 */
+		if (logfs_log_is_full(logfs) && logfs_garbage_collect(logfs) != 0) {
+			rc = -5;
+			goto out_end_trans;
+		}
 		/* Check one more time just to be sure we actually free'd some space */
 		if (logfs_log_is_full(logfs)) {
 			/*
@@ -964,9 +1363,9 @@ int32_t PIOS_FLASHFS_ObjLoad(uintptr_t fs_id, uint32_t obj_id, uint16_t obj_inst
 	}
 
 	/* Find the object in the log */
-	uint16_t slot_id = 0;
+	uint16_t slot_id;
 	struct slot_header slot_hdr;
-	if (logfs_object_find_next (logfs, &slot_hdr, &slot_id, obj_id, obj_inst_id) != 0) {
+	if (logfs_object_find (logfs, &slot_hdr, &slot_id, obj_id, obj_inst_id) != 0) {
 		/* Object does not exist in fs */
 		rc = -3;
 		goto out_end_trans;
@@ -1043,6 +1442,82 @@ out_exit:
 	return rc;
 }
 
+/**
+ * @brief Run one bounded step of the garbage collection, so that the saves
+ * seldom have to collect the whole arena at once. A step copies a few slots
+ * or erases at most one sector.
+ * @param[in] fs_id The filesystem to use for this action
+ * @return 1 if there are more steps to run, 0 if there is nothing to collect, or error code
+ * @retval -1 if fs_id is not a valid filesystem instance
+ * @retval -2 if failed to start transaction
+ * @retval -3 if the step failed
+ * @note Meant to be called repeatedly from a low priority task, the
+ * filesystem can be used between the steps
+ */
+int32_t PIOS_FLASHFS_Collect(uintptr_t fs_id)
+{
+	int32_t rc;
+
+	struct logfs_state *logfs = (struct logfs_state *)fs_id;
+
+	if (!PIOS_FLASHFS_Logfs_validate(logfs)) {
+		rc = -1;
+		goto out_exit;
+	}
+
+	if (PIOS_FLASH_start_transaction(logfs->partition_id) != 0) {
+		rc = -2;
+		goto out_exit;
+	}
+
+	switch (logfs->gc_state) {
+	case LOGFS_GC_IDLE:
+		if (!logfs_gc_is_due(logfs)) {
+			rc = 0;
+			goto out_end_trans;
+		}
+		if (!logfs_arena_is_erased(logfs, (logfs->active_arena_id + 1) % (logfs->partition_size / logfs->cfg->arena_size))) {
+			/* Erase the destination arena a sector per step first */
+			logfs->gc_state        = LOGFS_GC_ERASING;
+			logfs->gc_erase_offset = 0;
+			break;
+		}
+		if (logfs_gc_start(logfs) != 0) {
+			rc = -3;
+			goto out_end_trans;
+		}
+		break;
+	case LOGFS_GC_COPYING:
+		if (logfs_gc_copy(logfs, 0) == 0) {
+			/* Every written slot is copied, switch arenas */
+			if (logfs_gc_finish(logfs) != 0) {
+				rc = -3;
+				goto out_end_trans;
+			}
+		} else if (logfs_gc_copy(logfs, LOGFS_GC_SLOTS_PER_STEP) < 0) {
+			logfs->gc_state = LOGFS_GC_IDLE;
+			rc = -3;
+			goto out_end_trans;
+		}
+		break;
+	case LOGFS_GC_ERASING:
+		if (logfs_gc_erase_step(logfs) < 0) {
+			rc = -3;
+			goto out_end_trans;
+		}
+		break;
+	}
+
+	/* A collection due once its destination arena is erased is a step away */
+	rc = (logfs->gc_state != LOGFS_GC_IDLE || logfs_gc_is_due(logfs)) ? 1 : 0;
+
+out_end_trans:
+	PIOS_FLASH_end_transaction(logfs->partition_id);
+
+out_exit:
+	return rc;
+}
+
 /**
  * @brief Erases all filesystem arenas and activate the first arena
  * @param[in] fs_id The filesystem to use for this action
@@ -1067,6 +1542,7 @@ int32_t PIOS_FLASHFS_Format(uintptr_t fs_id)
 	if (logfs->mounted) {
 		logfs_unmount_log(logfs);
 	}
+	logfs->gc_state = LOGFS_GC_IDLE;
 
 	if (PIOS_FLASH_start_transaction(logfs->partition_id) != 0) {
 		rc = -2;
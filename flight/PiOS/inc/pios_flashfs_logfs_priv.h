@@ -28,6 +28,7 @@
 #define PIOS_FLASHFS_LOGFS_PRIV_H_
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "pios_flash.h"		/* struct pios_flash_driver */
 
 /**
@@ -35,11 +36,13 @@
  *
  * Note: a filesystem requires room for at least 2 arenas within its partition.
  * Note: a filesystem requires room for at least 2 slots per arena.  The first slot is reserved.
+ * Note: the RAM index takes 8 bytes per slot of the arena.
  */
 struct flashfs_logfs_cfg {
 	uint32_t fs_magic;
 	uint32_t arena_size;	/* Max size of one generation of the filesystem */
 	uint32_t slot_size;	/* Max size of a "file" within the filesystem */
+	bool ram_index;		/* Find the objects through an index in RAM instead of scanning the arena */
 };
 
 int32_t PIOS_FLASHFS_Logfs_Init(uintptr_t * fs_id, const struct flashfs_logfs_cfg * cfg, enum pios_flash_partition_labels partition_label);
@@ -61,11 +61,9 @@ struct ObjectEventEntry {
 /*
   MetaInstance   == [UAVOBase [UAVObjMetadata]]
   SingleInstance == [UAVOBase [UAVOData [InstanceData]]]
-  MultiInstance  == [UAVOBase [UAVOData [NumInstances [InstanceData0 [next]]]]
-                                                  ____________________/
-                                                  \-->[InstanceData1 [next]]
-                                                  _________...________/
-                                                  \-->[InstanceDataN [next]]
+  MultiInstance  == [UAVOBase [UAVOData [NumInstances [Instances [InstanceData0]]]]
+                                                      __/
+                                                      \-->[&InstanceData1 ... &InstanceDataN]
  */
 
 /*
@@ -116,22 +114,18 @@ struct UAVOSingle {
 	 */
 } __attribute__((packed));
 
-/* Part of a linked list of instances chained off of a multi instance UAVO. */
-struct UAVOMultiInst {
-	struct UAVOMultiInst * next;
-	uint8_t                instance[];
-	/* 
-	 * Additional space will be malloc'd here to hold the
-	 * the data for this instance.
-	 */
-} __attribute__((packed));
-
 /* Augmented type for Multi Instance Data UAVO */
 struct UAVOMulti {
 	struct UAVOData        uavo;
 
 	uint16_t               num_instances;
-	struct UAVOMultiInst   instance0;
+	/*
+	 * Data of the instances after the first one, indexed by instance
+	 * id - 1, with room for max_instances - 1 of them.
+	 */
+	uint16_t               max_instances;
+	uint8_t             ** instances;
+	uint8_t                instance0[];
 	/*
 	 * Additional space will be malloc'd here to hold the
 	 * the data for instance 0.
@@ -148,7 +142,6 @@ struct UAVOMulti {
 
 /** all information about instances are dependant on object type **/
 #define ObjSingleInstanceDataOffset(obj) ((void*)(&(( (struct UAVOSingle*)obj )->instance0)))
-#define InstanceDataOffset(inst) ((void*)&(( (struct UAVOMultiInst*)inst )->instance))
 #define InstanceData(instance) (void*)instance
 
 // Private functions
@@ -161,8 +154,16 @@ static int32_t connectObj(UAVObjHandle obj_handle, struct pios_queue *queue,
 static int32_t disconnectObj(UAVObjHandle obj_handle, struct pios_queue *queue,
 			UAVObjEventCallback cb);
 
+/* Entries added at once to the index of the objects and of the instances */
+#define UAVO_INDEX_CHUNK 16
+#define INSTANCE_INDEX_CHUNK 4
+
 // Private variables
 static struct UAVOData * uavo_list;
+/* Registered objects sorted by id, for the lookups by id */
+static struct UAVOData ** uavo_index;
+static uint16_t uavo_index_count;
+static uint16_t uavo_index_size;
 static struct pios_recursive_mutex *mutex;
 static const UAVObjMetadata defMetadata = {
 	.flags = (ACCESS_READWRITE << UAVOBJ_ACCESS_SHIFT |
@@ -187,6 +188,9 @@ int32_t UAVObjInitialize()
 {
 	// Initialize variables
 	uavo_list = NULL;
+	uavo_index = NULL;
+	uavo_index_count = 0;
+	uavo_index_size = 0;
 
 	memset(&stats, 0, sizeof(UAVObjStats));
 
@@ -281,15 +285,66 @@ static struct UAVOData * UAVObjAllocMulti(uint32_t num_bytes)
 
 	/* Set up the type-specific part of the UAVO */
 	uavo_multi->num_instances = 1;
+	uavo_multi->max_instances = 1;
+	uavo_multi->instances = NULL;
 
 	/* Clear the instance data carried in the UAVO */
-	uavo_multi->instance0.next = NULL;
-	memset (&(uavo_multi->instance0.instance), 0, num_bytes);
+	memset (&(uavo_multi->instance0), 0, num_bytes);
 
 	/* Give back the generic UAVO part */
 	return (&(uavo_multi->uavo));
 }
 
+/**
+ * Position of the object with the given id in the index, or of the first
+ * object with a greater id if there is none
+ */
+static uint16_t UAVObjIndexFind(uint32_t id)
+{
+	uint16_t low = 0;
+	uint16_t high = uavo_index_count;
+
+	while (low < high) {
+		uint16_t mid = low + (high - low) / 2;
+		if (uavo_index[mid]->id < id)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return low;
+}
+
+/**
+ * Insert a newly registered object in the index, growing it if needed
+ * \return 0 Success
+ * \return -1 Failure
+ */
+static int32_t UAVObjIndexInsert(struct UAVOData * uavo_data)
+{
+	if (uavo_index_count == uavo_index_size) {
+		struct UAVOData ** new_index = (struct UAVOData **)
+			PIOS_malloc_no_dma((uavo_index_size + UAVO_INDEX_CHUNK) * sizeof(*new_index));
+		if (!new_index)
+			return -1;
+
+		if (uavo_index) {
+			memcpy(new_index, uavo_index, uavo_index_count * sizeof(*new_index));
+			PIOS_free(uavo_index);
+		}
+		uavo_index = new_index;
+		uavo_index_size += UAVO_INDEX_CHUNK;
+	}
+
+	uint16_t pos = UAVObjIndexFind(uavo_data->id);
+	memmove(&uavo_index[pos + 1], &uavo_index[pos],
+		(uavo_index_count - pos) * sizeof(*uavo_index));
+	uavo_index[pos] = uavo_data;
+	uavo_index_count++;
+
+	return 0;
+}
+
 /**************************
  * UAVObject Database APIs
  *************************/
@@ -330,6 +385,13 @@ UAVObjHandle UAVObjRegister(uint32_t id,
 	/* Fill in the details about this UAVO */
 	uavo_data->id            = id;
 	uavo_data->instance_size = num_bytes;
+
+	/* Index the object by id */
+	if (UAVObjIndexInsert(uavo_data) != 0) {
+		PIOS_free(uavo_data);
+		uavo_data = NULL;
+		goto unlock_exit;
+	}
 	if (isSettings) {
 		uavo_data->base.flags.isSettings = true;
 	}
@@ -372,17 +434,18 @@ UAVObjHandle UAVObjGetByID(uint32_t id)
 	// Get lock
 	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
 
-	// Look for object
-	struct UAVOData * tmp_obj;
-	LL_FOREACH(uavo_list, tmp_obj) {
-		if (tmp_obj->id == id) {
-			found_obj = (UAVObjHandle *)tmp_obj;
-			goto unlock_exit;
-		}
-		if (MetaObjectId(tmp_obj->id) == id) {
-			found_obj = (UAVObjHandle *)&(tmp_obj->metaObj);
-			goto unlock_exit;
-		}
+	// Look for a data object, then for the data object of a meta object
+	uint16_t pos = UAVObjIndexFind(id);
+	if (pos < uavo_index_count && uavo_index[pos]->id == id) {
+		found_obj = (UAVObjHandle *)uavo_index[pos];
+		goto unlock_exit;
+	}
+	if (pos > 0 && MetaObjectId(uavo_index[pos - 1]->id) == id) {
+		// Offset from the object rather than taking the address of the
+		// packed member, the meta object is only accessed through its handle
+		found_obj = (UAVObjHandle *)((uint8_t *)uavo_index[pos - 1] +
+				offsetof(struct UAVOData, metaObj));
+		goto unlock_exit;
 	}
 
 unlock_exit:
@@ -1679,7 +1742,8 @@ static int32_t sendEvent(struct UAVOBase * obj, uint16_t instId,
  */
 static InstanceHandle createInstance(struct UAVOData * obj, uint16_t instId)
 {
-	struct UAVOMultiInst *instEntry;
+	struct UAVOMulti * uavo_multi = (struct UAVOMulti *) obj;
+	uint8_t * instEntry;
 
 	/* Don't allow more than one instance for single instance objects */
 	if (UAVObjIsSingleInstance(&(obj->base))) {
@@ -1704,14 +1768,31 @@ static InstanceHandle createInstance(struct UAVOData * obj, uint16_t instId)
 		}
 	}
 
+	/* Make room in the index of the instances */
+	if (uavo_multi->num_instances == uavo_multi->max_instances) {
+		uint16_t max_instances = uavo_multi->max_instances + INSTANCE_INDEX_CHUNK;
+		uint8_t ** instances = (uint8_t **)
+			PIOS_malloc_no_dma((max_instances - 1) * sizeof(*instances));
+		if (!instances)
+			return NULL;
+
+		if (uavo_multi->instances) {
+			memcpy(instances, uavo_multi->instances,
+				(uavo_multi->num_instances - 1) * sizeof(*instances));
+			PIOS_free(uavo_multi->instances);
+		}
+		uavo_multi->instances = instances;
+		uavo_multi->max_instances = max_instances;
+	}
+
 	/* Create the actual instance */
-	instEntry = (struct UAVOMultiInst *) PIOS_malloc_no_dma(sizeof(struct UAVOMultiInst)+obj->instance_size);
+	instEntry = (uint8_t *) PIOS_malloc_no_dma(obj->instance_size);
 	if (!instEntry)
 		return NULL;
-	memset(InstanceDataOffset(instEntry), 0, obj->instance_size);
-	LL_APPEND(( (struct UAVOMulti*)obj )->instance0.next, instEntry);
+	memset(instEntry, 0, obj->instance_size);
+	uavo_multi->instances[instId - 1] = instEntry;
 
-	( (struct UAVOMulti*)obj )->num_instances++;
+	uavo_multi->num_instances++;
 
 	// Fire event
 	UAVObjInstanceUpdated((UAVObjHandle) obj, instId);
@@ -1720,7 +1801,7 @@ static InstanceHandle createInstance(struct UAVOData * obj, uint16_t instId)
 	if (newUavObjInstanceCB) {
 		newUavObjInstanceCB(obj->id, UAVObjGetNumInstances(obj));
 	}
-	return InstanceDataOffset(instEntry);
+	return instEntry;
 }
 
 /**
@@ -1754,17 +1835,9 @@ static InstanceHandle getInstance(struct UAVOData * obj, uint16_t instId)
 		if (instId >= uavo_multi->num_instances)
 			return NULL;
 
-		// Look for specified instance ID
-		uint16_t instance = 0;
-		struct UAVOMultiInst *instEntry;
-		LL_FOREACH(&(uavo_multi->instance0), instEntry) {
-			if (instance++ == instId) {
-				/* Found it */
-				return &(instEntry->instance);
-			}
-		}
-		/* Instance was not found */
-		return NULL;
+		if (instId == 0)
+			return (&(uavo_multi->instance0));
+		return (uavo_multi->instances[instId - 1]);
 	}
 }
 
@@ -1867,15 +1940,10 @@ int32_t getEventMask(UAVObjHandle obj_handle, struct pios_queue *queue)
  */
 uint8_t UAVObjCount()
 {
-	uint8_t count = 0;
 	// Get lock
 	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
 
-	// Look for object
-	struct UAVOData * tmp_obj;
-	LL_FOREACH(uavo_list, tmp_obj) {
-		++count;
-	}
+	uint8_t count = uavo_index_count;
 
 	// Release lock
 	PIOS_Recursive_Mutex_Unlock(mutex);
@@ -1883,7 +1951,9 @@ uint8_t UAVObjCount()
 }
 
 /**
- * UAVObjIDByIndex returns the ID of the object with index index
+ * UAVObjIDByIndex returns the ID of the object with index index, the objects
+ * being enumerated in registration order so that registering an object does
+ * not move the others
  * \return the ID of the object
  */
 uint32_t UAVObjIDByIndex(uint8_t index)
@@ -521,6 +521,7 @@ static const struct flashfs_logfs_cfg flashfs_settings_cfg = {
 	.fs_magic      = 0x99abcedf,
 	.arena_size    = 0x00010000, /* 256 * slot size */
 	.slot_size     = 0x00000100, /* 256 bytes */
+	.ram_index     = true, /* 2K bytes of RAM */
 };
 
 static const struct flashfs_logfs_cfg flashfs_waypoints_cfg = {
@@ -0,0 +1,5 @@
+/* Only the CRC functions are used by the compact log encoding */
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <pios_crc.h>
@@ -0,0 +1,650 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test of the compact log encoding, and of its size against
+ * UAVTalk frames for the sensors of a simulated flight
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdlib.h>		/* abort */
+#include <string.h>		/* memset */
+#include <stdint.h>		/* uint*_t */
+#include <math.h>		/* sinf */
+
+#include <map>
+#include <vector>
+
+extern "C" {
+
+#include "logcompact.h"
+
+}
+
+// The log written by the encoder through log_write()
+static std::vector<uint8_t> log_data;
+static bool write_fails;
+
+static int32_t log_write(uint8_t *data, int32_t length)
+{
+  if (write_fails)
+    return -1;
+  log_data.insert(log_data.end(), data, data + length);
+  return length;
+}
+
+struct Update {
+  uint32_t obj_id;
+  uint16_t inst_id;
+  uint32_t time;
+  std::vector<uint8_t> data;
+};
+
+static bool get_varint(const std::vector<uint8_t> &log, size_t *pos, size_t end, uint32_t *val)
+{
+  *val = 0;
+  for (int shift = 0; shift < 35 && *pos < end; shift += 7) {
+    uint8_t byte = log[(*pos)++];
+    *val |= (uint32_t) (byte & 0x7F) << shift;
+    if (!(byte & 0x80))
+      return true;
+  }
+  return false;
+}
+
+static uint8_t crc8(const uint8_t *data, size_t length)
+{
+  uint8_t crc = 0;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++)
+      crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+  }
+  return crc;
+}
+
+struct Object {
+  uint32_t obj_id;
+  std::vector<uint8_t> data;
+};
+
+// Length of the record starting at the sync byte at pos, without its CRC,
+// or 0 if it is not a record of a known object
+static size_t record_length(const std::vector<uint8_t> &log, size_t pos, const std::map<uint8_t, Object> &objects)
+{
+  size_t end = log.size() - 1;
+  size_t p = pos + 1;
+  if (p >= end)
+    return 0;
+  uint8_t tag = log[p++];
+  if (tag == LOGCOMPACT_TAG_END)
+    return 2;
+  if (tag == LOGCOMPACT_TAG_DEFINE)
+    return p + 8 <= end ? 10 : 0;
+
+  std::map<uint8_t, Object>::const_iterator object = objects.find(tag & LOGCOMPACT_TAG_INDEX);
+  uint32_t val;
+  if (object == objects.end() || !get_varint(log, &p, end, &val))
+    return 0;
+  if ((tag & LOGCOMPACT_TAG_INSTANCE) && !get_varint(log, &p, end, &val))
+    return 0;
+
+  size_t length = object->second.data.size();
+  size_t mask = p;
+  p += (length + 7) / 8;
+  if (p > end)
+    return 0;
+  for (size_t i = 0; i < length; i++) {
+    if (log[mask + i / 8] & (1 << (i % 8)))
+      p++;
+  }
+  return p <= end ? p - pos : 0;
+}
+
+// Decodes a log as the GCS does, skipping the damaged records and the
+// updates of the instances until their next keyframe. Returns false if the
+// header is wrong, sets skipped to the number of bytes skipped before the
+// end of the log
+static bool decode(const std::vector<uint8_t> &log, std::vector<Update> *updates, size_t *skipped = NULL)
+{
+  if (log.size() < 5 || memcmp(&log[0], LOGCOMPACT_MAGIC, 4) != 0 || log[4] != LOGCOMPACT_VERSION)
+    return false;
+
+  std::map<uint8_t, Object> objects;
+  std::map<std::pair<uint8_t, uint16_t>, std::vector<uint8_t> > instances;
+  uint32_t time = 0;
+  size_t pos = 5;
+  size_t gap = 0;
+  if (skipped)
+    *skipped = 0;
+
+  while (pos < log.size()) {
+    size_t length = log[pos] == LOGCOMPACT_SYNC ? record_length(log, pos, objects) : 0;
+    if (length == 0 || crc8(&log[pos + 1], length - 1) != log[pos + length]) {
+      pos++;
+      gap++;
+      continue;
+    }
+
+    // Records may be missing, the instances are known again at their keyframes
+    if (gap > 0) {
+      instances.clear();
+      if (skipped)
+        *skipped += gap;
+      gap = 0;
+    }
+
+    size_t p = pos + 1;
+    pos += length + 1;
+    uint8_t tag = log[p++];
+    if (tag == LOGCOMPACT_TAG_END)
+      break;
+    if (tag == LOGCOMPACT_TAG_DEFINE) {
+      Object &object = objects[log[p]];
+      uint32_t obj_id = log[p + 1] | log[p + 2] << 8 | log[p + 3] << 16 | (uint32_t) log[p + 4] << 24;
+      size_t length = log[p + 5] | log[p + 6] << 8;
+      if (obj_id != object.obj_id || length != object.data.size()) {
+        // The index is given to another object, drop its instances
+        for (std::map<std::pair<uint8_t, uint16_t>, std::vector<uint8_t> >::iterator i = instances.begin(); i != instances.end(); ) {
+          if (i->first.first == log[p])
+            instances.erase(i++);
+          else
+            ++i;
+        }
+      }
+      object.obj_id = obj_id;
+      object.data.resize(length);
+      continue;
+    }
+
+    Object &object = objects[tag & LOGCOMPACT_TAG_INDEX];
+    Update update;
+    update.obj_id = object.obj_id;
+    uint32_t val;
+    get_varint(log, &p, pos, &val);
+    time = (tag & LOGCOMPACT_TAG_KEYFRAME) ? val : time + val;
+    update.time = time;
+    update.inst_id = 0;
+    if (tag & LOGCOMPACT_TAG_INSTANCE) {
+      get_varint(log, &p, pos, &val);
+      update.inst_id = val;
+    }
+
+    std::pair<uint8_t, uint16_t> key(tag & LOGCOMPACT_TAG_INDEX, update.inst_id);
+    bool known = instances.count(key) > 0;
+    std::vector<uint8_t> &data = instances[key];
+    if (!known || (tag & LOGCOMPACT_TAG_KEYFRAME))
+      data.assign(object.data.size(), 0);
+
+    size_t mask = p;
+    p += (data.size() + 7) / 8;
+    for (size_t i = 0; i < data.size(); i++) {
+      if (log[mask + i / 8] & (1 << (i % 8)))
+        data[i] ^= log[p++];
+    }
+
+    if (!known && !(tag & LOGCOMPACT_TAG_KEYFRAME)) {
+      instances.erase(key);
+      continue;
+    }
+    update.data = data;
+    updates->push_back(update);
+  }
+  return true;
+}
+
+// To use a test fixture, derive a class from testing::Test.
+class LogCompact : public testing::Test {
+protected:
+  virtual void SetUp() {
+    srand(1);
+    log_data.clear();
+    write_fails = false;
+    ASSERT_EQ(0, logcompact_start(&log, log_write));
+  }
+
+  virtual void TearDown() {
+  }
+
+  struct logcompact log;
+};
+
+TEST_F(LogCompact, WritesTheHeader) {
+  ASSERT_EQ(5U, log_data.size());
+  EXPECT_EQ(0, memcmp(&log_data[0], "TLCL", 4));
+  EXPECT_EQ(LOGCOMPACT_VERSION, log_data[4]);
+}
+
+TEST_F(LogCompact, DefinesTheObjects) {
+  uint8_t data[16] = { 1, 2, 3 };
+
+  // A definition, then a keyframe
+  EXPECT_EQ(0, logcompact_update(&log, 0x12345678, 0, true, 100, data, sizeof(data)));
+  ASSERT_EQ(5U + 11 + 9, log_data.size());
+  EXPECT_EQ(LOGCOMPACT_SYNC, log_data[5]);
+  EXPECT_EQ(LOGCOMPACT_TAG_DEFINE, log_data[6]);
+  EXPECT_EQ(1, log_data[7]);
+  EXPECT_EQ(0x78, log_data[8]);
+  EXPECT_EQ(0x12, log_data[11]);
+  EXPECT_EQ(16, log_data[12]);
+  EXPECT_EQ(LOGCOMPACT_FLAG_SINGLE_INSTANCE, log_data[14]);
+  EXPECT_EQ(crc8(&log_data[6], 9), log_data[15]);
+  EXPECT_EQ(LOGCOMPACT_SYNC, log_data[16]);
+  EXPECT_EQ(1 | LOGCOMPACT_TAG_KEYFRAME, log_data[17]);
+  EXPECT_EQ(100, log_data[18]);
+
+  // The same data again is only a tag, a time and the empty mask
+  log_data.clear();
+  EXPECT_EQ(0, logcompact_update(&log, 0x12345678, 0, true, 102, data, sizeof(data)));
+  ASSERT_EQ(6U, log_data.size());
+  EXPECT_EQ(LOGCOMPACT_SYNC, log_data[0]);
+  EXPECT_EQ(1, log_data[1]);
+  EXPECT_EQ(2, log_data[2]);
+  EXPECT_EQ(0, log_data[3]);
+  EXPECT_EQ(0, log_data[4]);
+  EXPECT_EQ(crc8(&log_data[1], 4), log_data[5]);
+}
+
+TEST_F(LogCompact, StoresTheChangedBytes) {
+  uint8_t data[12] = { 0 };
+  EXPECT_EQ(0, logcompact_update(&log, 10, 0, true, 1000, data, sizeof(data)));
+
+  log_data.clear();
+  data[1] = 0x0F;
+  data[9] = 0xF0;
+  EXPECT_EQ(0, logcompact_update(&log, 10, 0, true, 1000, data, sizeof(data)));
+  ASSERT_EQ(8U, log_data.size());
+  EXPECT_EQ(0x02, log_data[3]);
+  EXPECT_EQ(0x02, log_data[4]);
+  EXPECT_EQ(0x0F, log_data[5]);
+  EXPECT_EQ(0xF0, log_data[6]);
+}
+
+TEST_F(LogCompact, KeepsThePreviousDataOfEachInstance) {
+  uint8_t data[2][8] = { { 1, 2, 3, 4, 5, 6, 7, 8 }, { 8, 7, 6, 5, 4, 3, 2, 1 } };
+
+  for (int i = 0; i < 2; i++)
+    EXPECT_EQ(0, logcompact_update(&log, 10, i + 1, false, 1000, data[i], sizeof(data[i])));
+
+  // Each instance is unchanged since its own previous update
+  for (int i = 0; i < 10; i++) {
+    log_data.clear();
+    EXPECT_EQ(0, logcompact_update(&log, 10, i % 2 + 1, false, 1000, data[i % 2], sizeof(data[i % 2])));
+    ASSERT_EQ(6U, log_data.size());
+    EXPECT_EQ(1 | LOGCOMPACT_TAG_INSTANCE, log_data[1]);
+    EXPECT_EQ(i % 2 + 1, log_data[3]);
+    EXPECT_EQ(0, log_data[4]);
+  }
+}
+
+TEST_F(LogCompact, RepeatsDefinitionsAndKeyframes) {
+  uint8_t data[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+  int defines = 0, keyframes = 0;
+
+  for (int i = 0; i < 10 * LOGCOMPACT_KEYFRAME_INTERVAL; i++) {
+    log_data.clear();
+    EXPECT_EQ(0, logcompact_update(&log, 10, 0, true, 1000 + i, data, sizeof(data)));
+    size_t pos = 0;
+    if (log_data[1] == LOGCOMPACT_TAG_DEFINE) {
+      defines++;
+      pos += 11;
+    }
+    ASSERT_EQ(LOGCOMPACT_SYNC, log_data[pos]);
+    if (log_data[pos + 1] & LOGCOMPACT_TAG_KEYFRAME) {
+      keyframes++;
+      // The time since boot and all the non zero bytes
+      ASSERT_EQ(pos + 1 + 1 + 2 + 1 + sizeof(data) + 1, log_data.size());
+    }
+  }
+  EXPECT_EQ(10, defines);
+  EXPECT_EQ(10, keyframes);
+}
+
+// A log of the updates of a few objects, one of them with instances
+static void write_updates(struct logcompact *log, int count, std::vector<Update> *written, std::vector<size_t> *offsets)
+{
+  uint32_t now = 1000;
+  for (int i = 0; i < count; i++) {
+    Update update;
+    update.obj_id = 100 + 2 * (rand() % 6);
+    update.inst_id = update.obj_id == 100 ? rand() % 4 : 0;
+    // Mostly small steps, with long gaps now and then
+    now += rand() % 100 == 0 ? rand() : rand() % 5;
+    update.time = now;
+    update.data.resize(update.obj_id - 96);
+    for (size_t j = 0; j < update.data.size(); j++)
+      update.data[j] = rand() % 4 == 0 ? rand() : j;
+
+    if (offsets)
+      offsets->push_back(log_data.size());
+    EXPECT_EQ(0, logcompact_update(log, update.obj_id, update.inst_id, update.obj_id != 100,
+        update.time, &update.data[0], update.data.size()));
+    written->push_back(update);
+  }
+}
+
+static bool operator==(const Update &a, const Update &b)
+{
+  return a.obj_id == b.obj_id && a.inst_id == b.inst_id && a.time == b.time && a.data == b.data;
+}
+
+TEST_F(LogCompact, RoundTrips) {
+  std::vector<Update> written;
+  write_updates(&log, 2000, &written, NULL);
+
+  // The stale bytes after the end are not decoded
+  EXPECT_EQ(0, logcompact_end(&log));
+  for (int i = 0; i < 100; i++)
+    log_data.push_back(i % 2 ? LOGCOMPACT_SYNC : rand());
+
+  std::vector<Update> read;
+  size_t skipped;
+  ASSERT_TRUE(decode(log_data, &read, &skipped));
+  EXPECT_EQ(0U, skipped);
+  ASSERT_EQ(written.size(), read.size());
+  for (size_t i = 0; i < written.size(); i++)
+    EXPECT_TRUE(written[i] == read[i]);
+}
+
+TEST_F(LogCompact, RecoversFromDamagedRecords) {
+  std::vector<Update> written;
+  std::vector<size_t> offsets;
+  write_updates(&log, 6000, &written, &offsets);
+
+  // Damage a few places, as much as a flash page
+  const size_t damaged[] = { log_data.size() / 4, log_data.size() / 2, 3 * log_data.size() / 4 };
+  const size_t damage_length = 256;
+  for (size_t i = 0; i < sizeof(damaged) / sizeof(damaged[0]); i++) {
+    for (size_t j = 0; j < damage_length; j++)
+      log_data[damaged[i] + j] = rand();
+  }
+
+  std::vector<Update> read;
+  size_t skipped;
+  ASSERT_TRUE(decode(log_data, &read, &skipped));
+  EXPECT_GE(skipped, 3 * damage_length);
+
+  // What is decoded was written, in the same order
+  size_t next = 0;
+  for (size_t i = 0; i < read.size(); i++) {
+    while (next < written.size() && !(written[next] == read[i]))
+      next++;
+    ASSERT_LT(next, written.size());
+  }
+
+  // Only the updates of the damaged records and of their instances until
+  // the next keyframes are lost. A definition may be lost too, then the
+  // instances are known again at a keyframe after the next definition.
+  typedef std::pair<uint32_t, uint16_t> Key;
+  std::map<Key, int> recovering;
+  std::map<Key, bool> seen;
+  size_t expected = 0;
+  next = 0;
+  for (size_t i = 0; i < written.size(); i++) {
+    Key key(written[i].obj_id, written[i].inst_id);
+    size_t end = i + 1 < offsets.size() ? offsets[i + 1] : log_data.size();
+    bool lost = false;
+    for (size_t j = 0; j < sizeof(damaged) / sizeof(damaged[0]); j++) {
+      if (end > damaged[j] && offsets[i] < damaged[j] + damage_length)
+        lost = true;
+    }
+    seen[key] = true;
+    if (lost) {
+      for (std::map<Key, bool>::iterator k = seen.begin(); k != seen.end(); ++k)
+        recovering[k->first] = 0;
+      continue;
+    }
+    if (recovering.count(key)) {
+      if (++recovering[key] <= 2 * LOGCOMPACT_KEYFRAME_INTERVAL)
+        continue;
+      recovering.erase(key);
+    }
+
+    expected++;
+    while (next < read.size() && !(read[next] == written[i]))
+      next++;
+    ASSERT_LT(next, read.size()) << "update " << i << " lost";
+  }
+  EXPECT_GE(read.size(), expected);
+  EXPECT_GT(expected, written.size() / 2);
+}
+
+TEST_F(LogCompact, DropsWhatDoesNotFit) {
+  uint8_t data[LOGCOMPACT_MAX_LENGTH + 1] = { 0 };
+
+  EXPECT_EQ(-1, logcompact_update(&log, 10, 0, true, 1000, data, sizeof(data)));
+  EXPECT_EQ(0, logcompact_update(&log, 10, 0, true, 1000, data, 8));
+  EXPECT_EQ(-1, logcompact_update(&log, 10, 0, true, 1000, data, 9));
+
+  // Out of objects, then out of space for their data
+  for (int i = 1; i < LOGCOMPACT_MAX_OBJECTS; i++)
+    EXPECT_EQ(0, logcompact_update(&log, 10 + 2 * i, 0, true, 1000, data, 8));
+  EXPECT_EQ(-1, logcompact_update(&log, 100, 0, true, 1000, data, 8));
+  EXPECT_EQ(3U, log.dropped);
+
+  log_data.clear();
+  ASSERT_EQ(0, logcompact_start(&log, log_write));
+  for (int i = 0; i < LOGCOMPACT_DATA_SIZE / LOGCOMPACT_MAX_LENGTH; i++)
+    EXPECT_EQ(0, logcompact_update(&log, 10 + 2 * i, 0, true, 1000, data, LOGCOMPACT_MAX_LENGTH));
+  EXPECT_EQ(-1, logcompact_update(&log, 100, 0, true, 1000, data, 1));
+
+  // Out of instances
+  ASSERT_EQ(0, logcompact_start(&log, log_write));
+  for (int i = 0; i < LOGCOMPACT_MAX_INSTANCES; i++)
+    EXPECT_EQ(0, logcompact_update(&log, 10, i, false, 1000, data, 1));
+  EXPECT_EQ(-1, logcompact_update(&log, 10, LOGCOMPACT_MAX_INSTANCES, false, 1000, data, 1));
+  EXPECT_EQ(1U, log.dropped);
+}
+
+TEST_F(LogCompact, ReportsFailedWrites) {
+  uint8_t data[8] = { 0 };
+
+  write_fails = true;
+  EXPECT_EQ(-1, logcompact_start(&log, log_write));
+  EXPECT_EQ(-1, logcompact_update(&log, 10, 0, true, 1000, data, sizeof(data)));
+}
+
+// The sensors of a simulated flight, as the simulated Sensors module
+// produces them
+static float rand_gauss()
+{
+  float v1, v2, s;
+  do {
+    v1 = 2 * (rand() / (float) RAND_MAX) - 1;
+    v2 = 2 * (rand() / (float) RAND_MAX) - 1;
+    s = v1 * v1 + v2 * v2;
+  } while (s >= 1 || s == 0);
+  return v1 * sqrtf(-2 * logf(s) / s);
+}
+
+struct Sensor {
+  const char *name;
+  uint32_t obj_id;
+  uint32_t period_ms;
+  uint16_t length;
+};
+
+enum { GYROS, ACCELS, ATTITUDE, MAG, BARO, GPS, GPSTIME, NUM_SENSORS };
+
+static const Sensor sensors[NUM_SENSORS] = {
+  { "Gyros", 0x10, 2, 16 },
+  { "Accels", 0x12, 2, 16 },
+  { "AttitudeActual", 0x14, 2, 28 },
+  { "Magnetometer", 0x16, 13, 12 },
+  { "BaroAltitude", 0x18, 25, 12 },
+  { "GPSPosition", 0x1A, 200, 38 },
+  { "GPSTime", 0x1C, 1000, 7 },
+};
+
+#define FLIGHT_MS 60000
+
+static void sample(int sensor, uint32_t t, uint8_t *data)
+{
+  float s = t / 1000.0f;
+  float roll = 10 * sinf(0.5f * s), pitch = 5 * sinf(0.3f * s), yaw = fmodf(20 * s, 360);
+  float f[7] = { 0 };
+
+  switch (sensor) {
+  case GYROS:
+    f[0] = 5 * cosf(0.5f * s) + rand_gauss();
+    f[1] = 1.5f * cosf(0.3f * s) + rand_gauss();
+    f[2] = 20 + rand_gauss();
+    f[3] = 30;
+    break;
+  case ACCELS:
+    f[0] = 9.81f * sinf(pitch * M_PI / 180) + 0.05f;
+    f[1] = -9.81f * sinf(roll * M_PI / 180) - 0.02f;
+    f[2] = -9.81f * cosf(roll * M_PI / 180) * cosf(pitch * M_PI / 180) + 0.08f;
+    f[3] = 30;
+    break;
+  case ATTITUDE:
+    f[0] = cosf(yaw * M_PI / 360);
+    f[1] = roll / 114.6f;
+    f[2] = pitch / 114.6f;
+    f[3] = sinf(yaw * M_PI / 360);
+    f[4] = roll;
+    f[5] = pitch;
+    f[6] = yaw;
+    break;
+  case MAG:
+    f[0] = 400 * cosf(yaw * M_PI / 180);
+    f[1] = -400 * sinf(yaw * M_PI / 180);
+    f[2] = 800;
+    break;
+  case BARO:
+    f[0] = 10 + rand_gauss() / 10;
+    f[1] = 25;
+    f[2] = 101.2f - f[0] / 83;
+    break;
+  case GPS: {
+    int32_t lat = 473977420 + (int32_t) (30 * sinf(0.1f * s)), lon = 85455940 + (int32_t) (30 * cosf(0.1f * s));
+    data[0] = 3;
+    memcpy(&data[1], &lat, 4);
+    memcpy(&data[5], &lon, 4);
+    f[0] = 10 + rand_gauss();
+    f[1] = 48;
+    f[2] = fmodf(5.7f * s + 90, 360);
+    f[3] = 3 + rand_gauss() / 10;
+    memcpy(&data[9], f, 16);
+    data[25] = 9;
+    f[0] = 1.8f;
+    f[1] = 1.1f;
+    f[2] = 1.4f;
+    memcpy(&data[26], f, 12);
+    return;
+  }
+  case GPSTIME:
+    data[0] = 6;
+    data[1] = 21;
+    data[2] = 2015 & 0xFF;
+    data[3] = 2015 >> 8;
+    data[4] = 12;
+    data[5] = t / 60000;
+    data[6] = t / 1000 % 60;
+    return;
+  }
+  memcpy(data, f, sensors[sensor].length);
+}
+
+// Size of a single instance update as a timestamped UAVTalk frame: header,
+// timestamp, data and checksum
+#define UAVTALK_BYTES(length) (8 + 2 + (length) + 1)
+
+static void fly(struct logcompact *log, const uint32_t max_rate_hz[NUM_SENSORS])
+{
+  uint32_t uavtalk[NUM_SENSORS] = { 0 };
+  uint32_t compact[NUM_SENSORS] = { 0 };
+  uint32_t total_uavtalk = 0;
+  std::vector<Update> written;
+
+  for (uint32_t t = 1; t <= FLIGHT_MS; t++) {
+    for (int i = 0; i < NUM_SENSORS; i++) {
+      uint32_t period = sensors[i].period_ms;
+      if (max_rate_hz[i] > 0 && 1000 / max_rate_hz[i] > period)
+        period = 1000 / max_rate_hz[i];
+      if (t % period != 0)
+        continue;
+
+      Update update;
+      update.obj_id = sensors[i].obj_id;
+      update.inst_id = 0;
+      update.time = t;
+      update.data.resize(sensors[i].length);
+      sample(i, t, &update.data[0]);
+
+      size_t before = log_data.size();
+      ASSERT_EQ(0, logcompact_update(log, update.obj_id, 0, true, t, &update.data[0], update.data.size()));
+      compact[i] += log_data.size() - before;
+      uavtalk[i] += UAVTALK_BYTES(sensors[i].length);
+      total_uavtalk += UAVTALK_BYTES(sensors[i].length);
+      written.push_back(update);
+    }
+  }
+
+  for (int i = 0; i < NUM_SENSORS; i++) {
+    printf("  %-16s %6d bytes as UAVTalk, %6d bytes compact, %4.2f times smaller\n",
+        sensors[i].name, uavtalk[i], compact[i], (double) uavtalk[i] / compact[i]);
+  }
+  printf("  %-16s %6d bytes as UAVTalk, %6d bytes compact, %4.2f times smaller\n",
+      "All", total_uavtalk, (uint32_t) log_data.size(), (double) total_uavtalk / log_data.size());
+
+  // Nothing is lost
+  std::vector<Update> read;
+  ASSERT_TRUE(decode(log_data, &read));
+  ASSERT_EQ(written.size(), read.size());
+  for (size_t i = 0; i < written.size(); i++) {
+    ASSERT_EQ(written[i].obj_id, read[i].obj_id);
+    ASSERT_EQ(written[i].time, read[i].time);
+    ASSERT_TRUE(written[i].data == read[i].data);
+  }
+
+  // The noise of the sensors is in the low bytes of their floats, which
+  // change at every update
+  EXPECT_GT(2 * total_uavtalk, 3 * log_data.size());
+}
+
+TEST_F(LogCompact, SimulatedFlightAtTheDefaultRates) {
+  const uint32_t rates[NUM_SENSORS] = { 50, 50, 50, 50, 5, 5, 1 };
+
+  log_data.clear();
+  ASSERT_EQ(0, logcompact_start(&log, log_write));
+  printf("Sensors at the default rates:\n");
+  fly(&log, rates);
+}
+
+TEST_F(LogCompact, SimulatedFlightAtEveryUpdate) {
+  const uint32_t rates[NUM_SENSORS] = { 0, 0, 0, 0, 0, 0, 0 };
+
+  log_data.clear();
+  ASSERT_EQ(0, logcompact_start(&log, log_write));
+  printf("Sensors at every update:\n");
+  fly(&log, rates);
+}
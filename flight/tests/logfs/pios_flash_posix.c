@@ -19,6 +19,10 @@ struct flash_posix_dev {
 	FILE * flash_file;
 };
 
+uint32_t pios_flash_posix_reads;
+uint32_t pios_flash_posix_writes;
+uint32_t pios_flash_posix_erases;
+
 static struct flash_posix_dev * PIOS_Flash_Posix_Alloc(void)
 {
 	struct flash_posix_dev * flash_dev = PIOS_malloc(sizeof(struct flash_posix_dev));
@@ -116,6 +120,8 @@ static int32_t PIOS_Flash_Posix_EraseSector(uintptr_t chip_id, uint32_t chip_sec
 
 	assert (s == flash_dev->cfg->size_of_sector);
 
+	pios_flash_posix_erases++;
+
 	return 0;
 }
 
@@ -137,6 +143,8 @@ static int32_t PIOS_Flash_Posix_WriteData(uintptr_t chip_id, uint32_t chip_offse
 
 	assert (s == len);
 
+	pios_flash_posix_writes++;
+
 	return 0;
 }
 
@@ -158,6 +166,8 @@ static int32_t PIOS_Flash_Posix_ReadData(uintptr_t chip_id, uint32_t chip_offset
 
 	assert (s == len);
 
+	pios_flash_posix_reads++;
+
 	return 0;
 }
 
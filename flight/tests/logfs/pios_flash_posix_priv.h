@@ -9,3 +9,8 @@ int32_t PIOS_Flash_Posix_Init(uintptr_t * chip_id, const struct pios_flash_posix
 void PIOS_Flash_Posix_Destroy(uintptr_t chip_id);
 
 extern const struct pios_flash_driver pios_posix_flash_driver;
+
+/* Accesses to the flash, counted for the benchmarks */
+extern uint32_t pios_flash_posix_reads;
+extern uint32_t pios_flash_posix_writes;
+extern uint32_t pios_flash_posix_erases;
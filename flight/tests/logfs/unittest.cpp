@@ -37,6 +37,7 @@
 #include <stdlib.h>		/* abort */
 #include <string.h>		/* memset */
 #include <stdint.h>		/* uint*_t */
+#include <time.h>		/* clock_gettime */
 
 extern "C" {
 
@@ -55,6 +56,8 @@ extern struct pios_flash_posix_cfg flash_config;
 #include "pios_flashfs_logfs_priv.h"
 
 extern struct flashfs_logfs_cfg flashfs_config_settings;
+extern struct flashfs_logfs_cfg flashfs_config_settings_indexed;
+extern struct flashfs_logfs_cfg flashfs_config_settings_two_sectors;
 extern struct flashfs_logfs_cfg flashfs_config_waypoints;
 
 #include "pios_flashfs.h"	/* PIOS_FLASHFS_* */
@@ -425,3 +428,419 @@ TEST_F(LogfsTestCookedMultiPart, WriteLarge) {
   memset(obj4_check, 0, sizeof(obj4_check));
   EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id_b, OBJ4_ID, 0, obj4_check, sizeof(obj4_check)));
 }
+
+class LogfsTestIndexed : public LogfsTestRaw {
+protected:
+  virtual void SetUp() {
+    /* First, we need to set up the super fixture (LogfsTestRaw) */
+    LogfsTestRaw::SetUp();
+
+    EXPECT_EQ(0, PIOS_Flash_Posix_Init(&pios_posix_flash_id, &flash_config));
+    EXPECT_EQ(0, PIOS_FLASHFS_Logfs_Init(&fs_id, &flashfs_config_settings_indexed, FLASH_PARTITION_LABEL_SETTINGS));
+  }
+
+  virtual void TearDown() {
+    PIOS_FLASHFS_Logfs_Destroy(fs_id);
+    PIOS_Flash_Posix_Destroy(pios_posix_flash_id);
+  }
+
+  uintptr_t fs_id;
+};
+
+TEST_F(LogfsTestIndexed, WriteVerifyDeleteVerifyOne) {
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, 0, obj1, sizeof(obj1)));
+
+  unsigned char obj1_check[OBJ1_SIZE];
+  memset(obj1_check, 0, sizeof(obj1_check));
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, 0, obj1_check, sizeof(obj1_check)));
+  EXPECT_EQ(0, memcmp(obj1, obj1_check, sizeof(obj1)));
+
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjDelete(fs_id, OBJ1_ID, 0));
+
+  EXPECT_EQ(-3, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, 0, obj1_check, sizeof(obj1_check)));
+}
+
+TEST_F(LogfsTestIndexed, WriteVerifyMultiInstance) {
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, 123, obj1_alt, sizeof(obj1_alt)));
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, 0, obj1, sizeof(obj1)));
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ2_ID, 0, obj2, sizeof(obj2)));
+
+  unsigned char obj1_check[OBJ1_SIZE];
+
+  memset(obj1_check, 0, sizeof(obj1_check));
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, 123, obj1_check, sizeof(obj1_check)));
+  EXPECT_EQ(0, memcmp(obj1_alt, obj1_check, sizeof(obj1_alt)));
+
+  memset(obj1_check, 0, sizeof(obj1_check));
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, 0, obj1_check, sizeof(obj1_check)));
+  EXPECT_EQ(0, memcmp(obj1, obj1_check, sizeof(obj1)));
+
+  EXPECT_EQ(-3, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, 1, obj1_check, sizeof(obj1_check)));
+}
+
+TEST_F(LogfsTestIndexed, FillFilesystemAndGarbageCollect) {
+  for (uint32_t i = 0; i < (flashfs_config_settings_indexed.arena_size / flashfs_config_settings_indexed.slot_size) - 1; i++) {
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, i, obj1, sizeof(obj1)));
+  }
+
+  EXPECT_EQ(-4, PIOS_FLASHFS_ObjSave(fs_id, OBJ2_ID, 0, obj2, sizeof(obj2)));
+
+  /* The index follows the slots moved by the garbage collection */
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, 0, obj1_alt, sizeof(obj1_alt)));
+
+  unsigned char obj1_check[OBJ1_SIZE];
+  for (uint32_t i = 1; i < (flashfs_config_settings_indexed.arena_size / flashfs_config_settings_indexed.slot_size) - 1; i++) {
+    memset(obj1_check, 0, sizeof(obj1_check));
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, i, obj1_check, sizeof(obj1_check)));
+    EXPECT_EQ(0, memcmp(obj1, obj1_check, sizeof(obj1)));
+  }
+
+  memset(obj1_check, 0, sizeof(obj1_check));
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, 0, obj1_check, sizeof(obj1_check)));
+  EXPECT_EQ(0, memcmp(obj1_alt, obj1_check, sizeof(obj1_alt)));
+}
+
+TEST_F(LogfsTestIndexed, MatchesTheScans) {
+  /* Random saves and deletes of a few instances, through several garbage collections */
+  const uint32_t num_inst = 40;
+  int32_t saved[num_inst];
+  for (uint32_t i = 0; i < num_inst; i++) {
+    saved[i] = -1;
+  }
+
+  srand(1);
+  unsigned char data[OBJ1_SIZE];
+  for (uint32_t i = 0; i < 3000; i++) {
+    uint16_t inst = rand() % num_inst;
+    if (rand() % 5 == 0) {
+      EXPECT_EQ(0, PIOS_FLASHFS_ObjDelete(fs_id, OBJ1_ID, inst));
+      saved[inst] = -1;
+    } else {
+      memset(data, i, sizeof(data));
+      EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, inst, data, sizeof(data)));
+      saved[inst] = i & 0xFF;
+    }
+  }
+
+  /* Check with the index kept up to date, then built at mount, then without it */
+  const struct flashfs_logfs_cfg *cfgs[] = {
+    &flashfs_config_settings_indexed,
+    &flashfs_config_settings_indexed,
+    &flashfs_config_settings,
+  };
+  for (uint32_t c = 0; c < 3; c++) {
+    if (c > 0) {
+      PIOS_FLASHFS_Logfs_Destroy(fs_id);
+      EXPECT_EQ(0, PIOS_FLASHFS_Logfs_Init(&fs_id, cfgs[c], FLASH_PARTITION_LABEL_SETTINGS));
+    }
+
+    for (uint16_t inst = 0; inst < num_inst; inst++) {
+      memset(data, 0, sizeof(data));
+      if (saved[inst] < 0) {
+        EXPECT_EQ(-3, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, inst, data, sizeof(data)));
+      } else {
+        EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, inst, data, sizeof(data)));
+        EXPECT_EQ(saved[inst], data[0]);
+        EXPECT_EQ(saved[inst], data[OBJ1_SIZE - 1]);
+      }
+    }
+  }
+}
+
+/* As many settings objects as in shared/uavobjectdefinition */
+#define NUM_SETTINGS 48
+#define BOOT_ROUNDS 50
+
+static double now_ns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+TEST_F(LogfsTestRaw, LoadAllSettingsTime) {
+  EXPECT_EQ(0, PIOS_Flash_Posix_Init(&pios_posix_flash_id, &flash_config));
+  PIOS_FLASH_register_partition_table(pios_flash_partition_table, pios_flash_partition_table_size);
+
+  uintptr_t fs_id;
+  EXPECT_EQ(0, PIOS_FLASHFS_Logfs_Init(&fs_id, &flashfs_config_settings, FLASH_PARTITION_LABEL_SETTINGS));
+
+  /* Settings saved a few times over, leaving obsolete slots ahead of the active ones */
+  uint16_t sizes[NUM_SETTINGS];
+  unsigned char data[OBJ3_SIZE];
+  memset(data, 0x5A, sizeof(data));
+  for (uint32_t i = 0; i < NUM_SETTINGS; i++) {
+    sizes[i] = 4 + (i * 37) % (OBJ3_SIZE - 4);
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID + i, 0, data, sizes[i]));
+  }
+  uint32_t slots = flashfs_config_settings.arena_size / flashfs_config_settings.slot_size;
+  for (uint32_t i = 0; i < slots - 1 - NUM_SETTINGS - 8; i++) {
+    uint32_t obj = (i * 7) % NUM_SETTINGS;
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID + obj, 0, data, sizes[obj]));
+  }
+  PIOS_FLASHFS_Logfs_Destroy(fs_id);
+
+  /* Mount the filesystem and load every settings object, as done at boot */
+  const struct flashfs_logfs_cfg *cfgs[] = {
+    &flashfs_config_settings,
+    &flashfs_config_settings_indexed,
+  };
+  double ns[2];
+  uint32_t reads[2];
+  for (uint32_t c = 0; c < 2; c++) {
+    pios_flash_posix_reads = 0;
+    double start = now_ns();
+    for (uint32_t round = 0; round < BOOT_ROUNDS; round++) {
+      EXPECT_EQ(0, PIOS_FLASHFS_Logfs_Init(&fs_id, cfgs[c], FLASH_PARTITION_LABEL_SETTINGS));
+      for (uint32_t i = 0; i < NUM_SETTINGS; i++) {
+        EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID + i, 0, data, sizes[i]));
+      }
+      PIOS_FLASHFS_Logfs_Destroy(fs_id);
+    }
+    ns[c] = (now_ns() - start) / BOOT_ROUNDS;
+    reads[c] = pios_flash_posix_reads / BOOT_ROUNDS;
+  }
+
+  printf("%d settings loaded at boot: %6.1f us and %u flash reads scanning, %6.1f us and %u flash reads indexed\n",
+      NUM_SETTINGS, ns[0] / 1000, reads[0], ns[1] / 1000, reads[1]);
+  EXPECT_LT(reads[1], reads[0]);
+  EXPECT_LT(ns[1], ns[0]);
+
+  PIOS_Flash_Posix_Destroy(pios_posix_flash_id);
+}
+
+/* Saves and deletes of a few instances, with a few steps of garbage collection after each */
+#define NUM_COLLECTED_INST 40
+
+static void save_and_collect(uintptr_t fs_id, uint32_t ops, int32_t saved[NUM_COLLECTED_INST])
+{
+  unsigned char data[OBJ1_SIZE];
+  for (uint32_t i = 0; i < ops; i++) {
+    uint16_t inst = rand() % NUM_COLLECTED_INST;
+    if (rand() % 5 == 0) {
+      EXPECT_EQ(0, PIOS_FLASHFS_ObjDelete(fs_id, OBJ1_ID, inst));
+      saved[inst] = -1;
+    } else {
+      memset(data, i, sizeof(data));
+      EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, inst, data, sizeof(data)));
+      saved[inst] = i & 0xFF;
+    }
+
+    for (int32_t step = rand() % 3; step > 0; step--) {
+      EXPECT_LE(0, PIOS_FLASHFS_Collect(fs_id));
+    }
+  }
+}
+
+static void verify_collected(uintptr_t fs_id, const int32_t saved[NUM_COLLECTED_INST])
+{
+  unsigned char data[OBJ1_SIZE];
+  for (uint16_t inst = 0; inst < NUM_COLLECTED_INST; inst++) {
+    memset(data, 0, sizeof(data));
+    if (saved[inst] < 0) {
+      EXPECT_EQ(-3, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, inst, data, sizeof(data)));
+    } else {
+      EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, inst, data, sizeof(data)));
+      EXPECT_EQ(saved[inst], data[0]);
+      EXPECT_EQ(saved[inst], data[OBJ1_SIZE - 1]);
+    }
+  }
+}
+
+TEST_F(LogfsTestCooked, CollectInSteps) {
+  int32_t saved[NUM_COLLECTED_INST];
+  for (uint32_t i = 0; i < NUM_COLLECTED_INST; i++) {
+    saved[i] = -1;
+  }
+
+  srand(2);
+  for (uint32_t round = 0; round < 10; round++) {
+    save_and_collect(fs_id, 300, saved);
+    verify_collected(fs_id, saved);
+  }
+
+  /* Nothing is lost across a reset, whatever step the collection was at */
+  PIOS_FLASHFS_Logfs_Destroy(fs_id);
+  EXPECT_EQ(0, PIOS_FLASHFS_Logfs_Init(&fs_id, &flashfs_config_settings, FLASH_PARTITION_LABEL_SETTINGS));
+  verify_collected(fs_id, saved);
+}
+
+TEST_F(LogfsTestIndexed, CollectInSteps) {
+  int32_t saved[NUM_COLLECTED_INST];
+  for (uint32_t i = 0; i < NUM_COLLECTED_INST; i++) {
+    saved[i] = -1;
+  }
+
+  srand(3);
+  for (uint32_t round = 0; round < 10; round++) {
+    save_and_collect(fs_id, 300, saved);
+    verify_collected(fs_id, saved);
+  }
+
+  PIOS_FLASHFS_Logfs_Destroy(fs_id);
+  EXPECT_EQ(0, PIOS_FLASHFS_Logfs_Init(&fs_id, &flashfs_config_settings_indexed, FLASH_PARTITION_LABEL_SETTINGS));
+  verify_collected(fs_id, saved);
+}
+
+TEST_F(LogfsTestCooked, ResetDuringCollection) {
+  int32_t saved[NUM_COLLECTED_INST];
+  unsigned char data[OBJ1_SIZE];
+  uint32_t slots = flashfs_config_settings.arena_size / flashfs_config_settings.slot_size;
+
+  /* Nothing to collect yet */
+  for (uint16_t inst = 0; inst < NUM_COLLECTED_INST; inst++) {
+    memset(data, inst, sizeof(data));
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, inst, data, sizeof(data)));
+    saved[inst] = inst;
+  }
+  EXPECT_EQ(0, PIOS_FLASHFS_Collect(fs_id));
+
+  /* Fill the log with old versions until the collection is due */
+  for (uint32_t i = 0; i < slots - NUM_COLLECTED_INST - (slots - 1) / 4; i++) {
+    uint16_t inst = i % NUM_COLLECTED_INST;
+    memset(data, i, sizeof(data));
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, inst, data, sizeof(data)));
+    saved[inst] = i & 0xFF;
+  }
+
+  /* Reset at each step of the collection, saving and deleting between the steps */
+  int32_t rc;
+  uint32_t steps = 0;
+  do {
+    rc = PIOS_FLASHFS_Collect(fs_id);
+    EXPECT_LE(0, rc);
+    steps++;
+
+    uint16_t inst = steps % NUM_COLLECTED_INST;
+    if (steps % 3 == 0) {
+      EXPECT_EQ(0, PIOS_FLASHFS_ObjDelete(fs_id, OBJ1_ID, inst));
+      saved[inst] = -1;
+    } else {
+      memset(data, 0x80 + steps, sizeof(data));
+      EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, inst, data, sizeof(data)));
+      saved[inst] = (0x80 + steps) & 0xFF;
+    }
+
+    /* The state of the collection is lost, the flash is mounted again */
+    uintptr_t reset_fs_id;
+    EXPECT_EQ(0, PIOS_FLASHFS_Logfs_Init(&reset_fs_id, &flashfs_config_settings, FLASH_PARTITION_LABEL_SETTINGS));
+    verify_collected(reset_fs_id, saved);
+    PIOS_FLASHFS_Logfs_Destroy(reset_fs_id);
+  } while (rc > 0);
+
+  /* Started, copied in steps, switched arenas and erased the next one */
+  EXPECT_LT(4U, steps);
+  verify_collected(fs_id, saved);
+}
+
+TEST_F(LogfsTestRaw, CollectErasesASectorPerStep) {
+  EXPECT_EQ(0, PIOS_Flash_Posix_Init(&pios_posix_flash_id, &flash_config));
+  PIOS_FLASH_register_partition_table(pios_flash_partition_table, pios_flash_partition_table_size);
+
+  uintptr_t fs_id;
+  EXPECT_EQ(0, PIOS_FLASHFS_Logfs_Init(&fs_id, &flashfs_config_settings_two_sectors, FLASH_PARTITION_LABEL_SETTINGS));
+
+  int32_t saved[NUM_COLLECTED_INST];
+  unsigned char data[OBJ1_SIZE];
+  for (uint32_t i = 0; i < NUM_COLLECTED_INST; i++) {
+    saved[i] = -1;
+  }
+
+  /* Enough saves for the collections to go round all the arenas */
+  uint32_t slots = flashfs_config_settings_two_sectors.arena_size / flashfs_config_settings_two_sectors.slot_size;
+  uint32_t num_arenas = (31 - 0 + 1) * FLASH_SECTOR_64KB / flashfs_config_settings_two_sectors.arena_size;
+  uint32_t erases_in_steps = 0;
+  for (uint32_t i = 0; i < 2 * num_arenas * slots; i++) {
+    uint16_t inst = i % NUM_COLLECTED_INST;
+    memset(data, i, sizeof(data));
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, inst, data, sizeof(data)));
+    saved[inst] = i & 0xFF;
+
+    int32_t rc;
+    do {
+      uint32_t erases = pios_flash_posix_erases;
+      rc = PIOS_FLASHFS_Collect(fs_id);
+      EXPECT_LE(0, rc);
+      EXPECT_GE(1U, pios_flash_posix_erases - erases);
+      erases_in_steps += pios_flash_posix_erases - erases;
+    } while (rc > 0);
+  }
+
+  /* Every arena went through the collection, erased in two steps */
+  EXPECT_LE(2 * num_arenas, erases_in_steps);
+  verify_collected(fs_id, saved);
+
+  PIOS_FLASHFS_Logfs_Destroy(fs_id);
+  PIOS_Flash_Posix_Destroy(pios_posix_flash_id);
+}
+
+/* Enough saves for the collections to go round all the arenas of the partition */
+#define NUM_SAVES 10000
+
+/* Latency of the saves of the settings, in time and in accesses to the flash */
+struct save_latency {
+  double max_ns;
+  double total_ns;
+  uint32_t max_accesses;
+  uint32_t max_erases;
+};
+
+static void measure_saves(uintptr_t fs_id, bool collect, struct save_latency *latency)
+{
+  unsigned char data[OBJ3_SIZE];
+  memset(data, 0x5A, sizeof(data));
+  memset(latency, 0, sizeof(*latency));
+
+  for (uint32_t i = 0; i < NUM_SAVES; i++) {
+    uint32_t obj = (i * 7) % NUM_SETTINGS;
+    uint32_t accesses = pios_flash_posix_reads + pios_flash_posix_writes + pios_flash_posix_erases;
+    uint32_t erases = pios_flash_posix_erases;
+
+    double start = now_ns();
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID + obj, 0, data, 4 + (obj * 37) % (OBJ3_SIZE - 4)));
+    double ns = now_ns() - start;
+
+    accesses = pios_flash_posix_reads + pios_flash_posix_writes + pios_flash_posix_erases - accesses;
+    erases = pios_flash_posix_erases - erases;
+    latency->max_ns = ns > latency->max_ns ? ns : latency->max_ns;
+    latency->total_ns += ns;
+    latency->max_accesses = accesses > latency->max_accesses ? accesses : latency->max_accesses;
+    latency->max_erases = erases > latency->max_erases ? erases : latency->max_erases;
+
+    /* As many steps as the system task runs between two saves */
+    for (uint32_t step = 0; collect && step < 16; step++) {
+      int32_t rc = PIOS_FLASHFS_Collect(fs_id);
+      EXPECT_LE(0, rc);
+      if (rc == 0)
+        break;
+    }
+  }
+}
+
+TEST_F(LogfsTestRaw, SaveLatency) {
+  EXPECT_EQ(0, PIOS_Flash_Posix_Init(&pios_posix_flash_id, &flash_config));
+  PIOS_FLASH_register_partition_table(pios_flash_partition_table, pios_flash_partition_table_size);
+
+  uintptr_t fs_id;
+  struct save_latency latency[2];
+  for (uint32_t c = 0; c < 2; c++) {
+    EXPECT_EQ(0, PIOS_FLASHFS_Logfs_Init(&fs_id, &flashfs_config_settings_indexed, FLASH_PARTITION_LABEL_SETTINGS));
+    EXPECT_EQ(0, PIOS_FLASHFS_Format(fs_id));
+    measure_saves(fs_id, c == 1, &latency[c]);
+    PIOS_FLASHFS_Logfs_Destroy(fs_id);
+  }
+
+  printf("%d saves collected at once:   worst %7.1f us, %4u flash accesses, %u erases, mean %5.1f us\n",
+      NUM_SAVES, latency[0].max_ns / 1000, latency[0].max_accesses, latency[0].max_erases,
+      latency[0].total_ns / NUM_SAVES / 1000);
+  printf("%d saves collected in steps: worst %7.1f us, %4u flash accesses, %u erases, mean %5.1f us\n",
+      NUM_SAVES, latency[1].max_ns / 1000, latency[1].max_accesses, latency[1].max_erases,
+      latency[1].total_ns / NUM_SAVES / 1000);
+
+  /* The saves never collect or erase themselves */
+  EXPECT_LT(0U, latency[0].max_erases);
+  EXPECT_EQ(0U, latency[1].max_erases);
+  EXPECT_LT(latency[1].max_accesses * 2, latency[0].max_accesses);
+
+  PIOS_Flash_Posix_Destroy(pios_posix_flash_id);
+}
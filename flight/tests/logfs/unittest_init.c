@@ -13,6 +13,19 @@ const struct flashfs_logfs_cfg flashfs_config_settings = {
 	.slot_size     = 0x00000100, /* 256 bytes */
 };
 
+const struct flashfs_logfs_cfg flashfs_config_settings_indexed = {
+	.fs_magic      = 0x89abceef,
+	.arena_size    = 0x00010000, /* 256 * slot size */
+	.slot_size     = 0x00000100, /* 256 bytes */
+	.ram_index     = true,
+};
+
+const struct flashfs_logfs_cfg flashfs_config_settings_two_sectors = {
+	.fs_magic      = 0x89abceef,
+	.arena_size    = 0x00020000, /* 2 sectors, 512 * slot size */
+	.slot_size     = 0x00000100, /* 256 bytes */
+};
+
 const struct flashfs_logfs_cfg flashfs_config_waypoints = {
 	.fs_magic      = 0x89abceef,
 	.arena_size    = 0x00010000, /* 64 * slot size */
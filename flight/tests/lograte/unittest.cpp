@@ -0,0 +1,208 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test of the rate limit of the logged objects, and of the share
+ * of the updates of a simulated flight which are logged
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdlib.h>		/* abort */
+#include <string.h>		/* memset */
+#include <stdint.h>		/* uint*_t */
+
+extern "C" {
+
+#include "lograte.h"
+
+}
+
+// To use a test fixture, derive a class from testing::Test.
+class LogRate : public testing::Test {
+protected:
+  virtual void SetUp() {
+    srand(1);
+    lograte_init(&rate);
+  }
+
+  virtual void TearDown() {
+  }
+
+  // Updates of an object every period_us for duration_ms, with up to
+  // jitter_us of jitter, returns how many were logged
+  uint32_t run(uint32_t obj_id, uint32_t period_us, uint32_t jitter_us, uint32_t duration_ms) {
+    uint32_t logged = 0;
+    for (uint32_t t = period_us; t < duration_ms * 1000; t += period_us) {
+      uint32_t jitter = jitter_us ? rand() % (2 * jitter_us + 1) : jitter_us;
+      logged += lograte_accept(&rate, obj_id, (t + jitter - jitter_us) / 1000);
+    }
+    return logged;
+  }
+
+  struct lograte rate;
+};
+
+TEST_F(LogRate, LogsEveryUpdateWithoutLimit) {
+  EXPECT_EQ(0, lograte_add(&rate, 10, 0));
+
+  EXPECT_EQ(4999U, run(10, 2000, 0, 10000));
+  EXPECT_EQ(rate.produced, rate.captured);
+}
+
+TEST_F(LogRate, IgnoresOtherObjects) {
+  EXPECT_EQ(0, lograte_add(&rate, 10, 0));
+
+  EXPECT_FALSE(lograte_accept(&rate, 12, 0));
+  EXPECT_EQ(0U, rate.produced);
+}
+
+TEST_F(LogRate, AddsEachObjectOnce) {
+  EXPECT_EQ(0, lograte_add(&rate, 10, 50));
+  EXPECT_EQ(-1, lograte_add(&rate, 10, 5));
+  EXPECT_EQ(1, rate.num_objects);
+
+  for (uint32_t i = 1; i < LOGRATE_MAX_OBJECTS; i++)
+    EXPECT_EQ(0, lograte_add(&rate, 10 + 2 * i, 50));
+  EXPECT_EQ(-1, lograte_add(&rate, 100, 50));
+}
+
+TEST_F(LogRate, LogsTheFirstUpdate) {
+  EXPECT_EQ(0, lograte_add(&rate, 10, 1));
+
+  // With the credit of the time before
+  EXPECT_TRUE(lograte_accept(&rate, 10, 123456));
+  EXPECT_TRUE(lograte_accept(&rate, 10, 123457));
+  EXPECT_FALSE(lograte_accept(&rate, 10, 123458));
+  EXPECT_TRUE(lograte_accept(&rate, 10, 124457));
+}
+
+TEST_F(LogRate, LimitsFastObjects) {
+  EXPECT_EQ(0, lograte_add(&rate, 10, 50));
+
+  // A 500 Hz sensor logged at 50 Hz for 10 s
+  uint32_t logged = run(10, 2000, 0, 10000);
+  EXPECT_GE(logged, 499U);
+  EXPECT_LE(logged, 502U);
+}
+
+TEST_F(LogRate, KeepsUpWithJitteryObjects) {
+  EXPECT_EQ(0, lograte_add(&rate, 10, 50));
+
+  // An object updated at the rate it is logged at, a few ms early or late,
+  // is logged at every update
+  EXPECT_EQ(499U, run(10, 20000, 3000, 10000));
+}
+
+TEST_F(LogRate, RecoversAfterAPause) {
+  EXPECT_EQ(0, lograte_add(&rate, 10, 10));
+
+  EXPECT_TRUE(lograte_accept(&rate, 10, 0));
+  // No burst after the pause, the credit is capped
+  EXPECT_TRUE(lograte_accept(&rate, 10, 5000));
+  EXPECT_TRUE(lograte_accept(&rate, 10, 5001));
+  EXPECT_FALSE(lograte_accept(&rate, 10, 5002));
+  EXPECT_FALSE(lograte_accept(&rate, 10, 5099));
+  EXPECT_TRUE(lograte_accept(&rate, 10, 5101));
+}
+
+TEST_F(LogRate, WrapsAroundTheClock) {
+  EXPECT_EQ(0, lograte_add(&rate, 10, 50));
+
+  EXPECT_TRUE(lograte_accept(&rate, 10, 0xFFFFFFF0));
+  EXPECT_TRUE(lograte_accept(&rate, 10, 0xFFFFFFF1));
+  EXPECT_FALSE(lograte_accept(&rate, 10, 0xFFFFFFF2));
+  EXPECT_TRUE(lograte_accept(&rate, 10, 0x10));
+}
+
+// A flight of the sensors at their native rates with the default settings,
+// and with the sensors logged at every update
+struct Producer {
+  const char *name;
+  uint32_t obj_id;
+  uint32_t rate_hz;
+};
+
+static const Producer producers[] = {
+  { "Gyros", 10, 500 },
+  { "Accels", 12, 500 },
+  { "AttitudeActual", 14, 500 },
+  { "Magnetometer", 16, 75 },
+  { "BaroAltitude", 18, 40 },
+  { "GPSPosition", 20, 5 },
+  { "GPSTime", 22, 1 },
+};
+
+#define NUM_PRODUCERS (sizeof(producers) / sizeof(producers[0]))
+#define FLIGHT_MS 60000
+
+static void fly(struct lograte *rate, uint32_t produced[], uint32_t captured[])
+{
+  // Step in us, each producer updates when its period elapsed
+  uint32_t next_us[NUM_PRODUCERS] = { 0 };
+  for (uint32_t t = 0; t < FLIGHT_MS * 1000; t += 100) {
+    for (uint32_t i = 0; i < NUM_PRODUCERS; i++) {
+      if (t < next_us[i])
+        continue;
+      next_us[i] += 1000000 / producers[i].rate_hz;
+      produced[i]++;
+      captured[i] += lograte_accept(rate, producers[i].obj_id, t / 1000);
+    }
+  }
+}
+
+TEST_F(LogRate, CapturedShareOfAFlight) {
+  const uint16_t defaults[NUM_PRODUCERS] = { 50, 50, 50, 50, 5, 5, 1 };
+  const uint16_t native[NUM_PRODUCERS] = { 0, 0, 0, 0, 0, 5, 1 };
+  const uint16_t *settings[2] = { defaults, native };
+
+  for (int s = 0; s < 2; s++) {
+    lograte_init(&rate);
+    for (uint32_t i = 0; i < NUM_PRODUCERS; i++)
+      EXPECT_EQ(0, lograte_add(&rate, producers[i].obj_id, settings[s][i]));
+
+    uint32_t produced[NUM_PRODUCERS] = { 0 };
+    uint32_t captured[NUM_PRODUCERS] = { 0 };
+    fly(&rate, produced, captured);
+
+    printf("%s:\n", s == 0 ? "Default rates" : "Sensors at every update");
+    for (uint32_t i = 0; i < NUM_PRODUCERS; i++) {
+      uint32_t expected = settings[s][i] == 0 || settings[s][i] > producers[i].rate_hz ?
+          produced[i] : settings[s][i] * FLIGHT_MS / 1000;
+      printf("  %-16s %3d Hz, max %3d Hz: %6d of %6d updates logged (%5.1f%%)\n",
+          producers[i].name, producers[i].rate_hz, settings[s][i], captured[i], produced[i],
+          100.0 * captured[i] / produced[i]);
+      EXPECT_GE(captured[i], expected * 99 / 100);
+      EXPECT_LE(captured[i], expected + 2);
+    }
+    EXPECT_EQ(rate.captured, (uint32_t) (captured[0] + captured[1] + captured[2] + captured[3] +
+        captured[4] + captured[5] + captured[6]));
+  }
+}
@@ -0,0 +1,489 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test of the sliding window of the log download, and of a whole
+ * download over a simulated link with configurable round trip time and loss
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdlib.h>		/* abort */
+#include <string.h>		/* memset */
+#include <stdint.h>		/* uint*_t */
+
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+extern "C" {
+
+#include "logwindow.h"
+
+}
+
+// The file being downloaded, read by the window through file_read()
+static std::vector<uint8_t> file_data;
+static size_t file_pos;
+static int32_t file_reads;
+
+static int32_t file_read(uint8_t *data, uint16_t len)
+{
+  size_t n = std::min((size_t) len, file_data.size() - file_pos);
+  memcpy(data, &file_data[file_pos], n);
+  file_pos += n;
+  file_reads++;
+  return n;
+}
+
+static int32_t failing_read(uint8_t *, uint16_t)
+{
+  return -1;
+}
+
+static void make_file(size_t size)
+{
+  file_data.resize(size);
+  for (size_t i = 0; i < size; i++)
+    file_data[i] = rand();
+  file_pos = 0;
+  file_reads = 0;
+}
+
+// To use a test fixture, derive a class from testing::Test.
+class LogWindow : public testing::Test {
+protected:
+  virtual void SetUp() {
+    srand(1);
+    make_file(10 * LOGWINDOW_SECTOR_SIZE + 17);
+  }
+
+  virtual void TearDown() {
+  }
+
+  struct logwindow window;
+};
+
+TEST_F(LogWindow, SendsUpToTheWindowSize) {
+  const uint8_t *data;
+  bool last;
+
+  logwindow_init(&window, 4);
+  EXPECT_EQ(0, logwindow_fill(&window, file_read));
+
+  for (int32_t i = 0; i < 4; i++) {
+    EXPECT_EQ(i, logwindow_next(&window, 0, &data, &last));
+    EXPECT_EQ(0, memcmp(data, &file_data[i * LOGWINDOW_SECTOR_SIZE], LOGWINDOW_SECTOR_SIZE));
+    EXPECT_FALSE(last);
+  }
+  EXPECT_EQ(-1, logwindow_next(&window, 0, &data, &last));
+
+  // Acknowledging the first two lets two more go
+  logwindow_ack(&window, 2, 0, 50);
+  EXPECT_EQ(2, window.base);
+  EXPECT_EQ(4, logwindow_next(&window, 50, &data, &last));
+}
+
+TEST_F(LogWindow, PadsTheLastSector) {
+  const uint8_t *data;
+  bool last = false;
+
+  logwindow_init(&window, LOGWINDOW_MAX_SECTORS);
+  EXPECT_EQ(0, logwindow_fill(&window, file_read));
+  EXPECT_EQ(10, window.last_sector);
+  EXPECT_EQ(11, window.next_read);
+
+  int32_t sector;
+  while ((sector = logwindow_next(&window, 0, &data, &last)) != 10)
+    EXPECT_FALSE(last);
+  EXPECT_TRUE(last);
+  EXPECT_EQ(0, memcmp(data, &file_data[10 * LOGWINDOW_SECTOR_SIZE], 17));
+  for (int32_t i = 17; i < LOGWINDOW_SECTOR_SIZE; i++)
+    EXPECT_EQ(0, data[i]);
+
+  EXPECT_FALSE(logwindow_done(&window));
+  logwindow_ack(&window, 11, 0, 10);
+  EXPECT_TRUE(logwindow_done(&window));
+}
+
+TEST_F(LogWindow, ResendsOnlyTheLostSectors) {
+  const uint8_t *data;
+  bool last;
+
+  logwindow_init(&window, 8);
+  logwindow_fill(&window, file_read);
+  for (uint32_t i = 0; i < 6; i++)
+    EXPECT_EQ((int32_t) i, logwindow_next(&window, i, &data, &last));
+
+  // 1 and 3 did not get through
+  logwindow_ack(&window, 1, (1 << 0) | (1 << 2) | (1 << 3), 40);
+  EXPECT_EQ(1, window.base);
+  EXPECT_EQ(1, logwindow_next(&window, 50, &data, &last));
+  EXPECT_EQ(0, memcmp(data, &file_data[1 * LOGWINDOW_SECTOR_SIZE], LOGWINDOW_SECTOR_SIZE));
+  EXPECT_EQ(3, logwindow_next(&window, 55, &data, &last));
+  EXPECT_EQ(6, logwindow_next(&window, 60, &data, &last));
+
+  logwindow_ack(&window, 7, 0, 100);
+  EXPECT_EQ(7, window.base);
+}
+
+TEST_F(LogWindow, ResendsAfterTheTimeout) {
+  const uint8_t *data;
+  bool last;
+
+  logwindow_init(&window, 1);
+  logwindow_fill(&window, file_read);
+  EXPECT_EQ(0, logwindow_next(&window, 0, &data, &last));
+  EXPECT_EQ(-1, logwindow_next(&window, LOGWINDOW_INITIAL_TIMEOUT_MS - 1, &data, &last));
+  EXPECT_EQ(0, logwindow_next(&window, LOGWINDOW_INITIAL_TIMEOUT_MS, &data, &last));
+
+  // Backs off, and retransmitted sectors do not measure the round trip
+  EXPECT_EQ((uint32_t) 2 * LOGWINDOW_INITIAL_TIMEOUT_MS, window.timeout);
+  logwindow_ack(&window, 1, 0, LOGWINDOW_INITIAL_TIMEOUT_MS + 10);
+  EXPECT_EQ((uint32_t) 0, window.srtt);
+
+  // The timeout follows the measured round trip
+  uint32_t now = 10000;
+  for (int32_t i = 1; i < 8; i++) {
+    EXPECT_EQ(i, logwindow_next(&window, now, &data, &last));
+    now += 150;
+    logwindow_ack(&window, i + 1, 0, now);
+  }
+  EXPECT_EQ((uint32_t) 150, window.srtt);
+  EXPECT_GE(window.timeout, (uint32_t) 150);
+  EXPECT_LT(window.timeout, (uint32_t) LOGWINDOW_INITIAL_TIMEOUT_MS);
+}
+
+TEST_F(LogWindow, ReadErrorsAreReported) {
+  logwindow_init(&window, 4);
+  EXPECT_EQ(-1, logwindow_fill(&window, failing_read));
+}
+
+/**
+ * A serial link carrying UAVObject updates one way. Updates wait in a short
+ * queue for the link; when it is full the newest update replaces the last
+ * queued one, as the telemetry sends the current contents of an object and
+ * not those at the time of the update.
+ */
+template <typename T> class SimulatedLink {
+public:
+  SimulatedLink(double bytes_per_ms, double delay_ms, double loss, size_t depth, size_t packet_size) :
+    bytes_per_ms(bytes_per_ms), delay_ms(delay_ms), loss(loss), depth(depth), packet_size(packet_size),
+    busy_until(0), busy(false), sent(0), lost(0) {}
+
+  void send(const T &update) {
+    if (queue.size() >= depth)
+      queue.back() = update;
+    else
+      queue.push_back(update);
+  }
+
+  // Move the link to time now, returns the updates arriving at that time
+  std::vector<T> run(double now) {
+    if (busy && busy_until <= now) {
+      busy = false;
+      sent++;
+      if (rand() < loss * RAND_MAX)
+        lost++;
+      else
+        in_flight.push_back(std::make_pair(busy_until + delay_ms, current));
+    }
+    if (!busy && !queue.empty()) {
+      current = queue.front();
+      queue.pop_front();
+      busy = true;
+      busy_until = now + packet_size / bytes_per_ms;
+    }
+
+    std::vector<T> arrived;
+    while (!in_flight.empty() && in_flight.front().first <= now) {
+      arrived.push_back(in_flight.front().second);
+      in_flight.pop_front();
+    }
+    return arrived;
+  }
+
+  double bytes_per_ms;
+  double delay_ms;
+  double loss;
+  size_t depth;
+  size_t packet_size;
+
+  std::deque<T> queue;
+  std::deque<std::pair<double, T> > in_flight;
+  T current;
+  double busy_until;
+  bool busy;
+  uint32_t sent;
+  uint32_t lost;
+};
+
+struct SectorUpdate {
+  int32_t sector;
+  bool last;
+  uint8_t data[LOGWINDOW_SECTOR_SIZE];
+};
+
+struct AckUpdate {
+  uint16_t window;
+  uint16_t ack;
+  uint32_t mask;
+};
+
+/**
+ * The receiving end, as in FlightLogDownload::sectorReceived() of the GCS
+ */
+class Receiver {
+public:
+  Receiver() : next_sector(0), highest_sector(-1), last_sector(-1), window(2),
+    window_threshold(LOGWINDOW_MAX_SECTORS), recovery_sector(-1) {}
+
+  AckUpdate received(const SectorUpdate &update) {
+    int32_t sector = update.sector;
+    if (update.last)
+      last_sector = sector;
+    if (sector >= (int32_t) have.size()) {
+      have.resize(sector + 1, false);
+      log.resize((sector + 1) * LOGWINDOW_SECTOR_SIZE);
+    }
+
+    if (!have[sector]) {
+      have[sector] = true;
+      memcpy(&log[sector * LOGWINDOW_SECTOR_SIZE], update.data, LOGWINDOW_SECTOR_SIZE);
+
+      if (sector > highest_sector + 1 && highest_sector + 1 > recovery_sector) {
+        window_threshold = std::max(window * 0.7, 1.0);
+        window = window_threshold;
+        recovery_sector = sector;
+      } else if (window < window_threshold) {
+        window += 1;
+      } else {
+        window += 1 / window;
+      }
+      window = std::min(window, (double) LOGWINDOW_MAX_SECTORS);
+      highest_sector = std::max(highest_sector, sector);
+
+      while (next_sector < (int32_t) have.size() && have[next_sector])
+        next_sector++;
+    }
+
+    return ack();
+  }
+
+  AckUpdate ack() const {
+    AckUpdate update;
+    update.window = (uint16_t) window;
+    update.ack = next_sector;
+    update.mask = 0;
+    for (int32_t i = 0; i < 32 && next_sector + 1 + i < (int32_t) have.size(); i++) {
+      if (have[next_sector + 1 + i])
+        update.mask |= 1u << i;
+    }
+    return update;
+  }
+
+  bool complete() const {
+    return last_sector >= 0 && next_sector > last_sector;
+  }
+
+  std::vector<bool> have;
+  std::vector<uint8_t> log;
+  int32_t next_sector;
+  int32_t highest_sector;
+  int32_t last_sector;
+  double window;
+  double window_threshold;
+  int32_t recovery_sector;
+};
+
+// A 57600 baud radio
+static const double LINK_BYTES_PER_MS = 5.76;
+// UAVTalk packets of LoggingStats and LoggingDownloadAck
+static const size_t SECTOR_PACKET_SIZE = 150;
+static const size_t ACK_PACKET_SIZE = 18;
+// Updates queued in the telemetry before they replace each other
+static const size_t LINK_QUEUE_DEPTH = 2;
+// Period of the logging task during the windowed download
+static const uint32_t FLIGHT_PERIOD_MS = 5;
+// Period of the logging task otherwise, which paced the old download
+static const uint32_t LEGACY_PERIOD_MS = 20;
+static const double TIME_LIMIT_MS = 3600 * 1000;
+
+class SimulatedDownload : public testing::Test {
+protected:
+  virtual void SetUp() {
+    srand(2);
+    make_file(32 * 1024 + 77);
+  }
+
+  virtual void TearDown() {
+  }
+
+  // Link rate available to sector payloads, in bytes per second
+  double payload_rate() {
+    return LINK_BYTES_PER_MS * 1000 * LOGWINDOW_SECTOR_SIZE / SECTOR_PACKET_SIZE;
+  }
+
+  /**
+   * Download the file with the sliding window
+   * @return the rate in bytes per second
+   */
+  double windowed(double rtt_ms, double loss) {
+    SimulatedLink<SectorUpdate> down(LINK_BYTES_PER_MS, rtt_ms / 2, loss, LINK_QUEUE_DEPTH, SECTOR_PACKET_SIZE);
+    SimulatedLink<AckUpdate> up(LINK_BYTES_PER_MS, rtt_ms / 2, loss, LINK_QUEUE_DEPTH, ACK_PACKET_SIZE);
+    Receiver receiver;
+    struct logwindow window;
+
+    // The GCS sets up the window before requesting the file
+    AckUpdate flight_ack = receiver.ack();
+    logwindow_init(&window, flight_ack.window);
+
+    double now;
+    for (now = 0; now < TIME_LIMIT_MS && !receiver.complete(); now += 1) {
+      std::vector<AckUpdate> acks = up.run(now);
+      if (!acks.empty())
+        flight_ack = acks.back();
+
+      if ((uint32_t) now % FLIGHT_PERIOD_MS == 0 && !logwindow_done(&window)) {
+        logwindow_set_size(&window, flight_ack.window);
+        logwindow_ack(&window, flight_ack.ack, flight_ack.mask, now);
+        EXPECT_EQ(0, logwindow_fill(&window, file_read));
+
+        SectorUpdate update;
+        const uint8_t *data;
+        update.sector = logwindow_next(&window, now, &data, &update.last);
+        if (update.sector >= 0) {
+          memcpy(update.data, data, LOGWINDOW_SECTOR_SIZE);
+          down.send(update);
+        }
+      }
+
+      std::vector<SectorUpdate> sectors = down.run(now);
+      for (size_t i = 0; i < sectors.size(); i++)
+        up.send(receiver.received(sectors[i]));
+    }
+
+    EXPECT_TRUE(receiver.complete());
+    check_log(receiver.log);
+
+    double rate = file_data.size() / (now / 1000);
+    printf("RTT %4.0f ms, loss %2.0f%%: %5.0f bytes/s, %3.0f%% of the link, %u sectors sent, %u lost, %u acks sent, %u lost\n",
+           rtt_ms, loss * 100, rate, 100 * rate / payload_rate(), down.sent, down.lost, up.sent, up.lost);
+    return rate;
+  }
+
+  /**
+   * Download the file one sector at a time, as before the sliding window. It
+   * stalls on any loss so only lossless links are simulated.
+   * @return the rate in bytes per second
+   */
+  double one_at_a_time(double rtt_ms) {
+    SimulatedLink<SectorUpdate> down(LINK_BYTES_PER_MS, rtt_ms / 2, 0, LINK_QUEUE_DEPTH, SECTOR_PACKET_SIZE);
+    SimulatedLink<int32_t> up(LINK_BYTES_PER_MS, rtt_ms / 2, 0, LINK_QUEUE_DEPTH, SECTOR_PACKET_SIZE);
+    std::vector<uint8_t> log;
+    int32_t request = 0;
+    int32_t read_sector = -1;
+    bool complete = false;
+
+    double now;
+    for (now = 0; now < TIME_LIMIT_MS && !complete; now += 1) {
+      std::vector<int32_t> requests = up.run(now);
+      if (!requests.empty())
+        request = requests.back();
+
+      if ((uint32_t) now % LEGACY_PERIOD_MS == 0 && request == read_sector + 1) {
+        SectorUpdate update;
+        memset(update.data, 0, sizeof(update.data));
+        update.sector = request;
+        update.last = file_read(update.data, LOGWINDOW_SECTOR_SIZE) < LOGWINDOW_SECTOR_SIZE;
+        down.send(update);
+        read_sector = request;
+      }
+
+      std::vector<SectorUpdate> sectors = down.run(now);
+      for (size_t i = 0; i < sectors.size(); i++) {
+        log.insert(log.end(), sectors[i].data, sectors[i].data + LOGWINDOW_SECTOR_SIZE);
+        if (sectors[i].last)
+          complete = true;
+        else
+          up.send(sectors[i].sector + 1);
+      }
+    }
+
+    EXPECT_TRUE(complete);
+    check_log(log);
+
+    double rate = file_data.size() / (now / 1000);
+    printf("RTT %4.0f ms, one sector at a time: %5.0f bytes/s, %3.0f%% of the link\n",
+           rtt_ms, rate, 100 * rate / payload_rate());
+    return rate;
+  }
+
+  void check_log(const std::vector<uint8_t> &log) {
+    ASSERT_GE(log.size(), file_data.size());
+    EXPECT_EQ(0, memcmp(&log[0], &file_data[0], file_data.size()));
+    for (size_t i = file_data.size(); i < log.size(); i++)
+      EXPECT_EQ(0, log[i]);
+  }
+};
+
+TEST_F(SimulatedDownload, ApproachesTheLinkRate) {
+  const double rtts[] = { 50, 100, 300 };
+
+  for (size_t i = 0; i < sizeof(rtts) / sizeof(rtts[0]); i++) {
+    file_pos = 0;
+    double old_rate = one_at_a_time(rtts[i]);
+    file_pos = 0;
+    double rate = windowed(rtts[i], 0);
+
+    // The file is only a few windows long at the longer round trips, so the
+    // start of the download weighs more
+    EXPECT_GT(rate, (rtts[i] <= 100 ? 0.7 : 0.5) * payload_rate());
+    EXPECT_GT(rate, 2 * old_rate);
+  }
+}
+
+TEST_F(SimulatedDownload, RecoversFromLoss) {
+  const double rtts[] = { 100, 300, 1000 };
+  const double losses[] = { 0.01, 0.05, 0.2 };
+
+  for (size_t i = 0; i < sizeof(rtts) / sizeof(rtts[0]); i++) {
+    for (size_t j = 0; j < sizeof(losses) / sizeof(losses[0]); j++) {
+      file_pos = 0;
+      windowed(rtts[i], losses[j]);
+    }
+  }
+}
+
+TEST_F(SimulatedDownload, LongRoundTrip) {
+  // The window limits the rate to LOGWINDOW_MAX_SECTORS per round trip
+  double rate = windowed(2000, 0);
+  EXPECT_GT(rate, 0.5 * LOGWINDOW_MAX_SECTORS * LOGWINDOW_SECTOR_SIZE / 2.0);
+}
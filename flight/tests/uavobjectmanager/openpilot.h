@@ -0,0 +1,12 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/* Would be from pios_debug.h but that file pulls on way too many dependencies */
+#define PIOS_Assert(x) if (!(x)) { while (1) ; }
+#define PIOS_DEBUG_Assert(x) PIOS_Assert(x)
+
+#include "pios_flashfs.h"
+#include "utlist.h"
+#include "uavobjectmanager.h"
+#include "eventdispatcher.h"
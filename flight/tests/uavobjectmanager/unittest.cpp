@@ -0,0 +1,262 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test of the lookups of the object manager by object id and by
+ * instance id, and their time against the walk of the object list
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdlib.h>		/* abort */
+#include <string.h>		/* memset */
+#include <stdint.h>		/* uint*_t */
+#include <time.h>		/* clock_gettime */
+
+#include <algorithm>
+#include <vector>
+
+extern "C" {
+
+#include "openpilot.h"
+
+}
+
+// As many objects as in shared/uavobjectdefinition, a few of them multi instance
+#define NUM_OBJECTS 116
+#define NUM_MULTI_INSTANCE 4
+#define OBJECT_BYTES 32
+
+// Lookups timed for each object
+#define LOOKUP_ROUNDS 2000
+
+static double now_ns()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// The object ids are hashes with the lowest bit cleared, the meta object
+// ids setting it
+static uint32_t next_id(uint32_t *seed)
+{
+  *seed = *seed * 1664525 + 1013904223;
+  return *seed & 0xFFFFFFFE;
+}
+
+class UAVObjectManager : public testing::Test {
+protected:
+  virtual void SetUp() {
+    ASSERT_EQ(0, UAVObjInitialize());
+
+    uint32_t seed = 1;
+    for (int i = 0; i < NUM_OBJECTS; i++) {
+      uint32_t id = next_id(&seed);
+      bool multi = i % (NUM_OBJECTS / NUM_MULTI_INSTANCE) == 0;
+      UAVObjHandle obj = UAVObjRegister(id, !multi, i % 3 == 0, OBJECT_BYTES, NULL);
+      ASSERT_TRUE(obj != NULL);
+      ids.push_back(id);
+      handles.push_back(obj);
+    }
+  }
+
+  virtual void TearDown() {
+  }
+
+  std::vector<uint32_t> ids;
+  std::vector<UAVObjHandle> handles;
+};
+
+TEST_F(UAVObjectManager, FindsEveryObject) {
+  for (int i = 0; i < NUM_OBJECTS; i++) {
+    UAVObjHandle obj = UAVObjGetByID(ids[i]);
+    EXPECT_EQ(handles[i], obj);
+    EXPECT_EQ(ids[i], UAVObjGetID(obj));
+    EXPECT_FALSE(UAVObjIsMetaobject(obj));
+  }
+}
+
+TEST_F(UAVObjectManager, FindsEveryMetaObject) {
+  for (int i = 0; i < NUM_OBJECTS; i++) {
+    UAVObjHandle meta = UAVObjGetByID(ids[i] + 1);
+    ASSERT_TRUE(meta != NULL);
+    EXPECT_TRUE(UAVObjIsMetaobject(meta));
+    EXPECT_EQ(ids[i] + 1, UAVObjGetID(meta));
+    EXPECT_EQ(handles[i], UAVObjGetLinkedObj(meta));
+  }
+}
+
+TEST_F(UAVObjectManager, UnknownIdsAreNotFound) {
+  std::vector<uint32_t> sorted(ids);
+  std::sort(sorted.begin(), sorted.end());
+
+  EXPECT_TRUE(UAVObjGetByID(0) == NULL);
+  EXPECT_TRUE(UAVObjGetByID(0xFFFFFFFE) == NULL);
+  EXPECT_TRUE(UAVObjGetByID(sorted.front() - 1) == NULL);
+  EXPECT_TRUE(UAVObjGetByID(sorted.back() + 2) == NULL);
+  for (int i = 0; i < NUM_OBJECTS; i++) {
+    EXPECT_TRUE(UAVObjGetByID(sorted[i] + 2) == NULL || (i + 1 < NUM_OBJECTS && sorted[i + 1] == sorted[i] + 2));
+  }
+}
+
+TEST_F(UAVObjectManager, RejectsDuplicateIds) {
+  EXPECT_TRUE(UAVObjRegister(ids[10], true, false, OBJECT_BYTES, NULL) == NULL);
+  EXPECT_EQ(NUM_OBJECTS, UAVObjCount());
+  EXPECT_EQ(handles[10], UAVObjGetByID(ids[10]));
+}
+
+TEST_F(UAVObjectManager, EnumeratesInRegistrationOrder) {
+  ASSERT_EQ(NUM_OBJECTS, UAVObjCount());
+  for (int i = 0; i < NUM_OBJECTS; i++) {
+    EXPECT_EQ(ids[i], UAVObjIDByIndex(i));
+  }
+  EXPECT_EQ(0U, UAVObjIDByIndex(NUM_OBJECTS));
+
+  // An object registered later, even with the lowest id, comes last
+  std::vector<uint32_t> sorted(ids);
+  std::sort(sorted.begin(), sorted.end());
+  ASSERT_GT(sorted.front(), 2U);
+  ASSERT_TRUE(UAVObjRegister(sorted.front() - 2, true, false, OBJECT_BYTES, NULL) != NULL);
+  ASSERT_EQ(NUM_OBJECTS + 1, UAVObjCount());
+  for (int i = 0; i < NUM_OBJECTS; i++) {
+    EXPECT_EQ(ids[i], UAVObjIDByIndex(i));
+  }
+  EXPECT_EQ(sorted.front() - 2, UAVObjIDByIndex(NUM_OBJECTS));
+}
+
+TEST_F(UAVObjectManager, IndexesTheInstances) {
+  UAVObjHandle obj = handles[0];
+  ASSERT_FALSE(UAVObjIsSingleInstance(obj));
+
+  const int instances = 200;
+  for (int i = 1; i < instances; i++) {
+    EXPECT_EQ(i, UAVObjCreateInstance(obj, NULL));
+  }
+  EXPECT_EQ(instances, UAVObjGetNumInstances(obj));
+
+  uint8_t data[OBJECT_BYTES];
+  for (int i = 0; i < instances; i++) {
+    memset(data, i, sizeof(data));
+    EXPECT_EQ(0, UAVObjSetInstanceData(obj, i, data));
+  }
+  for (int i = 0; i < instances; i++) {
+    EXPECT_EQ(0, UAVObjGetInstanceData(obj, i, data));
+    EXPECT_EQ(i, data[0]);
+    EXPECT_EQ(i, data[OBJECT_BYTES - 1]);
+  }
+
+  EXPECT_EQ(-1, UAVObjGetInstanceData(obj, instances, data));
+  EXPECT_EQ(-1, UAVObjGetInstanceData(handles[1], 1, data));
+}
+
+// The object list as walked by the lookups before they were indexed
+struct ListedObject {
+  uint32_t id;
+  ListedObject *next;
+};
+
+static ListedObject *find_listed(ListedObject *list, uint32_t id)
+{
+  for (ListedObject *obj = list; obj; obj = obj->next) {
+    if (obj->id == id || obj->id + 1 == id)
+      return obj;
+  }
+  return NULL;
+}
+
+TEST_F(UAVObjectManager, LookupTime) {
+  ListedObject *list = NULL;
+  for (int i = NUM_OBJECTS - 1; i >= 0; i--) {
+    ListedObject *obj = new ListedObject;
+    obj->id = ids[i];
+    obj->next = list;
+    list = obj;
+  }
+
+  // Received objects, in no particular order
+  std::vector<uint32_t> received;
+  for (int i = 0; i < NUM_OBJECTS; i++) {
+    received.push_back(ids[(i * 37) % NUM_OBJECTS]);
+  }
+
+  int found = 0;
+  double start = now_ns();
+  for (int round = 0; round < LOOKUP_ROUNDS; round++) {
+    for (int i = 0; i < NUM_OBJECTS; i++) {
+      found += find_listed(list, received[i]) != NULL;
+    }
+  }
+  double list_ns = (now_ns() - start) / (LOOKUP_ROUNDS * NUM_OBJECTS);
+  EXPECT_EQ(LOOKUP_ROUNDS * NUM_OBJECTS, found);
+
+  found = 0;
+  start = now_ns();
+  for (int round = 0; round < LOOKUP_ROUNDS; round++) {
+    for (int i = 0; i < NUM_OBJECTS; i++) {
+      found += UAVObjGetByID(received[i]) != NULL;
+    }
+  }
+  double index_ns = (now_ns() - start) / (LOOKUP_ROUNDS * NUM_OBJECTS);
+  EXPECT_EQ(LOOKUP_ROUNDS * NUM_OBJECTS, found);
+
+  printf("%d objects: list walked in %5.1f ns/lookup, index searched in %5.1f ns/lookup\n",
+      NUM_OBJECTS, list_ns, index_ns);
+  EXPECT_LT(index_ns, list_ns);
+
+  while (list) {
+    ListedObject *next = list->next;
+    delete list;
+    list = next;
+  }
+}
+
+TEST_F(UAVObjectManager, InstanceTime) {
+  UAVObjHandle obj = handles[0];
+  const int instances = UAVOBJ_MAX_INSTANCES;
+  while (UAVObjGetNumInstances(obj) < instances) {
+    ASSERT_NE(0, UAVObjCreateInstance(obj, NULL));
+  }
+
+  // The last instance takes no longer to reach than the first one
+  uint8_t data[OBJECT_BYTES];
+  double ns[2];
+  const uint16_t inst_ids[2] = { 1, instances - 1 };
+  for (int i = 0; i < 2; i++) {
+    double start = now_ns();
+    for (int round = 0; round < LOOKUP_ROUNDS * 10; round++) {
+      UAVObjGetInstanceData(obj, inst_ids[i], data);
+    }
+    ns[i] = (now_ns() - start) / (LOOKUP_ROUNDS * 10);
+  }
+
+  printf("Instance %d read in %5.1f ns, instance %d in %5.1f ns\n", inst_ids[0], ns[0], inst_ids[1], ns[1]);
+  EXPECT_LT(ns[1], ns[0] * 4);
+}
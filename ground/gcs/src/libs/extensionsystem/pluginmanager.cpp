@@ -143,6 +143,11 @@ enum { debugLeaks = 0 };
     determine the type of an object.
     If there are more than one object of the given type in
     the object pool, this method will choose an arbitrary one of them.
+    The pool is searched once for each type and the result is cached
+    until an object is added to or removed from the pool, so the type
+    must declare Q_OBJECT: its meta object is the key of the cache.
+    Components added to an aggregate already in the pool are not seen
+    by a cached lookup until the pool changes.
 
     \sa addObject()
 */
@@ -181,7 +186,8 @@ PluginManager *PluginManager::instance()
     Create a plugin manager. Should be done only once per application.
 */
 PluginManager::PluginManager()
-    : d(new PluginManagerPrivate(this)),m_allPluginsLoaded(false)
+    : d(new PluginManagerPrivate(this)),m_allPluginsLoaded(false),
+      m_objectCacheGeneration(0)
 {
     m_instance = this;
 }
@@ -235,6 +241,31 @@ QList<QObject *> PluginManager::allObjects() const
     return d->allObjects;
 }
 
+/*!
+    \fn void PluginManager::cacheObject(const QMetaObject *type, QObject *obj, quint32 generation) const
+    Remembers \a obj as the result of getObject() for \a type, unless the
+    cache was cleared since \a generation was read.
+    \internal
+*/
+void PluginManager::cacheObject(const QMetaObject *type, QObject *obj, quint32 generation) const
+{
+    QWriteLocker lock(&m_objectCacheLock);
+    if (generation == m_objectCacheGeneration)
+        m_objectCache.insert(type, obj);
+}
+
+/*!
+    \fn void PluginManager::clearObjectCache()
+    Forgets the results of getObject(), called when the object pool changes.
+    \internal
+*/
+void PluginManager::clearObjectCache()
+{
+    QWriteLocker lock(&m_objectCacheLock);
+    m_objectCache.clear();
+    m_objectCacheGeneration++;
+}
+
 /*!
     \fn void PluginManager::loadPlugins()
     Tries to load all the plugins that were previously found when
@@ -543,6 +574,7 @@ void PluginManagerPrivate::addObject(QObject *obj)
             qDebug() << "PluginManagerPrivate::addObject" << obj << obj->objectName();
 
         allObjects.append(obj);
+        q->clearObjectCache();
     }
     emit q->objectAdded(obj);
 }
@@ -569,6 +601,7 @@ void PluginManagerPrivate::removeObject(QObject *obj)
     emit q->aboutToRemoveObject(obj);
     QWriteLocker lock(&(q->m_lock));
     allObjects.removeAll(obj);
+    q->clearObjectCache();
 }
 
 /*!
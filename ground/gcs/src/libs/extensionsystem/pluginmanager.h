@@ -37,6 +37,7 @@
 #include <QtCore/QObject>
 #include <QtCore/QStringList>
 #include <QtCore/QReadWriteLock>
+#include <QtCore/QHash>
 
 QT_BEGIN_NAMESPACE
 class QTextStream;
@@ -81,6 +82,16 @@ public:
     }
     template <typename T> T *getObject() const
     {
+        const QMetaObject *type = &T::staticMetaObject;
+        quint32 generation;
+        {
+            QReadLocker cacheLock(&m_objectCacheLock);
+            QHash<const QMetaObject *, QObject *>::const_iterator it = m_objectCache.constFind(type);
+            if (it != m_objectCache.constEnd())
+                return static_cast<T *>(it.value());
+            generation = m_objectCacheGeneration;
+        }
+
         QReadLocker lock(&m_lock);
         QList<QObject *> all = allObjects();
         T *result = 0;
@@ -88,6 +99,7 @@ public:
             if ((result = Aggregation::query<T>(obj)) != 0)
                 break;
         }
+        cacheObject(type, result, generation);
         return result;
     }
 
@@ -123,11 +135,20 @@ private slots:
     void startTests();
 
 private:
+    void cacheObject(const QMetaObject *type, QObject *obj, quint32 generation) const;
+    void clearObjectCache();
+
     Internal::PluginManagerPrivate *d;
     static PluginManager *m_instance;
     mutable QReadWriteLock m_lock;
     bool m_allPluginsLoaded;
 
+    //! Result of getObject() for each type, null when the pool has none
+    mutable QHash<const QMetaObject *, QObject *> m_objectCache;
+    //! Incremented when the cache is cleared, so that searches started before are not cached
+    quint32 m_objectCacheGeneration;
+    mutable QReadWriteLock m_objectCacheLock;
+
     friend class Internal::PluginManagerPrivate;
 };
 
@@ -1,3 +1,3 @@
 TEMPLATE = subdirs
-SUBDIRS = pluginmanager pluginspec
+SUBDIRS = pluginmanager pluginspec objectpoolbenchmark
 
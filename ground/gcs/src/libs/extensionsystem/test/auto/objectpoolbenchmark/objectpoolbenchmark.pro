@@ -0,0 +1,15 @@
+# Benchmark of PluginManager::getObject() while the plugins start, when
+# objects are added between lookups, and on the hot path, with the pool
+# scanned as before and with the cached lookups. The hot path lookups are
+# set with OBJECTPOOL_BENCH_LOOKUPS.
+
+QT += testlib
+QT -= gui
+TARGET = tst_objectpoolbenchmark
+CONFIG += console testcase
+CONFIG -= app_bundle
+TEMPLATE = app
+
+include(../../extensionsystem_test.pri)
+
+SOURCES += tst_objectpoolbenchmark.cpp
@@ -0,0 +1,268 @@
+/**
+ ******************************************************************************
+ * @file       tst_objectpoolbenchmark.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @brief Measures the lookups of objects in the pool of the plugin manager
+ * while the plugins start and on the hot path, and checks the cached lookups
+ * follow the changes to the pool
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <extensionsystem/pluginmanager.h>
+#include <aggregation/aggregate.h>
+
+#include <QtTest/QtTest>
+#include <QElapsedTimer>
+
+using namespace ExtensionSystem;
+
+class PoolObject : public QObject
+{
+    Q_OBJECT
+};
+
+class ObjectManager : public QObject
+{
+    Q_OBJECT
+};
+
+class UtilManager : public QObject
+{
+    Q_OBJECT
+};
+
+class AggregatedSettings : public QObject
+{
+    Q_OBJECT
+};
+
+class tst_ObjectPoolBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void startup_data();
+    void startup();
+    void hotPath_data();
+    void hotPath();
+    void cacheFollowsPool();
+
+private:
+    int m_lookups;
+};
+
+//! Lookups done by each plugin as it starts
+static const int LOOKUPS_PER_OBJECT = 3;
+
+/**
+ * Lookup as done before: every object of the pool is queried in turn
+ */
+template <typename T> static T *scanPool(const PluginManager &pm)
+{
+    QList<QObject *> all = pm.allObjects();
+    T *result = 0;
+    foreach (QObject *obj, all) {
+        if ((result = Aggregation::query<T>(obj)) != 0)
+            break;
+    }
+    return result;
+}
+
+/**
+ * Fills the pool with filler objects, the looked up objects last
+ */
+static void fillPool(PluginManager &pm, int objects, QList<QObject *> &added)
+{
+    for (int i = 0; i < objects; i++)
+        added << new PoolObject;
+    added << new ObjectManager << new UtilManager;
+
+    Aggregation::Aggregate *aggregate = new Aggregation::Aggregate;
+    QObject *aggregated = new PoolObject;
+    aggregate->add(aggregated);
+    aggregate->add(new AggregatedSettings);
+    added << aggregated;
+
+    foreach (QObject *obj, added)
+        pm.addObject(obj);
+}
+
+static void emptyPool(PluginManager &pm, QList<QObject *> &added)
+{
+    foreach (QObject *obj, added)
+        pm.removeObject(obj);
+    // Deleting a component deletes its whole aggregate
+    qDeleteAll(added);
+    added.clear();
+}
+
+void tst_ObjectPoolBenchmark::initTestCase()
+{
+    m_lookups = qgetenv("OBJECTPOOL_BENCH_LOOKUPS").toInt();
+    if (m_lookups <= 0)
+        m_lookups = 1000000;
+}
+
+void tst_ObjectPoolBenchmark::startup_data()
+{
+    QTest::addColumn<int>("objects");
+
+    QTest::newRow("10") << 10;
+    QTest::newRow("100") << 100;
+    QTest::newRow("1000") << 1000;
+}
+
+/**
+ * Every object added to the pool is followed by a few lookups, as when the
+ * plugins add their objects and look up the ones of the others, so the cache
+ * is cleared between them
+ */
+void tst_ObjectPoolBenchmark::startup()
+{
+    QFETCH(int, objects);
+
+    PluginManager pm;
+    ObjectManager *manager = new ObjectManager;
+    pm.addObject(manager);
+
+    QList<QObject *> added;
+    for (int i = 0; i < objects; i++)
+        added << new PoolObject;
+
+    QElapsedTimer timer;
+    timer.start();
+    int scanFound = 0;
+    foreach (QObject *obj, added) {
+        pm.addObject(obj);
+        for (int i = 0; i < LOOKUPS_PER_OBJECT; i++)
+            scanFound += scanPool<ObjectManager>(pm) == manager;
+    }
+    double scanMs = timer.nsecsElapsed() / 1e6;
+
+    foreach (QObject *obj, added)
+        pm.removeObject(obj);
+
+    timer.start();
+    int cachedFound = 0;
+    foreach (QObject *obj, added) {
+        pm.addObject(obj);
+        for (int i = 0; i < LOOKUPS_PER_OBJECT; i++)
+            cachedFound += pm.getObject<ObjectManager>() == manager;
+    }
+    double cachedMs = timer.nsecsElapsed() / 1e6;
+
+    qDebug("Startup with %4d objects: scanned %8.3f ms, cached %8.3f ms", objects, scanMs, cachedMs);
+
+    QCOMPARE(scanFound, objects * LOOKUPS_PER_OBJECT);
+    QCOMPARE(cachedFound, objects * LOOKUPS_PER_OBJECT);
+
+    foreach (QObject *obj, added)
+        pm.removeObject(obj);
+    pm.removeObject(manager);
+    qDeleteAll(added);
+    delete manager;
+}
+
+void tst_ObjectPoolBenchmark::hotPath_data()
+{
+    QTest::addColumn<int>("objects");
+
+    QTest::newRow("10") << 10;
+    QTest::newRow("100") << 100;
+    QTest::newRow("1000") << 1000;
+}
+
+/**
+ * Repeated lookups of the same types in a pool that does not change, as in
+ * the update paths of the gadgets
+ */
+void tst_ObjectPoolBenchmark::hotPath()
+{
+    QFETCH(int, objects);
+
+    PluginManager pm;
+    QList<QObject *> added;
+    fillPool(pm, objects, added);
+
+    // Fewer scans in the large pools
+    int scans = qMin(m_lookups, qMax(m_lookups / objects * 10, 1000));
+
+    QElapsedTimer timer;
+    timer.start();
+    int scanFound = 0;
+    for (int i = 0; i < scans; i++)
+        scanFound += scanPool<ObjectManager>(pm) != 0;
+    double scanNs = timer.nsecsElapsed() / (double) scans;
+
+    timer.start();
+    int cachedFound = 0;
+    for (int i = 0; i < m_lookups; i++)
+        cachedFound += pm.getObject<ObjectManager>() != 0;
+    double cachedNs = timer.nsecsElapsed() / (double) m_lookups;
+
+    qDebug("Lookups in %4d objects: scanned %9.1f ns/lookup, cached %6.1f ns/lookup", objects, scanNs, cachedNs);
+
+    QCOMPARE(scanFound, scans);
+    QCOMPARE(cachedFound, m_lookups);
+
+    emptyPool(pm, added);
+}
+
+/**
+ * The cached lookups give the same objects as scanning the pool, including
+ * the components of aggregates and the types missing from the pool, after
+ * every change to the pool
+ */
+void tst_ObjectPoolBenchmark::cacheFollowsPool()
+{
+    PluginManager pm;
+    QList<QObject *> added;
+
+    QCOMPARE(pm.getObject<ObjectManager>(), (ObjectManager *) 0);
+
+    fillPool(pm, 5, added);
+    for (int i = 0; i < 2; i++) {
+        QVERIFY(pm.getObject<ObjectManager>() != 0);
+        QCOMPARE(pm.getObject<ObjectManager>(), scanPool<ObjectManager>(pm));
+        QCOMPARE(pm.getObject<UtilManager>(), scanPool<UtilManager>(pm));
+        QVERIFY(pm.getObject<AggregatedSettings>() != 0);
+        QCOMPARE(pm.getObject<AggregatedSettings>(), scanPool<AggregatedSettings>(pm));
+        QCOMPARE(pm.getObject<PoolObject>(), qobject_cast<PoolObject *>(added.first()));
+    }
+
+    // A second object of the type is found once the first one is removed
+    ObjectManager *first = pm.getObject<ObjectManager>();
+    ObjectManager *second = new ObjectManager;
+    pm.addObject(second);
+    QCOMPARE(pm.getObject<ObjectManager>(), first);
+    pm.removeObject(first);
+    QCOMPARE(pm.getObject<ObjectManager>(), second);
+    pm.removeObject(second);
+    QCOMPARE(pm.getObject<ObjectManager>(), (ObjectManager *) 0);
+    added.removeAll(first);
+    delete first;
+    delete second;
+
+    emptyPool(pm, added);
+    QCOMPARE(pm.getObject<UtilManager>(), (UtilManager *) 0);
+    QCOMPARE(pm.getObject<AggregatedSettings>(), (AggregatedSettings *) 0);
+}
+
+QTEST_MAIN(tst_ObjectPoolBenchmark)
+
+#include "tst_objectpoolbenchmark.moc"
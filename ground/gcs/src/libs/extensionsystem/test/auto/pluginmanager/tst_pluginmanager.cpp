@@ -160,7 +160,11 @@ void tst_PluginManager::getObject()
     QCOMPARE(m_pm->getObject<MyClass1>(), qobject_cast<MyClass1*>(object11));
     QCOMPARE(m_pm->getObject<MyClass2>(), object2);
     m_pm->removeObject(object2);
+    QCOMPARE(m_pm->getObject<MyClass2>(), (MyClass2*)0);
+    QCOMPARE(m_pm->getObject<MyClass11>(), object11);
     m_pm->removeObject(object11);
+    QCOMPARE(m_pm->getObject<MyClass11>(), (MyClass11*)0);
+    QCOMPARE(m_pm->getObject<MyClass1>(), (MyClass1*)0);
     delete object2;
     delete object11;
 }
@@ -38,9 +38,13 @@ struct diagnostics
     int tilesFromMem;
     int tilesFromNet;
     int tilesFromDB;
+    //! Decoded tiles looked up in memory and not found, tilesFromMem are the hits
+    int memoryCacheMisses;
+    int prefetchedTiles;
+    double memoryCacheMB;
     QString toString()
     {
-        return QString("Network errors:%1\nEmpty Tiles:%2\nTimeOuts:%3\nRunningThreads:%4\nTilesFromMem:%5\nTilesFromNet:%6\nTilesFromDB:%7").arg(networkerrors).arg(emptytiles).arg(timeouts).arg(runningThreads).arg(tilesFromMem).arg(tilesFromNet).arg(tilesFromDB);
+        return QString("Network errors:%1\nEmpty Tiles:%2\nTimeOuts:%3\nRunningThreads:%4\nTilesFromMem:%5\nTilesFromNet:%6\nTilesFromDB:%7\nMemoryCacheMisses:%8\nPrefetchedTiles:%9\nMemoryCacheMB:%10").arg(networkerrors).arg(emptytiles).arg(timeouts).arg(runningThreads).arg(tilesFromMem).arg(tilesFromNet).arg(tilesFromDB).arg(memoryCacheMisses).arg(prefetchedTiles).arg(memoryCacheMB,0,'f',1);
        ;
     }
 };
@@ -27,44 +27,46 @@
 */
 #include "kibertilecache.h"
 
-//TODO add readwrite lock
-
 namespace core {
     KiberTileCache::KiberTileCache()
     {
-        memoryCacheSize = 0;
-        _MemoryCacheCapacity = 22;
+        // A decoded 256x256 tile takes 256kB
+        setMemoryCacheCapacity(128);
     }
 
     void KiberTileCache::setMemoryCacheCapacity(const int &value)
     {
-        kiberCacheLock.lockForWrite();
+        QMutexLocker locker(&mutex);
         _MemoryCacheCapacity=value;
-        kiberCacheLock.unlock();
+        tiles.setMaxCost(value*1024);
     }
     int KiberTileCache::MemoryCacheCapacity()
     {
-        kiberCacheLock.lockForRead();
+        QMutexLocker locker(&mutex);
         return _MemoryCacheCapacity;
-        kiberCacheLock.unlock();
     }
-
-    void KiberTileCache::RemoveMemoryOverload()
+    double KiberTileCache::MemoryCacheSize()
     {
-        while(MemoryCacheSize()>MemoryCacheCapacity())
-        {
-            if(cachequeue.count()>0 && list.count()>0)
-            {
-#ifdef DEBUG_MEMORY_CACHE
-                qDebug()<<"Cleaning Memory cache="<<" started with "<<cachequeue.count()<<" tile "<<"ocupying "<<memoryCacheSize<<" bytes";
-#endif
-                RawTile first=list.dequeue();
-                memoryCacheSize-=cachequeue.value(first).size();
-                cachequeue.remove(first);
-            }
-        }
+        QMutexLocker locker(&mutex);
+        return tiles.totalCost()/1024.0;
+    }
+    QImage KiberTileCache::Get(const RawTile &tile)
+    {
+        QMutexLocker locker(&mutex);
+        QImage *image=tiles.object(tile);
+        return image ? *image : QImage();
+    }
+    void KiberTileCache::Insert(const RawTile &tile, const QImage &image)
+    {
+        QMutexLocker locker(&mutex);
+        tiles.insert(tile,new QImage(image),qMax(image.byteCount()/1024,1));
 #ifdef DEBUG_MEMORY_CACHE
-        qDebug()<<"Cleaning Memory cache="<<" ended with "<<cachequeue.count()<<" tile "<<"ocupying "<<memoryCacheSize<<" bytes";
+        qDebug()<<"Current memory="<<tiles.totalCost()<<"kB in "<<tiles.count()<<" tiles";
 #endif
     }
+    bool KiberTileCache::Contains(const RawTile &tile)
+    {
+        QMutexLocker locker(&mutex);
+        return tiles.contains(tile);
+    }
 }
@@ -30,11 +30,15 @@
 
 #include "rawtile.h"
 #include <QMutex>
-#include <QReadWriteLock>
-#include <QQueue>
+#include <QCache>
+#include <QImage>
 #include <QDebug>
 #include "debugheader.h"
 namespace core {
+    /**
+     * Decoded tiles, up to a budget in MB. The least recently used tiles
+     * are dropped first when the budget is exceeded.
+     */
     class KiberTileCache
     {
     public:
@@ -42,13 +46,15 @@ namespace core {
 
         void setMemoryCacheCapacity(const int &value);
         int MemoryCacheCapacity();
-        double MemoryCacheSize(){return memoryCacheSize/1048576.0;}
-        void RemoveMemoryOverload();
-        QReadWriteLock kiberCacheLock;
-        QHash <RawTile,QByteArray> cachequeue;
-        QQueue <RawTile> list;
-        long memoryCacheSize;
+        double MemoryCacheSize();
+        QImage Get(const RawTile &tile);
+        void Insert(const RawTile &tile, const QImage &image);
+        bool Contains(const RawTile &tile);
     private:
+        //! Looking a tile up reorders the cache, so reads lock too
+        QMutex mutex;
+        //! Cost of a tile is its size in kB
+        QCache<RawTile,QImage> tiles;
         int _MemoryCacheCapacity;
 
     };
@@ -29,9 +29,6 @@
 #define MEMORYCACHE_H
 
 #include "rawtile.h"
-#include <QMutex>
-#include <QReadWriteLock>
-#include <QQueue>
 #include "kibertilecache.h"
 #include <QDebug>
 #include "debugheader.h"
@@ -42,9 +39,8 @@ namespace core {
         MemoryCache();
 
         KiberTileCache TilesInMemory;
-        QByteArray GetTileFromMemoryCache(const RawTile &tile);
-        void AddTileToMemoryCache(const RawTile &tile, const QByteArray &pic);
-        QReadWriteLock kiberCacheLock;
+        QImage GetTileFromMemoryCache(const RawTile &tile);
+        void AddTileToMemoryCache(const RawTile &tile, const QImage &pic);
     };
 
 
@@ -32,15 +32,21 @@
 namespace core {
     qlonglong PureImageCache::ConnCounter=0;
 
-    PureImageCache::PureImageCache()
+    PureImageCache::PureImageCache():generation(0)
     {
 
     }
+    PureImageCache::~PureImageCache()
+    {
+        // Close the connection of this thread, the others close when their thread exits
+        connections.setLocalData(0);
+    }
 
     void PureImageCache::setGtileCache(const QString &value)
     {
         lock.lockForWrite();
         gtilecache=value;
+        generation++;
         QDir d;
         if(!d.exists(gtilecache))
         {
@@ -172,6 +178,89 @@ namespace core {
         QSqlDatabase::removeDatabase(QLatin1String("CreateConn"));
         return true;
     }
+    PureImageCache::Connection::Connection(const QString &file, const QString &name, int generation):name(name),generation(generation)
+    {
+        db = QSqlDatabase::addDatabase("QSQLITE",name);
+        db.setDatabaseName(file);
+    }
+    PureImageCache::Connection::~Connection()
+    {
+        // The queries and the handle must be released before the connection is removed
+        insertTile = QSqlQuery();
+        insertData = QSqlQuery();
+        selectTile = QSqlQuery();
+        db.close();
+        db = QSqlDatabase();
+        QSqlDatabase::removeDatabase(name);
+    }
+    bool PureImageCache::Connection::open()
+    {
+        if(!db.open())
+            return false;
+        QSqlQuery query(db);
+        // With a write-ahead log the map keeps reading tiles while the
+        // cache queue writes new ones
+        query.exec("PRAGMA journal_mode=WAL");
+        query.exec("PRAGMA synchronous=NORMAL");
+        // Caches created before the index existed get it on the first open
+        query.exec("CREATE INDEX IF NOT EXISTS IndexOfTiles ON Tiles (X, Y, Zoom, Type)");
+
+        insertTile = QSqlQuery(db);
+        insertData = QSqlQuery(db);
+        selectTile = QSqlQuery(db);
+        selectTile.setForwardOnly(true);
+        if(!insertTile.prepare("INSERT INTO Tiles(X, Y, Zoom, Type, Date) VALUES(?, ?, ?, ?, ?)") ||
+                !insertData.prepare("INSERT INTO TilesData(id, Tile) VALUES(?, ?)") ||
+                !selectTile.prepare("SELECT Tile FROM TilesData WHERE id = (SELECT id FROM Tiles WHERE X=? AND Y=? AND Zoom=? AND Type=?)"))
+        {
+#ifdef DEBUG_PUREIMAGECACHE
+            qDebug()<<"Connection: "<<db.lastError().driverText();
+#endif //DEBUG_PUREIMAGECACHE
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Get the connection of the calling thread, opening it on the first use
+     * and when the cache location changed. Must be called with the lock held.
+     * @return the connection or 0 if the database could not be opened
+     */
+    PureImageCache::Connection *PureImageCache::connection()
+    {
+        if(connections.hasLocalData())
+        {
+            Connection *cn=connections.localData();
+            if(cn && cn->generation==generation)
+                return cn;
+        }
+        Mcounter.lock();
+        qlonglong id=++ConnCounter;
+        Mcounter.unlock();
+        // Replacing the local data deletes the previous connection
+        connections.setLocalData(0);
+        Connection *cn=new Connection(gtilecache+"Data.qmdb",QString::number(id),generation);
+        if(!cn->open())
+        {
+            delete cn;
+            return 0;
+        }
+        connections.setLocalData(cn);
+        return cn;
+    }
+    bool PureImageCache::storeTile(Connection *cn, const QByteArray &tile, const MapType::Types &type, const Point &pos, int zoom, const QString &date)
+    {
+        cn->insertTile.addBindValue(pos.X());
+        cn->insertTile.addBindValue(pos.Y());
+        cn->insertTile.addBindValue(zoom);
+        cn->insertTile.addBindValue((int)type);
+        cn->insertTile.addBindValue(date);
+        if(!cn->insertTile.exec())
+            return false;
+        cn->insertData.addBindValue(cn->insertTile.lastInsertId());
+        cn->insertData.addBindValue(tile);
+        return cn->insertData.exec();
+    }
     bool PureImageCache::PutImageToCache(const QByteArray &tile, const MapType::Types &type,const Point &pos,const int &zoom)
     {
         if(gtilecache.isEmpty()|gtilecache.isNull())
@@ -180,80 +269,74 @@ namespace core {
 #ifdef DEBUG_PUREIMAGECACHE
         qDebug()<<"PutImageToCache Start:";//<<pos;
 #endif //DEBUG_PUREIMAGECACHE
-        Mcounter.lock();
-        qlonglong id=++ConnCounter;
-        Mcounter.unlock();
+        bool ret=false;
+        Connection *cn=connection();
+        if(cn)
+            ret=storeTile(cn,tile,type,pos,zoom,QDateTime::currentDateTime().toString());
+        lock.unlock();
+        return ret;
+    }
+    /**
+     * Store several tiles in one transaction, which costs about as much as
+     * storing one tile on its own
+     */
+    bool PureImageCache::PutImagesToCache(const QList<CacheItemQueue*> &tiles)
+    {
+        if(gtilecache.isEmpty()|gtilecache.isNull())
+            return false;
+        lock.lockForRead();
+#ifdef DEBUG_PUREIMAGECACHE
+        qDebug()<<"PutImagesToCache Start:"<<tiles.count();
+#endif //DEBUG_PUREIMAGECACHE
+        bool ret=false;
+        Connection *cn=connection();
+        if(cn && cn->db.transaction())
         {
-            QSqlDatabase cn;
-            cn = QSqlDatabase::addDatabase("QSQLITE",QString::number(id));
-            QString db=gtilecache+"Data.qmdb";
-            cn.setDatabaseName(db);
-            cn.setConnectOptions("QSQLITE_ENABLE_SHARED_CACHE");
-            if(cn.open())
+            QString date=QDateTime::currentDateTime().toString();
+            ret=true;
+            foreach(CacheItemQueue *task,tiles)
             {
+                if(!storeTile(cn,task->GetImg(),task->GetMapType(),task->GetPosition(),task->GetZoom(),date))
                 {
-                    QSqlQuery query(cn);
-                    query.prepare("INSERT INTO Tiles(X, Y, Zoom, Type,Date) VALUES(?, ?, ?, ?,?)");
-                    query.addBindValue(pos.X());
-                    query.addBindValue(pos.Y());
-                    query.addBindValue(zoom);
-
-                    query.addBindValue((int)type);
-                    query.addBindValue(QDateTime::currentDateTime().toString());
-                    query.exec();
-                }
-                {
-                    QSqlQuery query(cn);
-                    query.prepare("INSERT INTO TilesData(id, Tile) VALUES((SELECT last_insert_rowid()), ?)");
-                    query.addBindValue(tile);
-                    query.exec();
+#ifdef DEBUG_PUREIMAGECACHE
+                    qDebug()<<"PutImagesToCache: "<<cn->insertTile.lastError().driverText()<<cn->insertData.lastError().driverText();
+#endif //DEBUG_PUREIMAGECACHE
+                    ret=false;
                 }
-                cn.close();
+            }
+            if(!cn->db.commit())
+            {
+                cn->db.rollback();
+                ret=false;
             }
         }
-        QSqlDatabase::removeDatabase(QString::number(id));
         lock.unlock();
-        return true;
+        return ret;
     }
     QByteArray PureImageCache::GetImageFromCache(MapType::Types type, Point pos, int zoom)
     {
-        lock.lockForRead();
         QByteArray ar;
+        lock.lockForRead();
         if(gtilecache.isEmpty()|gtilecache.isNull())
+        {
+            lock.unlock();
             return ar;
-        QString dir=gtilecache;
-        Mcounter.lock();
-        qlonglong id=++ConnCounter;
-        Mcounter.unlock();
+        }
 #ifdef DEBUG_PUREIMAGECACHE
-        qDebug()<<"Cache dir="<<dir<<" Try to GET:"<<pos.X()+","+pos.Y();
+        qDebug()<<"Cache dir="<<gtilecache<<" Try to GET:"<<pos.X()+","+pos.Y();
 #endif //DEBUG_PUREIMAGECACHE
-
+        Connection *cn=connection();
+        if(cn)
         {
-            QString db=dir+"Data.qmdb";
-            {
-                QSqlDatabase cn;
-
-                cn = QSqlDatabase::addDatabase("QSQLITE",QString::number(id));
-
-                cn.setDatabaseName(db);
-                cn.setConnectOptions("QSQLITE_ENABLE_SHARED_CACHE");
-                if(cn.open())
-                {
-                    {
-                        QSqlQuery query(cn);
-                        query.exec(QString("SELECT Tile FROM TilesData WHERE id = (SELECT id FROM Tiles WHERE X=%1 AND Y=%2 AND Zoom=%3 AND Type=%4)").arg(pos.X()).arg(pos.Y()).arg(zoom).arg((int) type));
-                        query.next();
-                        if(query.isValid())
-                        {
-                            ar=query.value(0).toByteArray();
-                        }
-                    }
-                    cn.close();
-                }
-            }
+            cn->selectTile.addBindValue(pos.X());
+            cn->selectTile.addBindValue(pos.Y());
+            cn->selectTile.addBindValue(zoom);
+            cn->selectTile.addBindValue((int) type);
+            if(cn->selectTile.exec() && cn->selectTile.next())
+                ar=cn->selectTile.value(0).toByteArray();
+            // Ends the read transaction so the log can be checkpointed
+            cn->selectTile.finish();
         }
-        QSqlDatabase::removeDatabase(QString::number(id));
         lock.unlock();
         return ar;
     }
@@ -262,41 +345,34 @@ namespace core {
         if(gtilecache.isEmpty()|gtilecache.isNull())
             return;
         QList<long> add;
-        bool ret=true;
-        QString dir=gtilecache;
+        lock.lockForRead();
+        if(QFileInfo(gtilecache+"Data.qmdb").exists())
         {
-            QString db=dir+"Data.qmdb";
-            ret=QFileInfo(db).exists();
-            if(ret)
+            Connection *cn=connection();
+            if(cn)
             {
-                QSqlDatabase cn;
-                Mcounter.lock();
-                qlonglong id=++ConnCounter;
-                Mcounter.unlock();
-                cn = QSqlDatabase::addDatabase("QSQLITE",QString::number(id));
-                cn.setDatabaseName(db);
-                cn.setConnectOptions("QSQLITE_ENABLE_SHARED_CACHE");
-                if(cn.open())
                 {
+                    QSqlQuery query(cn->db);
+                    query.setForwardOnly(true);
+                    query.exec(QString("SELECT id, Date FROM Tiles"));
+                    while(query.next())
                     {
-                        QSqlQuery query(cn);
-                        query.exec(QString("SELECT id, X, Y, Zoom, Type, Date FROM Tiles"));
-                        while(query.next())
-                        {
-                            if(QDateTime::fromString(query.value(5).toString()).daysTo(QDateTime::currentDateTime())>days)
-                                add.append(query.value(0).toLongLong());
-                        }
-                        foreach(long i,add)
-                        {
-                            query.exec(QString("DELETE FROM Tiles WHERE id = %1;").arg(i));
-                        }
+                        if(QDateTime::fromString(query.value(1).toString()).daysTo(QDateTime::currentDateTime())>days)
+                            add.append(query.value(0).toLongLong());
                     }
-
-                    cn.close();
                 }
-                QSqlDatabase::removeDatabase(QString::number(id));
+                cn->db.transaction();
+                QSqlQuery query(cn->db);
+                query.prepare("DELETE FROM Tiles WHERE id = ?");
+                foreach(long i,add)
+                {
+                    query.addBindValue((qlonglong)i);
+                    query.exec();
+                }
+                cn->db.commit();
             }
         }
+        lock.unlock();
     }
     // PureImageCache::ExportMapDataToDB("C:/Users/Xapo/Documents/mapcontrol/debug/mapscache/data.qmdb","C:/Users/Xapo/Documents/mapcontrol/debug/mapscache/data2.qmdb");
     bool PureImageCache::ExportMapDataToDB(QString sourceFile, QString destFile)
@@ -43,21 +43,52 @@
 #include <QList>
 #include <QMutex>
 #include <QReadWriteLock>
+#include <QThreadStorage>
+#include "cacheitemqueue.h"
 namespace core {
     class PureImageCache
     {
 
     public:
         PureImageCache();
+        ~PureImageCache();
         static bool CreateEmptyDB(const QString &file);
         bool PutImageToCache(const QByteArray &tile,const MapType::Types &type,const core::Point &pos, const int &zoom);
+        bool PutImagesToCache(const QList<CacheItemQueue*> &tiles);
         QByteArray GetImageFromCache(MapType::Types type, core::Point pos, int zoom);
         QString GtileCache();
         void setGtileCache(const QString &value);
         static bool ExportMapDataToDB(QString sourceFile, QString destFile);
         void deleteOlderTiles(int const& days);
     private:
+        /**
+         * A connection to the tile database kept open for the thread which
+         * uses it, with its statements prepared once. SQLite connections
+         * can't be shared between threads, so each thread gets its own.
+         */
+        class Connection
+        {
+        public:
+            Connection(const QString &file, const QString &name, int generation);
+            ~Connection();
+            bool open();
+
+            QString name;
+            //! Generation of the cache location the connection was opened for
+            int generation;
+            QSqlDatabase db;
+            QSqlQuery insertTile;
+            QSqlQuery insertData;
+            QSqlQuery selectTile;
+        };
+
+        Connection *connection();
+        bool storeTile(Connection *cn, const QByteArray &tile, const MapType::Types &type, const core::Point &pos, int zoom, const QString &date);
+
         QString gtilecache;
+        //! Changed with the cache location, so connections to the old database are reopened
+        int generation;
+        QThreadStorage<Connection*> connections;
         QMutex Mcounter;
         QReadWriteLock lock;
         static qlonglong ConnCounter;
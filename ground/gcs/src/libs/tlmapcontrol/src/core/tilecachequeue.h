@@ -51,6 +51,8 @@ namespace core {
     protected:
         QQueue<CacheItemQueue*> tileCacheQueue;
     private:
+        //! Most tiles stored in one transaction
+        static const int MaxBatchSize=256;
         void run();
         QMutex mutex;
         QMutex waitmutex;
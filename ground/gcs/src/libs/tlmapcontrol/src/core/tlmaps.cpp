@@ -84,203 +84,166 @@ namespace core {
 #endif //DEBUG_GMAPS
         QByteArray ret;
 
-        if(useMemoryCache)
+        //Attempt to read tile from cache
+        if(accessmode != (AccessMode::ServerOnly) && type != MapType::UserImage) //Don't use cache if the user supplies a file. This is because
         {
 #ifdef DEBUG_GMAPS
-            qDebug()<<"Try Tile from memory:Size="<<TilesInMemory.MemoryCacheSize();
+            qDebug()<<"Try tile from DataBase";
 #endif //DEBUG_GMAPS
-            ret=GetTileFromMemoryCache(RawTile(type,pos,zoom));
+            ret=Cache::Instance()->ImageCache.GetImageFromCache(type,pos,zoom);
             if(!ret.isEmpty())
             {
                 errorvars.lock();
-                ++diag.tilesFromMem;
+                ++diag.tilesFromDB;
                 errorvars.unlock();
-            }
-
-        }
-        if(ret.isEmpty())
-        {
 #ifdef DEBUG_GMAPS
-            qDebug()<<"Tile not in memory";
+                qDebug()<<"Tile found in Database";
 #endif //DEBUG_GMAPS
+                return ret;
+            }
+        }
 
-            //Attempt to read tile from cache
-            if(accessmode != (AccessMode::ServerOnly) && type != MapType::UserImage) //Don't use cache if the user supplies a file. This is because
-            {
-#ifdef DEBUG_GMAPS
-                qDebug()<<"Try tile from DataBase";
-#endif //DEBUG_GMAPS
-                ret=Cache::Instance()->ImageCache.GetImageFromCache(type,pos,zoom);
-                if(!ret.isEmpty())
+        //Attempt to read file from original source
+        if(accessmode!=AccessMode::CacheOnly)
+        {
+            //If it's a local user file...
+            if (type == MapType::UserImage)
                 {
-                    errorvars.lock();
-                    ++diag.tilesFromDB;
-                    errorvars.unlock();
-#ifdef DEBUG_GMAPS
-                    qDebug()<<"Tile found in Database";
-#endif //DEBUG_GMAPS
-                    if(useMemoryCache)
-                    {
-#ifdef DEBUG_GMAPS
-                        qDebug()<<"Add Tile to memory";
-#endif //DEBUG_GMAPS
-                        AddTileToMemoryCache(RawTile(type,pos,zoom),ret);
+                    //Load the image
+                    static QImage imMap(userImageFileName);
+
+                    //Get image width and height, in [m]
+                    static double widthPx=imMap.width();
+                    static double heightPx=imMap.height();
+                    static double width=widthPx*hScale;
+                    static double height=heightPx*vScale;
+                    static double cornerLLA[3];
+                    static bool once=true;
+
+                    //TODO: Only do this once, not every time
+                    if(once){
+                        once=false;
+
+                        double homeLLA[3]={0,0,0};
+                        double cornerNED[3]={-height, width, 0};
+                        Utils::CoordinateConversions().NED2LLA_HomeLLA(homeLLA, cornerNED, cornerLLA);
                     }
-                    return ret;
-                }
-            }
-
-            //Attempt to read file from original source
-            if(accessmode!=AccessMode::CacheOnly)
-            {
-                //If it's a local user file...
-                if (type == MapType::UserImage)
-                    {
-                        //Load the image
-                        static QImage imMap(userImageFileName);
-
-                        //Get image width and height, in [m]
-                        static double widthPx=imMap.width();
-                        static double heightPx=imMap.height();
-                        static double width=widthPx*hScale;
-                        static double height=heightPx*vScale;
-                        static double cornerLLA[3];
-                        static bool once=true;
-
-                        //TODO: Only do this once, not every time
-                        if(once){
-                            once=false;
-
-                            double homeLLA[3]={0,0,0};
-                            double cornerNED[3]={-height, width, 0};
-                            Utils::CoordinateConversions().NED2LLA_HomeLLA(homeLLA, cornerNED, cornerLLA);
-                        }
 
-                        //Get the tile width
-                        int tileSize= projection->TileSize().Width();
+                    //Get the tile width
+                    int tileSize= projection->TileSize().Width();
 
-                        //Only update is the zoom level has changed
-                        if(lastZoom != zoom){
-                            lastZoom=zoom;
+                    //Only update is the zoom level has changed
+                    if(lastZoom != zoom){
+                        lastZoom=zoom;
 
-                            //Generate image scaled for this zoom level
-                            imScaled=imMap.scaledToWidth(width / projection->GetGroundResolution(zoom, 0));
+                        //Generate image scaled for this zoom level
+                        imScaled=imMap.scaledToWidth(width / projection->GetGroundResolution(zoom, 0));
 
-                            //Find the quadtile that contains the opposite corner of the image
-                            double top=90, bottom=-90, left=-180, right=180;
-                            double lat=cornerLLA[0];
-                            double lon=cornerLLA[1];
-                            quadCoordRight=0;
-                            quadCoordBottom=0;
-                            for (int i=0; i<zoom; i++)
+                        //Find the quadtile that contains the opposite corner of the image
+                        double top=90, bottom=-90, left=-180, right=180;
+                        double lat=cornerLLA[0];
+                        double lon=cornerLLA[1];
+                        quadCoordRight=0;
+                        quadCoordBottom=0;
+                        for (int i=0; i<zoom; i++)
+                        {
+                            quadCoordRight <<=1;
+                            quadCoordBottom<<=1;
+                            if ((left+right)/2<lon	)
                             {
-                                quadCoordRight <<=1;
-                                quadCoordBottom<<=1;
-                                if ((left+right)/2<lon	)
-                                {
-                                    quadCoordRight|=1;
-                                    left=(right+left)/2;
-                                }
-                                else
-                                {
-                                    right=(right+left)/2;
-                                }
-
-                                if ((top+bottom)/2<lat)
-                                {
-                                    bottom=(top+bottom)/2;
-                                }
-                                else
-                                {
-                                    quadCoordBottom |= 1;
-                                    top=(top+bottom)/2;
-                                }
+                                quadCoordRight|=1;
+                                left=(right+left)/2;
                             }
-
-                            // Determine the smallest quadtile that contains all the image, as determined by the location of the opposite corner.
-                            leastCommonZoom=zoom-1;
-                            while((((1<<leastCommonZoom) & quadCoordBottom) == ((1<<leastCommonZoom) & quadCoordRight)) && ((1<<leastCommonZoom) & quadCoordRight) && leastCommonZoom >0 )
-
+                            else
                             {
-                                leastCommonZoom--;
+                                right=(right+left)/2;
                             }
 
-
-                            while((((1<<leastCommonZoom) & quadCoordBottom) == ((1<<leastCommonZoom) & quadCoordRight)) && !((1<<leastCommonZoom) & quadCoordRight) && leastCommonZoom >0 )
+                            if ((top+bottom)/2<lat)
                             {
-                                leastCommonZoom--;
+                                bottom=(top+bottom)/2;
                             }
+                            else
+                            {
+                                quadCoordBottom |= 1;
+                                top=(top+bottom)/2;
+                            }
+                        }
 
-                            qDebug() << "LCZ: " << leastCommonZoom;
+                        // Determine the smallest quadtile that contains all the image, as determined by the location of the opposite corner.
+                        leastCommonZoom=zoom-1;
+                        while((((1<<leastCommonZoom) & quadCoordBottom) == ((1<<leastCommonZoom) & quadCoordRight)) && ((1<<leastCommonZoom) & quadCoordRight) && leastCommonZoom >0 )
 
+                        {
+                            leastCommonZoom--;
                         }
 
-                        // Only write output files for the smallest quadtile the contains the image, as determined by the opposite corner
-                        if((pos.X() >> (leastCommonZoom+1)) == (quadCoordRight >> (leastCommonZoom+1)) && (pos.Y() >> (leastCommonZoom+1)) == (quadCoordBottom >> (leastCommonZoom+1)))
+
+                        while((((1<<leastCommonZoom) & quadCoordBottom) == ((1<<leastCommonZoom) & quadCoordRight)) && !((1<<leastCommonZoom) & quadCoordRight) && leastCommonZoom >0 )
                         {
+                            leastCommonZoom--;
+                        }
 
-                            QImage retImage=imScaled.copy((pos.X() & ((1<<(leastCommonZoom+1))-1)) * tileSize, (pos.Y() & ((1<<(leastCommonZoom+1))-1)) * tileSize, tileSize, tileSize);
+                        qDebug() << "LCZ: " << leastCommonZoom;
 
-#ifdef DEBUG_Q_TILES
-                            //For a silly reason of making sure that everything is properly drawn, display the quadtile element on each tile
-                            retImage=retImage.convertToFormat(QImage::Format_ARGB32);
-                            QPainter painter(&retImage);
-                            painter.setFont(QFont("Chicago", 7)); // The font size
-                            painter.setPen(QColor(233, 10, 150));
-                            painter.drawText(20, 40, QString::number(pos.X() , 2));
-                            painter.drawText(20, 80, QString::number(pos.Y() , 2));
-                            painter.drawText(20, 120, QString::number(quadCoordRight , 2));
-                            painter.drawText(20, 160, QString::number(quadCoordBottom , 2));
-#endif
+                    }
 
-                            QBuffer buffer(&ret);
-                            buffer.open(QIODevice::WriteOnly);
-                            retImage.save(&buffer, "PNG"); // writes image into ba in PNG format
-                        }
-                        else{ //Nothing here, fill it in with black tiles.
-                            QImage retImage(tileSize,tileSize, QImage::Format_ARGB32);
-                            retImage.fill(Qt::black);
+                    // Only write output files for the smallest quadtile the contains the image, as determined by the opposite corner
+                    if((pos.X() >> (leastCommonZoom+1)) == (quadCoordRight >> (leastCommonZoom+1)) && (pos.Y() >> (leastCommonZoom+1)) == (quadCoordBottom >> (leastCommonZoom+1)))
+                    {
+
+                        QImage retImage=imScaled.copy((pos.X() & ((1<<(leastCommonZoom+1))-1)) * tileSize, (pos.Y() & ((1<<(leastCommonZoom+1))-1)) * tileSize, tileSize, tileSize);
 
 #ifdef DEBUG_Q_TILES
-                            //For a silly reason of making sure that everything is properly drawn, display the quadtile element on each tile
-                            QPainter painter(&retImage);
-                            painter.setFont(QFont("Chicago", 16)); // The font size
-                            painter.setPen(QColor(10, 233, 150));
-                            painter.drawText(20, 40, QString::number(pos.X() , 2));
-                            painter.drawText(20, 80, QString::number(pos.Y() , 2));
-                            painter.drawText(20, 120, QString::number(quadCoordRight , 2));
-                            painter.drawText(20, 160, QString::number(quadCoordBottom , 2));
+                        //For a silly reason of making sure that everything is properly drawn, display the quadtile element on each tile
+                        retImage=retImage.convertToFormat(QImage::Format_ARGB32);
+                        QPainter painter(&retImage);
+                        painter.setFont(QFont("Chicago", 7)); // The font size
+                        painter.setPen(QColor(233, 10, 150));
+                        painter.drawText(20, 40, QString::number(pos.X() , 2));
+                        painter.drawText(20, 80, QString::number(pos.Y() , 2));
+                        painter.drawText(20, 120, QString::number(quadCoordRight , 2));
+                        painter.drawText(20, 160, QString::number(quadCoordBottom , 2));
 #endif
-                            QBuffer buffer(&ret);
-                            buffer.open(QIODevice::WriteOnly);
-                            retImage.save(&buffer, "PNG"); // writes image into ba in PNG format
 
-                        }
+                        QBuffer buffer(&ret);
+                        buffer.open(QIODevice::WriteOnly);
+                        retImage.save(&buffer, "PNG"); // writes image into ba in PNG format
                     }
+                    else{ //Nothing here, fill it in with black tiles.
+                        QImage retImage(tileSize,tileSize, QImage::Format_ARGB32);
+                        retImage.fill(Qt::black);
 
-                errorvars.unlock();
+#ifdef DEBUG_Q_TILES
+                        //For a silly reason of making sure that everything is properly drawn, display the quadtile element on each tile
+                        QPainter painter(&retImage);
+                        painter.setFont(QFont("Chicago", 16)); // The font size
+                        painter.setPen(QColor(10, 233, 150));
+                        painter.drawText(20, 40, QString::number(pos.X() , 2));
+                        painter.drawText(20, 80, QString::number(pos.Y() , 2));
+                        painter.drawText(20, 120, QString::number(quadCoordRight , 2));
+                        painter.drawText(20, 160, QString::number(quadCoordBottom , 2));
+#endif
+                        QBuffer buffer(&ret);
+                        buffer.open(QIODevice::WriteOnly);
+                        retImage.save(&buffer, "PNG"); // writes image into ba in PNG format
 
-                //Save tile to cache
-                if (useMemoryCache)
-                {
-#ifdef DEBUG_GMAPS
-                    qDebug()<<"Add Tile to memory cache";
-#endif //DEBUG_GMAPS
-                    AddTileToMemoryCache(RawTile(type,pos,zoom),ret);
+                    }
                 }
 
-                //Save tile to database
-                if(accessmode!=AccessMode::ServerOnly)
-                {
+            errorvars.unlock();
+
+            //Save tile to database
+            if(accessmode!=AccessMode::ServerOnly)
+            {
 #ifdef DEBUG_GMAPS
-                    qDebug()<<"Add tile to DataBase";
+                qDebug()<<"Add tile to DataBase";
 #endif //DEBUG_GMAPS
-                    CacheItemQueue * item=new CacheItemQueue(type,pos,ret,zoom);
-                    TileDBcacheQueue.EnqueueCacheTask(item);
-                }
+                CacheItemQueue * item=new CacheItemQueue(type,pos,ret,zoom);
+                TileDBcacheQueue.EnqueueCacheTask(item);
+            }
 
 
-            }
         }
 #ifdef DEBUG_GMAPS
         qDebug()<<"Entered GetImageFrom";
@@ -308,214 +271,177 @@ namespace core {
 #endif //DEBUG_GMAPS
         QByteArray ret;
 
-        if(useMemoryCache)
+        //Attempt to read tile from cache
+        if(accessmode != (AccessMode::ServerOnly) && type != MapType::UserImage) //Don't use cache if the user supplies a file. This is because
         {
 #ifdef DEBUG_GMAPS
-            qDebug()<<"Try Tile from memory:Size="<<TilesInMemory.MemoryCacheSize();
+            qDebug()<<"Try tile from DataBase";
 #endif //DEBUG_GMAPS
-            ret=GetTileFromMemoryCache(RawTile(type,pos,zoom));
+            ret=Cache::Instance()->ImageCache.GetImageFromCache(type,pos,zoom);
             if(!ret.isEmpty())
             {
                 errorvars.lock();
-                ++diag.tilesFromMem;
+                ++diag.tilesFromDB;
                 errorvars.unlock();
-            }
-
-        }
-        if(ret.isEmpty())
-        {
 #ifdef DEBUG_GMAPS
-            qDebug()<<"Tile not in memory";
+                qDebug()<<"Tile found in Database";
 #endif //DEBUG_GMAPS
+                return ret;
+            }
+        }
 
-            //Attempt to read tile from cache
-            if(accessmode != (AccessMode::ServerOnly) && type != MapType::UserImage) //Don't use cache if the user supplies a file. This is because
-            {
+        //Attempt to read file from original source
+        if(accessmode!=AccessMode::CacheOnly)
+        {
+            { //Otherwise, we're getting the tiles from the internet
+                QEventLoop q;
+                QNetworkReply *reply;
+                QNetworkRequest qheader;
+                QNetworkAccessManager network;
+                QTimer tT;
+                tT.setSingleShot(true);
+                connect(&network, SIGNAL(finished(QNetworkReply*)),
+                        &q, SLOT(quit()));
+                connect(&tT, SIGNAL(timeout()), &q, SLOT(quit()));
+                network.setProxy(Proxy);
 #ifdef DEBUG_GMAPS
-                qDebug()<<"Try tile from DataBase";
+                qDebug()<<"Try Tile from the Internet";
 #endif //DEBUG_GMAPS
-                ret=Cache::Instance()->ImageCache.GetImageFromCache(type,pos,zoom);
-                if(!ret.isEmpty())
+#ifdef DEBUG_TIMINGS
+                qDebug()<<"opmaps before make image url"<<time.elapsed();
+#endif
+                QString url=MakeImageUrl(type,pos,zoom,LanguageStr);
+#ifdef DEBUG_TIMINGS
+                qDebug()<<"opmaps after make image url"<<time.elapsed();
+#endif		//url	"http://vec02.maps.yandex.ru/tiles?l=map&v=2.10.2&x=7&y=5&z=3"	string
+                //"http://map3.pergo.com.tr/tile/02/000/000/007/000/000/002.png"
+                qheader.setUrl(QUrl(url));
+                qheader.setRawHeader("User-Agent",UserAgent);
+                qheader.setRawHeader("Accept","*/*");
+                switch(type)
                 {
-                    errorvars.lock();
-                    ++diag.tilesFromDB;
-                    errorvars.unlock();
-#ifdef DEBUG_GMAPS
-                    qDebug()<<"Tile found in Database";
-#endif //DEBUG_GMAPS
-                    if(useMemoryCache)
+                case MapType::GoogleMap:
+                case MapType::GoogleSatellite:
+                case MapType::GoogleLabels:
+                case MapType::GoogleTerrain:
+                case MapType::GoogleHybrid:
                     {
-#ifdef DEBUG_GMAPS
-                        qDebug()<<"Add Tile to memory";
-#endif //DEBUG_GMAPS
-                        AddTileToMemoryCache(RawTile(type,pos,zoom),ret);
+                        qheader.setRawHeader("Referrer", "http://maps.google.com/");
                     }
-                    return ret;
-                }
-            }
+                    break;
 
-            //Attempt to read file from original source
-            if(accessmode!=AccessMode::CacheOnly)
-            {
-                { //Otherwise, we're getting the tiles from the internet
-                    QEventLoop q;
-                    QNetworkReply *reply;
-                    QNetworkRequest qheader;
-                    QNetworkAccessManager network;
-                    QTimer tT;
-                    tT.setSingleShot(true);
-                    connect(&network, SIGNAL(finished(QNetworkReply*)),
-                            &q, SLOT(quit()));
-                    connect(&tT, SIGNAL(timeout()), &q, SLOT(quit()));
-                    network.setProxy(Proxy);
-    #ifdef DEBUG_GMAPS
-                    qDebug()<<"Try Tile from the Internet";
-    #endif //DEBUG_GMAPS
-    #ifdef DEBUG_TIMINGS
-                    qDebug()<<"opmaps before make image url"<<time.elapsed();
-    #endif
-                    QString url=MakeImageUrl(type,pos,zoom,LanguageStr);
-    #ifdef DEBUG_TIMINGS
-                    qDebug()<<"opmaps after make image url"<<time.elapsed();
-    #endif		//url	"http://vec02.maps.yandex.ru/tiles?l=map&v=2.10.2&x=7&y=5&z=3"	string
-                    //"http://map3.pergo.com.tr/tile/02/000/000/007/000/000/002.png"
-                    qheader.setUrl(QUrl(url));
-                    qheader.setRawHeader("User-Agent",UserAgent);
-                    qheader.setRawHeader("Accept","*/*");
-                    switch(type)
+                case MapType::GoogleMapChina:
+                case MapType::GoogleSatelliteChina:
+                case MapType::GoogleLabelsChina:
+                case MapType::GoogleTerrainChina:
+                case MapType::GoogleHybridChina:
                     {
-                    case MapType::GoogleMap:
-                    case MapType::GoogleSatellite:
-                    case MapType::GoogleLabels:
-                    case MapType::GoogleTerrain:
-                    case MapType::GoogleHybrid:
-                        {
-                            qheader.setRawHeader("Referrer", "http://maps.google.com/");
-                        }
-                        break;
-
-                    case MapType::GoogleMapChina:
-                    case MapType::GoogleSatelliteChina:
-                    case MapType::GoogleLabelsChina:
-                    case MapType::GoogleTerrainChina:
-                    case MapType::GoogleHybridChina:
-                        {
-                            qheader.setRawHeader("Referrer", "http://ditu.google.cn/");
-                        }
-                        break;
-
-                    case MapType::BingHybrid:
-                    case MapType::BingMap:
-                    case MapType::BingSatellite:
-                        {
-                            qheader.setRawHeader("Referrer", "http://www.bing.com/maps/");
-                        }
-                        break;
-
-                    case MapType::YahooHybrid:
-                    case MapType::YahooLabels:
-                    case MapType::YahooMap:
-                    case MapType::YahooSatellite:
-                        {
-                            qheader.setRawHeader("Referrer", "http://maps.yahoo.com/");
-                        }
-                        break;
-
-                    case MapType::ArcGIS_MapsLT_Map_Labels:
-                    case MapType::ArcGIS_MapsLT_Map:
-                    case MapType::ArcGIS_MapsLT_OrtoFoto:
-                    case MapType::ArcGIS_MapsLT_Map_Hybrid:
-                        {
-                            qheader.setRawHeader("Referrer", "http://www.maps.lt/map_beta/");
-                        }
-                        break;
+                        qheader.setRawHeader("Referrer", "http://ditu.google.cn/");
+                    }
+                    break;
 
-                    case MapType::OpenStreetMapSurfer:
-                    case MapType::OpenStreetMapSurferTerrain:
-                        {
-                            qheader.setRawHeader("Referrer", "http://www.mapsurfer.net/");
-                        }
-                        break;
+                case MapType::BingHybrid:
+                case MapType::BingMap:
+                case MapType::BingSatellite:
+                    {
+                        qheader.setRawHeader("Referrer", "http://www.bing.com/maps/");
+                    }
+                    break;
 
-                    case MapType::OpenStreetMap:
-                    case MapType::OpenStreetOsm:
-                        {
-                            qheader.setRawHeader("Referrer", "http://www.openstreetmap.org/");
-                        }
-                        break;
+                case MapType::YahooHybrid:
+                case MapType::YahooLabels:
+                case MapType::YahooMap:
+                case MapType::YahooSatellite:
+                    {
+                        qheader.setRawHeader("Referrer", "http://maps.yahoo.com/");
+                    }
+                    break;
 
-                    case MapType::YandexMapRu:
-                        {
-                            qheader.setRawHeader("Referrer", "http://maps.yandex.ru/");
-                        }
-                        break;
-                    default:
-                        break;
+                case MapType::ArcGIS_MapsLT_Map_Labels:
+                case MapType::ArcGIS_MapsLT_Map:
+                case MapType::ArcGIS_MapsLT_OrtoFoto:
+                case MapType::ArcGIS_MapsLT_Map_Hybrid:
+                    {
+                        qheader.setRawHeader("Referrer", "http://www.maps.lt/map_beta/");
                     }
-#ifdef DEBUG_GMAPS
-                    qDebug() << "qheader: " << qheader.url();
-#endif //DEBUG_GMAPS
-                    reply=network.get(qheader);
-                    tT.start(Timeout);
-                    q.exec();
-
-                    if(!tT.isActive()){
-                        errorvars.lock();
-                        ++diag.timeouts;
-                        errorvars.unlock();
-                        return ret;
+                    break;
+
+                case MapType::OpenStreetMapSurfer:
+                case MapType::OpenStreetMapSurferTerrain:
+                    {
+                        qheader.setRawHeader("Referrer", "http://www.mapsurfer.net/");
                     }
-                    tT.stop();
-                    if( (reply->error()!=QNetworkReply::NoError))
+                    break;
+
+                case MapType::OpenStreetMap:
+                case MapType::OpenStreetOsm:
                     {
-                        errorvars.lock();
-                        ++diag.networkerrors;
-                        errorvars.unlock();
-                        reply->deleteLater();
-                        return ret;
+                        qheader.setRawHeader("Referrer", "http://www.openstreetmap.org/");
                     }
-                    ret=reply->readAll();
-                    reply->deleteLater();//TODO can't this be global??
-                    if(ret.isEmpty())
+                    break;
+
+                case MapType::YandexMapRu:
                     {
-    #ifdef DEBUG_GMAPS
-                        qDebug()<<"Invalid Tile";
-    #endif //DEBUG_GMAPS
-                        errorvars.lock();
-                        ++diag.emptytiles;
-                        errorvars.unlock();
-                        return ret;
+                        qheader.setRawHeader("Referrer", "http://maps.yandex.ru/");
                     }
-    #ifdef DEBUG_GMAPS
-                    qDebug()<<"Received Tile from the Internet";
-    #endif //DEBUG_GMAPS
-                    errorvars.lock();
-                    ++diag.tilesFromNet;
+                    break;
+                default:
+                    break;
                 }
-
-                errorvars.unlock();
-
-                //Save tile to cache
-                if (useMemoryCache)
-                {
 #ifdef DEBUG_GMAPS
-                    qDebug()<<"Add Tile to memory cache";
+                qDebug() << "qheader: " << qheader.url();
 #endif //DEBUG_GMAPS
-                    AddTileToMemoryCache(RawTile(type,pos,zoom),ret);
-                }
+                reply=network.get(qheader);
+                tT.start(Timeout);
+                q.exec();
 
-                //Save tile to database
-                if(accessmode!=AccessMode::ServerOnly)
+                if(!tT.isActive()){
+                    errorvars.lock();
+                    ++diag.timeouts;
+                    errorvars.unlock();
+                    return ret;
+                }
+                tT.stop();
+                if( (reply->error()!=QNetworkReply::NoError))
+                {
+                    errorvars.lock();
+                    ++diag.networkerrors;
+                    errorvars.unlock();
+                    reply->deleteLater();
+                    return ret;
+                }
+                ret=reply->readAll();
+                reply->deleteLater();//TODO can't this be global??
+                if(ret.isEmpty())
                 {
 #ifdef DEBUG_GMAPS
-                    qDebug()<<"Add tile to DataBase";
+                    qDebug()<<"Invalid Tile";
 #endif //DEBUG_GMAPS
-                    CacheItemQueue * item=new CacheItemQueue(type,pos,ret,zoom);
-                    TileDBcacheQueue.EnqueueCacheTask(item);
+                    errorvars.lock();
+                    ++diag.emptytiles;
+                    errorvars.unlock();
+                    return ret;
                 }
+#ifdef DEBUG_GMAPS
+                qDebug()<<"Received Tile from the Internet";
+#endif //DEBUG_GMAPS
+                errorvars.lock();
+                ++diag.tilesFromNet;
+            }
 
+            errorvars.unlock();
 
+            //Save tile to database
+            if(accessmode!=AccessMode::ServerOnly)
+            {
+#ifdef DEBUG_GMAPS
+                qDebug()<<"Add tile to DataBase";
+#endif //DEBUG_GMAPS
+                CacheItemQueue * item=new CacheItemQueue(type,pos,ret,zoom);
+                TileDBcacheQueue.EnqueueCacheTask(item);
             }
+
+
         }
 #ifdef DEBUG_GMAPS
         qDebug()<<"Entered GetImageFrom";
@@ -532,12 +458,49 @@ namespace core {
         return Cache::Instance()->ImageCache.ExportMapDataToDB(file,Cache::Instance()->ImageCache.GtileCache()+QDir::separator()+"Data.qmdb");
     }
 
+    /**
+     * @brief TLMaps::GetImageFromMemory get a decoded tile from the memory cache
+     * @return the tile, or a null image if it isn't in memory
+     */
+    QImage TLMaps::GetImageFromMemory(const MapType::Types &type,const core::Point &pos,const int &zoom)
+    {
+        if(!useMemoryCache)
+            return QImage();
+        QImage ret=GetTileFromMemoryCache(RawTile(type,pos,zoom));
+        errorvars.lock();
+        if(ret.isNull())
+            ++diag.memoryCacheMisses;
+        else
+            ++diag.tilesFromMem;
+        errorvars.unlock();
+        return ret;
+    }
+
+    /**
+     * @brief TLMaps::DecodeImage decode a tile read from the database, the
+     * server or a file, in the format the map is drawn in, and keep it in the
+     * memory cache. This is done by the loader threads so drawing the map
+     * never decodes.
+     * @return the decoded tile, or a null image if it could not be decoded
+     */
+    QImage TLMaps::DecodeImage(const MapType::Types &type,const core::Point &pos,const int &zoom,const QByteArray &data)
+    {
+        QImage ret=QImage::fromData(data);
+        if(ret.isNull())
+            return ret;
+        ret=ret.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+        if(useMemoryCache)
+            AddTileToMemoryCache(RawTile(type,pos,zoom),ret);
+        return ret;
+    }
+
     diagnostics TLMaps::GetDiagnostics()
     {
         diagnostics i;
         errorvars.lock();
         i=diag;
         errorvars.unlock();
+        i.memoryCacheMB=TilesInMemory.MemoryCacheSize();
         return i;
     }
 }
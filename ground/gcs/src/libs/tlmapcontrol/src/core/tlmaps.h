@@ -68,6 +68,8 @@ namespace core {
 
         QByteArray GetImageFromServer(const MapType::Types &type,const core::Point &pos,const int &zoom);
         QByteArray GetImageFromFile(const MapType::Types &type,const core::Point &pos,const int &zoom, double hScale, double vScale, QString userImageFileName, internals::PureProjection *projection);
+        QImage GetImageFromMemory(const MapType::Types &type,const core::Point &pos,const int &zoom);
+        QImage DecodeImage(const MapType::Types &type,const core::Point &pos,const int &zoom,const QByteArray &data);
         bool UseMemoryCache(){return useMemoryCache;}//TODO
         void setUseMemoryCache(const bool& value){useMemoryCache=value;}
         void setLanguage(const LanguageType::Types& language){Language=language;}//TODO
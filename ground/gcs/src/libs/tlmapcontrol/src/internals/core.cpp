@@ -35,7 +35,7 @@ using namespace projections;
 
 namespace internals {
     Core::Core():started(false),MouseWheelZooming(false),currentPosition(0,0),currentPositionPixel(0,0),LastLocationInBounds(-1,-1),sizeOfMapArea(0,0)
-            ,minOfTiles(0,0),maxOfTiles(0,0),zoom(0),isDragging(false),TooltipTextPadding(10,10),mapType(MapType::None),loaderLimit(5),maxzoom(21),runningThreads(0)
+            ,minOfTiles(0,0),maxOfTiles(0,0),zoom(0),isDragging(false),TooltipTextPadding(10,10),mapType(MapType::None),loaderLimit(5),maxzoom(21),runningThreads(0),prefetchedTiles(0)
     {
         mousewheelzoomtype=MouseWheelZoomType::MousePositionAndCenter;
         SetProjection(new MercatorProjection());
@@ -65,6 +65,7 @@ namespace internals {
         qDebug()<<"core:run"<<" ID="<<debug;
 #endif //DEBUG_CORE
         bool last = false;
+        bool prefetch = false;
 
         LoadTask task;
 
@@ -81,10 +82,24 @@ namespace internals {
 #endif //DEBUG_CORE
                 }
             }
+            else if(prefetchQueue.count() > 0)
+            {
+                // Tiles out of view are only loaded once the ones in view are
+                task = prefetchQueue.dequeue();
+                prefetch = true;
+            }
         }
         MtileLoadQueue.unlock();
 
-        if(task.HasValue())
+        if(prefetch)
+        {
+            if(loaderLimit.tryAcquire(1,TLMaps::Instance()->Timeout))
+            {
+                PrefetchTile(task);
+                loaderLimit.release();
+            }
+        }
+        else if(task.HasValue())
             if(loaderLimit.tryAcquire(1,TLMaps::Instance()->Timeout))
             {
             MtileToload.lock();
@@ -113,54 +128,22 @@ namespace internals {
 
                         foreach(MapType::Types tl,layers)
                         {
-                            int retry = 0;
+                            QImage tileImage = TLMaps::Instance()->GetImageFromMemory(tl, task.Pos, task.Zoom);
+                            if(tileImage.isNull())
+                                tileImage = LoadLayer(tl, task);
 
-                            do
+                            if(!tileImage.isNull())
                             {
-                                QByteArray tileImage;
-
-                                // tile number inversion(BottomLeft -> TopLeft) for pergo maps
-                                if(tl == MapType::PergoTurkeyMap)
-                                {
-                                    tileImage = TLMaps::Instance()->GetImageFromServer(tl, Point(task.Pos.X(), maxOfTiles.Height() - task.Pos.Y()), task.Zoom);
-                                }
-                                else if(tl == MapType::UserImage)
-                                {
-                                    tileImage = TLMaps::Instance()->GetImageFromFile(tl, task.Pos, task.Zoom, userImageHorizontalScale, userImageVerticalScale, userImageLocation, Projection());
-                                }
-                                else // ok
-                                {
-#ifdef DEBUG_CORE
-                                    qDebug()<<"start getting image"<<" ID="<<debug;
-#endif //DEBUG_CORE
-                                    tileImage = TLMaps::Instance()->GetImageFromServer(tl, task.Pos, task.Zoom);
-#ifdef DEBUG_CORE
-                                    qDebug()<<"Core::run:gotimage size:"<<tileImage.count()<<" ID="<<debug;
-#endif //DEBUG_CORE
-                                }
-
-                                if(tileImage.length()!=0)
+                                Moverlays.lock();
                                 {
-                                    Moverlays.lock();
-                                    {
-                                        t->Overlays.append(tileImage);
+                                    t->Overlays.append(tileImage);
 #ifdef DEBUG_CORE
-                                        qDebug()<<"Core::run append tileImage:"<<tileImage.length()<<" to tile:"<<t->GetPos().ToString()<<" now has "<<t->Overlays.count()<<" overlays"<<" ID="<<debug;
+                                    qDebug()<<"Core::run append tileImage:"<<tileImage.byteCount()<<" to tile:"<<t->GetPos().ToString()<<" now has "<<t->Overlays.count()<<" overlays"<<" ID="<<debug;
 #endif //DEBUG_CORE
 
-                                    }
-                                    Moverlays.unlock();
-
-                                    break;
-                                }
-                                else if(TLMaps::Instance()->RetryLoadTile > 0)
-                                {
-#ifdef DEBUG_CORE
-                                    qDebug()<<"ProcessLoadTask: " << task.ToString()<< " -> empty tile, retry " << retry<<" ID="<<debug;;
-#endif //DEBUG_CORE
                                 }
+                                Moverlays.unlock();
                             }
-                            while(++retry < TLMaps::Instance()->RetryLoadTile);
                         }
 
                         if(t->Overlays.count() > 0)
@@ -191,10 +174,6 @@ namespace internals {
                     // last buddy cleans stuff ;}
                     if(last)
                     {
-                        TLMaps::Instance()->kiberCacheLock.lockForWrite();
-                        TLMaps::Instance()->TilesInMemory.RemoveMemoryOverload();
-                        TLMaps::Instance()->kiberCacheLock.unlock();
-
                         MtileDrawingList.lock();
                         {
                             Matrix.ClearPointsNotIn(tileDrawingList);
@@ -223,11 +202,121 @@ namespace internals {
         --runningThreads;
         MrunningThreads.unlock();
     }
+    /**
+     * @brief Core::LoadLayer load one layer of a tile from the database, the
+     * server or the user image and decode it, retrying empty tiles
+     * @return the decoded image, or a null image if it could not be loaded
+     */
+    QImage Core::LoadLayer(MapType::Types const& type, LoadTask const& task)
+    {
+        int retry = 0;
+
+        do
+        {
+            QByteArray tileImage;
+
+            // tile number inversion(BottomLeft -> TopLeft) for pergo maps
+            if(type == MapType::PergoTurkeyMap)
+            {
+                tileImage = TLMaps::Instance()->GetImageFromServer(type, Point(task.Pos.X(), Projection()->GetTileMatrixMaxXY(task.Zoom).Height() - task.Pos.Y()), task.Zoom);
+            }
+            else if(type == MapType::UserImage)
+            {
+                tileImage = TLMaps::Instance()->GetImageFromFile(type, task.Pos, task.Zoom, userImageHorizontalScale, userImageVerticalScale, userImageLocation, Projection());
+            }
+            else // ok
+            {
+                tileImage = TLMaps::Instance()->GetImageFromServer(type, task.Pos, task.Zoom);
+            }
+
+            if(tileImage.length()!=0)
+                return TLMaps::Instance()->DecodeImage(type, task.Pos, task.Zoom, tileImage);
+#ifdef DEBUG_CORE
+            qDebug()<<"LoadLayer: " << task.ToString()<< " -> empty tile, retry " << retry;
+#endif //DEBUG_CORE
+        }
+        while(++retry < TLMaps::Instance()->RetryLoadTile);
+
+        return QImage();
+    }
+    /**
+     * @brief Core::PrefetchTile load the layers of a tile out of view into the
+     * memory cache, so they are drawn without waiting when the map is panned
+     * or zoomed in
+     */
+    void Core::PrefetchTile(LoadTask const& task)
+    {
+        foreach(MapType::Types tl,TLMaps::Instance()->GetAllLayersOfType(GetMapType()))
+        {
+            if(!TLMaps::Instance()->TilesInMemory.Contains(RawTile(tl, task.Pos, task.Zoom)))
+                LoadLayer(tl, task);
+        }
+        MrunningThreads.lock();
+        ++prefetchedTiles;
+        MrunningThreads.unlock();
+    }
+    /**
+     * @brief Core::QueuePrefetch queue the ring of tiles around the view and
+     * the tiles of the next zoom level around the center which aren't in the
+     * memory cache. They are loaded after the tiles in view.
+     */
+    void Core::QueuePrefetch()
+    {
+        MtileLoadQueue.lock();
+        prefetchQueue.clear();
+        MtileLoadQueue.unlock();
+
+        // User images are scaled for one zoom level at a time
+        if(!TLMaps::Instance()->UseMemoryCache() || GetMapType() == MapType::UserImage)
+            return;
+
+        QList<LoadTask> tasks;
+        int ringWidth = sizeOfMapArea.Width() + 1;
+        int ringHeight = sizeOfMapArea.Height() + 1;
+        for(int i = -ringWidth; i <= ringWidth; i++)
+        {
+            for(int j = -ringHeight; j <= ringHeight; j++)
+            {
+                if(qAbs(i) == ringWidth || qAbs(j) == ringHeight)
+                    tasks.append(LoadTask(Point(centerTileXYLocation.X() + i, centerTileXYLocation.Y() + j), Zoom()));
+            }
+        }
+        if(Zoom() < MaxZoom())
+        {
+            // The center tile splits in four at the next zoom level
+            for(int i = -sizeOfMapArea.Width(); i <= sizeOfMapArea.Width() + 1; i++)
+            {
+                for(int j = -sizeOfMapArea.Height(); j <= sizeOfMapArea.Height() + 1; j++)
+                    tasks.append(LoadTask(Point(centerTileXYLocation.X() * 2 + i, centerTileXYLocation.Y() * 2 + j), Zoom() + 1));
+            }
+        }
+
+        QVector<MapType::Types> layers = TLMaps::Instance()->GetAllLayersOfType(GetMapType());
+        MtileLoadQueue.lock();
+        foreach(LoadTask task,tasks)
+        {
+            Size min = Projection()->GetTileMatrixMinXY(task.Zoom);
+            Size max = Projection()->GetTileMatrixMaxXY(task.Zoom);
+            if(task.Pos.X() < min.Width() || task.Pos.Y() < min.Height() || task.Pos.X() > max.Width() || task.Pos.Y() > max.Height())
+                continue;
+
+            bool cached = true;
+            foreach(MapType::Types tl,layers)
+                cached = cached && TLMaps::Instance()->TilesInMemory.Contains(RawTile(tl, task.Pos, task.Zoom));
+            if(!cached)
+            {
+                prefetchQueue.enqueue(task);
+                ProcessLoadTaskCallback.start(this);
+            }
+        }
+        MtileLoadQueue.unlock();
+    }
     diagnostics Core::GetDiagnostics()
     {
         MrunningThreads.lock();
         diag=TLMaps::Instance()->GetDiagnostics();
         diag.runningThreads=runningThreads;
+        diag.prefetchedTiles=prefetchedTiles;
         MrunningThreads.unlock();
         return diag;
     }
@@ -245,6 +334,7 @@ namespace internals {
             {
                 MtileLoadQueue.lock();
                 tileLoadQueue.clear();
+                prefetchQueue.clear();
                 MtileLoadQueue.unlock();
                 MtileToload.lock();
                 tilesToload=0;
@@ -533,6 +623,7 @@ namespace internals {
             MtileLoadQueue.lock();
             {
                 tileLoadQueue.clear();
+                prefetchQueue.clear();
             }
             MtileLoadQueue.unlock();
             MtileToload.lock();
@@ -641,6 +732,7 @@ namespace internals {
             MtileLoadQueue.lock();
             {
                 tileLoadQueue.clear();
+                prefetchQueue.clear();
                 //tilesToload=0;
             }
             MtileLoadQueue.unlock();
@@ -687,6 +779,7 @@ namespace internals {
             }
         }
         MtileDrawingList.unlock();
+        QueuePrefetch();
         UpdateGroundResolution();
     }
     void Core::FindTilesAround(QList<Point> &list)
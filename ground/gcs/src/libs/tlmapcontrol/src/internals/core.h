@@ -215,6 +215,9 @@ namespace internals {
         bool started;
         bool MouseWheelZooming;
         void keepInBounds();
+        QImage LoadLayer(MapType::Types const& type, LoadTask const& task);
+        void PrefetchTile(LoadTask const& task);
+        void QueuePrefetch();
         PointLatLng currentPosition;
         core::Point currentPositionPixel;
         core::Point renderOffset;
@@ -243,6 +246,8 @@ namespace internals {
         Rectangle CurrentRegion;
 
         QQueue<LoadTask> tileLoadQueue;
+        //! Tiles out of view to load into the memory cache, after tileLoadQueue
+        QQueue<LoadTask> prefetchQueue;
 
         int zoom;
 
@@ -272,6 +277,7 @@ namespace internals {
         int maxzoom; //Max zoom level in  quadtile format
         QMutex MrunningThreads;
         int runningThreads;
+        int prefetchedTiles;
         diagnostics diag;
 
     protected:
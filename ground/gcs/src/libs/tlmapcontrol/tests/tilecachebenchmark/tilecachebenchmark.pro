@@ -0,0 +1,16 @@
+# Tile store and load rates of the SQLite tile cache on a database of 100k
+# tiles. The number of tiles can be set with the TILECACHE_BENCH_TILES
+# environment variable.
+
+QT += testlib network sql widgets concurrent
+TARGET = tilecachebenchmark
+CONFIG += console testcase
+CONFIG -= app_bundle
+TEMPLATE = app
+
+include(../../../../../gcs.pri)
+
+INCLUDEPATH *= ../../src/core
+LIBS += -L$$GCS_BUILD_TREE/src/libs/tlmapcontrol/src/build -lcore
+
+SOURCES += tst_tilecachebenchmark.cpp
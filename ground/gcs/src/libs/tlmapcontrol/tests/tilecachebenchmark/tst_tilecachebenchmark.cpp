@@ -0,0 +1,188 @@
+/**
+ ******************************************************************************
+ * @file       tst_tilecachebenchmark.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @brief Fills a tile cache database, then measures how fast tiles are stored
+ * one at a time and loaded from one and from several threads
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <QtTest/QtTest>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QtConcurrent>
+
+#include "pureimagecache.h"
+#include "cacheitemqueue.h"
+
+using namespace core;
+
+class tst_TileCacheBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void storeOneByOne();
+    void loadSingleThread();
+    void loadAllCores();
+    void missingTiles();
+
+private:
+    void checkTile(int tile);
+
+    QTemporaryDir m_dir;
+    PureImageCache *m_cache;
+    int m_tiles;
+    QByteArray m_payload;
+};
+
+static const int TILE_BYTES = 4096;
+static const int TILES_PER_ROW = 512;
+static const int ZOOM = 17;
+static const int LOADS = 20000;
+
+//! Tile number i is at (i % TILES_PER_ROW, i / TILES_PER_ROW)
+static Point tilePosition(int tile)
+{
+    return Point(tile % TILES_PER_ROW, tile / TILES_PER_ROW);
+}
+
+//! The random payload with the tile number at the start
+static QByteArray tileData(const QByteArray &payload, int tile)
+{
+    QByteArray data(payload);
+    memcpy(data.data(), &tile, sizeof(tile));
+    return data;
+}
+
+void tst_TileCacheBenchmark::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+    m_tiles = qgetenv("TILECACHE_BENCH_TILES").toInt();
+    if (m_tiles <= 0)
+        m_tiles = 100000;
+
+    qsrand(1);
+    m_payload.resize(TILE_BYTES);
+    for (int i = 0; i < TILE_BYTES; i++)
+        m_payload[i] = (char) qrand();
+
+    m_cache = new PureImageCache();
+    m_cache->setGtileCache(m_dir.path() + QDir::separator());
+
+    // Batches of the size the cache queue stores at most at once
+    QElapsedTimer timer;
+    timer.start();
+    for (int start = 0; start < m_tiles; start += 256) {
+        QList<CacheItemQueue*> batch;
+        for (int tile = start; tile < qMin(start + 256, m_tiles); tile++)
+            batch.append(new CacheItemQueue(MapType::GoogleSatellite, tilePosition(tile), tileData(m_payload, tile), ZOOM));
+        QVERIFY(m_cache->PutImagesToCache(batch));
+        qDeleteAll(batch);
+    }
+    qint64 nsecs = timer.nsecsElapsed();
+    qDebug("Stored %d tiles in batches of 256: %.0f tiles/s, %.1f MB/s", m_tiles,
+           m_tiles / (nsecs / 1e9), m_tiles * (double) TILE_BYTES / 1048576.0 / (nsecs / 1e9));
+}
+
+void tst_TileCacheBenchmark::cleanupTestCase()
+{
+    delete m_cache;
+}
+
+void tst_TileCacheBenchmark::checkTile(int tile)
+{
+    QByteArray data = m_cache->GetImageFromCache(MapType::GoogleSatellite, tilePosition(tile), ZOOM);
+    QCOMPARE(data, tileData(m_payload, tile));
+}
+
+/**
+ * Store tiles in a transaction each, as PutImageToCache does
+ */
+void tst_TileCacheBenchmark::storeOneByOne()
+{
+    const int count = 1000;
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int tile = m_tiles; tile < m_tiles + count; tile++)
+        QVERIFY(m_cache->PutImageToCache(tileData(m_payload, tile), MapType::GoogleSatellite, tilePosition(tile), ZOOM));
+    qint64 nsecs = timer.nsecsElapsed();
+    qDebug("Stored %d tiles one by one: %.0f tiles/s", count, count / (nsecs / 1e9));
+
+    checkTile(m_tiles + count - 1);
+}
+
+void tst_TileCacheBenchmark::loadSingleThread()
+{
+    qsrand(2);
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < LOADS; i++)
+        checkTile(qrand() % m_tiles);
+    qint64 nsecs = timer.nsecsElapsed();
+    qDebug("Loaded %d random tiles from one thread: %.0f tiles/s", LOADS, LOADS / (nsecs / 1e9));
+}
+
+struct Load {
+    PureImageCache *cache;
+    const QByteArray *payload;
+    int tile;
+    bool matches;
+};
+
+static void loadTile(Load &load)
+{
+    QByteArray data = load.cache->GetImageFromCache(MapType::GoogleSatellite, tilePosition(load.tile), ZOOM);
+    load.matches = (data == tileData(*load.payload, load.tile));
+}
+
+/**
+ * Each thread of the pool loads with its own connection
+ */
+void tst_TileCacheBenchmark::loadAllCores()
+{
+    qsrand(3);
+    QVector<Load> loads(LOADS);
+    for (int i = 0; i < LOADS; i++) {
+        loads[i].cache = m_cache;
+        loads[i].payload = &m_payload;
+        loads[i].tile = qrand() % m_tiles;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    QtConcurrent::blockingMap(loads, loadTile);
+    qint64 nsecs = timer.nsecsElapsed();
+    qDebug("Loaded %d random tiles from %d threads: %.0f tiles/s", LOADS,
+           QThreadPool::globalInstance()->maxThreadCount(), LOADS / (nsecs / 1e9));
+
+    foreach (const Load &load, loads)
+        QVERIFY(load.matches);
+}
+
+void tst_TileCacheBenchmark::missingTiles()
+{
+    QVERIFY(m_cache->GetImageFromCache(MapType::GoogleSatellite, tilePosition(0), ZOOM + 1).isEmpty());
+    QVERIFY(m_cache->GetImageFromCache(MapType::GoogleMap, tilePosition(0), ZOOM).isEmpty());
+}
+
+QTEST_MAIN(tst_TileCacheBenchmark)
+
+#include "tst_tilecachebenchmark.moc"
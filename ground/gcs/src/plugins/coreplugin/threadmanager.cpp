@@ -42,12 +42,38 @@ ThreadManager::ThreadManager(QObject *parent) : QObject(parent)
 
 ThreadManager::~ThreadManager()
 {
+    foreach (QThread *thread, ioThreads) {
+        thread->quit();
+        thread->wait();
+    }
     realTimeThread->quit();
     realTimeThread->wait();
     m_instance = 0;
 }
 
+/**
+ * Thread shared by the telemetry link: the connection device (serial port,
+ * network socket) and the telemetry manager decoding it.
+ */
 QThread *ThreadManager::getRealTimeThread()
 {
 	return realTimeThread;
 }
+
+/**
+ * Get the dedicated I/O thread for the link called \a name, creating it the
+ * first time it is asked for. Links running in separate threads don't delay
+ * each other, e.g. a busy HITL session does not hold up telemetry parsing.
+ */
+QThread *ThreadManager::getIoThread(const QString &name)
+{
+    QMutexLocker locker(&ioThreadsMutex);
+    QThread *thread = ioThreads.value(name);
+    if (thread == NULL) {
+        thread = new QThread(this);
+        thread->setObjectName(name);
+        thread->start(QThread::TimeCriticalPriority);
+        ioThreads.insert(name, thread);
+    }
+    return thread;
+}
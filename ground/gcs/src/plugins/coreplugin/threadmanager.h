@@ -33,6 +33,8 @@
 
 #include <QtCore/QObject>
 #include <QtCore/QThread>
+#include <QtCore/QMap>
+#include <QtCore/QMutex>
 
 QT_BEGIN_NAMESPACE
 QT_END_NAMESPACE
@@ -50,10 +52,13 @@ public:
     static ThreadManager* instance() { return m_instance; }
 
     QThread *getRealTimeThread();
+    QThread *getIoThread(const QString &name);
 
 
 private:
     QThread *realTimeThread;
+    QMap<QString, QThread *> ioThreads;
+    QMutex ioThreadsMutex;
     static ThreadManager *m_instance;
 };
 
@@ -27,6 +27,7 @@
  */
 
 #include "dialgadgetwidget.h"
+#include "uavobjectupdatebridge.h"
 #include <utils/stylehelper.h>
 #include <iostream>
 #include <QtOpenGL/QGLWidget>
@@ -85,22 +86,24 @@ void DialGadgetWidget::enableOpenGL(bool flag)
 void DialGadgetWidget::connectNeedles(QString object1, QString nfield1,
                                           QString object2, QString nfield2,
                                           QString object3, QString nfield3) {
+    ExtensionSystem::PluginManager *pm = ExtensionSystem::PluginManager::instance();
+    UAVObjectManager *objManager = pm->getObject<UAVObjectManager>();
+    // The needles only show the latest value, so coalesced updates are enough
+    UAVObjectUpdateBridge *bridge = pm->getObject<UAVObjectUpdateBridge>();
+
     if (obj1 != NULL)
-        disconnect(obj1,SIGNAL(objectUpdated(UAVObject*)),this,SLOT(updateNeedle1(UAVObject*)));
+        bridge->disconnectObject(obj1,this,SLOT(updateNeedle1(UAVObject*)));
     if (obj2 != NULL)
-        disconnect(obj2,SIGNAL(objectUpdated(UAVObject*)),this,SLOT(updateNeedle2(UAVObject*)));
+        bridge->disconnectObject(obj2,this,SLOT(updateNeedle2(UAVObject*)));
     if (obj3 != NULL)
-        disconnect(obj3,SIGNAL(objectUpdated(UAVObject*)),this,SLOT(updateNeedle3(UAVObject*)));
-
-    ExtensionSystem::PluginManager *pm = ExtensionSystem::PluginManager::instance();
-    UAVObjectManager *objManager = pm->getObject<UAVObjectManager>();
+        bridge->disconnectObject(obj3,this,SLOT(updateNeedle3(UAVObject*)));
 
     // Check validity of arguments first, reject empty args and unknown fields.
     if (!(object1.isEmpty() || nfield1.isEmpty())) {
         obj1 = dynamic_cast<UAVDataObject*>( objManager->getObject(object1) );
         if (obj1 != NULL ) {
             // qDebug() << "Connected Object 1 (" << object1 << ").";
-            connect(obj1, SIGNAL(objectUpdated(UAVObject*)), this, SLOT(updateNeedle1(UAVObject*)));
+            bridge->connectObject(obj1, this, SLOT(updateNeedle1(UAVObject*)));
             if(nfield1.contains("-"))
             {
                 QStringList fieldSubfield = nfield1.split("-", QString::SkipEmptyParts);
@@ -123,7 +126,7 @@ void DialGadgetWidget::connectNeedles(QString object1, QString nfield1,
         obj2 = dynamic_cast<UAVDataObject*>( objManager->getObject(object2) );
         if (obj2 != NULL ) {
             // qDebug() << "Connected Object 2 (" << object2 << ").";
-            connect(obj2, SIGNAL(objectUpdated(UAVObject*)), this, SLOT(updateNeedle2(UAVObject*)));
+            bridge->connectObject(obj2, this, SLOT(updateNeedle2(UAVObject*)));
             if(nfield2.contains("-"))
             {
                 QStringList fieldSubfield = nfield2.split("-", QString::SkipEmptyParts);
@@ -146,7 +149,7 @@ void DialGadgetWidget::connectNeedles(QString object1, QString nfield1,
         obj3 = dynamic_cast<UAVDataObject*>( objManager->getObject(object3) );
         if (obj3 != NULL ) {
             // qDebug() << "Connected Object 3 (" << object3 << ").";
-            connect(obj3, SIGNAL(objectUpdated(UAVObject*)), this, SLOT(updateNeedle3(UAVObject*)));
+            bridge->connectObject(obj3, this, SLOT(updateNeedle3(UAVObject*)));
             if(nfield3.contains("-"))
             {
                 QStringList fieldSubfield = nfield3.split("-", QString::SkipEmptyParts);
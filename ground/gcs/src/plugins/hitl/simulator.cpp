@@ -52,7 +52,7 @@ Simulator::Simulator(const SimulatorSettings& params) :
 	name("")
 {
 	// move to thread
-	moveToThread(Core::ICore::instance()->threadManager()->getRealTimeThread());
+	moveToThread(Core::ICore::instance()->threadManager()->getIoThread("HITL"));
         connect(this, SIGNAL(myStart()), this, SLOT(onStart()),Qt::QueuedConnection);
 	emit myStart();
 
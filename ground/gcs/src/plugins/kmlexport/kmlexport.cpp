@@ -371,11 +371,15 @@ void KmlExport::parseLogFile()
         QByteArray dataBuffer;
         dataBuffer.append(logFile.read(packetSize));
 
+        // Keyframes and the index of the log start with a marker beginning
+        // with "TLL", see LogIndex. Keyframes only repeat the state of the
+        // objects, and the index holds no packets.
+        if (dataBuffer.startsWith("TLL"))
+            continue;
+
         // Parse the packet. This operation passes the data to the kmlTalk object, which internally parses the data
         // and then emits objectUpdated(UAVObject *) signals. These signals are connected to in the KmlExport constructor.
-        for (int i=0; i < dataBuffer.size(); i++) {
-            kmlTalk->processInputByte(dataBuffer[i]);
-        }
+        kmlTalk->processInputBlock((const quint8 *) dataBuffer.constData(), dataBuffer.size());
 
         timeStampIdx++;
     }
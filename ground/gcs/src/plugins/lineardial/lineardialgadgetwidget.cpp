@@ -26,6 +26,7 @@
  */
 
 #include "lineardialgadgetwidget.h"
+#include "uavobjectupdatebridge.h"
 #include <utils/stylehelper.h>
 #include <QFileDialog>
 #include <QtOpenGL/QGLWidget>
@@ -77,10 +78,13 @@ void LineardialGadgetWidget::enableOpenGL(bool flag)
   */
 void LineardialGadgetWidget::connectInput(QString object1, QString nfield1) {
 
-    if (obj1 != NULL)
-        disconnect(obj1,SIGNAL(objectUpdated(UAVObject*)),this,SLOT(updateIndex(UAVObject*)));
     ExtensionSystem::PluginManager *pm = ExtensionSystem::PluginManager::instance();
     UAVObjectManager *objManager = pm->getObject<UAVObjectManager>();
+    // The index only shows the latest value, so coalesced updates are enough
+    UAVObjectUpdateBridge *bridge = pm->getObject<UAVObjectUpdateBridge>();
+
+    if (obj1 != NULL)
+        bridge->disconnectObject(obj1,this,SLOT(updateIndex(UAVObject*)));
 
     // qDebug() << "Lineardial Connect needles - " << object1 << "-"<< nfield1;
 
@@ -88,7 +92,7 @@ void LineardialGadgetWidget::connectInput(QString object1, QString nfield1) {
     if (!(object1.isEmpty() || nfield1.isEmpty())) {
         obj1 = dynamic_cast<UAVDataObject*>( objManager->getObject(object1) );
         if (obj1 != NULL ) {
-            connect(obj1, SIGNAL(objectUpdated(UAVObject*)), this, SLOT(updateIndex(UAVObject*)));
+            bridge->connectObject(obj1, this, SLOT(updateIndex(UAVObject*)));
             if(nfield1.contains("-"))
             {
                 QStringList fieldSubfield = nfield1.split("-", QString::SkipEmptyParts);
@@ -0,0 +1,222 @@
+/**
+ ******************************************************************************
+ *
+ * @file       compactlog.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @brief      Decoder of the compact logs written onboard
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "compactlog.h"
+#include "uavtalk/uavtalk.h"
+#include <QDebug>
+#include <QtEndian>
+#include <string.h>
+
+CompactLog::CompactLog() :
+    updateCount(0), skippedBytes(0)
+{
+}
+
+/**
+ * @return true if a log starting with \a header is a compact log
+ */
+bool CompactLog::isCompact(const QByteArray &header)
+{
+    return header.size() >= HEADER_SIZE && header.startsWith("TLCL") && (quint8) header[4] == VERSION;
+}
+
+/**
+ * Write the updates of a compact log to \a out as telemetry log records.
+ * Damaged records are skipped up to the next valid one, the instances are
+ * then decoded again from their next keyframes.
+ * @return false if the log does not have the header of a compact log
+ */
+bool CompactLog::decode(const QByteArray &log, QIODevice *out)
+{
+    objects.clear();
+    instances.clear();
+    updateCount = 0;
+    skippedBytes = 0;
+    if (!isCompact(log))
+        return false;
+
+    const quint8 *data = (const quint8 *) log.constData();
+    quint32 timestamp = 0;
+    int pos = HEADER_SIZE;
+    int gap = 0;
+    while (pos < log.size()) {
+        int length = data[pos] == SYNC ? recordLength(log, pos) : 0;
+        if (length == 0 || UAVTalk::updateCRC(0, data + pos + 1, length - 1) != data[pos + length]) {
+            pos++;
+            gap++;
+            continue;
+        }
+
+        // Records may be missing, the instances are known again at their
+        // keyframes
+        if (gap > 0) {
+            instances.clear();
+            skippedBytes += gap;
+            gap = 0;
+        }
+
+        int p = pos + 1;
+        pos += length + 1;
+        quint8 tag = data[p++];
+
+        // The rest of the last sector is padding
+        if (tag == TAG_END)
+            break;
+
+        if (tag == TAG_DEFINE) {
+            Object &object = objects[data[p]];
+            quint32 objId = qFromLittleEndian<quint32>(data + p + 1);
+            int objLength = qFromLittleEndian<quint16>(data + p + 5);
+            if (objId != object.objId || objLength != object.length) {
+                // The index is given to another object
+                QMutableHashIterator<quint32, QByteArray> i(instances);
+                while (i.hasNext()) {
+                    if (i.next().key() >> 16 == data[p])
+                        i.remove();
+                }
+            }
+            object.objId = objId;
+            object.length = objLength;
+            object.singleInstance = data[p + 7] & FLAG_SINGLE_INSTANCE;
+            continue;
+        }
+
+        quint8 index = tag & TAG_INDEX;
+        const Object &object = objects[index];
+        bool keyframe = tag & TAG_KEYFRAME;
+        quint32 time;
+        quint32 instId = 0;
+        getVarint(log, &p, pos, &time);
+        if (tag & TAG_INSTANCE)
+            getVarint(log, &p, pos, &instId);
+        timestamp = keyframe ? time : timestamp + time;
+
+        // Apply the changed bytes to the previous data of the instance,
+        // unknown until its keyframe
+        quint32 key = (quint32) index << 16 | (quint16) instId;
+        bool known = instances.contains(key);
+        QByteArray &instData = instances[key];
+        if (keyframe || !known)
+            instData.fill(0, object.length);
+        char *objData = instData.data();
+        int mask = p;
+        p += (object.length + 7) / 8;
+        for (int i = 0; i < object.length; i++) {
+            if (data[mask + i / 8] & (1 << (i % 8)))
+                objData[i] ^= data[p++];
+        }
+
+        if (!keyframe && !known) {
+            instances.remove(key);
+            continue;
+        }
+
+        writeRecord(out, timestamp, object, instId, instData);
+        updateCount++;
+    }
+
+    return true;
+}
+
+/**
+ * Length of the record starting with the sync byte at \a pos, without its
+ * CRC
+ * @return the length, or 0 if the record is cut or of an unknown object
+ */
+int CompactLog::recordLength(const QByteArray &log, int pos) const
+{
+    const quint8 *data = (const quint8 *) log.constData();
+    int end = log.size() - 1;
+    int p = pos + 1;
+    if (p >= end)
+        return 0;
+
+    quint8 tag = data[p++];
+    if (tag == TAG_END)
+        return 2;
+    if (tag == TAG_DEFINE)
+        return p + 8 <= end ? 10 : 0;
+
+    QHash<quint8, Object>::const_iterator object = objects.constFind(tag & TAG_INDEX);
+    quint32 val;
+    if (object == objects.constEnd() || !getVarint(log, &p, end, &val))
+        return 0;
+    if ((tag & TAG_INSTANCE) && !getVarint(log, &p, end, &val))
+        return 0;
+
+    int length = object->length;
+    int mask = p;
+    p += (length + 7) / 8;
+    if (p > end)
+        return 0;
+    for (int i = 0; i < length; i++) {
+        if (data[mask + i / 8] & (1 << (i % 8)))
+            p++;
+    }
+    return p <= end ? p - pos : 0;
+}
+
+/**
+ * Read a varint ending before \a end
+ * @return false if the record ends in the middle of it
+ */
+bool CompactLog::getVarint(const QByteArray &log, int *pos, int end, quint32 *val)
+{
+    *val = 0;
+    for (int shift = 0; shift < 35 && *pos < end; shift += 7) {
+        quint8 byte = log[(*pos)++];
+        *val |= (quint32) (byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+/**
+ * Write an update as a record of a telemetry log holding a UAVTalk object
+ * packet, as LogFile::writeData() does
+ */
+void CompactLog::writeRecord(QIODevice *out, quint32 timestamp, const Object &object, quint16 instId, const QByteArray &data)
+{
+    int headerLength = UAVTalk::MIN_HEADER_LENGTH + (object.singleInstance ? 0 : 2);
+    int length = headerLength + data.size();
+    packet.resize(length + UAVTalk::CHECKSUM_LENGTH);
+
+    quint8 *p = (quint8 *) packet.data();
+    p[0] = UAVTalk::SYNC_VAL;
+    p[1] = UAVTalk::TYPE_OBJ;
+    qToLittleEndian<quint16>(length, p + 2);
+    qToLittleEndian<quint32>(object.objId, p + 4);
+    if (!object.singleInstance)
+        qToLittleEndian<quint16>(instId, p + UAVTalk::MIN_HEADER_LENGTH);
+    memcpy(p + headerLength, data.constData(), data.size());
+    p[length] = UAVTalk::updateCRC(0, p, length);
+
+    qint64 dataSize = packet.size();
+    out->write((const char *) &timestamp, sizeof(timestamp));
+    out->write((const char *) &dataSize, sizeof(dataSize));
+    out->write(packet);
+}
@@ -0,0 +1,86 @@
+/**
+ ******************************************************************************
+ *
+ * @file       compactlog.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @brief      Decoder of the compact logs written onboard
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef COMPACTLOG_H
+#define COMPACTLOG_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QIODevice>
+
+/**
+ * @brief Decodes the logs the Logging module writes to its flash in the
+ * compact format, see flight/Modules/Logging/inc/logcompact.h.
+ *
+ * The updates are turned back into UAVTalk object packets, written as the
+ * records of a telemetry log with the time of the update, so that the log
+ * is replayed as one recorded by the GCS. Damaged records are skipped, along
+ * with the updates of the instances until their next keyframes.
+ */
+class CompactLog
+{
+public:
+    //! Size of the header the compact logs start with
+    static const int HEADER_SIZE = 5;
+
+    static bool isCompact(const QByteArray &header);
+
+    CompactLog();
+    bool decode(const QByteArray &log, QIODevice *out);
+    int getUpdateCount() const { return updateCount; }
+    int getSkippedBytes() const { return skippedBytes; }
+
+private:
+    static const quint8 SYNC = 0xA5;
+    static const quint8 TAG_END = 0x00;
+    static const quint8 TAG_DEFINE = 0x7F;
+    static const quint8 TAG_KEYFRAME = 0x40;
+    static const quint8 TAG_INSTANCE = 0x80;
+    static const quint8 TAG_INDEX = 0x3F;
+    static const quint8 FLAG_SINGLE_INSTANCE = 0x01;
+    static const quint8 VERSION = 2;
+
+    struct Object {
+        Object() : objId(0), singleInstance(false), length(0) {}
+        quint32 objId;
+        bool singleInstance;
+        int length;
+    };
+
+    static bool getVarint(const QByteArray &log, int *pos, int end, quint32 *val);
+    int recordLength(const QByteArray &log, int pos) const;
+    void writeRecord(QIODevice *out, quint32 timestamp, const Object &object, quint16 instId, const QByteArray &data);
+
+    //! Objects by index
+    QHash<quint8, Object> objects;
+    //! Previous data of the instances by object index and instance id
+    QHash<quint32, QByteArray> instances;
+    QByteArray packet;
+    int updateCount;
+    int skippedBytes;
+};
+
+#endif // COMPACTLOG_H
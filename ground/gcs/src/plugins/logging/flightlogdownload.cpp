@@ -52,6 +52,9 @@ FlightLogDownload::FlightLogDownload(QWidget *parent) :
     UAVObjectManager *uavoManager = pm->getObject<UAVObjectManager>();
     loggingStats = LoggingStats::GetInstance(uavoManager);
     Q_ASSERT(loggingStats);
+    downloadAck = LoggingDownloadAck::GetInstance(uavoManager);
+    Q_ASSERT(downloadAck);
+    windowed = false;
 
     connect(ui->fileNameButton, SIGNAL(clicked()), this, SLOT(getFilename()));
     connect(ui->saveButton, SIGNAL(clicked()), this, SLOT(startDownload()));
@@ -102,6 +105,21 @@ void FlightLogDownload::updateReceived()
         break;
     }
 
+    if (windowed) {
+        if (logging.Operation == LoggingStats::OPERATION_DOWNLOAD ||
+                logging.Operation == LoggingStats::OPERATION_COMPLETE) {
+            sectorReceived(logging);
+            return;
+        }
+
+        // Firmware without the sliding window answers the request with the
+        // first sector and IDLE, carry on one sector at a time
+        if (logging.Operation == LoggingStats::OPERATION_IDLE) {
+            qDebug() << "Firmware does not support windowed log download";
+            windowed = false;
+        }
+    }
+
     UAVObject::Metadata mdata;
 
     switch (logging.Operation) {
@@ -115,20 +133,9 @@ void FlightLogDownload::updateReceived()
         qDebug() << "Requesting sector num: " << logging.FileSectorNum;
         break;
     case LoggingStats::OPERATION_COMPLETE:
-    {
         log.append((char *) logging.FileSector, LoggingStats::FILESECTOR_NUMELEM);
-
-        dl_state = DL_IDLE;
-
-        mdata = loggingStats->getMetadata();
-        UAVObject::SetFlightTelemetryUpdateMode(mdata, UAVObject::UPDATEMODE_MANUAL);
-        loggingStats->setMetadata(mdata);
-
-        logFile->write(log);
-        logFile->close();
-
+        finishDownload();
         break;
-    }
     case LoggingStats::OPERATION_ERROR:
         dl_state = DL_IDLE;
 
@@ -142,6 +149,101 @@ void FlightLogDownload::updateReceived()
     }
 }
 
+/**
+ * @brief FlightLogDownload::sectorReceived store a sector sent with the
+ * sliding window and acknowledge it. The window grows while sectors arrive
+ * in order and shrinks by 30% when a gap shows sectors were lost, a gentler cut
+ * than TCP as most losses on a radio link are not congestion.
+ */
+void FlightLogDownload::sectorReceived(const LoggingStats::DataFields &logging)
+{
+    const int sectorSize = LoggingStats::FILESECTOR_NUMELEM;
+    int sector = logging.FileSectorNum;
+    if (logging.Operation == LoggingStats::OPERATION_COMPLETE)
+        lastSector = sector;
+
+    if (sector >= received.size()) {
+        received.resize(sector + 1);
+        log.resize((sector + 1) * sectorSize);
+    }
+
+    if (!received.testBit(sector)) {
+        received.setBit(sector);
+        memcpy(log.data() + sector * sectorSize, logging.FileSector, sectorSize);
+
+        if (sector > highestSector + 1 && highestSector + 1 > recoverySector) {
+            windowThreshold = qMax(window * 0.7, 1.0);
+            window = windowThreshold;
+            recoverySector = sector;
+        } else if (window < windowThreshold) {
+            window += 1;
+        } else {
+            window += 1 / window;
+        }
+        window = qMin(window, (double) MAX_WINDOW);
+        highestSector = qMax(highestSector, sector);
+
+        while (nextSector < received.size() && received.testBit(nextSector))
+            nextSector++;
+    }
+
+    sendAck();
+
+    double seconds = downloadTimer.elapsed() / 1000.0;
+    ui->sectorLabel->setText(tr("%0 (%1 kB/s)").arg(nextSector)
+                             .arg(seconds > 0 ? nextSector * sectorSize / 1024.0 / seconds : 0, 0, 'f', 1));
+
+    if (lastSector >= 0 && nextSector > lastSector)
+        finishDownload();
+}
+
+/**
+ * @brief FlightLogDownload::sendAck tell the flight side which sectors were
+ * received and how many it may send ahead
+ */
+void FlightLogDownload::sendAck()
+{
+    LoggingDownloadAck::DataFields ack = downloadAck->getData();
+    ack.FileRequest = fileId;
+    ack.Window = (quint8) window;
+    ack.SectorAck = nextSector;
+    ack.SectorMask = 0;
+    for (int i = 0; i < 32 && nextSector + 1 + i < received.size(); i++) {
+        if (received.testBit(nextSector + 1 + i))
+            ack.SectorMask |= 1u << i;
+    }
+    downloadAck->setData(ack);
+    downloadAck->updated();
+}
+
+/**
+ * @brief FlightLogDownload::finishDownload save the log and stop the updates
+ * of the logging object
+ */
+void FlightLogDownload::finishDownload()
+{
+    dl_state = DL_IDLE;
+
+    UAVObject::Metadata mdata = loggingStats->getMetadata();
+    UAVObject::SetFlightTelemetryUpdateMode(mdata, UAVObject::UPDATEMODE_MANUAL);
+    loggingStats->setMetadata(mdata);
+
+    if (windowed) {
+        // The flight side may still be waiting for the last acknowledgement,
+        // which is not resent if lost, so end the transfer explicitly
+        LoggingStats::DataFields logging = loggingStats->getData();
+        logging.Operation = LoggingStats::OPERATION_IDLE;
+        loggingStats->setData(logging);
+        loggingStats->updated();
+
+        log.resize((lastSector + 1) * LoggingStats::FILESECTOR_NUMELEM);
+        qDebug() << "Downloaded" << log.size() << "bytes in" << downloadTimer.elapsed() << "ms";
+    }
+
+    logFile->write(log);
+    logFile->close();
+}
+
 /**
  * @brief FlightLogDownload::startDownload set up the metadata
  * on the logging object and start a download after checking the
@@ -172,6 +274,20 @@ void FlightLogDownload::startDownload()
     UAVObject::SetFlightTelemetryUpdateMode(mdata, UAVObject::UPDATEMODE_ONCHANGE);
     loggingStats->setMetadata(mdata);
 
+    // Set up the sliding window before requesting the file, the flight side
+    // checks it when opening the file
+    windowed = true;
+    fileId = file_id;
+    received.clear();
+    nextSector = 0;
+    highestSector = -1;
+    lastSector = -1;
+    window = 2;
+    windowThreshold = MAX_WINDOW;
+    recoverySector = -1;
+    downloadTimer.start();
+    sendAck();
+
     qDebug() << "Download file id: " << file_id;
     dl_state = DL_DOWNLOADING;
     logging.Operation = LoggingStats::OPERATION_DOWNLOAD;
@@ -31,8 +31,11 @@
 
 #include <QDialog>
 #include <QByteArray>
+#include <QBitArray>
+#include <QElapsedTimer>
 #include <QFile>
 #include "loggingstats.h"
+#include "loggingdownloadack.h"
 
 namespace Ui {
 class FlightLogDownload;
@@ -52,10 +55,34 @@ private slots:
     void getFilename();
 
 private:
+    void sectorReceived(const LoggingStats::DataFields &logging);
+    void sendAck();
+    void finishDownload();
+
+    //! Sectors the flight side can hold for retransmission
+    static const int MAX_WINDOW = 16;
+
     LoggingStats *loggingStats;
+    LoggingDownloadAck *downloadAck;
     QByteArray log;
     QFile *logFile;
 
+    //! Set while using the sliding window, cleared if the firmware answers
+    //! one sector at a time
+    bool windowed;
+    quint16 fileId;
+    QBitArray received;
+    //! All the sectors before this one were received
+    int nextSector;
+    int highestSector;
+    int lastSector;
+    //! Sectors allowed in flight, grown and cut on losses like a TCP window
+    double window;
+    double windowThreshold;
+    //! No more cuts of the window until this sector is received
+    int recoverySector;
+    QElapsedTimer downloadTimer;
+
     enum LOG_DL_STATE {DL_IDLE, DL_DOWNLOADING, DL_COMPLETE} dl_state;
 
     Ui::FlightLogDownload *ui;
@@ -26,6 +26,7 @@
  */
 
 #include "logfile.h"
+#include "compactlog.h"
 #include <QDebug>
 #include <QtGlobal>
 #include <QTextStream>
@@ -38,7 +39,14 @@
 
 LogFile::LogFile(QObject *parent) :
     QIODevice(parent),
-    timestampBufferIdx(0)
+    firstTimestamp(0),
+    writingKeyframe(false),
+    decodedFile(NULL),
+    queuedBytes(0),
+    fastReplay(false),
+    paused(false),
+    replayedBytes(0),
+    replayRate(0)
 {
     connect(&timer, SIGNAL(timeout()), this, SLOT(timerFired()));
 }
@@ -84,6 +92,15 @@ bool LogFile::open(OpenMode mode) {
         QTextStream out(&file);
 
         out << "Tau Labs git hash:\n" <<  gitHash << "\n" << uavoHash << "\n##\n";
+
+        index.clear();
+        writingKeyframe = false;
+    }
+    else if (mode == QIODevice::ReadOnly && CompactLog::isCompact(file.peek(CompactLog::HEADER_SIZE)))
+    {
+        // Damaged records are skipped by the decoder, and startReplay()
+        // reports a decoded log which cannot be written
+        decodeCompact();
     }
     else if(mode == QIODevice::ReadOnly)
     {
@@ -144,15 +161,59 @@ void LogFile::close()
 
     if (timer.isActive())
         timer.stop();
+    if (file.isOpen() && file.isWritable())
+        writeIndex();
+
+    // Wait for the parser to be done with the mapping before removing it
+    mapMutex.lock();
+    mutex.lock();
+    slices.clear();
+    queuedBytes = 0;
+    mutex.unlock();
+    mappedLog.close();
+    mapMutex.unlock();
+
+    delete decodedFile;
+    decodedFile = NULL;
+
     file.close();
     QIODevice::close();
 }
 
+/**
+ * Decode a log written onboard in the compact format into a temporary log
+ * of UAVTalk packets, which is replayed in place of the file
+ */
+void LogFile::decodeCompact()
+{
+    delete decodedFile;
+    decodedFile = new QTemporaryFile();
+    if (!decodedFile->open()) {
+        qDebug() << "Unable to create a file for the decoded log:" << decodedFile->errorString();
+        return;
+    }
+
+    CompactLog decoder;
+    decoder.decode(file.readAll(), decodedFile);
+    decodedFile->flush();
+    decodedFile->seek(0);
+    qDebug() << "Decoded" << decoder.getUpdateCount() << "updates from the compact log" << file.fileName();
+    if (decoder.getSkippedBytes() > 0)
+        qDebug() << "Skipped" << decoder.getSkippedBytes() << "damaged bytes of the compact log" << file.fileName();
+}
+
 qint64 LogFile::writeData(const char * data, qint64 dataSize) {
     if (!file.isWritable())
         return dataSize;
 
+    // Keyframe packets are gathered and written as a single record
+    if (writingKeyframe) {
+        keyframeBuffer.append(data, dataSize);
+        return dataSize;
+    }
+
     quint32 timeStamp = myTime.elapsed();
+    index.addRecord(timeStamp, file.pos());
 
     file.write((char *) &timeStamp,sizeof(timeStamp));
     file.write((char *) &dataSize, sizeof(dataSize));
@@ -164,126 +225,237 @@ qint64 LogFile::writeData(const char * data, qint64 dataSize) {
     return dataSize;
 }
 
+/**
+ * Start a keyframe. The packets written until endKeyframe() are stored as a
+ * single record, marked and indexed as a keyframe so that the readers do not
+ * play it as telemetry and replay can restore the state of all the objects
+ * from it when seeking.
+ */
+void LogFile::beginKeyframe()
+{
+    keyframeBuffer = QByteArray(LogIndex::KEYFRAME_MARKER, LogIndex::MARKER_SIZE);
+    writingKeyframe = true;
+}
+
+void LogFile::endKeyframe()
+{
+    writingKeyframe = false;
+    if (!file.isWritable() || keyframeBuffer.size() <= LogIndex::MARKER_SIZE)
+        return;
+
+    quint32 timeStamp = myTime.elapsed();
+    qint64 dataSize = keyframeBuffer.size();
+    index.addKeyframe(timeStamp, file.pos());
+    index.addRecord(timeStamp, file.pos());
+
+    file.write((char *) &timeStamp,sizeof(timeStamp));
+    file.write((char *) &dataSize, sizeof(dataSize));
+    file.write(keyframeBuffer);
+    keyframeBuffer.clear();
+}
+
+/**
+ * Append the index of the records to the log, as its last record
+ */
+void LogFile::writeIndex()
+{
+    qint64 indexOffset = file.pos();
+    QByteArray payload = index.serialize(indexOffset);
+    quint32 timeStamp = index.getLastTimestamp();
+    qint64 dataSize = payload.size();
+
+    file.write((char *) &timeStamp,sizeof(timeStamp));
+    file.write((char *) &dataSize, sizeof(dataSize));
+    file.write(payload);
+}
+
+/**
+ * Copy queued bytes out, for parsers which do not read the log in place
+ */
 qint64 LogFile::readData(char * data, qint64 maxSize) {
-    QMutexLocker locker(&mutex);
-    qint64 toRead = qMin(maxSize,(qint64)dataBuffer.size());
-    memcpy(data,dataBuffer.data(),toRead);
-    dataBuffer.remove(0,toRead);
+    QMutexLocker mapLocker(&mapMutex);
+    qint64 toRead = 0;
+    {
+        QMutexLocker locker(&mutex);
+        while (toRead < maxSize && !slices.isEmpty()) {
+            Slice &slice = slices.head();
+            qint64 length = qMin(maxSize - toRead, slice.bytes.size() - slice.offset);
+            memcpy(data + toRead, slice.bytes.constData() + slice.offset, length);
+            toRead += length;
+            slice.offset += length;
+            if (slice.offset == slice.bytes.size())
+                slices.dequeue();
+        }
+    }
+    consumed(toRead);
     return toRead;
 }
 
 qint64 LogFile::bytesAvailable() const
 {
-    return dataBuffer.size();
+    return queuedBytes;
+}
+
+/**
+ * Hand the queued slices of the mapped log to the parser in place. The
+ * mapping is kept until the parser is done with them.
+ * @return the number of bytes parsed
+ */
+qint64 LogFile::parseBlocks(UAVTalk *parser)
+{
+    QMutexLocker mapLocker(&mapMutex);
+    qint64 parsed = 0;
+    forever {
+        Slice slice;
+        {
+            QMutexLocker locker(&mutex);
+            if (slices.isEmpty())
+                break;
+            slice = slices.dequeue();
+        }
+        qint64 length = slice.bytes.size() - slice.offset;
+        parser->parseBlock((const quint8 *) slice.bytes.constData() + slice.offset, length);
+        consumed(length);
+        parsed += length;
+    }
+    return parsed;
+}
+
+/**
+ * Account for bytes handed to the parser, and queue more of them as soon as
+ * it has caught up when replaying as fast as possible
+ */
+void LogFile::consumed(qint64 length)
+{
+    bool drained;
+    {
+        QMutexLocker locker(&mutex);
+        queuedBytes -= length;
+        replayedBytes += length;
+        drained = slices.isEmpty();
+    }
+    if (drained && fastReplay)
+        QMetaObject::invokeMethod(this, "queueBatch", Qt::QueuedConnection);
+}
+
+void LogFile::queueSlice(const QByteArray &payload)
+{
+    QMutexLocker locker(&mutex);
+    Slice slice = { payload, 0 };
+    slices.enqueue(slice);
+    queuedBytes += payload.size();
+}
+
+/**
+ * Queue the payload of the next record for the parser
+ * @return RECORD_CORRUPTED if the replay must stop, RECORD_SKIPPED if
+ * nothing was queued
+ */
+LogFile::RecordStatus LogFile::queueRecord()
+{
+    QByteArray payload;
+    bool keyframe;
+    if (!mappedLog.next(&payload, &keyframe))
+        return mappedLog.atEnd() ? RECORD_SKIPPED : RECORD_CORRUPTED;
+
+    // Keyframes repeat the state of all the objects, they are only played
+    // when seeking
+    if (keyframe)
+        return RECORD_SKIPPED;
+
+    qint64 dataSize = payload.size();
+    if (dataSize<1 || dataSize>(1024*1024)) {
+        qDebug() << "Error: Logfile corrupted! Unlikely packet size: " << dataSize << "\n";
+        return RECORD_CORRUPTED;
+    }
+
+    queueSlice(payload);
+    return RECORD_QUEUED;
 }
 
 void LogFile::timerFired()
 {
-    qint64 dataSize;
+    bool queued = false;
 
-    if(file.bytesAvailable() > 4)
+    int time;
+    time = myTime.elapsed();
+
+    //Read packets
+    while (!mappedLog.atEnd() && (lastPlayTime + ((time - lastPlayTimeOffset)* playbackSpeed) > (mappedLog.getNextTimestamp()-firstTimestamp)))
     {
+        lastPlayTime += ((time - lastPlayTimeOffset)* playbackSpeed);
 
-        int time;
+        RecordStatus status = queueRecord();
+        if (status == RECORD_CORRUPTED) {
+            stopReplay();
+            return;
+        }
+        queued |= status == RECORD_QUEUED;
+
+        lastPlayTimeOffset = time;
         time = myTime.elapsed();
+    }
 
-        //Read packets
-        while ((lastPlayTime + ((time - lastPlayTimeOffset)* playbackSpeed) > (lastTimeStamp-firstTimestamp)))
-        {
-            lastPlayTime += ((time - lastPlayTimeOffset)* playbackSpeed);
-            if(file.bytesAvailable() < 4) {
-                stopReplay();
-                return;
-            }
-
-            file.seek(lastTimeStampPos+sizeof(lastTimeStamp));
-
-            file.read((char *) &dataSize, sizeof(dataSize));
-
-            if (dataSize<1 || dataSize>(1024*1024)) {
-                qDebug() << "Error: Logfile corrupted! Unlikely packet size: " << dataSize << "\n";
-                stopReplay();
-                return;
-            }
-            if(file.bytesAvailable() < dataSize) {
-                stopReplay();
-                return;
-            }
-
-            mutex.lock();
-            dataBuffer.append(file.read(dataSize));
-            mutex.unlock();
-            emit readyRead();
-
-            if(file.bytesAvailable() < 4) {
-                stopReplay();
-                return;
-            }
-
-            lastTimeStampPos = timestampPos[timestampBufferIdx];
-            lastTimeStamp = timestampBuffer[timestampBufferIdx];
-            timestampBufferIdx++;
-
-            lastPlayTimeOffset = time;
-            time = myTime.elapsed();
+    if (queued)
+        emit readyRead();
+    else if (mappedLog.atEnd() && bytesAvailable() == 0)
+        stopReplay();
+}
 
+/**
+ * Queue records until a batch is waiting for the parser, without waiting
+ * for the replay timer
+ */
+void LogFile::queueBatch()
+{
+    if (!fastReplay || paused || !mappedLog.isOpen() || bytesAvailable() > 0)
+        return;
+
+    bool queued = false;
+    while (!mappedLog.atEnd() && bytesAvailable() < FAST_REPLAY_BATCH) {
+        RecordStatus status = queueRecord();
+        if (status == RECORD_CORRUPTED) {
+            stopReplay();
+            return;
         }
-    } else {
-        stopReplay();
+        queued |= status == RECORD_QUEUED;
     }
 
+    if (queued)
+        emit readyRead();
+    else if (mappedLog.atEnd())
+        stopReplay();
 }
 
 bool LogFile::startReplay() {
-    dataBuffer.clear();
     myTime.restart();
     lastPlayTimeOffset = 0;
     lastPlayTime = 0;
     playbackSpeed = 1;
+    paused = false;
 
-    //Read all log timestamps into array
-    timestampBuffer.clear(); //Save beginning of log for later use
-    timestampPos.clear();
-    quint64 logFileStartIdx = file.pos();
-    timestampBufferIdx = 0;
-    lastTimeStamp = 0;
-
-    while (!file.atEnd()){
-        qint64 dataSize;
-
-        //Get time stamp position
-        timestampPos.append(file.pos());
-
-        //Read timestamp and logfile packet size
-        file.read((char *) &lastTimeStamp, sizeof(lastTimeStamp));
-        file.read((char *) &dataSize, sizeof(dataSize));
-
-        //Check if dataSize sync bytes are correct.
-        //TODO: LIKELY AS NOT, THIS WILL FAIL TO RESYNC BECAUSE THERE IS TOO LITTLE INFORMATION IN THE STRING OF SIX 0x00
-        if ((dataSize & 0xFFFFFFFFFFFF0000)!=0){
-            qDebug() << "Wrong sync byte. At file location 0x"  << QString("%1").arg(file.pos(),0,16) << "Got 0x" << QString("%1").arg(dataSize & 0xFFFFFFFFFFFF0000,0,16) << ", but expected 0x""00"".";
-            file.seek(timestampPos.last()+1);
-            timestampPos.pop_back();
-            continue;
-        }
-
-        //Check if timestamps are sequential.
-        if (!timestampBuffer.isEmpty() && lastTimeStamp < timestampBuffer.last()){
-            QMessageBox msgBox;
-            msgBox.setText("Corrupted file.");
-            msgBox.setInformativeText("Timestamps are not sequential. Playback may have unexpected behavior"); //<--TODO: add hyperlink to webpage with better description.
-            msgBox.exec();
-
-            qDebug() << "Timestamp: " << timestampBuffer.last() << " " << lastTimeStamp;
-        }
+    //Map the log, using the index written at its end if there is one
+    QFile *source = decodedFile ? decodedFile : &file;
+    if (!mappedLog.open(source, source->pos())) {
+        QMessageBox msgBox;
+        msgBox.setText("Unable to read the logfile.");
+        msgBox.setInformativeText(source->errorString());
+        msgBox.exec();
 
-        timestampBuffer.append(lastTimeStamp);
+        stopReplay();
+        return false;
+    }
 
-        file.seek(timestampPos.last()+sizeof(lastTimeStamp)+sizeof(dataSize)+dataSize);
+    //Check if timestamps are sequential.
+    if (!mappedLog.getIndex().isSequential()){
+        QMessageBox msgBox;
+        msgBox.setText("Corrupted file.");
+        msgBox.setInformativeText("Timestamps are not sequential. Playback may have unexpected behavior"); //<--TODO: add hyperlink to webpage with better description.
+        msgBox.exec();
     }
 
     //Check if any timestamps were successfully read
-    if (timestampBuffer.size() == 0){
+    if (mappedLog.getIndex().getRecordCount() == 0){
         QMessageBox msgBox;
         msgBox.setText("Empty logfile.");
         msgBox.setInformativeText("No log data can be found.");
@@ -293,53 +465,111 @@ bool LogFile::startReplay() {
         return false;
     }
 
-    //Reset to log beginning.
-    file.seek(logFileStartIdx+sizeof(lastTimeStamp));
-    lastTimeStampPos = timestampPos[0];
-    lastTimeStamp = timestampBuffer[0];
-    firstTimestamp = timestampBuffer[0];
-    timestampBufferIdx = 1;
+    firstTimestamp = mappedLog.getIndex().getFirstTimestamp();
+    replayedBytes = 0;
+    replayRate = 0;
+    replayClock.start();
 
-    timer.setInterval(10);
-    timer.start();
+    if (fastReplay) {
+        QMetaObject::invokeMethod(this, "queueBatch", Qt::QueuedConnection);
+    } else {
+        timer.setInterval(10);
+        timer.start();
+    }
     emit replayStarted();
     return true;
 }
 
 bool LogFile::stopReplay() {
+    if (replayClock.isValid() && replayClock.elapsed() > 0) {
+        replayRate = replayedBytes / 1048576.0 / (replayClock.elapsed() / 1000.0);
+        qDebug() << "Replayed" << replayedBytes / 1048576.0 << "MB in" << replayClock.elapsed() / 1000.0 << "s," << replayRate << "MB/s";
+    }
+    replayClock.invalidate();
+
     close();
     emit replayFinished();
     return true;
 }
 
+/**
+ * @brief LogFile::getReplayRate, the decode rate of the current or last replay
+ * @return the rate in MB/s
+ */
+double LogFile::getReplayRate() const
+{
+    if (replayClock.isValid() && replayClock.elapsed() > 0)
+        return replayedBytes / 1048576.0 / (replayClock.elapsed() / 1000.0);
+    return replayRate;
+}
+
 void LogFile::pauseReplay()
 {
     timer.stop();
+    paused = true;
 }
 
 void LogFile::resumeReplay()
 {
+    paused = false;
     lastPlayTimeOffset = myTime.elapsed();
-    timer.start();
+    if (fastReplay)
+        queueBatch();
+    else
+        timer.start();
 }
 
 /**
- * @brief LogFile::setReplayTime, sets the playback time
- * @param val, the time in
+ * @brief LogFile::setReplayAsFastAsPossible, plays the log as fast as the
+ * parser decodes it instead of following its timestamps, for batch analysis
+ * @param val, true to replay as fast as possible
  */
-void LogFile::setReplayTime(double val)
+void LogFile::setReplayAsFastAsPossible(bool val)
 {
-    quint32 tmpIdx=0;
-    while(timestampBuffer[tmpIdx++] <= val*1000 && tmpIdx <= timestampBufferIdx){
+    fastReplay = val;
+    if (!mappedLog.isOpen() || paused)
+        return;
+
+    if (fastReplay) {
+        timer.stop();
+        queueBatch();
+    } else {
+        lastPlayTimeOffset = myTime.elapsed();
+        lastPlayTime = mappedLog.getNextTimestamp() - firstTimestamp;
+        timer.start(10);
     }
+}
 
-    lastTimeStampPos=timestampPos[tmpIdx];
-    lastTimeStamp=timestampBuffer[tmpIdx];
-    timestampBufferIdx=tmpIdx;
+/**
+ * @brief LogFile::setReplayTime, sets the playback time. The state of all the
+ * objects is restored from the last keyframe before that time, found with a
+ * binary search of the index, and playback resumes from the first packet at
+ * or after that time.
+ * @param val, the time in seconds from the start of the log
+ */
+void LogFile::setReplayTime(double val)
+{
+    if (!mappedLog.isOpen())
+        return;
+
+    quint32 replayTime = firstTimestamp + val*1000;
+
+    // Drop what was queued at the previous position
+    mapMutex.lock();
+    mutex.lock();
+    slices.clear();
+    queuedBytes = 0;
+    mutex.unlock();
+    mapMutex.unlock();
+
+    QByteArray keyframe;
+    if (mappedLog.seek(replayTime, &keyframe)) {
+        queueSlice(keyframe);
+        emit readyRead();
+    }
 
     lastPlayTimeOffset = myTime.elapsed();
-    lastPlayTime=lastTimeStamp;
+    lastPlayTime = replayTime - firstTimestamp;
 
-    qDebug() << "Replaying at: " << lastTimeStamp << ", but requestion at" << val*1000;
+    qDebug() << "Replaying at: " << mappedLog.getNextTimestamp() << ", but requestion at" << val*1000;
 }
-
@@ -32,14 +32,21 @@
 #include <QTime>
 #include <QTimer>
 #include <QMutexLocker>
+#include <QElapsedTimer>
+#include <QQueue>
 #include <QDebug>
 #include <QBuffer>
+#include <QTemporaryFile>
 #include "uavobjectmanager.h"
+#include "uavtalk/uavtalk.h"
+#include "logindex.h"
+#include "mappedlog.h"
 #include <math.h>
 
-class LogFile : public QIODevice
+class LogFile : public QIODevice, public UAVTalkDirectSource
 {
     Q_OBJECT
+    Q_INTERFACES(UAVTalkDirectSource)
 public:
     explicit LogFile(QObject *parent = 0);
     qint64 bytesAvailable() const;
@@ -50,29 +57,37 @@ public:
     qint64 writeData(const char * data, qint64 dataSize);
     qint64 readData(char * data, qint64 maxlen);
 
+    qint64 parseBlocks(UAVTalk *parser);
+
     bool startReplay();
     bool stopReplay();
+    double getReplayRate() const;
+
+    void beginKeyframe();
+    void endKeyframe();
 
 public slots:
     void setReplaySpeed(double val) { playbackSpeed = val; qDebug() << "New playback speed: " << playbackSpeed; }
     void setReplayTime(double val);
+    void setReplayAsFastAsPossible(bool val);
     void pauseReplay();
     void resumeReplay();
 
 protected slots:
     void timerFired();
 
+private slots:
+    void queueBatch();
+
 signals:
     void readReady();
     void replayStarted();
     void replayFinished();
 
 protected:
-    QByteArray dataBuffer;
     QTimer timer;
     QTime myTime;
     QFile file;
-    quint32 lastTimeStamp;
     quint32 lastPlayTime;
     QMutex mutex;
 
@@ -81,11 +96,41 @@ protected:
     double playbackSpeed;
 
 private:
-    QList<quint32> timestampBuffer;
-    QList<quint32> timestampPos;
-    quint32 timestampBufferIdx;
-    quint32 lastTimeStampPos;
+    //! Payload of a record queued for the parser, wrapping the mapped log
+    typedef struct {
+        QByteArray bytes;
+        qint64 offset;          //!< Bytes already read
+    } Slice;
+
+    typedef enum {RECORD_QUEUED, RECORD_SKIPPED, RECORD_CORRUPTED} RecordStatus;
+
+    //! Bytes queued at once when replaying as fast as possible
+    static const qint64 FAST_REPLAY_BATCH = 256 * 1024;
+
+    RecordStatus queueRecord();
+    void queueSlice(const QByteArray &payload);
+    void consumed(qint64 length);
+    void writeIndex();
+    void decodeCompact();
+
+    LogIndex index;
     quint32 firstTimestamp;
+    bool writingKeyframe;
+    QByteArray keyframeBuffer;
+
+    MappedLog mappedLog;
+    //! Packets of a compact onboard log, replayed in place of the file
+    QTemporaryFile *decodedFile;
+    //! Held while the parser reads a slice, so that the log is not unmapped under it
+    QMutex mapMutex;
+    QQueue<Slice> slices;
+    qint64 queuedBytes;
+    bool fastReplay;
+    bool paused;
+
+    QElapsedTimer replayClock;
+    qint64 replayedBytes;
+    double replayRate;
 };
 
 #endif // LOGFILE_H
@@ -42,6 +42,7 @@
 #include <QList>
 #include <QErrorMessage>
 #include <QWriteLocker>
+#include <QTimer>
 
 #include <extensionsystem/pluginmanager.h>
 #include <QKeySequence>
@@ -198,10 +199,36 @@ void LoggingThread::run()
         qDebug() << "Logging: not connected, do no ask for settings";
     }
 
+    // Store the state of all objects periodically, so that replay can seek
+    // without playing the log from the start
+    QTimer keyframeTimer;
+    connect(&keyframeTimer, SIGNAL(timeout()), this, SLOT(writeKeyframe()), Qt::DirectConnection);
+    keyframeTimer.start(KEYFRAME_PERIOD_MS);
+    writeKeyframe();
 
     exec();
 }
 
+/**
+  * Logs the current state of every object instance as a keyframe
+  */
+void LoggingThread::writeKeyframe()
+{
+    QWriteLocker locker(&lock);
+    if (!logFile.isOpen())
+        return;
+
+    ExtensionSystem::PluginManager *pm = ExtensionSystem::PluginManager::instance();
+    UAVObjectManager *objManager = pm->getObject<UAVObjectManager>();
+
+    logFile.beginKeyframe();
+    foreach (QVector<UAVDataObject*> instances, objManager->getDataObjectsVector()) {
+        foreach (UAVDataObject *obj, instances)
+            uavTalk->sendObject(obj, false, false);
+    }
+    logFile.endKeyframe();
+}
+
 
 /**
   * Pass this command to the correct thread then close the file
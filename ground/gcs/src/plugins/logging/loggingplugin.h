@@ -93,6 +93,7 @@ public:
 private slots:
     void objectUpdated(UAVObject * obj);
     void transactionCompleted(UAVObject* obj, bool success);
+    void writeKeyframe();
 
 public slots:
     void stopLogging();
@@ -104,6 +105,9 @@ protected:
     UAVTalk * uavTalk;
 
 private:
+    //! Period of the snapshots of all objects used to seek during replay
+    static const int KEYFRAME_PERIOD_MS = 10000;
+
     QQueue<UAVDataObject*> queue;
 
     void retrieveSettings();
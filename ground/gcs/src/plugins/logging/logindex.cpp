@@ -0,0 +1,326 @@
+/**
+ ******************************************************************************
+ *
+ * @file       logindex.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @brief      Block and keyframe index of a telemetry log
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "logindex.h"
+#include <QDataStream>
+#include <QDebug>
+#include <string.h>
+
+static const char INDEX_MAGIC[8] = { 'T', 'L', 'L', 'I', 'N', 'D', 'E', 'X' };
+static const quint32 INDEX_VERSION = 3;
+
+const char LogIndex::KEYFRAME_MARKER[LogIndex::MARKER_SIZE] = { 'T', 'L', 'L', 'K', 'E', 'Y', 'F', 'R' };
+const char LogIndex::INDEX_MARKER[LogIndex::MARKER_SIZE] = { 'T', 'L', 'L', 'I', 'N', 'D', 'E', 'X' };
+
+LogIndex::LogIndex()
+{
+    clear();
+}
+
+void LogIndex::clear()
+{
+    blocks.clear();
+    keyframes.clear();
+    recordCount = 0;
+    firstTimestamp = 0;
+    lastTimestamp = 0;
+    sequential = true;
+    dataStart = 0;
+    dataEnd = 0;
+}
+
+/**
+ * Add a record to the index. Records must be added in the order they appear
+ * in the log.
+ */
+void LogIndex::addRecord(quint32 timestamp, qint64 offset)
+{
+    if (recordCount % RECORDS_PER_BLOCK == 0) {
+        Entry block = { timestamp, offset };
+        blocks.append(block);
+    }
+
+    if (recordCount == 0) {
+        firstTimestamp = timestamp;
+        dataStart = offset;
+    } else if (timestamp < lastTimestamp) {
+        sequential = false;
+    }
+    lastTimestamp = timestamp;
+    recordCount++;
+}
+
+/**
+ * Mark a record, which must also be added with addRecord(), as a keyframe
+ */
+void LogIndex::addKeyframe(quint32 timestamp, qint64 offset)
+{
+    Entry keyframe = { timestamp, offset };
+    keyframes.append(keyframe);
+}
+
+/**
+ * Serialize the index as the payload of the record written at indexOffset.
+ * The payload starts with the index marker and ends with the footer used by
+ * load() to find the index.
+ */
+QByteArray LogIndex::serialize(qint64 indexOffset) const
+{
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setByteOrder(QDataStream::LittleEndian);
+
+    out.writeRawData(INDEX_MARKER, MARKER_SIZE);
+    out << INDEX_VERSION << RECORDS_PER_BLOCK << recordCount << firstTimestamp << lastTimestamp;
+    out << (quint32) blocks.size();
+    foreach (const Entry &block, blocks)
+        out << block.timestamp << block.offset;
+    out << (quint32) keyframes.size();
+    foreach (const Entry &keyframe, keyframes)
+        out << keyframe.timestamp << keyframe.offset;
+
+    out << indexOffset;
+    out.writeRawData(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    return payload;
+}
+
+/**
+ * Load the index written at the end of the log
+ * @param dataStart Position of the first record, after the text header
+ * @return false if the log has no valid index
+ */
+bool LogIndex::load(QIODevice *file, qint64 dataStart)
+{
+    clear();
+
+    qint64 fileSize = file->size();
+    if (fileSize < dataStart + RECORD_HEADER_SIZE + FOOTER_SIZE)
+        return false;
+
+    // Find the index record from the footer
+    char magic[sizeof(INDEX_MAGIC)];
+    qint64 indexOffset;
+    if (!file->seek(fileSize - FOOTER_SIZE))
+        return false;
+    QDataStream footer(file);
+    footer.setByteOrder(QDataStream::LittleEndian);
+    footer >> indexOffset;
+    if (footer.readRawData(magic, sizeof(magic)) != sizeof(magic) || memcmp(magic, INDEX_MAGIC, sizeof(magic)) != 0)
+        return false;
+    if (indexOffset < dataStart || indexOffset > fileSize - RECORD_HEADER_SIZE - FOOTER_SIZE)
+        return false;
+
+    quint32 indexTimestamp;
+    qint64 indexSize;
+    if (!readHeader(file, indexOffset, &indexTimestamp, &indexSize) ||
+            indexOffset + RECORD_HEADER_SIZE + indexSize != fileSize)
+        return false;
+
+    QByteArray payload = file->read(indexSize);
+    if (getRecordType(payload.constData(), payload.size()) != RECORD_INDEX)
+        return false;
+    QDataStream in(payload);
+    in.setByteOrder(QDataStream::LittleEndian);
+    in.skipRawData(MARKER_SIZE);
+
+    quint32 version, recordsPerBlock, numBlocks, numKeyframes;
+    in >> version >> recordsPerBlock;
+    if (version != INDEX_VERSION || recordsPerBlock != RECORDS_PER_BLOCK) {
+        qDebug() << "Unsupported log index version" << version;
+        return false;
+    }
+    in >> recordCount >> firstTimestamp >> lastTimestamp;
+
+    in >> numBlocks;
+    if (in.status() != QDataStream::Ok || numBlocks > (quint32) (indexSize / 12))
+        return false;
+    blocks.resize(numBlocks);
+    for (quint32 i = 0; i < numBlocks; i++)
+        in >> blocks[i].timestamp >> blocks[i].offset;
+
+    in >> numKeyframes;
+    if (in.status() != QDataStream::Ok || numKeyframes > (quint32) (indexSize / 12))
+        return false;
+    keyframes.resize(numKeyframes);
+    for (quint32 i = 0; i < numKeyframes; i++) {
+        in >> keyframes[i].timestamp >> keyframes[i].offset;
+        if (i > 0 && keyframes[i].timestamp < keyframes[i - 1].timestamp)
+            sequential = false;
+    }
+
+    if (in.status() != QDataStream::Ok) {
+        clear();
+        return false;
+    }
+
+    for (quint32 i = 1; i < numBlocks; i++) {
+        if (blocks[i].timestamp < blocks[i - 1].timestamp)
+            sequential = false;
+    }
+
+    this->dataStart = dataStart;
+    dataEnd = indexOffset;
+    return true;
+}
+
+/**
+ * Build the index of a log which does not have one by reading the header and
+ * the marker of every record. A damaged index record is skipped.
+ */
+void LogIndex::scan(QIODevice *file, qint64 dataStart)
+{
+    clear();
+    dataEnd = file->size();
+
+    qint64 offset = dataStart;
+    quint32 timestamp;
+    qint64 size;
+    char marker[MARKER_SIZE];
+    while ((offset = nextRecord(file, offset, &timestamp, &size)) < dataEnd) {
+        // nextRecord() leaves the file at the payload
+        qint64 markerSize = file->read(marker, qMin(size, (qint64) MARKER_SIZE));
+        RecordType type = getRecordType(marker, markerSize);
+        if (type != RECORD_INDEX)
+            addRecord(timestamp, offset);
+        if (type == RECORD_KEYFRAME)
+            addKeyframe(timestamp, offset);
+        offset += RECORD_HEADER_SIZE + size;
+    }
+
+    this->dataStart = dataStart;
+}
+
+/**
+ * Tell keyframes and the index apart from the records of telemetry from the
+ * marker at the start of their payload
+ */
+LogIndex::RecordType LogIndex::getRecordType(const char *payload, qint64 size)
+{
+    if (size < MARKER_SIZE)
+        return RECORD_DATA;
+    if (memcmp(payload, KEYFRAME_MARKER, MARKER_SIZE) == 0)
+        return RECORD_KEYFRAME;
+    if (memcmp(payload, INDEX_MARKER, MARKER_SIZE) == 0)
+        return RECORD_INDEX;
+    return RECORD_DATA;
+}
+
+/**
+ * Read the header of the record at offset and leave the file at its payload
+ * @return false if the header could not be read
+ */
+bool LogIndex::readHeader(QIODevice *file, qint64 offset, quint32 *timestamp, qint64 *size)
+{
+    if (!file->seek(offset))
+        return false;
+    if (file->read((char *) timestamp, sizeof(*timestamp)) != sizeof(*timestamp))
+        return false;
+    if (file->read((char *) size, sizeof(*size)) != sizeof(*size))
+        return false;
+    return true;
+}
+
+/**
+ * Find the first valid record at or after offset. The high bytes of the size
+ * are used as sync bytes to skip over corrupted data, like the replay always
+ * did.
+ * @return The offset of the record, or the end of the data if there is none
+ */
+qint64 LogIndex::nextRecord(QIODevice *file, qint64 offset, quint32 *timestamp, qint64 *size) const
+{
+    while (offset + RECORD_HEADER_SIZE <= dataEnd) {
+        if (!readHeader(file, offset, timestamp, size))
+            break;
+
+        if ((*size & 0xFFFFFFFFFFFF0000) != 0) {
+            qDebug() << "Wrong sync byte. At file location 0x" << QString("%1").arg(offset + RECORD_HEADER_SIZE, 0, 16)
+                     << "Got 0x" << QString("%1").arg(*size & 0xFFFFFFFFFFFF0000, 0, 16) << ", but expected 0x""00"".";
+            offset++;
+            continue;
+        }
+
+        if (offset + RECORD_HEADER_SIZE + *size > dataEnd)
+            break;
+
+        return offset;
+    }
+    return dataEnd;
+}
+
+/**
+ * Index of the last entry at or before timestamp, -1 if there is none
+ */
+int LogIndex::findEntry(const QVector<Entry> &entries, quint32 timestamp)
+{
+    int low = 0;
+    int high = entries.size();
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (entries[mid].timestamp <= timestamp)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low - 1;
+}
+
+/**
+ * Find the last keyframe at or before timestamp
+ * @return Index of the keyframe in getKeyframes(), -1 if there is none
+ */
+int LogIndex::findKeyframe(quint32 timestamp) const
+{
+    return findEntry(keyframes, timestamp);
+}
+
+/**
+ * Find the first record at or after timestamp: a binary search of the blocks
+ * then a scan of at most one block.
+ * @param[out] recordTimestamp Timestamp of the record
+ * @return The offset of the record or getDataEnd() if there is none
+ */
+qint64 LogIndex::findRecord(QIODevice *file, quint32 timestamp, quint32 *recordTimestamp) const
+{
+    if (blocks.isEmpty())
+        return dataEnd;
+
+    int block = findEntry(blocks, timestamp);
+    // Records with the same timestamp may straddle blocks, start from the
+    // last block whose first record is before the timestamp
+    while (block > 0 && blocks[block].timestamp == timestamp)
+        block--;
+    if (block < 0)
+        block = 0;
+
+    qint64 offset = blocks[block].offset;
+    qint64 size;
+    while ((offset = nextRecord(file, offset, recordTimestamp, &size)) < dataEnd) {
+        if (*recordTimestamp >= timestamp)
+            return offset;
+        offset += RECORD_HEADER_SIZE + size;
+    }
+    return dataEnd;
+}
@@ -0,0 +1,109 @@
+/**
+ ******************************************************************************
+ *
+ * @file       logindex.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @brief      Block and keyframe index of a telemetry log
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef LOGINDEX_H
+#define LOGINDEX_H
+
+#include <QIODevice>
+#include <QByteArray>
+#include <QVector>
+
+/**
+ * @brief Index of the records of a log file.
+ *
+ * The body of a log is a sequence of records made of a 32 bit timestamp in
+ * ms, a 64 bit payload size and the payload, which is a run of UAVTalk
+ * packets. Some of the records are keyframes, whose payload holds the state
+ * of all the objects at that time.
+ *
+ * The index holds the position of the first record of every block of
+ * RECORDS_PER_BLOCK records and the position of every keyframe. It is
+ * written as the last record of the log, which ends with a footer pointing
+ * back to it. Logs without an index, such as a log cut short by a crash, are
+ * scanned once instead.
+ *
+ * The payloads of keyframes and of the index start with a marker of
+ * MARKER_SIZE bytes beginning with "TLL", which cannot be the sync byte of a
+ * UAVTalk packet. Every log reader skips these records when it plays the
+ * telemetry, and the scan finds the keyframes from their marker.
+ */
+class LogIndex
+{
+public:
+    typedef struct {
+        quint32 timestamp;
+        qint64 offset;
+    } Entry;
+
+    static const quint32 RECORDS_PER_BLOCK = 256;
+    static const qint64 RECORD_HEADER_SIZE = sizeof(quint32) + sizeof(qint64);
+    static const qint64 FOOTER_SIZE = sizeof(qint64) + 8;
+    static const int MARKER_SIZE = 8;
+    static const char KEYFRAME_MARKER[MARKER_SIZE];
+    static const char INDEX_MARKER[MARKER_SIZE];
+
+    typedef enum {RECORD_DATA, RECORD_KEYFRAME, RECORD_INDEX} RecordType;
+
+    LogIndex();
+
+    void clear();
+    void addRecord(quint32 timestamp, qint64 offset);
+    void addKeyframe(quint32 timestamp, qint64 offset);
+
+    QByteArray serialize(qint64 indexOffset) const;
+    bool load(QIODevice *file, qint64 dataStart);
+    void scan(QIODevice *file, qint64 dataStart);
+
+    quint32 getRecordCount() const { return recordCount; }
+    quint32 getFirstTimestamp() const { return firstTimestamp; }
+    quint32 getLastTimestamp() const { return lastTimestamp; }
+    bool isSequential() const { return sequential; }
+    qint64 getDataStart() const { return dataStart; }
+    qint64 getDataEnd() const { return dataEnd; }
+    const QVector<Entry> &getBlocks() const { return blocks; }
+    const QVector<Entry> &getKeyframes() const { return keyframes; }
+
+    int findKeyframe(quint32 timestamp) const;
+    qint64 findRecord(QIODevice *file, quint32 timestamp, quint32 *recordTimestamp) const;
+
+    static RecordType getRecordType(const char *payload, qint64 size);
+    static bool readHeader(QIODevice *file, qint64 offset, quint32 *timestamp, qint64 *size);
+    qint64 nextRecord(QIODevice *file, qint64 offset, quint32 *timestamp, qint64 *size) const;
+
+private:
+    static int findEntry(const QVector<Entry> &entries, quint32 timestamp);
+
+    QVector<Entry> blocks;
+    QVector<Entry> keyframes;
+    quint32 recordCount;
+    quint32 firstTimestamp;
+    quint32 lastTimestamp;
+    bool sequential;
+    qint64 dataStart;
+    qint64 dataEnd;
+};
+
+#endif // LOGINDEX_H
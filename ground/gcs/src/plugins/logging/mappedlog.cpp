@@ -0,0 +1,211 @@
+/**
+ ******************************************************************************
+ *
+ * @file       mappedlog.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @brief      Memory mapped reader of telemetry logs
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "mappedlog.h"
+#include <QDebug>
+#include <string.h>
+
+MappedLog::MappedLog() :
+    file(NULL),
+    data(NULL),
+    position(0),
+    nextTimestamp(0),
+    nextSize(0)
+{
+}
+
+MappedLog::~MappedLog()
+{
+    close();
+}
+
+/**
+ * Map the log and load its index, or build it if the log has none
+ * @param file The log, open for reading
+ * @param dataStart Position of the first record, after the text header
+ * @return false if the file is empty
+ */
+bool MappedLog::open(QFile *file, qint64 dataStart)
+{
+    close();
+
+    if (file->size() == 0)
+        return false;
+    data = file->map(0, file->size());
+    if (data == NULL)
+        qDebug() << "Unable to map" << file->fileName() << ":" << file->errorString() << ", reading the file instead";
+    this->file = file;
+
+    if (!index.load(file, dataStart)) {
+        qDebug() << "No index found in" << file->fileName() << ", scanning the log";
+        index.scan(file, dataStart);
+    }
+    rewind();
+    return true;
+}
+
+void MappedLog::close()
+{
+    if (data != NULL)
+        file->unmap(data);
+    data = NULL;
+    file = NULL;
+    index.clear();
+    position = 0;
+}
+
+/**
+ * Go back to the first record
+ */
+void MappedLog::rewind()
+{
+    if (index.getBlocks().isEmpty())
+        position = index.getDataEnd();
+    else
+        findNext(index.getBlocks().first().offset);
+}
+
+/**
+ * Locate the first valid record at or after offset, skipping index records.
+ * Headers are read from the mapping when there is one, the index is only
+ * used to resync after corrupted data.
+ */
+void MappedLog::findNext(qint64 offset)
+{
+    const qint64 end = index.getDataEnd();
+    forever {
+        bool found = false;
+        if (offset + LogIndex::RECORD_HEADER_SIZE <= end) {
+            if (data != NULL) {
+                memcpy(&nextTimestamp, data + offset, sizeof(nextTimestamp));
+                memcpy(&nextSize, data + offset + sizeof(nextTimestamp), sizeof(nextSize));
+                found = true;
+            } else {
+                found = LogIndex::readHeader(file, offset, &nextTimestamp, &nextSize);
+            }
+            found &= (nextSize & 0xFFFFFFFFFFFF0000) == 0 && offset + LogIndex::RECORD_HEADER_SIZE + nextSize <= end;
+        }
+        position = found ? offset : index.nextRecord(file, offset, &nextTimestamp, &nextSize);
+
+        if (position >= end || readType(position, nextSize) != LogIndex::RECORD_INDEX)
+            return;
+        offset = position + LogIndex::RECORD_HEADER_SIZE + nextSize;
+    }
+}
+
+/**
+ * Read the marker of a record
+ */
+LogIndex::RecordType MappedLog::readType(qint64 offset, qint64 size)
+{
+    offset += LogIndex::RECORD_HEADER_SIZE;
+    if (data != NULL)
+        return LogIndex::getRecordType((const char *) data + offset, size);
+
+    char marker[LogIndex::MARKER_SIZE];
+    if (!file->seek(offset))
+        return LogIndex::RECORD_DATA;
+    return LogIndex::getRecordType(marker, file->read(marker, qMin(size, (qint64) LogIndex::MARKER_SIZE)));
+}
+
+/**
+ * Get the payload of a record, from the mapping or from the file
+ * @return false if the file cannot be read
+ */
+bool MappedLog::readPayload(qint64 offset, qint64 size, QByteArray *payload)
+{
+    offset += LogIndex::RECORD_HEADER_SIZE;
+    if (data != NULL) {
+        *payload = QByteArray::fromRawData((const char *) data + offset, size);
+        return true;
+    }
+
+    *payload = QByteArray();
+    if (!file->seek(offset))
+        return false;
+    *payload = file->read(size);
+    return payload->size() == size;
+}
+
+/**
+ * Get the next record and advance
+ * @param[out] payload Payload of the record, valid until close()
+ * @param[out] isKeyframe Set if the record is a keyframe
+ * @return false at the end of the log, or if the file cannot be read in
+ * which case the log does not advance
+ */
+bool MappedLog::next(QByteArray *payload, bool *isKeyframe)
+{
+    if (atEnd())
+        return false;
+
+    if (!readPayload(position, nextSize, payload)) {
+        qDebug() << "Unable to read" << file->fileName() << ":" << file->errorString();
+        return false;
+    }
+
+    *isKeyframe = LogIndex::getRecordType(payload->constData(), payload->size()) == LogIndex::RECORD_KEYFRAME;
+    if (*isKeyframe)
+        *payload = payload->mid(LogIndex::MARKER_SIZE);
+
+    findNext(position + LogIndex::RECORD_HEADER_SIZE + nextSize);
+    return true;
+}
+
+/**
+ * Move to the first record at or after timestamp
+ * @param[out] keyframe Payload of the last keyframe before timestamp, which
+ * holds the state of all the objects at that point
+ * @return false if there is no keyframe before timestamp
+ */
+bool MappedLog::seek(quint32 timestamp, QByteArray *keyframe)
+{
+    if (!isOpen())
+        return false;
+
+    quint32 recordTimestamp;
+    qint64 offset = index.findRecord(file, timestamp, &recordTimestamp);
+    if (offset < index.getDataEnd())
+        findNext(offset);
+    else
+        position = offset;
+
+    int k = index.findKeyframe(timestamp);
+    if (k < 0)
+        return false;
+
+    quint32 keyframeTimestamp;
+    qint64 keyframeSize;
+    qint64 keyframeOffset = index.getKeyframes()[k].offset;
+    if (!LogIndex::readHeader(file, keyframeOffset, &keyframeTimestamp, &keyframeSize) ||
+            keyframeOffset + LogIndex::RECORD_HEADER_SIZE + keyframeSize > index.getDataEnd())
+        return false;
+    if (!readPayload(keyframeOffset, keyframeSize, keyframe) ||
+            LogIndex::getRecordType(keyframe->constData(), keyframe->size()) != LogIndex::RECORD_KEYFRAME)
+        return false;
+    *keyframe = keyframe->mid(LogIndex::MARKER_SIZE);
+    return true;
+}
@@ -0,0 +1,76 @@
+/**
+ ******************************************************************************
+ *
+ * @file       mappedlog.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @brief      Memory mapped reader of telemetry logs
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef MAPPEDLOG_H
+#define MAPPEDLOG_H
+
+#include <QFile>
+#include "logindex.h"
+
+/**
+ * @brief Reads the records of a log from a memory mapping of the file.
+ *
+ * The payloads are returned as byte arrays wrapping the mapping, which stay
+ * valid until close(), so they can be handed to the UAVTalk parser without
+ * being copied. When the file cannot be mapped, for example a large log in
+ * a 32 bit address space, the records are read from the file instead and
+ * each payload is a copy. Index records are skipped and keyframes are
+ * returned without their marker.
+ */
+class MappedLog
+{
+public:
+    MappedLog();
+    ~MappedLog();
+
+    bool open(QFile *file, qint64 dataStart);
+    void close();
+    bool isOpen() const { return file != NULL; }
+    bool isMapped() const { return data != NULL; }
+    const LogIndex &getIndex() const { return index; }
+
+    bool atEnd() const { return position >= index.getDataEnd(); }
+    quint32 getNextTimestamp() const { return nextTimestamp; }
+    bool next(QByteArray *payload, bool *isKeyframe);
+    bool seek(quint32 timestamp, QByteArray *keyframe);
+    void rewind();
+
+private:
+    void findNext(qint64 offset);
+    bool readPayload(qint64 offset, qint64 size, QByteArray *payload);
+    LogIndex::RecordType readType(qint64 offset, qint64 size);
+
+    QFile *file;
+    uchar *data;
+    LogIndex index;
+
+    //! Offset, timestamp and size of the next record
+    qint64 position;
+    quint32 nextTimestamp;
+    qint64 nextSize;
+};
+
+#endif // MAPPEDLOG_H
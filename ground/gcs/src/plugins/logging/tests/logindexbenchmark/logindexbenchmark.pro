@@ -0,0 +1,18 @@
+# Open and seek times of an indexed log and of the same log scanned as done
+# for logs written without an index. The size of the generated log, 1 GB by
+# default, can be set in MB with the LOGINDEX_BENCH_MB environment variable.
+
+QT += testlib
+QT -= gui
+TARGET = logindexbenchmark
+CONFIG += console testcase
+CONFIG -= app_bundle
+TEMPLATE = app
+
+include(../../../../../gcs.pri)
+
+INCLUDEPATH *= ../..
+
+HEADERS += ../../logindex.h
+SOURCES += tst_logindexbenchmark.cpp \
+    ../../logindex.cpp
@@ -0,0 +1,270 @@
+/**
+ ******************************************************************************
+ * @file       tst_logindexbenchmark.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup Logging
+ * @{
+ * @brief Generates a large log in the indexed format and compares opening it
+ * from its index and by scanning every record, as done for logs without an
+ * index, then measures seeking with the index
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <QtTest/QtTest>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QFile>
+
+#include "logindex.h"
+
+class tst_LogIndexBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void indexMatchesScan();
+    void seekFindsRecords();
+    void openScanned();
+    void openIndexed();
+    void seekIndexed();
+
+private:
+    void writeRecord(QFile &file, quint32 timestamp, const char *data, qint64 size);
+
+    QTemporaryDir dir;
+    QString path;
+    qint64 dataStart;
+    quint32 duration;
+    quint32 numRecords;
+    quint32 numKeyframes;
+};
+
+//! Time between keyframes, as written by the logging thread
+static const quint32 KEYFRAME_PERIOD_MS = 10000;
+static const int KEYFRAME_SIZE = 16 * 1024;
+static const int SEEKS = 1000;
+
+void tst_LogIndexBenchmark::writeRecord(QFile &file, quint32 timestamp, const char *data, qint64 size)
+{
+    file.write((char *) &timestamp, sizeof(timestamp));
+    file.write((char *) &size, sizeof(size));
+    file.write(data, size);
+}
+
+/**
+ * Write a log of telemetry sized records, about one per ms, with a keyframe
+ * every KEYFRAME_PERIOD_MS, then its index
+ */
+void tst_LogIndexBenchmark::initTestCase()
+{
+    QVERIFY(dir.isValid());
+    path = dir.path() + "/benchmark.tll";
+
+    qint64 targetSize = qgetenv("LOGINDEX_BENCH_MB").toLongLong();
+    if (targetSize <= 0)
+        targetSize = 1024;
+    targetSize *= 1024 * 1024;
+
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("Tau Labs git hash:\nbenchmark\n0000\n##\n");
+    dataStart = file.pos();
+
+    QByteArray payload(KEYFRAME_SIZE, 0);
+    qsrand(1);
+    for (int i = 0; i < payload.size(); i++)
+        payload[i] = (char) qrand();
+    QByteArray keyframe = QByteArray(LogIndex::KEYFRAME_MARKER, LogIndex::MARKER_SIZE) + payload;
+
+    LogIndex index;
+    quint32 timestamp = 0;
+    quint32 nextKeyframe = 0;
+    numKeyframes = 0;
+    QElapsedTimer timer;
+    timer.start();
+    while (file.pos() < targetSize) {
+        if (timestamp >= nextKeyframe) {
+            index.addKeyframe(timestamp, file.pos());
+            index.addRecord(timestamp, file.pos());
+            writeRecord(file, timestamp, keyframe.constData(), keyframe.size());
+            nextKeyframe += KEYFRAME_PERIOD_MS;
+            numKeyframes++;
+        }
+
+        qint64 size = 16 + qrand() % 240;
+        index.addRecord(timestamp, file.pos());
+        writeRecord(file, timestamp, payload.constData() + qrand() % (KEYFRAME_SIZE - size), size);
+        timestamp += qrand() % 3;
+    }
+    duration = timestamp;
+    numRecords = index.getRecordCount();
+
+    QByteArray indexPayload = index.serialize(file.pos());
+    writeRecord(file, index.getLastTimestamp(), indexPayload.constData(), indexPayload.size());
+    qDebug("Wrote %u records, %u keyframes, %.1f s of log, %.0f MB in %.1f s",
+           numRecords, numKeyframes, duration / 1000.0, file.size() / 1048576.0, timer.elapsed() / 1000.0);
+    file.close();
+}
+
+void tst_LogIndexBenchmark::indexMatchesScan()
+{
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+
+    LogIndex indexed;
+    QVERIFY(indexed.load(&file, dataStart));
+    LogIndex scanned;
+    scanned.scan(&file, dataStart);
+
+    QCOMPARE(indexed.getRecordCount(), numRecords);
+    QCOMPARE(indexed.getKeyframes().size(), (int) numKeyframes);
+    QVERIFY(indexed.isSequential());
+
+    // The scan skips the index record and finds the keyframes from their
+    // marker, as for a log whose index was never written
+    QCOMPARE(scanned.getRecordCount(), numRecords);
+    QCOMPARE(indexed.getFirstTimestamp(), scanned.getFirstTimestamp());
+    QCOMPARE(scanned.getKeyframes().size(), indexed.getKeyframes().size());
+    for (int i = 0; i < indexed.getKeyframes().size(); i++)
+        QCOMPARE(indexed.getKeyframes()[i].offset, scanned.getKeyframes()[i].offset);
+    for (int i = 0; i < indexed.getBlocks().size(); i++) {
+        QCOMPARE(indexed.getBlocks()[i].offset, scanned.getBlocks()[i].offset);
+        QCOMPARE(indexed.getBlocks()[i].timestamp, scanned.getBlocks()[i].timestamp);
+    }
+
+    // A log without the index is not mistaken for an indexed one
+    QFile truncated(dir.path() + "/truncated.tll");
+    QVERIFY(truncated.open(QIODevice::WriteOnly));
+    file.seek(0);
+    truncated.write(file.read(1024 * 1024));
+    truncated.close();
+    QVERIFY(truncated.open(QIODevice::ReadOnly));
+    QVERIFY(!indexed.load(&truncated, dataStart));
+}
+
+void tst_LogIndexBenchmark::seekFindsRecords()
+{
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    LogIndex index;
+    QVERIFY(index.load(&file, dataStart));
+
+    qsrand(2);
+    for (int i = 0; i < SEEKS; i++) {
+        quint32 target = qrand() % duration;
+
+        int keyframe = index.findKeyframe(target);
+        QVERIFY(keyframe >= 0);
+        QVERIFY(index.getKeyframes()[keyframe].timestamp <= target);
+        if (keyframe + 1 < index.getKeyframes().size())
+            QVERIFY(index.getKeyframes()[keyframe + 1].timestamp > target);
+
+        quint32 timestamp;
+        qint64 offset = index.findRecord(&file, target, &timestamp);
+        QVERIFY(offset < index.getDataEnd());
+        QVERIFY(timestamp >= target);
+
+        // The record is the first one at or after the target
+        int block = 0;
+        while (block + 1 < index.getBlocks().size() && index.getBlocks()[block + 1].offset <= offset)
+            block++;
+        qint64 previous = -1;
+        qint64 size;
+        quint32 previousTimestamp = 0;
+        for (qint64 pos = index.getBlocks()[qMax(block - 1, 0)].offset; pos < offset; pos += LogIndex::RECORD_HEADER_SIZE + size) {
+            QVERIFY(LogIndex::readHeader(&file, pos, &previousTimestamp, &size));
+            previous = pos;
+        }
+        if (previous >= 0)
+            QVERIFY(previousTimestamp < target);
+    }
+
+    quint32 timestamp;
+    QCOMPARE(index.findRecord(&file, duration + 1, &timestamp), index.getDataEnd());
+    QCOMPARE(index.findRecord(&file, 0, &timestamp), index.getBlocks().first().offset);
+}
+
+void tst_LogIndexBenchmark::openScanned()
+{
+    QElapsedTimer timer;
+    timer.start();
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    LogIndex index;
+    index.scan(&file, dataStart);
+    qDebug("Open by scanning %u records: %.1f ms", index.getRecordCount(), timer.nsecsElapsed() / 1e6);
+}
+
+void tst_LogIndexBenchmark::openIndexed()
+{
+    QElapsedTimer timer;
+    timer.start();
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    LogIndex index;
+    QVERIFY(index.load(&file, dataStart));
+    qDebug("Open from the index of %u records: %.3f ms", index.getRecordCount(), timer.nsecsElapsed() / 1e6);
+
+    QBENCHMARK {
+        index.load(&file, dataStart);
+    }
+}
+
+/**
+ * Seek as the replay does: find the last keyframe, read it and find the
+ * first record at the requested time
+ */
+void tst_LogIndexBenchmark::seekIndexed()
+{
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    LogIndex index;
+    QVERIFY(index.load(&file, dataStart));
+
+    qsrand(3);
+    QVector<quint32> targets(SEEKS);
+    for (int i = 0; i < SEEKS; i++)
+        targets[i] = qrand() % duration;
+
+    QElapsedTimer timer;
+    timer.start();
+    qint64 bytes = 0;
+    foreach (quint32 target, targets) {
+        const LogIndex::Entry &keyframe = index.getKeyframes()[index.findKeyframe(target)];
+        quint32 timestamp;
+        qint64 size;
+        QVERIFY(LogIndex::readHeader(&file, keyframe.offset, &timestamp, &size));
+        bytes += file.read(size).size();
+        index.findRecord(&file, target, &timestamp);
+    }
+    qint64 nsecs = timer.nsecsElapsed();
+    qDebug("%d seeks with keyframe read: %.1f us per seek, %lld keyframe bytes read",
+           SEEKS, nsecs / 1e3 / SEEKS, bytes);
+
+    int i = 0;
+    QBENCHMARK {
+        quint32 timestamp;
+        index.findRecord(&file, targets[i++ % SEEKS], &timestamp);
+    }
+}
+
+QTEST_MAIN(tst_LogIndexBenchmark)
+
+#include "tst_logindexbenchmark.moc"
@@ -0,0 +1,23 @@
+# Decode rate, in MB/s, of a log replayed through the buffers used before
+# memory mapped replay and from the mapping. The size of the generated log,
+# 256 MB by default, can be set in MB with the LOGREPLAY_BENCH_MB environment
+# variable.
+
+QT += testlib network
+QT -= gui
+TARGET = logreplaybenchmark
+CONFIG += console testcase
+CONFIG -= app_bundle
+TEMPLATE = app
+
+include(../../../../../gcs.pri)
+
+INCLUDEPATH *= $$GCS_SOURCE_TREE/src/plugins ../..
+LIBS += -L$$GCS_PLUGIN_PATH/TauLabs
+include(../../../uavtalk/uavtalk.pri)
+
+HEADERS += ../../logindex.h \
+    ../../mappedlog.h
+SOURCES += tst_logreplaybenchmark.cpp \
+    ../../logindex.cpp \
+    ../../mappedlog.cpp
@@ -0,0 +1,220 @@
+/**
+ ******************************************************************************
+ * @file       tst_logreplaybenchmark.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup Logging
+ * @{
+ * @brief Compares the decode rate of a log read record by record into the
+ * replay buffer, as LogFile did, and parsed in place from a memory mapping
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <QtTest/QtTest>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QBuffer>
+#include <QFile>
+
+#include <extensionsystem/pluginmanager.h>
+#include "uavtalk/uavtalk.h"
+#include "uavobjectmanager.h"
+#include "uavobjectsinit.h"
+#include "logindex.h"
+#include "mappedlog.h"
+
+class tst_LogReplayBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void bufferedReplay();
+    void mappedReplay();
+    void mappedMatchesBuffered();
+
+private:
+    void reportRate(const char *label, qint64 bytes, quint32 objects, qint64 nsecs);
+
+    ExtensionSystem::PluginManager *m_pm;
+    UAVObjectManager *m_objMngr;
+    QTemporaryDir m_dir;
+    QString m_path;
+    qint64 m_dataStart;
+    qint64 m_payloadBytes;
+    UAVTalk::ComStats m_bufferedStats;
+    UAVTalk::ComStats m_mappedStats;
+};
+
+//! Size of the reads done by the parser, as UAVTalk::processInputStream()
+static const qint64 PARSER_READ_SIZE = 4 * 1024;
+//! Records queued per replay timer tick
+static const int RECORDS_PER_TICK = 100;
+
+void tst_LogReplayBenchmark::initTestCase()
+{
+    m_pm = new ExtensionSystem::PluginManager();
+    m_objMngr = new UAVObjectManager();
+    UAVObjectsInitialize(m_objMngr);
+    QVERIFY(m_dir.isValid());
+
+    qint64 targetSize = qgetenv("LOGREPLAY_BENCH_MB").toLongLong();
+    if (targetSize <= 0)
+        targetSize = 256;
+    targetSize *= 1024 * 1024;
+
+    // One packet of every object instance, as logged one per record
+    QBuffer packets;
+    packets.open(QIODevice::WriteOnly);
+    UAVTalk talk(&packets, m_objMngr);
+    QVector<qint64> packetEnds;
+    foreach (QVector<UAVDataObject*> instances, m_objMngr->getDataObjectsVector()) {
+        foreach (UAVDataObject *obj, instances) {
+            talk.sendObject(obj, false, false);
+            packetEnds.append(packets.pos());
+        }
+    }
+    const QByteArray &stream = packets.data();
+
+    m_path = m_dir.path() + "/replay.tll";
+    QFile file(m_path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("Tau Labs git hash:\nbenchmark\n0000\n##\n");
+    m_dataStart = file.pos();
+
+    LogIndex index;
+    quint32 timestamp = 0;
+    m_payloadBytes = 0;
+    while (file.pos() < targetSize) {
+        qint64 start = 0;
+        foreach (qint64 end, packetEnds) {
+            qint64 size = end - start;
+            index.addRecord(timestamp, file.pos());
+            file.write((char *) &timestamp, sizeof(timestamp));
+            file.write((char *) &size, sizeof(size));
+            file.write(stream.constData() + start, size);
+            m_payloadBytes += size;
+            start = end;
+        }
+        timestamp += 10;
+    }
+    QByteArray indexPayload = index.serialize(file.pos());
+    qint64 indexSize = indexPayload.size();
+    file.write((char *) &timestamp, sizeof(timestamp));
+    file.write((char *) &indexSize, sizeof(indexSize));
+    file.write(indexPayload);
+    qDebug("Log of %u records, %.0f MB of packets", index.getRecordCount(), m_payloadBytes / 1048576.0);
+}
+
+void tst_LogReplayBenchmark::cleanupTestCase()
+{
+    delete m_objMngr;
+    delete m_pm;
+}
+
+void tst_LogReplayBenchmark::reportRate(const char *label, qint64 bytes, quint32 objects, qint64 nsecs)
+{
+    qDebug("%s: %.0f MB and %u objects in %.0f ms, %.1f MB/s", label, bytes / 1048576.0, objects,
+           nsecs / 1e6, bytes / 1048576.0 / (nsecs / 1e9));
+}
+
+/**
+ * Replay as LogFile did before mapping the log: each record is read from
+ * the file, appended to the replay buffer, then copied out to the parser
+ * and removed from the front of the buffer.
+ */
+void tst_LogReplayBenchmark::bufferedReplay()
+{
+    QFile file(m_path);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QBuffer idle;
+    UAVTalk talk(&idle, m_objMngr);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    LogIndex index;
+    QVERIFY(index.load(&file, m_dataStart));
+    QByteArray dataBuffer;
+    char parserBuffer[PARSER_READ_SIZE];
+    qint64 pos = m_dataStart;
+    qint64 bytes = 0;
+    while (pos < index.getDataEnd()) {
+        for (int i = 0; i < RECORDS_PER_TICK && pos < index.getDataEnd(); i++) {
+            quint32 timestamp;
+            qint64 dataSize;
+            QVERIFY(LogIndex::readHeader(&file, pos, &timestamp, &dataSize));
+            dataBuffer.append(file.read(dataSize));
+            pos += LogIndex::RECORD_HEADER_SIZE + dataSize;
+        }
+
+        while (dataBuffer.size() > 0) {
+            qint64 toRead = qMin(PARSER_READ_SIZE, (qint64) dataBuffer.size());
+            memcpy(parserBuffer, dataBuffer.data(), toRead);
+            dataBuffer.remove(0, toRead);
+            talk.processInputBlock((const quint8 *) parserBuffer, toRead);
+            bytes += toRead;
+        }
+    }
+
+    m_bufferedStats = talk.getStats();
+    reportRate("buffered", bytes, m_bufferedStats.rxObjects, timer.nsecsElapsed());
+    QCOMPARE(bytes, m_payloadBytes);
+}
+
+/**
+ * Replay as LogFile does now: the payloads are parsed in place
+ */
+void tst_LogReplayBenchmark::mappedReplay()
+{
+    QFile file(m_path);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QBuffer idle;
+    UAVTalk talk(&idle, m_objMngr);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    MappedLog log;
+    QVERIFY(log.open(&file, m_dataStart));
+    QVERIFY(log.isMapped());
+    QByteArray payload;
+    bool keyframe;
+    qint64 bytes = 0;
+    while (log.next(&payload, &keyframe)) {
+        talk.processInputBlock((const quint8 *) payload.constData(), payload.size());
+        bytes += payload.size();
+    }
+
+    m_mappedStats = talk.getStats();
+    reportRate("mapped", bytes, m_mappedStats.rxObjects, timer.nsecsElapsed());
+    QCOMPARE(bytes, m_payloadBytes);
+}
+
+void tst_LogReplayBenchmark::mappedMatchesBuffered()
+{
+    QCOMPARE(m_mappedStats.rxObjects, m_bufferedStats.rxObjects);
+    QCOMPARE(m_mappedStats.rxBytes, m_bufferedStats.rxBytes);
+    QCOMPARE(m_mappedStats.rxErrors, m_bufferedStats.rxErrors);
+    QVERIFY(m_mappedStats.rxObjects > 0);
+}
+
+QTEST_MAIN(tst_LogReplayBenchmark)
+
+#include "tst_logreplaybenchmark.moc"
@@ -51,7 +51,7 @@ Exporter::Exporter(const MocapSettings& params) :
 	name("")
 {
 	// move to thread
-	moveToThread(Core::ICore::instance()->threadManager()->getRealTimeThread());
+	moveToThread(Core::ICore::instance()->threadManager()->getIoThread("MotionCapture"));
         connect(this, SIGNAL(myStart()), this, SLOT(onStart()),Qt::QueuedConnection);
 	emit myStart();
 
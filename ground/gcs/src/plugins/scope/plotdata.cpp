@@ -41,7 +41,6 @@
  * @param p_uavFieldName The plotted UAVO field name
  */
 Plot2dData::Plot2dData(QString p_uavObject, QString p_uavFieldName):
-    yDataHistory(0),
     dataUpdated(false)
 {
     uavObjectName = p_uavObject;
@@ -61,17 +60,15 @@ Plot2dData::Plot2dData(QString p_uavObject, QString p_uavFieldName):
 
     xData = new QVector<double>();
     yData = new QVector<double>();
-    yDataHistory = new QVector<double>();
 
     scalePower = 0;
     meanSamples = 1;
-    meanSum = 0.0f;
-    correctionSum = 0.0f;
-    correctionCount = 0;
     yMinimum = 0;
     yMaximum = 120;
 
     m_xWindowSize = 0;
+    fieldHandleObject = NULL;
+    fieldHandleHasField = false;
 }
 
 
@@ -101,20 +98,17 @@ Plot3dData::Plot3dData(QString p_uavObject, QString p_uavFieldName):
     xData = new QVector<double>();
     yData = new QVector<double>();
     zData = new QVector<double>();
-    zDataHistory = new QVector<double>();
-    timeDataHistory = new QVector<double>();
 
     scalePower = 0;
     meanSamples = 1;
-    meanSum = 0.0f;
-    correctionSum = 0.0f;
-    correctionCount = 0;
     xMinimum = 0;
     xMaximum = 16;
     yMinimum = 0;
     yMaximum = 60;
     zMinimum = 0;
     zMaximum = 100;
+    fieldHandleObject = NULL;
+    fieldHandleHasField = false;
 }
 
 
@@ -124,8 +118,6 @@ Plot2dData::~Plot2dData()
         delete xData;
     if (yData != NULL)
         delete yData;
-    if (yDataHistory != NULL)
-        delete yDataHistory;
 }
 
 
@@ -137,31 +129,41 @@ Plot3dData::~Plot3dData()
         delete yData;
     if (zData != NULL)
         delete zData;
-    if (zDataHistory != NULL)
-        delete zDataHistory;
-    if (timeDataHistory != NULL)
-        delete timeDataHistory;
 }
 
 
 /**
- * @brief valueAsDouble Fetch the value from the UAVO and return it as a double
+ * @brief getFieldHandle Get the handle on the plotted field element of the UAVO. The
+ * field and subfield names are only resolved when the UAVO changes.
  * @param obj UAVO
- * @param field UAVO field
- * @param haveSubField TRUE if UAVO has subfield. FALSE if not.
- * @param uavSubFieldName UAVO subfield, if it exists
- * @return
+ * @return The handle, invalid if the UAVO does not have the field or subfield
  */
-double PlotData::valueAsDouble(UAVObject* obj, UAVObjectField* field, bool haveSubField, QString uavSubFieldName)
+const UAVObjectFieldHandle &PlotData::getFieldHandle(UAVObject* obj)
 {
-    Q_UNUSED(obj);
-    QVariant value;
+    if (obj != fieldHandleObject) {
+        fieldHandle = UAVObjectFieldHandle::resolve(obj, uavFieldName, haveSubField ? uavSubFieldName : QString());
+        fieldHandleObject = obj;
+        fieldHandleHasField = fieldHandle.isValid() || obj->getField(uavFieldName) != NULL;
+        if (!fieldHandle.isValid() && fieldHandleHasField)
+            qWarning() << "No subfield" << uavSubFieldName << "in" << obj->getName() << "." << uavFieldName << ", plotted as 0";
+    }
+    return fieldHandle;
+}
 
-    if(haveSubField){
-        int indexOfSubField = field->getElementNames().indexOf(QRegExp(uavSubFieldName, Qt::CaseSensitive, QRegExp::FixedString));
-        value = field->getValue(indexOfSubField);
-    }else
-        value = field->getValue();
 
-    return value.toDouble();
+/**
+ * @brief valueAsDouble Fetch the value of the plotted field element of the UAVO
+ * @param obj UAVO
+ * @param value Set to the value, or to 0 if the UAVO has the field but not the
+ * subfield so that the sample stays in step with the other curves
+ * @return false if the UAVO does not have the field
+ */
+bool PlotData::valueAsDouble(UAVObject* obj, double *value)
+{
+    const UAVObjectFieldHandle &handle = getFieldHandle(obj);
+    if (!fieldHandleHasField)
+        return false;
+
+    *value = handle.isValid() ? handle.getDouble() : 0;
+    return true;
 }
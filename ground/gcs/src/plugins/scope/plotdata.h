@@ -46,7 +46,8 @@ class PlotData : public QObject
 {
     Q_OBJECT
 public:
-    double valueAsDouble(UAVObject* obj, UAVObjectField* field, bool haveSubField, QString uavSubFieldName);
+    const UAVObjectFieldHandle &getFieldHandle(UAVObject* obj);
+    bool valueAsDouble(UAVObject* obj, double *value);
 
     //Setter functions
     void setXMinimum(double val){xMinimum=val;}
@@ -104,10 +105,10 @@ protected:
     int scalePower; //This is the power to which each value must be raised
     unsigned int meanSamples;
     QString mathFunction;
-    double meanSum;
 
-    double correctionSum;
-    int correctionCount;
+    UAVObjectFieldHandle fieldHandle; //Plotted element, resolved once per object
+    UAVObject* fieldHandleObject;
+    bool fieldHandleHasField; //The object has the field, even if not the subfield
 
 private:
 
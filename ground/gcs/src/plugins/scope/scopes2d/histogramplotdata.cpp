@@ -99,7 +99,8 @@ bool HistogramData::append(UAVObject* obj)
     if (uavObjectName == obj->getName()) {
 
         //Get the field of interest
-        UAVObjectField* field =  obj->getField(uavFieldName);
+        double value;
+        bool haveValue = valueAsDouble(obj, &value);
 
         //Bad place to do this
         double step = binWidth;
@@ -109,8 +110,8 @@ bool HistogramData::append(UAVObject* obj)
         if (numberOfBins > MAX_NUMBER_OF_INTERVALS)
             numberOfBins = MAX_NUMBER_OF_INTERVALS;
 
-        if (field) {
-            double currentValue = valueAsDouble(obj, field, haveSubField, uavSubFieldName) * pow(10, scalePower);
+        if (haveValue) {
+            double currentValue = value * pow(10, scalePower);
 
             // Extend interval, if necessary
             if(!histogramInterval->empty()){
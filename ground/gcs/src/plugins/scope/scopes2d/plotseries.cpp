@@ -0,0 +1,530 @@
+/**
+ ******************************************************************************
+ *
+ * @file       plotseries.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup ScopePlugin Scope Gadget Plugin
+ * @{
+ * @brief Ring buffers keeping the samples of the scope curves
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "scopes2d/plotseries.h"
+
+#include <limits.h>
+#include <math.h>
+
+//! Capacity of a growable series at its first point
+#define MINIMUM_CAPACITY 1024
+
+//! Each group of a level is made of 2^LEVEL_BITS groups of the level below
+#define LEVEL_BITS 2
+#define GROUP_BITS(level) (LEVEL_BITS * ((level) + 1))
+#define GROUP_SIZE(level) ((qint64) 1 << GROUP_BITS(level))
+
+//! Points per pixel under which the points are not decimated
+#define DECIMATION_THRESHOLD 4
+
+
+/**
+ * @brief PlotSeries::PlotSeries
+ * @param capacity Number of points kept before the buffer is full
+ * @param growable If set, the capacity is doubled when the buffer is full,
+ * otherwise the oldest point is overwritten
+ */
+PlotSeries::PlotSeries(int capacity, bool growable) :
+    first(0),
+    count(0),
+    growable(growable),
+    revision(0),
+    firstIndex(0)
+{
+    buffer.resize(qMax(capacity, 0));
+    rebuildLevels();
+}
+
+
+/**
+ * @brief PlotSeries::setCapacity Change the capacity, keeping the newest points
+ * which fit in it
+ */
+void PlotSeries::setCapacity(int capacity)
+{
+    capacity = qMax(capacity, 0);
+    int kept = qMin(count, capacity);
+
+    QVector<QPointF> resized(capacity);
+    for (int i = 0; i < kept; i++)
+        resized[i] = at(count - kept + i);
+
+    buffer.swap(resized);
+    first = 0;
+    firstIndex += count - kept;
+    count = kept;
+    revision++;
+
+    rebuildLevels();
+}
+
+
+/**
+ * @brief PlotSeries::append Append a point after the newest one
+ */
+void PlotSeries::append(const QPointF &point)
+{
+    if (count == buffer.size()) {
+        if (growable) {
+            setCapacity(qMax(2 * buffer.size(), MINIMUM_CAPACITY));
+        } else if (count > 0) {
+            // Overwrite the oldest point, which makes the next one the oldest
+            buffer[first] = point;
+            if (++first == buffer.size())
+                first = 0;
+            firstIndex++;
+            revision++;
+            completeGroups(firstIndex + count - 1);
+            return;
+        } else {
+            return;
+        }
+    }
+
+    int index = first + count;
+    if (index >= buffer.size())
+        index -= buffer.size();
+    buffer[index] = point;
+    count++;
+    revision++;
+    completeGroups(firstIndex + count - 1);
+}
+
+
+/**
+ * @brief PlotSeries::removeFirst Drop the n oldest points
+ */
+void PlotSeries::removeFirst(int n)
+{
+    n = qBound(0, n, count);
+    if (n == 0)
+        return;
+
+    first += n;
+    if (first >= buffer.size())
+        first -= buffer.size();
+    firstIndex += n;
+    count -= n;
+    revision++;
+}
+
+
+/**
+ * @brief PlotSeries::clear Drop all the points, keeping the capacity
+ */
+void PlotSeries::clear()
+{
+    first = 0;
+    firstIndex += count;
+    count = 0;
+    revision++;
+}
+
+
+/**
+ * @brief PlotSeries::decimate Get the points to draw for a range of the series,
+ * in the order of the series. Each aligned group of the largest level with
+ * at most groupSize points is replaced by its points with the smallest and
+ * the largest y. The ends of the range which are not aligned are covered by
+ * groups of lower levels and single points.
+ * @param from Position of the first point of the range
+ * @param to Position after the last point of the range
+ * @param groupSize Largest number of points replaced by two, no decimation
+ * under DECIMATION_THRESHOLD
+ * @param positions The positions of the points to draw are appended to it
+ */
+void PlotSeries::decimate(int from, int to, int groupSize, QVector<int> &positions) const
+{
+    int top = -1;
+    if (groupSize >= DECIMATION_THRESHOLD) {
+        while (top + 1 < levels.size() && GROUP_SIZE(top + 1) <= groupSize)
+            top++;
+    }
+
+    qint64 index = firstIndex + qMax(from, 0);
+    qint64 end = firstIndex + qMin(to, count);
+    while (index < end) {
+        // Largest group starting at this point and ending in the range
+        int level = top;
+        while (level >= 0 && ((index & (GROUP_SIZE(level) - 1)) != 0 || index + GROUP_SIZE(level) > end))
+            level--;
+
+        if (level < 0) {
+            positions.append(index - firstIndex);
+            index++;
+            continue;
+        }
+
+        const Group &group = getGroup(level, index >> GROUP_BITS(level));
+        qint64 firstExtreme = qMin(group.minIndex, group.maxIndex);
+        qint64 lastExtreme = qMax(group.minIndex, group.maxIndex);
+        positions.append(firstExtreme - firstIndex);
+        if (lastExtreme != firstExtreme)
+            positions.append(lastExtreme - firstIndex);
+        index += GROUP_SIZE(level);
+    }
+}
+
+
+/**
+ * @brief PlotSeries::getYRange Get the smallest and largest y of all the
+ * points, from the largest groups
+ * @return false if the series is empty
+ */
+bool PlotSeries::getYRange(double &minY, double &maxY) const
+{
+    if (count == 0)
+        return false;
+
+    QVector<int> extremes;
+    decimate(0, count, INT_MAX, extremes);
+
+    minY = at(extremes.at(0)).y();
+    maxY = minY;
+    for (int i = 1; i < extremes.size(); i++) {
+        minY = qMin(minY, at(extremes.at(i)).y());
+        maxY = qMax(maxY, at(extremes.at(i)).y());
+    }
+    return true;
+}
+
+
+/**
+ * @brief PlotSeries::rebuildLevels Size the levels for the capacity and
+ * compute the groups of the points in the buffer
+ */
+void PlotSeries::rebuildLevels()
+{
+    levels.clear();
+    for (int level = 0; GROUP_SIZE(level) <= buffer.size(); level++) {
+        // Room for the groups of a full buffer and the ones cut at its ends
+        levels.append(QVector<Group>(buffer.size() / GROUP_SIZE(level) + 2));
+    }
+
+    for (int i = 0; i < count; i++)
+        completeGroups(firstIndex + i);
+}
+
+
+/**
+ * @brief PlotSeries::completeGroups Compute the groups completed by a point,
+ * from the points for the first level and from the groups of the level below
+ * for the others
+ * @param index Index of the point
+ */
+void PlotSeries::completeGroups(qint64 index)
+{
+    qint64 end = index + 1;
+
+    for (int level = 0; level < levels.size(); level++) {
+        qint64 start = end - GROUP_SIZE(level);
+        if ((end & (GROUP_SIZE(level) - 1)) != 0 || start < firstIndex)
+            break;
+
+        QVector<Group> &groups = levels[level];
+        Group &group = groups[(start >> GROUP_BITS(level)) % groups.size()];
+
+        if (level == 0) {
+            group.minIndex = start;
+            group.maxIndex = start;
+            group.minY = group.maxY = at(start - firstIndex).y();
+            for (qint64 i = start + 1; i < end; i++) {
+                double y = at(i - firstIndex).y();
+                if (y < group.minY) {
+                    group.minY = y;
+                    group.minIndex = i;
+                }
+                if (y > group.maxY) {
+                    group.maxY = y;
+                    group.maxIndex = i;
+                }
+            }
+        } else {
+            qint64 child = start >> GROUP_BITS(level - 1);
+            group = getGroup(level - 1, child);
+            for (qint64 i = child + 1; i < child + (1 << LEVEL_BITS); i++) {
+                const Group &part = getGroup(level - 1, i);
+                if (part.minY < group.minY) {
+                    group.minY = part.minY;
+                    group.minIndex = part.minIndex;
+                }
+                if (part.maxY > group.maxY) {
+                    group.maxY = part.maxY;
+                    group.maxIndex = part.maxIndex;
+                }
+            }
+        }
+    }
+}
+
+
+/**
+ * @brief RunningStatistics::RunningStatistics
+ * @param window Number of samples the statistics are computed over
+ */
+RunningStatistics::RunningStatistics(int window)
+{
+    setWindow(window);
+}
+
+
+/**
+ * @brief RunningStatistics::setWindow Change the number of samples the
+ * statistics are computed over. The samples already appended are dropped.
+ */
+void RunningStatistics::setWindow(int window)
+{
+    values.resize(qMax(window, 1));
+    clear();
+}
+
+
+/**
+ * @brief RunningStatistics::clear Drop all the samples
+ */
+void RunningStatistics::clear()
+{
+    first = 0;
+    count = 0;
+    mean = 0;
+    squaresSum = 0;
+    updates = 0;
+}
+
+
+/**
+ * @brief RunningStatistics::append Add a sample, dropping the oldest one if the
+ * window is full. The mean and the sum of the squared differences are updated
+ * as in Welford's algorithm, and computed from scratch every window of samples
+ * so the rounding errors do not add up.
+ */
+void RunningStatistics::append(double value)
+{
+    if (count < values.size()) {
+        values[count++] = value;
+
+        double delta = value - mean;
+        mean += delta / count;
+        squaresSum += delta * (value - mean);
+        return;
+    }
+
+    double oldest = values[first];
+    values[first] = value;
+    if (++first == values.size())
+        first = 0;
+
+    if (++updates >= values.size()) {
+        recompute();
+        return;
+    }
+
+    double previousMean = mean;
+    mean += (value - oldest) / count;
+    squaresSum += (value - oldest) * (value - mean + oldest - previousMean);
+    if (squaresSum < 0)
+        squaresSum = 0;
+}
+
+
+/**
+ * @brief RunningStatistics::getStandardDeviation Sample standard deviation,
+ * with Bessel's correction
+ */
+double RunningStatistics::getStandardDeviation() const
+{
+    if (count < 2)
+        return 0;
+
+    return sqrt(squaresSum / (count - 1));
+}
+
+
+/**
+ * @brief RunningStatistics::recompute Compute the mean and the sum of the
+ * squared differences from the samples in the window
+ */
+void RunningStatistics::recompute()
+{
+    double sum = 0;
+    for (int i = 0; i < count; i++)
+        sum += values.at(i);
+    mean = sum / count;
+
+    squaresSum = 0;
+    for (int i = 0; i < count; i++)
+        squaresSum += (values.at(i) - mean) * (values.at(i) - mean);
+
+    updates = 0;
+}
+
+
+/**
+ * @brief PlotSeriesData::PlotSeriesData
+ * @param series The points, which must outlive this object
+ * @param indexed If set, the x of each point is replaced by its position
+ */
+PlotSeriesData::PlotSeriesData(const PlotSeries *series, bool indexed) :
+    series(series),
+    indexed(indexed),
+    boundingRectRevision(0),
+    pixelWidth(0),
+    positionsValid(false),
+    positionsRevision(0)
+{
+}
+
+
+/**
+ * @brief PlotSeriesData::setPixelWidth Set the width of the plot, which
+ * enables the decimation
+ * @param width Width of the plot in pixels, 0 to hand all the points to the curve
+ */
+void PlotSeriesData::setPixelWidth(int width)
+{
+    if (width != pixelWidth) {
+        pixelWidth = width;
+        positionsValid = false;
+    }
+}
+
+
+/**
+ * @brief PlotSeriesData::setRectOfInterest Called by the curve with the
+ * scales of the plot before it is drawn
+ */
+void PlotSeriesData::setRectOfInterest(const QRectF &rect)
+{
+    if (rect != rectOfInterest) {
+        rectOfInterest = rect;
+        positionsValid = false;
+    }
+}
+
+
+size_t PlotSeriesData::size() const
+{
+    if (pixelWidth <= 0)
+        return series->size();
+
+    updatePositions();
+    return positions.size();
+}
+
+
+QPointF PlotSeriesData::sample(size_t i) const
+{
+    int position = i;
+    if (pixelWidth > 0) {
+        updatePositions();
+        position = positions.at(i);
+    }
+
+    if (indexed)
+        return QPointF(position, series->at(position).y());
+
+    return series->at(position);
+}
+
+
+/**
+ * @brief PlotSeriesData::updatePositions Select the points in the rectangle of
+ * interest, and the ones on both sides of it so the lines reach its edges,
+ * then decimate them to about two per pixel
+ */
+void PlotSeriesData::updatePositions() const
+{
+    if (positionsValid && positionsRevision == series->getRevision())
+        return;
+
+    positionsValid = true;
+    positionsRevision = series->getRevision();
+    positions.clear();
+
+    int from = 0;
+    int to = series->size();
+    if (rectOfInterest.width() > 0) {
+        if (indexed) {
+            from = qBound(0, (int) floor(rectOfInterest.left()) - 1, to);
+            to = qBound(from, (int) ceil(rectOfInterest.right()) + 2, to);
+        } else {
+            from = qMax(lowerBound(rectOfInterest.left()) - 1, 0);
+            to = qMin(lowerBound(rectOfInterest.right()) + 1, to);
+        }
+    }
+
+    series->decimate(from, to, (to - from) / pixelWidth, positions);
+}
+
+
+/**
+ * @brief PlotSeriesData::lowerBound Binary search of the first point at or
+ * after an x
+ * @return The position of the point, the size of the series if there is none
+ */
+int PlotSeriesData::lowerBound(double x) const
+{
+    int low = 0;
+    int high = series->size();
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+        if (series->at(middle).x() < x)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+
+/**
+ * @brief PlotSeriesData::boundingRect Bounding rectangle of the points. It is
+ * only computed again once the series changed, at most once per replot, and
+ * the range of y comes from the groups of points of the series.
+ */
+QRectF PlotSeriesData::boundingRect() const
+{
+    if (d_boundingRect.width() >= 0 && boundingRectRevision == series->getRevision())
+        return d_boundingRect;
+
+    boundingRectRevision = series->getRevision();
+    double minY, maxY;
+    if (!series->getYRange(minY, maxY)) {
+        d_boundingRect = QRectF(1.0, 1.0, -2.0, -2.0);
+        return d_boundingRect;
+    }
+
+    double minX = 0;
+    double maxX = series->size() - 1;
+    if (!indexed) {
+        minX = series->front().x();
+        maxX = series->back().x();
+    }
+
+    d_boundingRect = QRectF(minX, minY, maxX - minX, maxY - minY);
+    return d_boundingRect;
+}
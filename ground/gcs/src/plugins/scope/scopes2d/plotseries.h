@@ -0,0 +1,181 @@
+/**
+ ******************************************************************************
+ *
+ * @file       plotseries.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup ScopePlugin Scope Gadget Plugin
+ * @{
+ * @brief Ring buffers keeping the samples of the scope curves
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef PLOTSERIES_H
+#define PLOTSERIES_H
+
+#include "qwt/src/qwt_series_data.h"
+
+#include <QPointF>
+#include <QVector>
+
+
+/**
+ * @brief The PlotSeries class Ring buffer of the points of a curve. The oldest
+ * points are dropped in constant time. When the buffer is full, appending
+ * either overwrites the oldest point or doubles the capacity.
+ *
+ * Every point has an index, counting all the points ever appended. The
+ * smallest and largest y of each group of 4, 16, 64... points with aligned
+ * indices are kept in a pyramid of levels, completed as the last point of a
+ * group is appended, so that long ranges are decimated without reading all
+ * their points.
+ */
+class PlotSeries
+{
+public:
+    PlotSeries(int capacity = 0, bool growable = true);
+
+    void setCapacity(int capacity);
+    int getCapacity() const {return buffer.size();}
+    int size() const {return count;}
+    bool isEmpty() const {return count == 0;}
+
+    void append(const QPointF &point);
+    void removeFirst(int n = 1);
+    void clear();
+
+    //! Point i, counting from the oldest one
+    const QPointF &at(int i) const {
+        int index = first + i;
+        if (index >= buffer.size())
+            index -= buffer.size();
+        return buffer.at(index);
+    }
+    const QPointF &front() const {return at(0);}
+    const QPointF &back() const {return at(count - 1);}
+
+    //! Incremented on every change, for the users caching what they derive from the points
+    quint32 getRevision() const {return revision;}
+
+    void decimate(int from, int to, int groupSize, QVector<int> &positions) const;
+    bool getYRange(double &minY, double &maxY) const;
+
+private:
+    /**
+     * @brief The Group struct Smallest and largest y of a group of points
+     */
+    struct Group {
+        double minY;
+        double maxY;
+        qint64 minIndex;
+        qint64 maxIndex;
+    };
+
+    void rebuildLevels();
+    void completeGroups(qint64 index);
+    const Group &getGroup(int level, qint64 group) const {
+        const QVector<Group> &groups = levels.at(level);
+        return groups.at(group % groups.size());
+    }
+
+    QVector<QPointF> buffer;
+    int first;
+    int count;
+    bool growable;
+    quint32 revision;
+
+    //! Index of the oldest point
+    qint64 firstIndex;
+    //! Ring of the groups of each level, level k groups 4^(k+1) points
+    QVector<QVector<Group> > levels;
+};
+
+
+/**
+ * @brief The RunningStatistics class Mean and standard deviation of the last
+ * samples, updated in constant time for every new sample
+ */
+class RunningStatistics
+{
+public:
+    RunningStatistics(int window = 1);
+
+    void setWindow(int window);
+    int getWindow() const {return values.size();}
+    int getCount() const {return count;}
+
+    void append(double value);
+    void clear();
+
+    double getMean() const {return mean;}
+    double getStandardDeviation() const;
+
+private:
+    void recompute();
+
+    QVector<double> values;
+    int first;
+    int count;
+    double mean;
+    //! Sum of the squared differences to the mean
+    double squaresSum;
+    //! Samples replaced since the sums were last computed from scratch
+    int updates;
+};
+
+
+/**
+ * @brief The PlotSeriesData class Hands the points of a PlotSeries to a curve
+ * without copying them. In indexed mode the x of each point is its position
+ * in the series, otherwise the x must not decrease.
+ *
+ * Once the pixel width of the plot is set, only the points in the rectangle
+ * of interest are handed to the curve, and when there are more than a few
+ * per pixel, only the smallest and largest y of the groups of points drawn
+ * on each pixel. Drawing then costs as much as the plot is wide, however
+ * long the series is.
+ */
+class PlotSeriesData : public QwtSeriesData<QPointF>
+{
+public:
+    PlotSeriesData(const PlotSeries *series, bool indexed = false);
+
+    void setPixelWidth(int width);
+
+    virtual size_t size() const;
+    virtual QPointF sample(size_t i) const;
+    virtual QRectF boundingRect() const;
+    virtual void setRectOfInterest(const QRectF &rect);
+
+private:
+    void updatePositions() const;
+    int lowerBound(double x) const;
+
+    const PlotSeries *series;
+    bool indexed;
+    mutable quint32 boundingRectRevision;
+
+    int pixelWidth;
+    QRectF rectOfInterest;
+    //! Positions in the series of the points handed to the curve, when decimating
+    mutable QVector<int> positions;
+    mutable bool positionsValid;
+    mutable quint32 positionsRevision;
+};
+
+#endif // PLOTSERIES_H
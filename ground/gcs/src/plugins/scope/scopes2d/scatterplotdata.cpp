@@ -49,9 +49,7 @@ void TimeSeriesPlotData::plotNewData(PlotData *plot2dData, ScopeConfig *scopeCon
     Q_UNUSED(scopeConfig);
     Q_UNUSED(scopeGadgetWidget);
 
-    //Plot new data
-    if (readAndResetUpdatedFlag() == true)
-        curve->setSamples(*xData, *yData);
+    updateSeriesData(scopeGadgetWidget);
 
     QDateTime NOW = QDateTime::currentDateTime();
     double toTime = NOW.toTime_t();
@@ -71,9 +69,7 @@ void SeriesPlotData::plotNewData(PlotData *plot2dData, ScopeConfig *scopeConfig,
     Q_UNUSED(scopeConfig);
     Q_UNUSED(scopeGadgetWidget);
 
-    //Plot new data
-    if (readAndResetUpdatedFlag() == true)
-        curve->setSamples(*xData, *yData);
+    updateSeriesData(scopeGadgetWidget);
 }
 
 
@@ -87,55 +83,18 @@ bool SeriesPlotData::append(UAVObject* obj)
     if (uavObjectName == obj->getName()) {
 
         //Get the field of interest
-        UAVObjectField* field =  obj->getField(uavFieldName);
-
-        if (field) {
-
-            double currentValue = valueAsDouble(obj, field, haveSubField, uavSubFieldName) * pow(10, scalePower);
-
-            //Perform scope math, if necessary
-            if (mathFunction  == "Boxcar average" || mathFunction  == "Standard deviation"){
-                //Put the new value at the front
-                yDataHistory->append( currentValue );
-
-                // calculate average value
-                meanSum += currentValue;
-                if(yDataHistory->size() > (int)meanSamples) {
-                    meanSum -= yDataHistory->first();
-                    yDataHistory->pop_front();
-                }
-
-                // make sure to correct the sum every meanSamples steps to prevent it
-                // from running away due to floating point rounding errors
-                correctionSum+=currentValue;
-                if (++correctionCount >= (int)meanSamples) {
-                    meanSum = correctionSum;
-                    correctionSum = 0.0f;
-                    correctionCount = 0;
-                }
-
-                double boxcarAvg=meanSum/yDataHistory->size();
-
-                if ( mathFunction  == "Standard deviation" ){
-                    //Calculate square of sample standard deviation, with Bessel's correction
-                    double stdSum=0;
-                    for (int i=0; i < yDataHistory->size(); i++){
-                        stdSum+= pow(yDataHistory->at(i)- boxcarAvg,2)/(meanSamples-1);
-                    }
-                    yData->append(sqrt(stdSum));
-                }
-                else  {
-                    yData->append(boxcarAvg);
-                }
-            }
-            else{
-                yData->append( currentValue );
-            }
-
-            if (yData->size() > getXWindowSize()) { //If new data overflows the window, remove old data...
-                yData->pop_front();
-            } else //...otherwise, add a new y point at position xData
-                xData->insert(xData->size(), xData->size());
+        double value;
+
+        if (valueAsDouble(obj, &value)) {
+
+            double currentValue = value * pow(10, scalePower);
+
+            //The series keeps as many points as the window is wide
+            if (samples.getCapacity() != (int) getXWindowSize())
+                samples.setCapacity(getXWindowSize());
+
+            //Once full, the oldest point is overwritten and the x are the positions
+            samples.append(QPointF(0, applyMathFunction(currentValue)));
 
             return true;
         }
@@ -154,52 +113,14 @@ bool TimeSeriesPlotData::append(UAVObject* obj)
 {
     if (uavObjectName == obj->getName()) {
         //Get the field of interest
-        UAVObjectField* field =  obj->getField(uavFieldName);
+        double value;
 
-        if (field) {
+        if (valueAsDouble(obj, &value)) {
             QDateTime NOW = QDateTime::currentDateTime(); //THINK ABOUT REIMPLEMENTING THIS TO SHOW UAVO TIME, NOT SYSTEM TIME
-            double currentValue = valueAsDouble(obj, field, haveSubField, uavSubFieldName) * pow(10, scalePower);
-
-            //Perform scope math, if necessary
-            if (mathFunction  == "Boxcar average" || mathFunction  == "Standard deviation"){
-                //Put the new value at the back
-                yDataHistory->append( currentValue );
-
-                // calculate average value
-                meanSum += currentValue;
-                if(yDataHistory->size() > (int)meanSamples) {
-                    meanSum -= yDataHistory->first();
-                    yDataHistory->pop_front();
-                }
-                // make sure to correct the sum every meanSamples steps to prevent it
-                // from running away due to floating point rounding errors
-                correctionSum+=currentValue;
-                if (++correctionCount >= (int)meanSamples) {
-                    meanSum = correctionSum;
-                    correctionSum = 0.0f;
-                    correctionCount = 0;
-                }
-
-                double boxcarAvg=meanSum/yDataHistory->size();
-
-                if ( mathFunction  == "Standard deviation" ){
-                    //Calculate square of sample standard deviation, with Bessel's correction
-                    double stdSum=0;
-                    for (int i=0; i < yDataHistory->size(); i++){
-                        stdSum+= pow(yDataHistory->at(i)- boxcarAvg,2)/(meanSamples-1);
-                    }
-                    yData->append(sqrt(stdSum));
-                }
-                else  {
-                    yData->append(boxcarAvg);
-                }
-            }
-            else{
-                yData->append( currentValue );
-            }
+            double currentValue = value * pow(10, scalePower);
 
             double valueX = NOW.toTime_t() + NOW.time().msec() / 1000.0;
-            xData->append(valueX);
+            samples.append(QPointF(valueX, applyMathFunction(currentValue)));
 
             //Remove stale data
             removeStaleData();
@@ -217,22 +138,13 @@ bool TimeSeriesPlotData::append(UAVObject* obj)
  */
 void TimeSeriesPlotData::removeStaleData()
 {
-    double newestValue;
-    double oldestValue;
+    if (samples.isEmpty())
+        return;
 
-    while (1) {
-        if (xData->size() == 0)
-            break;
+    double newestValue = samples.back().x();
 
-        newestValue = xData->last();
-        oldestValue = xData->first();
-
-        if (newestValue - oldestValue > getXWindowSize()) {
-            yData->pop_front();
-            xData->pop_front();
-        } else
-            break;
-    }
+    while (!samples.isEmpty() && newestValue - samples.front().x() > getXWindowSize())
+        samples.removeFirst();
 }
 
 
@@ -245,6 +157,54 @@ void TimeSeriesPlotData::removeStaleDataTimeout()
 }
 
 
+/**
+ * @brief ScatterplotData::setCurve Set the curve and have it read the samples in place
+ * @param val The curve, which takes ownership of the series data handed to it
+ */
+void ScatterplotData::setCurve(QwtPlotCurve *val)
+{
+    curve = val;
+    seriesData = new PlotSeriesData(&samples, indexed);
+    curve->setData(seriesData);
+}
+
+
+/**
+ * @brief ScatterplotData::updateSeriesData Prepare the curve for the replot
+ * @param scopeGadgetWidget
+ */
+void ScatterplotData::updateSeriesData(ScopeGadgetWidget *scopeGadgetWidget)
+{
+    //The samples are decimated to the pixels of the visible range on replot
+    seriesData->setPixelWidth(scopeGadgetWidget->canvas()->width());
+
+    //The curve reads the samples in place, only tell it they changed
+    if (readAndResetUpdatedFlag() == true)
+        curve->itemChanged();
+}
+
+
+/**
+ * @brief ScatterplotData::applyMathFunction Perform scope math, if necessary
+ * @param value The new value
+ * @return The value to plot
+ */
+double ScatterplotData::applyMathFunction(double value)
+{
+    if (mathFunction != "Boxcar average" && mathFunction != "Standard deviation")
+        return value;
+
+    if (statistics.getWindow() != (int) meanSamples)
+        statistics.setWindow(meanSamples);
+    statistics.append(value);
+
+    if (mathFunction == "Standard deviation")
+        return statistics.getStandardDeviation();
+
+    return statistics.getMean();
+}
+
+
 /**
  * @brief ScatterplotData::clearPlots Clear all plot data
  */
@@ -29,6 +29,7 @@
 #define SCATTERPLOTDATA_H
 
 #include "scopes2d/plotdata2d.h"
+#include "scopes2d/plotseries.h"
 #include "uavobject.h"
 #include "qwt/src/qwt_plot_curve.h"
 
@@ -44,16 +45,27 @@ class ScatterplotData : public Plot2dData
 {
     Q_OBJECT
 public:
-    ScatterplotData(QString uavObject, QString uavField):
-        Plot2dData(uavObject, uavField){curve = 0;}
+    ScatterplotData(QString uavObject, QString uavField, bool indexed = false):
+        Plot2dData(uavObject, uavField), samples(0, !indexed), indexed(indexed){curve = 0; seriesData = 0;}
     ~ScatterplotData(){}
 
     virtual void clearPlots(PlotData *);
 
-    void setCurve(QwtPlotCurve *val){curve = val;}
+    void setCurve(QwtPlotCurve *val);
+
+    const PlotSeries &getSamples(){return samples;}
 
 protected:
+    double applyMathFunction(double value);
+    void updateSeriesData(ScopeGadgetWidget *scopeGadgetWidget);
+
     QwtPlotCurve* curve;
+    PlotSeriesData* seriesData; //Owned by the curve
+    PlotSeries samples;         //Points of the curve, shown without a copy
+    RunningStatistics statistics; //Last meanSamples values, for the scope math
+
+private:
+    bool indexed;
 };
 
 
@@ -67,7 +79,7 @@ class SeriesPlotData : public ScatterplotData
     Q_OBJECT
 public:
     SeriesPlotData(QString uavObject, QString uavField)
-            : ScatterplotData(uavObject, uavField) {}
+            : ScatterplotData(uavObject, uavField, true) {}
     ~SeriesPlotData() {}
 
     /*!
@@ -36,7 +36,6 @@
 
 #include "qwt/src/qwt.h"
 #include "qwt/src/qwt_color_map.h"
-#include "qwt/src/qwt_matrix_raster_data.h"
 #include "qwt/src/qwt_plot_spectrogram.h"
 #include "qwt/src/qwt_scale_draw.h"
 #include "qwt/src/qwt_scale_widget.h"
@@ -53,7 +52,8 @@
 SpectrogramData::SpectrogramData(QString uavObject, QString uavField, double samplingFrequency, unsigned int windowWidth, double timeHorizon)
         : Plot3dData(uavObject, uavField),
           spectrogram(0),
-          rasterData(0)
+          rasterData(0),
+          instanceHandlesValid(false)
 {
     this->samplingFrequency = samplingFrequency;
     this->timeHorizon = timeHorizon;
@@ -61,12 +61,18 @@ SpectrogramData::SpectrogramData(QString uavObject, QString uavField, double sam
     autoscaleValueUpdated = 0;
 
     // Create raster data
-    rasterData = new QwtMatrixRasterData();
-
-    rasterData->setValueMatrix( *zDataHistory, windowWidth );
+    rasterData = new SpectrogramRasterData(windowWidth);
 
     // Set the ranges for the plot
     resetAxisRanges();
+
+    // Resolve the instances once, and again only when one is created
+    ExtensionSystem::PluginManager *pm = ExtensionSystem::PluginManager::instance();
+    Q_ASSERT(pm != NULL);
+    objManager = pm->getObject<UAVObjectManager>();
+    Q_ASSERT(objManager != NULL);
+    connect(objManager, SIGNAL(newInstance(UAVObject*)), this, SLOT(instanceCreated(UAVObject*)));
+    resolveInstances();
 }
 
 void SpectrogramData::setXMaximum(double val)
@@ -108,11 +114,8 @@ void SpectrogramData::plotNewData(PlotData *plot3dData, ScopeConfig *scopeConfig
 
     removeStaleData();
 
-    // Check for new data
+    // Check for new data. The raster is read in place, there is nothing to copy.
     if (readAndResetUpdatedFlag() == true){
-        // Plot new data
-        rasterData->setValueMatrix(*zDataHistory, windowWidth);
-
         // Check autoscale. (For some reason, QwtSpectrogram doesn't support autoscale)
         if (zMaximum == 0){
             double newVal = readAndResetAutoscaleValue();
@@ -141,20 +144,11 @@ bool SpectrogramData::append(UAVObject* multiObj)
         if (multiObj->isSingleInstance())
             return false;
 
-        //Instantiate object manager
-        UAVObjectManager *objManager;
-
-        ExtensionSystem::PluginManager *pm = ExtensionSystem::PluginManager::instance();
-        Q_ASSERT(pm != NULL);
-        objManager = pm->getObject<UAVObjectManager>();
-        Q_ASSERT(objManager != NULL);
-
-
-        // Get list of object instances
-        QVector<UAVObject*> list = objManager->getObjectInstancesVector(multiObj->getName());
+        // Resolve the field of interest in the instances, if some were created since the last row
+        if (!instanceHandlesValid && !resolveInstances())
+            return false;
 
-        // Remove a row's worth of data.
-        unsigned int spectrogramWidth = list.size();
+        unsigned int spectrogramWidth = instanceHandles.size();
 
         // Check that there is a full window worth of data. While GCS is starting up, the size of
         // multiple instance UAVOs is 1, so it's possible for spurious data to come in before
@@ -164,19 +158,22 @@ bool SpectrogramData::append(UAVObject* multiObj)
             return false;
         }
 
-        //Initialize vector where we will read out an entire row of multiple instance UAVO
-        QVector<double> values;
-
-        timeDataHistory->append(NOW.toTime_t() + NOW.time().msec() / 1000.0);
-        UAVObjectField* multiField =  multiObj->getField(uavFieldName);
+        UAVObjectField* multiField = multiObj->getField(uavFieldName);
         Q_ASSERT(multiField);
         if (multiField ) {
+            double scale = pow(10, scalePower);
 
-            // Get the field of interest
-            foreach (UAVObject *obj, list) {
-                UAVObjectField* field =  obj->getField(uavFieldName);
+            // Drop the rows which are out of the time horizon
+            double rowTime = NOW.toTime_t() + NOW.time().msec() / 1000.0;
+            while (rasterData->numRows() > 0 && rowTime - rasterData->getRowTime(0) > timeHorizon)
+                rasterData->removeFirstRows();
+
+            // The values are read straight into the row
+            double *values = rasterData->appendRow(rowTime);
 
-                double currentValue = valueAsDouble(obj, field, haveSubField, uavSubFieldName) * pow(10, scalePower);
+            // Get the field of interest
+            for (int i = 0; i < instanceHandles.size(); i++) {
+                double currentValue = instanceHandles.at(i).getDouble() * scale;
 
                 double vecVal = currentValue;
                 //Normally some math would go here, modifying vecVal before appending it to values
@@ -191,18 +188,8 @@ bool SpectrogramData::append(UAVObject* multiObj)
                     rasterData->setInterval(Qt::ZAxis, QwtInterval(0, vecVal) );
                     autoscaleValueUpdated = vecVal;
                 }
-                // Last step, assign value to vector
-                values += vecVal;
-            }
-
-            while (timeDataHistory->back() - timeDataHistory->front() > timeHorizon){
-                timeDataHistory->pop_front();
-                zDataHistory->remove(0, fminl(spectrogramWidth, zDataHistory->size()));
-            }
-
-            // Doublecheck that there are the right number of samples. This can occur if the "field" assert fails
-            if(values.size() == (int) windowWidth){
-                *zDataHistory << values;
+                // Last step, assign value to the row
+                values[i] = vecVal;
             }
 
             return true;
@@ -213,6 +200,46 @@ bool SpectrogramData::append(UAVObject* multiObj)
 }
 
 
+/**
+ * @brief SpectrogramData::resolveInstances Resolve the field of interest in all
+ * the instances of the UAVO
+ * @return false if the field is missing. An instance missing the subfield
+ * keeps an invalid handle, which reads as 0 like before the handles.
+ */
+bool SpectrogramData::resolveInstances()
+{
+    QVector<UAVObject*> list = objManager->getObjectInstancesVector(uavObjectName);
+
+    instanceHandles.resize(list.size());
+    for (int i = 0; i < list.size(); i++) {
+        if (instanceHandles[i].getObject() == list[i])
+            continue;
+        if (list[i]->getField(uavFieldName) == NULL) {
+            instanceHandles.clear();
+            return false;
+        }
+        instanceHandles[i] = UAVObjectFieldHandle::resolve(list[i], uavFieldName, haveSubField ? uavSubFieldName : QString());
+        if (!instanceHandles[i].isValid())
+            qWarning() << "No subfield" << uavSubFieldName << "in" << list[i]->getName() << "." << uavFieldName << ", plotted as 0";
+    }
+
+    instanceHandlesValid = !instanceHandles.isEmpty();
+    return instanceHandlesValid;
+}
+
+
+/**
+ * @brief SpectrogramData::instanceCreated Resolve the instances again on the
+ * next row when one of the plotted UAVO is created
+ * @param obj The new instance
+ */
+void SpectrogramData::instanceCreated(UAVObject *obj)
+{
+    if (obj->getName() == uavObjectName)
+        instanceHandlesValid = false;
+}
+
+
 /**
  * @brief SpectrogramScopeConfig::clearPlots Clear all plot data
  */
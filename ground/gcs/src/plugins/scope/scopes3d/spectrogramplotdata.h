@@ -29,14 +29,15 @@
 #define SPECTROGRAMDATA_H
 
 #include "scopes3d/plotdata3d.h"
+#include "scopes3d/spectrogramrasterdata.h"
 #include "uavobject.h"
 #include "qwt/src/qwt_plot_spectrogram.h"
-#include "qwt/src/qwt_matrix_raster_data.h"
 
 #include <QTimer>
 #include <QTime>
 #include <QVector>
 
+class UAVObjectManager;
 
 /**
  * @brief The SpectrogramData class The spectrogram plot has a fixed size
@@ -71,19 +72,27 @@ public:
     virtual void setYMaximum(double val);
     virtual void setZMaximum(double val);
 
-    QwtMatrixRasterData *getRasterData(){return rasterData;}
+    SpectrogramRasterData *getRasterData(){return rasterData;}
     void setSpectrogram(QwtPlotSpectrogram *val){spectrogram = val;}
 
+private slots:
+    void instanceCreated(UAVObject *obj);
+
 private:
     void resetAxisRanges();
+    bool resolveInstances();
 
     QwtPlotSpectrogram *spectrogram;
-    QwtMatrixRasterData *rasterData;
+    SpectrogramRasterData *rasterData;
+    UAVObjectManager *objManager;
 
     double samplingFrequency;
     double timeHorizon;
     unsigned int windowWidth;
     double autoscaleValueUpdated;
+
+    QVector<UAVObjectFieldHandle> instanceHandles; //Plotted element of each instance
+    bool instanceHandlesValid;
 };
 
 #endif // SPECTROGRAMDATA_H
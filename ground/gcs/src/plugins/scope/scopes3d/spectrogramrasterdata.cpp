@@ -0,0 +1,155 @@
+/**
+ ******************************************************************************
+ *
+ * @file       spectrogramrasterdata.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup ScopePlugin Scope Gadget Plugin
+ * @{
+ * @brief Ring buffer of the rows of a spectrogram
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "scopes3d/spectrogramrasterdata.h"
+
+#include <qnumeric.h>
+#include <string.h>
+
+//! Rows of the buffer at the first row
+#define MINIMUM_CAPACITY 64
+
+
+/**
+ * @brief SpectrogramRasterData::SpectrogramRasterData
+ * @param numColumns Number of values in a row
+ */
+SpectrogramRasterData::SpectrogramRasterData(int numColumns) :
+    columns(qMax(numColumns, 1)),
+    rows(0),
+    first(0),
+    dx(0),
+    dy(0)
+{
+}
+
+
+/**
+ * @brief SpectrogramRasterData::appendRow Add a row after the newest one
+ * @param time Time of the row
+ * @return The values of the row, set to zero, to be filled by the caller
+ */
+double *SpectrogramRasterData::appendRow(double time)
+{
+    if (rows == times.size())
+        setCapacity(qMax(2 * times.size(), MINIMUM_CAPACITY));
+
+    int index = slot(rows);
+    rows++;
+    updatePixelSize();
+
+    times[index] = time;
+    double *row = values.data() + index * columns;
+    memset(row, 0, columns * sizeof(double));
+    return row;
+}
+
+
+/**
+ * @brief SpectrogramRasterData::removeFirstRows Drop the n oldest rows
+ */
+void SpectrogramRasterData::removeFirstRows(int n)
+{
+    n = qBound(0, n, rows);
+    first = slot(n);
+    rows -= n;
+    updatePixelSize();
+}
+
+
+/**
+ * @brief SpectrogramRasterData::setCapacity Change the number of rows of the
+ * buffer, moving the rows so the oldest one is first
+ */
+void SpectrogramRasterData::setCapacity(int capacity)
+{
+    QVector<double> resizedValues(capacity * columns);
+    QVector<double> resizedTimes(capacity);
+    for (int i = 0; i < rows; i++) {
+        memcpy(resizedValues.data() + i * columns, getRow(i), columns * sizeof(double));
+        resizedTimes[i] = getRowTime(i);
+    }
+
+    values.swap(resizedValues);
+    times.swap(resizedTimes);
+    first = 0;
+}
+
+
+void SpectrogramRasterData::setInterval(Qt::Axis axis, const QwtInterval &interval)
+{
+    QwtRasterData::setInterval(axis, interval);
+    updatePixelSize();
+}
+
+
+/**
+ * @brief SpectrogramRasterData::pixelHint The size of a value, so the
+ * spectrogram is rendered at the resolution of the rows and scaled
+ */
+QRectF SpectrogramRasterData::pixelHint(const QRectF &area) const
+{
+    Q_UNUSED(area);
+
+    const QwtInterval xInterval = interval(Qt::XAxis);
+    const QwtInterval yInterval = interval(Qt::YAxis);
+    if (rows == 0 || !xInterval.isValid() || !yInterval.isValid())
+        return QRectF();
+
+    return QRectF(xInterval.minValue(), yInterval.minValue(), dx, dy);
+}
+
+
+/**
+ * @brief SpectrogramRasterData::value Value of the row and column at a
+ * position, without interpolation
+ * @return The value, NaN outside of the intervals
+ */
+double SpectrogramRasterData::value(double x, double y) const
+{
+    const QwtInterval xInterval = interval(Qt::XAxis);
+    const QwtInterval yInterval = interval(Qt::YAxis);
+
+    if (rows == 0 || !(xInterval.contains(x) && yInterval.contains(y)))
+        return qQNaN();
+
+    int row = qMin(int((y - yInterval.minValue()) / dy), rows - 1);
+    int col = qMin(int((x - xInterval.minValue()) / dx), columns - 1);
+
+    return values.at(slot(row) * columns + col);
+}
+
+
+/**
+ * @brief SpectrogramRasterData::updatePixelSize Size of a value in plot
+ * coordinates, the intervals being split among the rows and columns
+ */
+void SpectrogramRasterData::updatePixelSize()
+{
+    dx = interval(Qt::XAxis).width() / columns;
+    dy = rows > 0 ? interval(Qt::YAxis).width() / rows : 0;
+}
@@ -0,0 +1,82 @@
+/**
+ ******************************************************************************
+ *
+ * @file       spectrogramrasterdata.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup ScopePlugin Scope Gadget Plugin
+ * @{
+ * @brief Ring buffer of the rows of a spectrogram
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef SPECTROGRAMRASTERDATA_H
+#define SPECTROGRAMRASTERDATA_H
+
+#include "qwt/src/qwt_raster_data.h"
+
+#include <QVector>
+
+
+/**
+ * @brief The SpectrogramRasterData class Keeps the rows of a spectrogram in a
+ * ring buffer, oldest at the bottom of the y interval. Appending a row or
+ * dropping the oldest ones costs as much as a row is wide, and the raster is
+ * read in place at the offset of the oldest row. When the buffer is full,
+ * its capacity is doubled.
+ */
+class SpectrogramRasterData : public QwtRasterData
+{
+public:
+    SpectrogramRasterData(int numColumns);
+
+    int numColumns() const {return columns;}
+    int numRows() const {return rows;}
+
+    double *appendRow(double time);
+    void removeFirstRows(int n = 1);
+
+    //! Time of row i, counting from the oldest one
+    double getRowTime(int i) const {return times.at(slot(i));}
+    const double *getRow(int i) const {return values.constData() + slot(i) * columns;}
+
+    virtual void setInterval(Qt::Axis axis, const QwtInterval &interval);
+    virtual QRectF pixelHint(const QRectF &area) const;
+    virtual double value(double x, double y) const;
+
+private:
+    int slot(int i) const {
+        int index = first + i;
+        if (index >= times.size())
+            index -= times.size();
+        return index;
+    }
+    void setCapacity(int capacity);
+    void updatePixelSize();
+
+    int columns;
+    int rows;
+    int first;
+    QVector<double> values;
+    QVector<double> times;
+
+    double dx;
+    double dy;
+};
+
+#endif // SPECTROGRAMRASTERDATA_H
@@ -266,13 +266,9 @@ void SpectrogramScopeConfig::loadConfiguration(ScopeGadgetWidget *scopeGadgetWid
     // Initial raster data
 
     QDateTime NOW = QDateTime::currentDateTime(); //TODO: Upgrade this to show UAVO time and not system time
-    for ( uint i = 0; i < timeHorizon; i++ ){
-        spectrogramData->timeDataHistory->append(NOW.toTime_t() + NOW.time().msec() / 1000.0 + i);
-    }
-
-    if (((double) windowWidth) * timeHorizon < (double) 10000000.0 * sizeof(spectrogramData->zDataHistory->front())){ //Don't exceed 10MB for memory
-        for ( uint i = 0; i < windowWidth*timeHorizon; i++ ){
-            spectrogramData->zDataHistory->append(0);
+    if (((double) windowWidth) * timeHorizon < (double) 10000000.0 * sizeof(double)){ //Don't exceed 10MB for memory
+        for ( uint i = 0; i < timeHorizon; i++ ){
+            spectrogramData->getRasterData()->appendRow(NOW.toTime_t() + NOW.time().msec() / 1000.0 + i);
         }
     }
     else{
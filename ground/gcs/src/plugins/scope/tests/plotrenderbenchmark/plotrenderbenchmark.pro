@@ -0,0 +1,19 @@
+# Time to draw a time series curve with all its points and decimated to the
+# pixels of the plot, for histories of up to 1000000 points. The longest
+# history can be set with the PLOTRENDER_BENCH_POINTS environment variable.
+# Run with QT_QPA_PLATFORM=offscreen where there is no display.
+
+QT += testlib gui
+TARGET = plotrenderbenchmark
+CONFIG += console testcase
+CONFIG -= app_bundle
+TEMPLATE = app
+
+include(../../../../../gcs.pri)
+include(../../../../libs/qwt/qwt.pri)
+
+INCLUDEPATH *= ../..
+
+HEADERS += ../../scopes2d/plotseries.h
+SOURCES += tst_plotrenderbenchmark.cpp \
+    ../../scopes2d/plotseries.cpp
@@ -0,0 +1,157 @@
+/**
+ ******************************************************************************
+ * @file       tst_plotrenderbenchmark.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @brief Draws long time series curves with all their points and decimated to
+ * the pixels of the plot, and checks both drawings cover the same pixels
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <QtTest/QtTest>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QPainter>
+#include <math.h>
+
+#include "qwt/src/qwt_plot_curve.h"
+#include "qwt/src/qwt_scale_div.h"
+#include "qwt/src/qwt_scale_map.h"
+#include "scopes2d/plotseries.h"
+
+class tst_PlotRenderBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void render_data();
+    void render();
+
+private:
+    int m_points;
+};
+
+static const int WIDTH = 1000;
+static const int HEIGHT = 400;
+//! Rate of the plotted object
+static const double SAMPLE_RATE_HZ = 500;
+//! Points drawn for each history, to repeat the short ones
+static const double POINTS_DRAWN = 4e6;
+
+/**
+ * Draw the curve over the whole series, as the scope does on replot
+ */
+static QImage draw(QwtPlotCurve &curve, const PlotSeries &series, int frames, double *msPerFrame)
+{
+    QwtScaleMap xMap;
+    xMap.setScaleInterval(series.front().x(), series.back().x());
+    xMap.setPaintInterval(0, WIDTH);
+    QwtScaleMap yMap;
+    yMap.setScaleInterval(-2, 2);
+    yMap.setPaintInterval(HEIGHT, 0);
+
+    QImage image(WIDTH, HEIGHT, QImage::Format_ARGB32_Premultiplied);
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < frames; i++) {
+        image.fill(Qt::white);
+        QPainter painter(&image);
+        curve.updateScaleDiv(QwtScaleDiv(xMap.s1(), xMap.s2()), QwtScaleDiv(yMap.s1(), yMap.s2()));
+        curve.draw(&painter, xMap, yMap, QRectF(0, 0, WIDTH, HEIGHT));
+    }
+    *msPerFrame = timer.nsecsElapsed() / 1e6 / frames;
+
+    return image;
+}
+
+/**
+ * Rows covered by the curve in a column of the image
+ */
+static bool columnExtent(const QImage &image, int x, int *top, int *bottom)
+{
+    *top = -1;
+    for (int y = 0; y < image.height(); y++) {
+        if (image.pixel(x, y) != qRgb(255, 255, 255)) {
+            if (*top < 0)
+                *top = y;
+            *bottom = y;
+        }
+    }
+    return *top >= 0;
+}
+
+void tst_PlotRenderBenchmark::initTestCase()
+{
+    m_points = qgetenv("PLOTRENDER_BENCH_POINTS").toInt();
+    if (m_points <= 0)
+        m_points = 1000000;
+}
+
+void tst_PlotRenderBenchmark::render_data()
+{
+    QTest::addColumn<int>("points");
+
+    for (int points = 10000; points < m_points; points *= 10)
+        QTest::newRow(qPrintable(QString::number(points))) << points;
+    QTest::newRow(qPrintable(QString::number(m_points))) << m_points;
+}
+
+void tst_PlotRenderBenchmark::render()
+{
+    QFETCH(int, points);
+
+    qsrand(1);
+    PlotSeries series;
+    for (int i = 0; i < points; i++)
+        series.append(QPointF(i / SAMPLE_RATE_HZ, sin(i * 0.001) + (qrand() % 1000) / 1000.0 - 0.5));
+
+    QwtPlotCurve fullCurve;
+    PlotSeriesData *fullData = new PlotSeriesData(&series);
+    fullCurve.setData(fullData);
+
+    QwtPlotCurve decimatedCurve;
+    PlotSeriesData *decimatedData = new PlotSeriesData(&series);
+    decimatedData->setPixelWidth(WIDTH);
+    decimatedCurve.setData(decimatedData);
+
+    int frames = qMax((int) (POINTS_DRAWN / points), 1);
+    double fullMs, decimatedMs;
+    QImage full = draw(fullCurve, series, frames, &fullMs);
+    QImage decimated = draw(decimatedCurve, series, 50, &decimatedMs);
+
+    qDebug("%7d points: all drawn %8.2f ms, %5d decimated points drawn %6.2f ms", points,
+           fullMs, (int) decimatedData->size(), decimatedMs);
+
+    // A few points per pixel at most
+    QVERIFY((int) decimatedData->size() <= 8 * WIDTH + 100);
+
+    // The smallest and largest values of each column are kept
+    int mismatches = 0;
+    for (int x = 0; x < WIDTH; x++) {
+        int fullTop, fullBottom, decimatedTop, decimatedBottom;
+        bool fullDrawn = columnExtent(full, x, &fullTop, &fullBottom);
+        bool decimatedDrawn = columnExtent(decimated, x, &decimatedTop, &decimatedBottom);
+        if (fullDrawn != decimatedDrawn || (fullDrawn && (qAbs(fullTop - decimatedTop) > 2 || qAbs(fullBottom - decimatedBottom) > 2)))
+            mismatches++;
+    }
+    QVERIFY2(mismatches <= WIDTH / 100, qPrintable(QString("%1 columns differ").arg(mismatches)));
+}
+
+QTEST_MAIN(tst_PlotRenderBenchmark)
+
+#include "tst_plotrenderbenchmark.moc"
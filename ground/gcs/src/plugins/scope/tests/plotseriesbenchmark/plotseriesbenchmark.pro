@@ -0,0 +1,21 @@
+# Cost per sample of appending to a scope curve with the standard deviation
+# scope math, for windows up to a minute at 500 Hz, with the ring buffers and
+# with the vectors used before. The number of samples appended for each
+# window, 1000000 by default, can be set with the PLOTSERIES_BENCH_SAMPLES
+# environment variable.
+
+QT += testlib
+QT -= gui
+TARGET = plotseriesbenchmark
+CONFIG += console testcase
+CONFIG -= app_bundle
+TEMPLATE = app
+
+include(../../../../../gcs.pri)
+include(../../../../libs/qwt/qwt.pri)
+
+INCLUDEPATH *= ../..
+
+HEADERS += ../../scopes2d/plotseries.h
+SOURCES += tst_plotseriesbenchmark.cpp \
+    ../../scopes2d/plotseries.cpp
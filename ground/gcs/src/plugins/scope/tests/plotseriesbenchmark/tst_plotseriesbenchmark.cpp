@@ -0,0 +1,230 @@
+/**
+ ******************************************************************************
+ * @file       tst_plotseriesbenchmark.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @brief Measures the cost per sample of a time series curve with the
+ * standard deviation scope math against the window size, and checks the
+ * running statistics and the series data handed to the curves
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <QtTest/QtTest>
+#include <QElapsedTimer>
+#include <math.h>
+
+#include "scopes2d/plotseries.h"
+
+class tst_PlotSeriesBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void appendSamples_data();
+    void appendSamples();
+    void statisticsMatchWindow();
+    void seriesDataReadsInPlace();
+
+private:
+    int m_samples;
+};
+
+//! Rate of the plotted object
+static const double SAMPLE_RATE_HZ = 500;
+//! Most window updates of the vectors, which cost as much as the window is wide
+static const double VECTOR_WORK = 2e8;
+
+static double sampleValue(int i)
+{
+    return 100.0 + 10.0 * sin(i * 0.01) + (qrand() % 1000) / 1000.0;
+}
+
+/**
+ * Time series curve with the standard deviation of the last window samples,
+ * in vectors as done before: the oldest samples are removed from the front
+ * and the deviation is summed over the whole window for every sample
+ */
+static double appendToVectors(int samples, int window)
+{
+    QVector<double> xData, yData, history;
+    double meanSum = 0;
+    double timeWindow = window / SAMPLE_RATE_HZ;
+
+    for (int i = 0; i < samples; i++) {
+        double value = sampleValue(i);
+        history.append(value);
+        meanSum += value;
+        if (history.size() > window) {
+            meanSum -= history.first();
+            history.pop_front();
+        }
+
+        double mean = meanSum / history.size();
+        double stdSum = 0;
+        for (int j = 0; j < history.size(); j++)
+            stdSum += pow(history.at(j) - mean, 2) / (window - 1);
+
+        yData.append(sqrt(stdSum));
+        xData.append(i / SAMPLE_RATE_HZ);
+        while (xData.last() - xData.first() > timeWindow) {
+            xData.pop_front();
+            yData.pop_front();
+        }
+    }
+
+    return yData.last();
+}
+
+/**
+ * The same curve in a ring buffer with running statistics
+ */
+static double appendToRing(int samples, int window)
+{
+    PlotSeries series;
+    RunningStatistics statistics(window);
+    double timeWindow = window / SAMPLE_RATE_HZ;
+
+    for (int i = 0; i < samples; i++) {
+        statistics.append(sampleValue(i));
+        series.append(QPointF(i / SAMPLE_RATE_HZ, statistics.getStandardDeviation()));
+
+        double newest = series.back().x();
+        while (newest - series.front().x() > timeWindow)
+            series.removeFirst();
+    }
+
+    return series.back().y();
+}
+
+void tst_PlotSeriesBenchmark::initTestCase()
+{
+    m_samples = qgetenv("PLOTSERIES_BENCH_SAMPLES").toInt();
+    if (m_samples <= 0)
+        m_samples = 1000000;
+}
+
+void tst_PlotSeriesBenchmark::appendSamples_data()
+{
+    QTest::addColumn<int>("window");
+
+    QTest::newRow("100") << 100;
+    QTest::newRow("1000") << 1000;
+    QTest::newRow("10000") << 10000;
+    // A minute at the sample rate
+    QTest::newRow("30000") << 30000;
+}
+
+void tst_PlotSeriesBenchmark::appendSamples()
+{
+    QFETCH(int, window);
+
+    // Fewer samples into the vectors for the wide windows, past filling them
+    int vectorSamples = qMin(m_samples, window + qMax((int) (VECTOR_WORK / window), 100));
+
+    qsrand(1);
+    QElapsedTimer timer;
+    timer.start();
+    double vectorLast = appendToVectors(vectorSamples, window);
+    double vectorNs = timer.nsecsElapsed() / (double) vectorSamples;
+
+    qsrand(1);
+    double ringLast = appendToRing(vectorSamples, window);
+    QVERIFY(fabs(ringLast - vectorLast) < 1e-6 * qMax(1.0, fabs(vectorLast)));
+
+    qsrand(1);
+    timer.start();
+    appendToRing(m_samples, window);
+    double ringNs = timer.nsecsElapsed() / (double) m_samples;
+
+    qDebug("Window of %6d samples: vectors %10.0f ns/sample, ring %6.0f ns/sample", window, vectorNs, ringNs);
+}
+
+/**
+ * The running mean and standard deviation match the ones computed from the
+ * samples in the window, also after many times the window
+ */
+void tst_PlotSeriesBenchmark::statisticsMatchWindow()
+{
+    const int windows[] = {1, 2, 7, 1000};
+
+    for (unsigned int w = 0; w < sizeof(windows) / sizeof(windows[0]); w++) {
+        int window = windows[w];
+        RunningStatistics statistics(window);
+        QVector<double> values;
+
+        qsrand(2);
+        for (int i = 0; i < 20 * window + 3; i++) {
+            double value = 1e4 + sampleValue(i);
+            statistics.append(value);
+            values.append(value);
+        }
+        values.remove(0, values.size() - window);
+
+        double mean = 0;
+        foreach (double value, values)
+            mean += value / values.size();
+        double squaresSum = 0;
+        foreach (double value, values)
+            squaresSum += (value - mean) * (value - mean);
+        double deviation = window > 1 ? sqrt(squaresSum / (window - 1)) : 0;
+
+        QCOMPARE(statistics.getCount(), window);
+        QVERIFY(fabs(statistics.getMean() - mean) < 1e-6);
+        QVERIFY(fabs(statistics.getStandardDeviation() - deviation) < 1e-6);
+    }
+}
+
+/**
+ * The series data reads the points in the ring, oldest first, and follows
+ * the changes to it
+ */
+void tst_PlotSeriesBenchmark::seriesDataReadsInPlace()
+{
+    PlotSeries series(4, false);
+    PlotSeriesData data(&series);
+    PlotSeriesData indexed(&series, true);
+
+    for (int i = 0; i < 6; i++)
+        series.append(QPointF(10 + i, i * i));
+
+    QCOMPARE((int) data.size(), 4);
+    QCOMPARE(data.sample(0), QPointF(12, 4));
+    QCOMPARE(data.sample(3), QPointF(15, 25));
+    QCOMPARE(indexed.sample(3), QPointF(3, 25));
+    QCOMPARE(data.boundingRect(), QRectF(12, 4, 3, 21));
+    QCOMPARE(indexed.boundingRect(), QRectF(0, 4, 3, 21));
+
+    series.removeFirst(2);
+    QCOMPARE((int) data.size(), 2);
+    QCOMPARE(data.sample(0), QPointF(14, 16));
+    QCOMPARE(data.boundingRect(), QRectF(14, 16, 1, 9));
+
+    PlotSeries growing;
+    PlotSeriesData growingData(&growing);
+    for (int i = 0; i < 5000; i++)
+        growing.append(QPointF(i, -i));
+    growing.removeFirst(4000);
+    for (int i = 5000; i < 7000; i++)
+        growing.append(QPointF(i, -i));
+    QCOMPARE((int) growingData.size(), 3000);
+    for (int i = 0; i < 3000; i++)
+        QCOMPARE(growingData.sample(i).x(), 4000.0 + i);
+}
+
+QTEST_MAIN(tst_PlotSeriesBenchmark)
+
+#include "tst_plotseriesbenchmark.moc"
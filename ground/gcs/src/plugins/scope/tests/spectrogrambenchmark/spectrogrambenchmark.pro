@@ -0,0 +1,19 @@
+# Rows per second appended to a spectrogram with a full time horizon, for
+# several row widths, with the ring buffer and with the matrix copied on
+# every replot used before. The number of rows appended, 100000 by default,
+# can be set with the SPECTROGRAM_BENCH_ROWS environment variable.
+
+QT += testlib
+TARGET = spectrogrambenchmark
+CONFIG += console testcase
+CONFIG -= app_bundle
+TEMPLATE = app
+
+include(../../../../../gcs.pri)
+include(../../../../libs/qwt/qwt.pri)
+
+INCLUDEPATH *= ../..
+
+HEADERS += ../../scopes3d/spectrogramrasterdata.h
+SOURCES += tst_spectrogrambenchmark.cpp \
+    ../../scopes3d/spectrogramrasterdata.cpp
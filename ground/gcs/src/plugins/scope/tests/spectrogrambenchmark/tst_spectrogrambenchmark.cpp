@@ -0,0 +1,184 @@
+/**
+ ******************************************************************************
+ * @file       tst_spectrogrambenchmark.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @brief Measures how many rows per second a spectrogram with a full time
+ * horizon takes, and checks the raster reads the rows in place after the
+ * ring buffer wrapped and grew
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <QtTest/QtTest>
+#include <QElapsedTimer>
+
+#include "qwt/src/qwt_matrix_raster_data.h"
+#include "scopes3d/spectrogramrasterdata.h"
+
+class tst_SpectrogramBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void appendRows_data();
+    void appendRows();
+    void rasterReadsRows();
+
+private:
+    int m_rows;
+};
+
+//! Rows in the time horizon
+static const int HORIZON_ROWS = 2000;
+//! Rows appended between two replots, 500 Hz rows replotted at 20 Hz
+static const int ROWS_PER_REPLOT = 25;
+//! Most values moved in the matrix, which moves all its values for every row
+static const double MATRIX_WORK = 1e9;
+
+/**
+ * Rows in a matrix, as done before: the oldest row is removed from the front
+ * of the matrix and the matrix is copied into the raster on every replot
+ */
+static double appendToMatrix(int rows, int width)
+{
+    QVector<double> history(HORIZON_ROWS * width, 0);
+    QwtMatrixRasterData raster;
+
+    for (int i = 0; i < rows; i++) {
+        QVector<double> values;
+        for (int j = 0; j < width; j++)
+            values += i + j;
+
+        history.remove(0, width);
+        history << values;
+
+        if (i % ROWS_PER_REPLOT == 0)
+            raster.setValueMatrix(history, width);
+    }
+
+    return raster.valueMatrix().last();
+}
+
+/**
+ * Rows in the ring buffer of the raster
+ */
+static double appendToRing(int rows, int width)
+{
+    SpectrogramRasterData raster(width);
+    for (int i = 0; i < HORIZON_ROWS; i++)
+        raster.appendRow(i - HORIZON_ROWS);
+
+    for (int i = 0; i < rows; i++) {
+        raster.removeFirstRows();
+        double *values = raster.appendRow(i);
+        for (int j = 0; j < width; j++)
+            values[j] = i + j;
+    }
+
+    return raster.getRow(raster.numRows() - 1)[width - 1];
+}
+
+void tst_SpectrogramBenchmark::initTestCase()
+{
+    m_rows = qgetenv("SPECTROGRAM_BENCH_ROWS").toInt();
+    if (m_rows <= 0)
+        m_rows = 100000;
+}
+
+void tst_SpectrogramBenchmark::appendRows_data()
+{
+    QTest::addColumn<int>("width");
+
+    QTest::newRow("64") << 64;
+    QTest::newRow("256") << 256;
+    QTest::newRow("1024") << 1024;
+}
+
+void tst_SpectrogramBenchmark::appendRows()
+{
+    QFETCH(int, width);
+
+    // Fewer rows into the matrix for the wide rows
+    int matrixRows = qMin(m_rows, qMax((int) (MATRIX_WORK / HORIZON_ROWS / width), 100));
+
+    QElapsedTimer timer;
+    timer.start();
+    double matrixLast = appendToMatrix(matrixRows, width);
+    double matrixRate = matrixRows / (timer.nsecsElapsed() / 1e9);
+
+    timer.start();
+    double ringLast = appendToRing(m_rows, width);
+    double ringRate = m_rows / (timer.nsecsElapsed() / 1e9);
+
+    qDebug("Rows of %4d values: matrix %8.0f rows/s, ring %9.0f rows/s", width, matrixRate, ringRate);
+
+    // The matrix is copied every few rows, its last row may be older
+    QVERIFY(matrixLast > matrixRows - ROWS_PER_REPLOT - 1 && matrixLast <= matrixRows - 1 + width - 1);
+    QCOMPARE(ringLast, (double) (m_rows - 1 + width - 1));
+}
+
+/**
+ * The value at each cell is the one of its row, counted from the oldest row
+ * at the bottom of the y interval, after the ring wrapped and grew
+ */
+void tst_SpectrogramBenchmark::rasterReadsRows()
+{
+    const int width = 8;
+    SpectrogramRasterData raster(width);
+    raster.setInterval(Qt::XAxis, QwtInterval(0, 100));
+    raster.setInterval(Qt::YAxis, QwtInterval(0, 10));
+
+    QVERIFY(qIsNaN(raster.value(50, 5)));
+
+    int appended = 0;
+    for (int i = 0; i < 50; i++, appended++) {
+        double *values = raster.appendRow(appended);
+        for (int j = 0; j < width; j++)
+            values[j] = appended * 100 + j;
+    }
+    raster.removeFirstRows(40);
+    for (int i = 0; i < 90; i++, appended++) {
+        double *values = raster.appendRow(appended);
+        for (int j = 0; j < width; j++)
+            values[j] = appended * 100 + j;
+    }
+    raster.removeFirstRows(20);
+
+    // Rows 60 to 139
+    const int rows = raster.numRows();
+    QCOMPARE(rows, 80);
+    QCOMPARE(raster.getRowTime(0), 60.0);
+    for (int row = 0; row < rows; row++) {
+        for (int col = 0; col < width; col++) {
+            double x = (col + 0.5) * 100.0 / width;
+            double y = (row + 0.5) * 10.0 / rows;
+            QCOMPARE(raster.value(x, y), (60.0 + row) * 100 + col);
+        }
+    }
+
+    // The ends of the intervals are in the last row and column
+    QCOMPARE(raster.value(100, 10), 139.0 * 100 + width - 1);
+    QVERIFY(qIsNaN(raster.value(100.1, 5)));
+
+    QRectF hint = raster.pixelHint(QRectF());
+    QCOMPARE(hint.width(), 100.0 / width);
+    QCOMPARE(hint.height(), 10.0 / rows);
+}
+
+QTEST_MAIN(tst_SpectrogramBenchmark)
+
+#include "tst_spectrogrambenchmark.moc"
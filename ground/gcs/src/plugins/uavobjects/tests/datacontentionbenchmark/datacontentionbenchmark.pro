@@ -0,0 +1,19 @@
+# Updates/s of a decoder thread unpacking an object while reader threads
+# copy its data, holding the object lock as before and through the
+# lock-free snapshots. The duration of each run is set with
+# DATACONTENTION_BENCH_MS.
+
+QT += testlib
+QT -= gui
+TARGET = datacontentionbenchmark
+CONFIG += console testcase
+CONFIG -= app_bundle
+TEMPLATE = app
+
+include(../../../../../gcs.pri)
+
+INCLUDEPATH *= $$GCS_SOURCE_TREE/src/plugins
+LIBS += -L$$GCS_PLUGIN_PATH/TauLabs
+include(../../uavobjects.pri)
+
+SOURCES += tst_datacontentionbenchmark.cpp
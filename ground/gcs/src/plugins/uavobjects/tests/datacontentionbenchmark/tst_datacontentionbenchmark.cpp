@@ -0,0 +1,222 @@
+/**
+ ******************************************************************************
+ * @file       tst_datacontentionbenchmark.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVObjectsPlugin UAVObjects Plugin
+ * @{
+ * @brief Measures how fast a decoder thread unpacks an object while other
+ * threads read it, holding the object lock and through the lock-free
+ * snapshots, and checks the readers never copy a torn update
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <QtTest/QtTest>
+#include <QElapsedTimer>
+#include <QThread>
+
+#include "uavobjectmanager.h"
+#include "uavobjectsinit.h"
+#include "attitudeactual.h"
+
+/**
+ * Unpacks the object as the telemetry decoding does, with every field set
+ * to the number of the update
+ */
+class DecoderThread : public QThread
+{
+public:
+    DecoderThread(AttitudeActual *obj, QAtomicInt *stop) : updates(0), obj(obj), stop(stop) {}
+
+    quint64 updates;
+
+protected:
+    void run()
+    {
+        AttitudeActual::DataFields fields;
+        while (!stop->loadAcquire()) {
+            float value = ++updates;
+            fields.q1 = fields.q2 = fields.q3 = fields.q4 = value;
+            fields.Roll = fields.Pitch = fields.Yaw = value;
+            obj->unpack((const quint8 *) &fields);
+        }
+    }
+
+private:
+    AttitudeActual *obj;
+    QAtomicInt *stop;
+};
+
+/**
+ * Copies the data of the object as the scope, PFD or logging do, and counts
+ * the copies mixing two updates
+ */
+class ReaderThread : public QThread
+{
+public:
+    ReaderThread(AttitudeActual *obj, QAtomicInt *stop, bool locked) :
+        reads(0), tornReads(0), obj(obj), stop(stop), locked(locked) {}
+
+    quint64 reads;
+    quint64 tornReads;
+
+protected:
+    void run()
+    {
+        AttitudeActual::DataFields fields;
+        while (!stop->loadAcquire()) {
+            if (locked) {
+                QMutexLocker locker(obj->getMutex());
+                fields = obj->getData();
+            } else {
+                fields = obj->getData();
+            }
+            if (fields.q1 != fields.Yaw || fields.q4 != fields.Roll)
+                tornReads++;
+            reads++;
+        }
+    }
+
+private:
+    AttitudeActual *obj;
+    QAtomicInt *stop;
+    bool locked;
+};
+
+class tst_DataContentionBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void contention_data();
+    void contention();
+    void fieldReadsMatchData();
+
+private:
+    UAVObjectManager *m_objMngr;
+    AttitudeActual *m_obj;
+    int m_durationMs;
+};
+
+void tst_DataContentionBenchmark::initTestCase()
+{
+    m_durationMs = qgetenv("DATACONTENTION_BENCH_MS").toInt();
+    if (m_durationMs <= 0)
+        m_durationMs = 500;
+
+    m_objMngr = new UAVObjectManager();
+    UAVObjectsInitialize(m_objMngr);
+    m_obj = AttitudeActual::GetInstance(m_objMngr);
+    QVERIFY(m_obj != NULL);
+
+    // The updates would be queued to this thread, which is not running its event loop
+    m_obj->blockSignals(true);
+}
+
+void tst_DataContentionBenchmark::cleanupTestCase()
+{
+    delete m_objMngr;
+}
+
+void tst_DataContentionBenchmark::contention_data()
+{
+    QTest::addColumn<int>("readers");
+    QTest::addColumn<bool>("locked");
+
+    const int readers[] = {0, 1, 2, 4};
+    for (unsigned int i = 0; i < sizeof(readers) / sizeof(readers[0]); i++) {
+        QTest::newRow(qPrintable(QString("%1 locked readers").arg(readers[i]))) << readers[i] << true;
+        QTest::newRow(qPrintable(QString("%1 snapshot readers").arg(readers[i]))) << readers[i] << false;
+    }
+}
+
+void tst_DataContentionBenchmark::contention()
+{
+    QFETCH(int, readers);
+    QFETCH(bool, locked);
+
+    QAtomicInt stop(0);
+    DecoderThread decoder(m_obj, &stop);
+    QList<ReaderThread *> readerThreads;
+    for (int i = 0; i < readers; i++)
+        readerThreads << new ReaderThread(m_obj, &stop, locked);
+
+    QElapsedTimer timer;
+    timer.start();
+    decoder.start();
+    foreach (ReaderThread *reader, readerThreads)
+        reader->start();
+    QTest::qSleep(m_durationMs);
+    stop.storeRelease(1);
+    decoder.wait();
+    foreach (ReaderThread *reader, readerThreads)
+        reader->wait();
+    double seconds = timer.nsecsElapsed() / 1e9;
+
+    quint64 reads = 0;
+    quint64 tornReads = 0;
+    foreach (ReaderThread *reader, readerThreads) {
+        reads += reader->reads;
+        tornReads += reader->tornReads;
+    }
+    qDeleteAll(readerThreads);
+
+    qDebug("%d %s readers: %9.0f updates/s, %10.0f reads/s", readers, locked ? "locked  " : "snapshot",
+           decoder.updates / seconds, reads / seconds);
+
+    QVERIFY(decoder.updates > 0);
+    QCOMPARE(tornReads, (quint64) 0);
+}
+
+/**
+ * The field getters, the property getters and pack() read the data set by
+ * the writers
+ */
+void tst_DataContentionBenchmark::fieldReadsMatchData()
+{
+    AttitudeActual::DataFields fields = m_obj->getData();
+    fields.Roll = 12.5;
+    fields.Yaw = -3;
+    m_obj->setData(fields);
+
+    QCOMPARE(m_obj->getRoll(), 12.5f);
+    QCOMPARE(m_obj->getField("Yaw")->getDouble(), -3.0);
+    UAVObjectFieldHandle yaw = UAVObjectFieldHandle::resolve(m_obj, "Yaw");
+    QCOMPARE(yaw.getDouble(), -3.0);
+
+    m_obj->getField("Pitch")->setDouble(7);
+    QCOMPARE(m_obj->getData().Pitch, 7.0f);
+    m_obj->setq1(0.5);
+    float q1;
+    QCOMPARE(m_obj->getField("q1")->getFloats(&q1, 1), (quint32) 1);
+    QCOMPARE(q1, 0.5f);
+
+    QByteArray packed(m_obj->getNumBytes(), 0);
+    m_obj->pack((quint8 *) packed.data());
+    AttitudeActual::DataFields unpacked;
+    memcpy(&unpacked, packed.constData(), sizeof(unpacked));
+    QCOMPARE(unpacked.Roll, 12.5f);
+    QCOMPARE(unpacked.Pitch, 7.0f);
+    QCOMPARE(unpacked.q1, 0.5f);
+}
+
+QTEST_MAIN(tst_DataContentionBenchmark)
+
+#include "tst_datacontentionbenchmark.moc"
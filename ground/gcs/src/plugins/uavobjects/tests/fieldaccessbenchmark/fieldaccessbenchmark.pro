@@ -0,0 +1,17 @@
+# Per sample cost of reading field values the way the scope curves do,
+# through QVariant and by name, and through pre-resolved field handles.
+
+QT += testlib
+QT -= gui
+TARGET = fieldaccessbenchmark
+CONFIG += console testcase
+CONFIG -= app_bundle
+TEMPLATE = app
+
+include(../../../../../gcs.pri)
+
+INCLUDEPATH *= $$GCS_SOURCE_TREE/src/plugins
+LIBS += -L$$GCS_PLUGIN_PATH/TauLabs
+include(../../uavobjects.pri)
+
+SOURCES += tst_fieldaccessbenchmark.cpp
@@ -0,0 +1,248 @@
+/**
+ ******************************************************************************
+ * @file       tst_fieldaccessbenchmark.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVObjectsPlugin UAVObjects Plugin
+ * @{
+ * @brief Compares the samples/s a scope curve can read from a field through
+ * getValue() and the element name (the previous implementation) and through
+ * UAVObjectFieldHandle, and checks that both read the same values
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <QtTest/QtTest>
+#include <QElapsedTimer>
+
+#include "uavobjectmanager.h"
+#include "uavobjectsinit.h"
+
+class tst_FieldAccessBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void handlesMatchVariant();
+    void enumsReadAsOptionIndex();
+    void batchMatchesVariant();
+    void samplesVariant();
+    void samplesHandle();
+    void arrayVariant();
+    void arrayBatch();
+
+private:
+    double variantSample(UAVObject *obj);
+    void reportRate(const char *label, quint32 samples, qint64 nsecs);
+
+    UAVObjectManager *m_objMngr;
+    UAVObject *m_obj;
+    UAVObjectField *m_array;
+};
+
+//! Samples read per timed run
+static const quint32 SAMPLES = 200000;
+
+void tst_FieldAccessBenchmark::initTestCase()
+{
+    m_objMngr = new UAVObjectManager();
+    UAVObjectsInitialize(m_objMngr);
+
+    m_obj = m_objMngr->getObject("StabilizationSettings");
+    QVERIFY(m_obj != NULL);
+    QVERIFY(m_obj->getField("RollRatePID") != NULL);
+    m_obj->getField("RollRatePID")->setDouble(0.01, 1);
+
+    UAVObject *actuator = m_objMngr->getObject("ActuatorCommand");
+    QVERIFY(actuator != NULL);
+    m_array = actuator->getField("Channel");
+    QVERIFY(m_array != NULL);
+    for (quint32 n = 0; n < m_array->getNumElements(); ++n)
+        m_array->setDouble(1000 + n, n);
+}
+
+void tst_FieldAccessBenchmark::cleanupTestCase()
+{
+    delete m_objMngr;
+}
+
+void tst_FieldAccessBenchmark::reportRate(const char *label, quint32 samples, qint64 nsecs)
+{
+    qDebug("%s: %u samples in %.3f ms, %.0f samples/s", label, samples,
+           nsecs / 1e6, samples / (nsecs / 1e9));
+}
+
+/**
+ * Read a sample as the scope curves did before the field handles: look the
+ * field and element up by name and convert the QVariant.
+ */
+double tst_FieldAccessBenchmark::variantSample(UAVObject *obj)
+{
+    UAVObjectField *field = obj->getField("RollRatePID");
+    int index = field->getElementNames().indexOf(QRegExp("Ki", Qt::CaseSensitive, QRegExp::FixedString));
+    return field->getValue(index).toDouble();
+}
+
+/**
+ * Every numeric element of every object reads the same through a handle and
+ * through getValue()
+ */
+void tst_FieldAccessBenchmark::handlesMatchVariant()
+{
+    int checked = 0;
+    foreach (QVector<UAVObject*> instances, m_objMngr->getObjectsVector()) {
+        foreach (UAVObjectField *field, instances.first()->getFields()) {
+            if (!field->isNumeric())
+                continue;
+            for (quint32 n = 0; n < field->getNumElements(); ++n) {
+                UAVObjectFieldHandle handle = UAVObjectFieldHandle::resolve(instances.first(), field->getName(),
+                                                                            field->getElementNames().at(n));
+                QVERIFY(handle.isValid());
+                QCOMPARE(handle.getIndex(), n);
+                QCOMPARE(handle.getDouble(), field->getValue(n).toDouble());
+                QCOMPARE(field->getDouble(n), field->getValue(n).toDouble());
+                ++checked;
+            }
+        }
+    }
+    qDebug("%d elements checked", checked);
+
+    QVERIFY(!UAVObjectFieldHandle::resolve(m_obj, "RollRatePID", "NoSuchElement").isValid());
+    QVERIFY(!UAVObjectFieldHandle().isValid());
+
+    // Handles see the updates made after they were resolved
+    UAVObjectFieldHandle ki = UAVObjectFieldHandle::resolve(m_obj, "RollRatePID", "Ki");
+    m_obj->getField("RollRatePID")->setDouble(0.125, 1);
+    QCOMPARE(ki.getDouble(), 0.125);
+}
+
+/**
+ * Enum elements read as the index of their option from the handles and
+ * getDoubles(), getDouble() still converts them from their text
+ */
+void tst_FieldAccessBenchmark::enumsReadAsOptionIndex()
+{
+    int checked = 0;
+    foreach (QVector<UAVObject*> instances, m_objMngr->getObjectsVector()) {
+        foreach (UAVObjectField *field, instances.first()->getFields()) {
+            if (field->getType() != UAVObjectField::ENUM)
+                continue;
+            QVector<double> doubles(field->getNumElements());
+            QCOMPARE(field->getDoubles(doubles.data(), doubles.size()), field->getNumElements());
+            for (quint32 n = 0; n < field->getNumElements(); ++n) {
+                double option = field->getOptions().indexOf(field->getValue(n).toString());
+                UAVObjectFieldHandle handle(field, n);
+                QCOMPARE(field->getDouble(n), field->getValue(n).toDouble());
+                QCOMPARE(handle.getDouble(), option);
+                QCOMPARE(doubles[n], option);
+                ++checked;
+            }
+        }
+    }
+    qDebug("%d enum elements checked", checked);
+    QVERIFY(checked > 0);
+}
+
+void tst_FieldAccessBenchmark::batchMatchesVariant()
+{
+    quint32 count = m_array->getNumElements();
+    QVector<double> doubles(count + 1, -1);
+    QVector<float> floats(count + 1, -1);
+
+    QCOMPARE(m_array->getDoubles(doubles.data(), count + 1), count);
+    QCOMPARE(m_array->getFloats(floats.data(), count + 1), count);
+    for (quint32 n = 0; n < count; ++n) {
+        QCOMPARE(doubles[n], m_array->getValue(n).toDouble());
+        QCOMPARE(floats[n], m_array->getValue(n).toFloat());
+    }
+    QCOMPARE(doubles[count], -1.0);
+
+    QCOMPARE(m_array->getDoubles(doubles.data(), 2, count - 1), 1u);
+    QCOMPARE(doubles[0], m_array->getValue(count - 1).toDouble());
+    QCOMPARE(m_array->getDoubles(doubles.data(), 1, count), 0u);
+}
+
+void tst_FieldAccessBenchmark::samplesVariant()
+{
+    double sum = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (quint32 n = 0; n < SAMPLES; ++n)
+        sum += variantSample(m_obj);
+    reportRate("variant, by name", SAMPLES, timer.nsecsElapsed());
+    QVERIFY(sum > 0);
+
+    QBENCHMARK {
+        variantSample(m_obj);
+    }
+}
+
+void tst_FieldAccessBenchmark::samplesHandle()
+{
+    UAVObjectFieldHandle handle = UAVObjectFieldHandle::resolve(m_obj, "RollRatePID", "Ki");
+    QVERIFY(handle.isValid());
+
+    double sum = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (quint32 n = 0; n < SAMPLES; ++n)
+        sum += handle.getDouble();
+    reportRate("handle", SAMPLES, timer.nsecsElapsed());
+    QVERIFY(sum > 0);
+
+    QBENCHMARK {
+        handle.getDouble();
+    }
+}
+
+void tst_FieldAccessBenchmark::arrayVariant()
+{
+    quint32 count = m_array->getNumElements();
+    QVector<double> values(count);
+    QElapsedTimer timer;
+    timer.start();
+    for (quint32 n = 0; n < SAMPLES / count; ++n)
+        for (quint32 i = 0; i < count; ++i)
+            values[i] = m_array->getValue(i).toDouble();
+    reportRate("array, variant per element", (SAMPLES / count) * count, timer.nsecsElapsed());
+
+    QBENCHMARK {
+        for (quint32 i = 0; i < count; ++i)
+            values[i] = m_array->getValue(i).toDouble();
+    }
+}
+
+void tst_FieldAccessBenchmark::arrayBatch()
+{
+    quint32 count = m_array->getNumElements();
+    QVector<double> values(count);
+    QElapsedTimer timer;
+    timer.start();
+    for (quint32 n = 0; n < SAMPLES / count; ++n)
+        m_array->getDoubles(values.data(), count);
+    reportRate("array, batch", (SAMPLES / count) * count, timer.nsecsElapsed());
+
+    QBENCHMARK {
+        m_array->getDoubles(values.data(), count);
+    }
+}
+
+QTEST_MAIN(tst_FieldAccessBenchmark)
+
+#include "tst_fieldaccessbenchmark.moc"
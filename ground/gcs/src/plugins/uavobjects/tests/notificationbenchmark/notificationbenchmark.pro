@@ -0,0 +1,19 @@
+# Property change signals emitted by a generated object updated at telemetry
+# rate: every property on every update as before, the changed properties
+# only, and the changed properties coalesced over the notification interval.
+# The duration of the updates is set with NOTIFICATION_BENCH_MS.
+
+QT += testlib
+QT -= gui
+TARGET = notificationbenchmark
+CONFIG += console testcase
+CONFIG -= app_bundle
+TEMPLATE = app
+
+include(../../../../../gcs.pri)
+
+INCLUDEPATH *= $$GCS_SOURCE_TREE/src/plugins
+LIBS += -L$$GCS_PLUGIN_PATH/TauLabs
+include(../../uavobjects.pri)
+
+SOURCES += tst_notificationbenchmark.cpp
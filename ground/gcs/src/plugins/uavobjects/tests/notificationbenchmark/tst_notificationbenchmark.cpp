@@ -0,0 +1,196 @@
+/**
+ ******************************************************************************
+ * @file       tst_notificationbenchmark.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVObjectsPlugin UAVObjects Plugin
+ * @{
+ * @brief Counts the property change signals of a generated object unpacked at
+ * telemetry rate, and checks only the changed fields are notified and the
+ * last values are delivered once the updates are coalesced
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <QtTest/QtTest>
+#include <QElapsedTimer>
+
+#include "uavobjectmanager.h"
+#include "uavobjectsinit.h"
+#include "attitudeactual.h"
+
+/**
+ * Counts the property change signals of an object, as the bindings on its
+ * properties would be evaluated
+ */
+class SignalCounter : public QObject
+{
+    Q_OBJECT
+
+public:
+    SignalCounter(QObject *obj) : notifications(0), lastRoll(0)
+    {
+        const QMetaObject *metaObject = obj->metaObject();
+        const QMetaMethod slot = staticMetaObject.method(staticMetaObject.indexOfSlot("notified()"));
+        for (int i = 0; i < metaObject->propertyCount(); i++) {
+            QMetaProperty property = metaObject->property(i);
+            if (property.hasNotifySignal())
+                connect(obj, property.notifySignal(), this, slot);
+        }
+        connect(obj, SIGNAL(RollChanged(float)), this, SLOT(rollChanged(float)));
+    }
+
+    int notifications;
+    float lastRoll;
+
+public slots:
+    void notified() {notifications++;}
+    void rollChanged(float value) {lastRoll = value;}
+};
+
+class tst_NotificationBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void onlyChangedFieldsNotified();
+    void updatesCoalesced_data();
+    void updatesCoalesced();
+
+private:
+    void unpack(const AttitudeActual::DataFields &fields);
+
+    UAVObjectManager *m_objMngr;
+    AttitudeActual *m_obj;
+    int m_durationMs;
+};
+
+//! Period of the updates, 500 Hz telemetry
+static const int UPDATE_PERIOD_MS = 2;
+
+void tst_NotificationBenchmark::initTestCase()
+{
+    m_durationMs = qgetenv("NOTIFICATION_BENCH_MS").toInt();
+    if (m_durationMs <= 0)
+        m_durationMs = 1000;
+
+    m_objMngr = new UAVObjectManager();
+    UAVObjectsInitialize(m_objMngr);
+    m_obj = AttitudeActual::GetInstance(m_objMngr);
+    QVERIFY(m_obj != NULL);
+}
+
+void tst_NotificationBenchmark::cleanupTestCase()
+{
+    UAVDataObject::setNotificationInterval(20);
+    delete m_objMngr;
+}
+
+/**
+ * Unpack the fields as received from the telemetry link
+ */
+void tst_NotificationBenchmark::unpack(const AttitudeActual::DataFields &fields)
+{
+    m_obj->unpack((const quint8 *) &fields);
+}
+
+void tst_NotificationBenchmark::onlyChangedFieldsNotified()
+{
+    UAVDataObject::setNotificationInterval(0);
+    SignalCounter counter(m_obj);
+
+    AttitudeActual::DataFields fields = m_obj->getData();
+    fields.Roll += 10;
+    unpack(fields);
+    QCOMPARE(counter.notifications, 1);
+    QCOMPARE(counter.lastRoll, fields.Roll);
+
+    // The same data again
+    unpack(fields);
+    QCOMPARE(counter.notifications, 1);
+
+    fields.q1 += 1;
+    fields.q2 += 1;
+    fields.Yaw += 1;
+    unpack(fields);
+    QCOMPARE(counter.notifications, 4);
+
+    // A NaN left as it was is not a change
+    fields.Pitch = qQNaN();
+    unpack(fields);
+    unpack(fields);
+    QCOMPARE(counter.notifications, 5);
+
+    // Setting a property notifies it once, not again on the next update
+    m_obj->setRoll(fields.Roll + 1);
+    QCOMPARE(counter.notifications, 6);
+    m_obj->updated();
+    QCOMPARE(counter.notifications, 6);
+}
+
+void tst_NotificationBenchmark::updatesCoalesced_data()
+{
+    QTest::addColumn<int>("interval");
+
+    QTest::newRow("every update") << 0;
+    QTest::newRow("20 ms") << 20;
+    QTest::newRow("50 ms") << 50;
+}
+
+/**
+ * All the angles of the attitude change on every update, as in flight
+ */
+void tst_NotificationBenchmark::updatesCoalesced()
+{
+    QFETCH(int, interval);
+
+    UAVDataObject::setNotificationInterval(interval);
+    QTest::qWait(100);
+    SignalCounter counter(m_obj);
+    int properties = m_obj->metaObject()->propertyCount() - m_obj->metaObject()->propertyOffset();
+
+    AttitudeActual::DataFields fields = m_obj->getData();
+    int updates = 0;
+    QElapsedTimer timer;
+    timer.start();
+    while (timer.elapsed() < m_durationMs) {
+        updates++;
+        fields.q1 = fields.q2 = fields.q3 = fields.q4 = updates * 0.001f;
+        fields.Roll = fields.Pitch = fields.Yaw = updates * 0.1f;
+        unpack(fields);
+        QCoreApplication::processEvents();
+        QTest::qSleep(UPDATE_PERIOD_MS);
+    }
+    double seconds = timer.elapsed() / 1000.0;
+    QTest::qWait(2 * interval + 10);
+
+    qDebug("%4d updates/s, %2d ms interval: %6.0f signals/s, %6.0f signals/s notifying every property",
+           (int) (updates / seconds), interval, counter.notifications / seconds, updates * properties / seconds);
+
+    // The last values are notified
+    QCOMPARE(counter.lastRoll, fields.Roll);
+    if (interval == 0)
+        QCOMPARE(counter.notifications, updates * properties);
+    else
+        QVERIFY(counter.notifications <= properties * (int) (seconds * 1000 / interval + 2));
+}
+
+QTEST_MAIN(tst_NotificationBenchmark)
+
+#include "tst_notificationbenchmark.moc"
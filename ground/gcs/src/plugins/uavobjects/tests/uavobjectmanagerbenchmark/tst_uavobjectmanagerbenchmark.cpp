@@ -0,0 +1,201 @@
+/**
+ ******************************************************************************
+ * @file       tst_uavobjectmanagerbenchmark.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVObjectsPlugin UAVObjects Plugin
+ * @{
+ * @brief Compares the cost of object lookups by name and of getting all
+ * objects, using a linear scan (the previous implementation) and the index
+ * and snapshot of the UAVObjectManager
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <QtTest/QtTest>
+
+#include "uavobjectmanager.h"
+#include "uavobjectsinit.h"
+
+class tst_UAVObjectManagerBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void indexMatchesScan();
+    void snapshotIsShared();
+    void lookupByNameScan();
+    void lookupByNameIndexed();
+    void numInstancesScan();
+    void numInstancesIndexed();
+    void dataObjectsRebuilt();
+    void dataObjectsSnapshot();
+
+private:
+    UAVObject *scanObject(const QString &name, quint32 instId = 0);
+    qint32 scanNumInstances(const QString &name);
+    QVector< QVector<UAVDataObject*> > scanDataObjects();
+
+    UAVObjectManager *m_objMngr;
+    QStringList m_names;
+};
+
+void tst_UAVObjectManagerBenchmark::initTestCase()
+{
+    m_objMngr = new UAVObjectManager();
+    UAVObjectsInitialize(m_objMngr);
+
+    foreach (QVector<UAVObject*> instances, m_objMngr->getObjectsVector())
+        m_names.append(instances.first()->getName());
+    qDebug("%d object types registered", m_names.size());
+    QVERIFY(m_names.size() > 100);
+}
+
+void tst_UAVObjectManagerBenchmark::cleanupTestCase()
+{
+    delete m_objMngr;
+}
+
+/**
+ * Lookup as done before the name index: copy every instance map and compare
+ * names until a match is found.
+ */
+UAVObject *tst_UAVObjectManagerBenchmark::scanObject(const QString &name, quint32 instId)
+{
+    foreach (UAVObjectManager::ObjectMap map, m_objMngr->getObjects()) {
+        if (map.first()->getName().compare(name) == 0)
+            return map.value(instId, NULL);
+    }
+    return NULL;
+}
+
+qint32 tst_UAVObjectManagerBenchmark::scanNumInstances(const QString &name)
+{
+    foreach (UAVObjectManager::ObjectMap map, m_objMngr->getObjects()) {
+        if (map.first()->getName().compare(name) == 0)
+            return map.count();
+    }
+    return -1;
+}
+
+QVector< QVector<UAVDataObject*> > tst_UAVObjectManagerBenchmark::scanDataObjects()
+{
+    QVector< QVector<UAVDataObject*> > vector;
+    foreach (UAVObjectManager::ObjectMap map, m_objMngr->getObjects().values()) {
+        UAVDataObject *obj = dynamic_cast<UAVDataObject*>(map.first());
+        if (obj != NULL) {
+            QVector<UAVDataObject*> vec;
+            foreach (UAVObject *o, map) {
+                UAVDataObject *dobj = dynamic_cast<UAVDataObject*>(o);
+                if (dobj)
+                    vec.append(dobj);
+            }
+            vector.append(vec);
+        }
+    }
+    return vector;
+}
+
+void tst_UAVObjectManagerBenchmark::indexMatchesScan()
+{
+    foreach (const QString &name, m_names) {
+        QCOMPARE(m_objMngr->getObject(name), scanObject(name));
+        QCOMPARE(m_objMngr->getNumInstances(name), scanNumInstances(name));
+        QCOMPARE(m_objMngr->getObjectInstancesVector(name).size(), scanNumInstances(name));
+    }
+    QVERIFY(m_objMngr->getObject(QString("NoSuchObject")) == NULL);
+    QCOMPARE(m_objMngr->getNumInstances(QString("NoSuchObject")), -1);
+    QCOMPARE(m_objMngr->getDataObjectsVector(), scanDataObjects());
+}
+
+void tst_UAVObjectManagerBenchmark::snapshotIsShared()
+{
+    UAVObjectManager::SnapshotPtr first = m_objMngr->getSnapshot();
+    UAVObjectManager::SnapshotPtr second = m_objMngr->getSnapshot();
+    QCOMPARE(first.data(), second.data());
+    QCOMPARE(first->version, m_objMngr->getVersion());
+
+    // Registering a new instance publishes a new snapshot, the old one stays valid
+    UAVDataObject *multi = NULL;
+    foreach (QVector<UAVDataObject*> instances, first->dataObjects) {
+        if (!instances.first()->isSingleInstance()) {
+            multi = instances.first();
+            break;
+        }
+    }
+    if (multi == NULL)
+        QSKIP("No multi-instance object available");
+    quint32 instances = m_objMngr->getNumInstances(multi->getObjID());
+    QVERIFY(m_objMngr->registerObject(multi->clone(instances)));
+
+    UAVObjectManager::SnapshotPtr third = m_objMngr->getSnapshot();
+    QVERIFY(third.data() != first.data());
+    QVERIFY(third->version != first->version);
+    QCOMPARE(first->objects.size(), third->objects.size());
+}
+
+void tst_UAVObjectManagerBenchmark::lookupByNameScan()
+{
+    QBENCHMARK {
+        foreach (const QString &name, m_names)
+            scanObject(name);
+    }
+}
+
+void tst_UAVObjectManagerBenchmark::lookupByNameIndexed()
+{
+    QBENCHMARK {
+        foreach (const QString &name, m_names)
+            m_objMngr->getObject(name);
+    }
+}
+
+void tst_UAVObjectManagerBenchmark::numInstancesScan()
+{
+    QBENCHMARK {
+        foreach (const QString &name, m_names)
+            scanNumInstances(name);
+    }
+}
+
+void tst_UAVObjectManagerBenchmark::numInstancesIndexed()
+{
+    QBENCHMARK {
+        foreach (const QString &name, m_names)
+            m_objMngr->getNumInstances(name);
+    }
+}
+
+void tst_UAVObjectManagerBenchmark::dataObjectsRebuilt()
+{
+    QBENCHMARK {
+        scanDataObjects();
+    }
+}
+
+void tst_UAVObjectManagerBenchmark::dataObjectsSnapshot()
+{
+    QBENCHMARK {
+        m_objMngr->getSnapshot();
+    }
+}
+
+QTEST_MAIN(tst_UAVObjectManagerBenchmark)
+
+#include "tst_uavobjectmanagerbenchmark.moc"
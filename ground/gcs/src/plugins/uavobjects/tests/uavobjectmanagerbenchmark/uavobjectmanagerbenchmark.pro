@@ -0,0 +1,17 @@
+# Lookup cost benchmark for the UAVObjectManager, using the full set of
+# objects generated from shared/uavobjectdefinition.
+
+QT += testlib
+QT -= gui
+TARGET = uavobjectmanagerbenchmark
+CONFIG += console testcase
+CONFIG -= app_bundle
+TEMPLATE = app
+
+include(../../../../../gcs.pri)
+
+INCLUDEPATH *= $$GCS_SOURCE_TREE/src/plugins
+LIBS += -L$$GCS_PLUGIN_PATH/TauLabs
+include(../../uavobjects.pri)
+
+SOURCES += tst_uavobjectmanagerbenchmark.cpp
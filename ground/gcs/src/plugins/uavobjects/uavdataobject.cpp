@@ -27,6 +27,9 @@
  * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
  */
 #include "uavdataobject.h"
+#include <QTimer>
+
+int UAVDataObject::notificationInterval = 20;
 
 /**
  * Constructor
@@ -37,6 +40,9 @@ UAVDataObject::UAVDataObject(quint32 objID, bool isSingleInst, bool isSet,const
     mobj = NULL;
     this->isSet = isSet;
     this->isPresentOnHardware = false;
+    notificationTimer = NULL;
+
+    connect(this, SIGNAL(objectUpdated(UAVObject*)), this, SLOT(requestNotifications()));
 }
 
 /**
@@ -112,4 +118,56 @@ void UAVDataObject::setIsPresentOnHardware(bool value)
         emit presentOnHardwareChanged(this);
 }
 
+/**
+ * Set the shortest time between two notifications of the changed fields of
+ * the objects. The updates received in between are coalesced into a single
+ * notification of the fields they changed. 0 notifies on every update.
+ */
+void UAVDataObject::setNotificationInterval(int ms)
+{
+    notificationInterval = qMax(ms, 0);
+}
+
+int UAVDataObject::getNotificationInterval()
+{
+    return notificationInterval;
+}
+
+/**
+ * Emit the change signals of the fields changed since the last notification,
+ * implemented by the generated objects
+ */
+void UAVDataObject::emitNotifications()
+{
+}
+
+/**
+ * Notify the changed fields after an update, right away if the last
+ * notification is older than the interval, otherwise once it has elapsed
+ */
+void UAVDataObject::requestNotifications()
+{
+    if (notificationTimer != NULL && notificationTimer->isActive())
+        return;
+
+    qint64 elapsed = lastNotification.isValid() ? lastNotification.elapsed() : notificationInterval;
+    if (elapsed >= notificationInterval) {
+        emitPendingNotifications();
+        return;
+    }
+
+    if (notificationTimer == NULL) {
+        notificationTimer = new QTimer(this);
+        notificationTimer->setSingleShot(true);
+        connect(notificationTimer, SIGNAL(timeout()), this, SLOT(emitPendingNotifications()));
+    }
+    notificationTimer->start(notificationInterval - elapsed);
+}
+
+void UAVDataObject::emitPendingNotifications()
+{
+    lastNotification.start();
+    emitNotifications();
+}
+
 
@@ -34,6 +34,9 @@
 #include "uavobjectfield.h"
 #include "uavmetaobject.h"
 #include <QList>
+#include <QElapsedTimer>
+
+class QTimer;
 
 class UAVOBJECTS_EXPORT UAVDataObject: public UAVObject
 {
@@ -53,14 +56,30 @@ public:
     bool getIsPresentOnHardware() const;
     void setIsPresentOnHardware(bool value);
 
+    static void setNotificationInterval(int ms);
+    static int getNotificationInterval();
+
 signals:
     void presentOnHardwareChanged(UAVDataObject*);
 
+protected:
+    virtual void emitNotifications();
+
+private slots:
+    void requestNotifications();
+    void emitPendingNotifications();
+
 private:
     UAVMetaObject* mobj;
     bool isSet;
     bool isPresentOnHardware;
 
+    //! Created on the first update coalesced with the previous notifications
+    QTimer* notificationTimer;
+    QElapsedTimer lastNotification;
+    //! Shortest time between two notifications of the changed fields of an object
+    static int notificationInterval;
+
 };
 
 #endif // UAVDATAOBJECT_H
@@ -92,7 +92,10 @@ UAVObject::Metadata UAVMetaObject::getDefaultMetadata()
 void UAVMetaObject::setData(const Metadata& mdata)
 {
     QMutexLocker locker(mutex);
-    parentMetadata = mdata;
+    {
+        WriteLocker writeLocker(this);
+        parentMetadata = mdata;
+    }
     emit objectUpdatedAuto(this); // trigger object updated event
     emit objectUpdated(this);
 }
@@ -102,8 +105,9 @@ void UAVMetaObject::setData(const Metadata& mdata)
  */
 UAVObject::Metadata UAVMetaObject::getData()
 {
-    QMutexLocker locker(mutex);
-    return parentMetadata;
+    Metadata mdata;
+    readData((quint8*)&mdata);
+    return mdata;
 }
 
 
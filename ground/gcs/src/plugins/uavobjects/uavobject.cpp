@@ -28,6 +28,8 @@
  */
 #include "uavobject.h"
 #include <QtEndian>
+#include <QVarLengthArray>
+#include <string.h>
 #include <QDebug>
 
 // Constants
@@ -55,6 +57,7 @@ UAVObject::UAVObject(quint32 objID, bool isSingleInst, const QString& name)
     this->isSingleInst = isSingleInst;
     this->name = name;
     this->mutex = new QMutex(QMutex::Recursive);
+    this->writeDepth = 0;
 }
 
 /**
@@ -272,12 +275,14 @@ UAVObjectField* UAVObject::getField(const QString& name)
  */
 qint32 UAVObject::pack(quint8* dataOut)
 {
-    QMutexLocker locker(mutex);
+    // Copy the data without blocking the writers, then pack the copy
+    QVarLengthArray<quint8, 256> snapshot(numBytes);
+    readData(snapshot.data());
     qint32 offset = 0;
     for (QList<UAVObjectField*>::iterator iter = fields.begin(); iter != fields.end(); ++iter)
     {
         UAVObjectField *field = *iter;
-        field->pack(&dataOut[offset]);
+        field->packFrom(&snapshot[field->getDataOffset()], &dataOut[offset]);
         offset += field->getNumBytes();
     }
     return numBytes;
@@ -290,12 +295,15 @@ qint32 UAVObject::pack(quint8* dataOut)
 qint32 UAVObject::unpack(const quint8* dataIn)
 {
     QMutexLocker locker(mutex);
-    qint32 offset = 0;
-    for (QList<UAVObjectField*>::iterator iter = fields.begin(); iter != fields.end(); ++iter)
     {
-        UAVObjectField *field = *iter;
-        field->unpack(&dataIn[offset]);
-        offset += field->getNumBytes();
+        WriteLocker writeLocker(this);
+        qint32 offset = 0;
+        for (QList<UAVObjectField*>::iterator iter = fields.begin(); iter != fields.end(); ++iter)
+        {
+            UAVObjectField *field = *iter;
+            field->unpack(&dataIn[offset]);
+            offset += field->getNumBytes();
+        }
     }
     emit objectUnpacked(this); // trigger object updated event
     emit objectUpdated(this);
@@ -303,6 +311,56 @@ qint32 UAVObject::unpack(const quint8* dataIn)
     return numBytes;
 }
 
+/**
+ * Copy the object data without taking the lock, so that the readers never
+ * block the telemetry decoding. The copy is retried if a write happened
+ * meanwhile, and the lock is only waited for when the writes keep on
+ * overlapping the copy.
+ * @param dataOut Buffer receiving the data
+ * @param offset Offset of the first byte to copy in the data
+ * @param length Number of bytes to copy
+ */
+void UAVObject::readData(quint8* dataOut, quint32 offset, quint32 length) const
+{
+    for (int attempt = 0; attempt < 64; ++attempt)
+    {
+        int start = sequence.loadAcquire();
+        if ((start & 1) == 0)
+        {
+            memcpy(dataOut, &data[offset], length);
+            // Ordered, so that the copy is complete before the sequence is read again
+            if (sequence.fetchAndAddOrdered(0) == start)
+                return;
+        }
+    }
+
+    QMutexLocker locker(mutex);
+    memcpy(dataOut, &data[offset], length);
+}
+
+/**
+ * Copy all the object data, see readData(quint8*, quint32, quint32)
+ */
+void UAVObject::readData(quint8* dataOut) const
+{
+    readData(dataOut, 0, numBytes);
+}
+
+/**
+ * Mark the data as being written, called with the lock held
+ */
+void UAVObject::beginWrite()
+{
+    if (writeDepth++ == 0)
+        sequence.fetchAndAddOrdered(1);
+}
+
+void UAVObject::endWrite()
+{
+    if (--writeDepth == 0)
+        sequence.fetchAndAddOrdered(1);
+}
+
 /**
  * Save the object data to the file.
  * The file will be created in the current directory
@@ -34,6 +34,7 @@
 #include <QObject>
 #include <QMutex>
 #include <QMutexLocker>
+#include <QAtomicInt>
 #include <QString>
 #include <QList>
 #include <QFile>
@@ -109,6 +110,8 @@ public:
     quint32 getNumBytes(); 
     qint32 pack(quint8* dataOut);
     qint32 unpack(const quint8* dataIn);
+    void readData(quint8* dataOut) const;
+    void readData(quint8* dataOut, quint32 offset, quint32 length) const;
     bool save();
     bool save(QFile& file);
     bool load();
@@ -120,6 +123,22 @@ public:
     void lock(int timeoutMs);
     void unlock();
     QMutex* getMutex();
+
+    /**
+     * Holds the object lock and marks the data as being written, so that the
+     * readers of readData() retry rather than copy a torn update. Writes
+     * nested in the same thread count as a single one.
+     */
+    class WriteLocker
+    {
+    public:
+        WriteLocker(UAVObject* obj) : obj(obj) {obj->mutex->lock(); obj->beginWrite();}
+        ~WriteLocker() {obj->endWrite(); obj->mutex->unlock();}
+    private:
+        Q_DISABLE_COPY(WriteLocker)
+        UAVObject* obj;
+    };
+
     qint32 getNumFields();
     QList<UAVObjectField*> getFields();
     UAVObjectField* getField(const QString& name);
@@ -244,6 +263,15 @@ protected:
     void setDescription(const QString& description);
     void setCategory(const QString& category);
 
+private:
+    void beginWrite();
+    void endWrite();
+
+    //! Odd while the data is written, incremented twice by every write
+    mutable QAtomicInt sequence;
+    //! Writes in progress, counted while holding the lock
+    int writeDepth;
+
 };
 
 #endif // UAVOBJECT_H
@@ -28,6 +28,7 @@
 #include "uavobjectfield.h"
 #include <QtEndian>
 #include <QDebug>
+#include <QVarLengthArray>
 
 UAVObjectField::UAVObjectField(const QString& name, const QString& units, FieldType type, quint32 numElements, const QStringList& options, const QString &limits)
 {
@@ -515,6 +516,15 @@ QStringList UAVObjectField::getElementNames()
     return elementNames;
 }
 
+/**
+ * Get the index of an element from its name
+ * @returns The index or -1 if the field has no such element
+ */
+int UAVObjectField::getElementIndex(const QString& elementName)
+{
+    return elementNames.indexOf(elementName);
+}
+
 UAVObject* UAVObjectField::getObject()
 {
     return obj;
@@ -522,7 +532,7 @@ UAVObject* UAVObjectField::getObject()
 
 void UAVObjectField::clear()
 {
-    QMutexLocker locker(obj->getMutex());
+    UAVObject::WriteLocker locker(obj);
     switch (type)
     {
     case BITFIELD:
@@ -588,17 +598,26 @@ QString UAVObjectField::toString()
 qint32 UAVObjectField::pack(quint8* dataOut)
 {
     QMutexLocker locker(obj->getMutex());
+    return packFrom(&data[offset], dataOut);
+}
+
+/**
+ * Pack the field from \a source, which points to the field in the object
+ * data or in a copy of it
+ */
+qint32 UAVObjectField::packFrom(const quint8* source, quint8* dataOut)
+{
     // Pack each element in output buffer
     switch (type)
     {
     case INT8:
-        memcpy(dataOut, &data[offset], numElements);
+        memcpy(dataOut, source, numElements);
         break;
     case INT16:
         for (quint32 index = 0; index < numElements; ++index)
         {
             qint16 value;
-            memcpy(&value, &data[offset + numBytesPerElement*index], numBytesPerElement);
+            memcpy(&value, &source[numBytesPerElement*index], numBytesPerElement);
             qToLittleEndian<qint16>(value, &dataOut[numBytesPerElement*index]);
         }
         break;
@@ -606,21 +625,21 @@ qint32 UAVObjectField::pack(quint8* dataOut)
         for (quint32 index = 0; index < numElements; ++index)
         {
             qint32 value;
-            memcpy(&value, &data[offset + numBytesPerElement*index], numBytesPerElement);
+            memcpy(&value, &source[numBytesPerElement*index], numBytesPerElement);
             qToLittleEndian<qint32>(value, &dataOut[numBytesPerElement*index]);
         }
         break;
     case UINT8:
         for (quint32 index = 0; index < numElements; ++index)
         {
-            dataOut[numBytesPerElement*index] = data[offset + numBytesPerElement*index];
+            dataOut[numBytesPerElement*index] = source[numBytesPerElement*index];
         }
         break;
     case UINT16:
         for (quint32 index = 0; index < numElements; ++index)
         {
             quint16 value;
-            memcpy(&value, &data[offset + numBytesPerElement*index], numBytesPerElement);
+            memcpy(&value, &source[numBytesPerElement*index], numBytesPerElement);
             qToLittleEndian<quint16>(value, &dataOut[numBytesPerElement*index]);
         }
         break;
@@ -628,7 +647,7 @@ qint32 UAVObjectField::pack(quint8* dataOut)
         for (quint32 index = 0; index < numElements; ++index)
         {
             quint32 value;
-            memcpy(&value, &data[offset + numBytesPerElement*index], numBytesPerElement);
+            memcpy(&value, &source[numBytesPerElement*index], numBytesPerElement);
             qToLittleEndian<quint32>(value, &dataOut[numBytesPerElement*index]);
         }
         break;
@@ -636,24 +655,24 @@ qint32 UAVObjectField::pack(quint8* dataOut)
         for (quint32 index = 0; index < numElements; ++index)
         {
             quint32 value;
-            memcpy(&value, &data[offset + numBytesPerElement*index], numBytesPerElement);
+            memcpy(&value, &source[numBytesPerElement*index], numBytesPerElement);
             qToLittleEndian<quint32>(value, &dataOut[numBytesPerElement*index]);
         }
         break;
     case ENUM:
         for (quint32 index = 0; index < numElements; ++index)
         {
-            dataOut[numBytesPerElement*index] = data[offset + numBytesPerElement*index];
+            dataOut[numBytesPerElement*index] = source[numBytesPerElement*index];
         }
         break;
     case BITFIELD:
         for (quint32 index = 0; index < (quint32)(1+(numElements-1)/8); ++index)
         {
-            dataOut[numBytesPerElement*index] = data[offset + numBytesPerElement*index];
+            dataOut[numBytesPerElement*index] = source[numBytesPerElement*index];
         }
         break;
     case STRING:
-        memcpy(dataOut, &data[offset], numElements);
+        memcpy(dataOut, source, numElements);
         break;
     }
     // Done
@@ -662,7 +681,7 @@ qint32 UAVObjectField::pack(quint8* dataOut)
 
 qint32 UAVObjectField::unpack(const quint8* dataIn)
 {
-    QMutexLocker locker(obj->getMutex());
+    UAVObject::WriteLocker locker(obj);
     // Unpack each element from input buffer
     switch (type)
     {
@@ -948,7 +967,7 @@ bool UAVObjectField::checkValue(const QVariant& value, quint32 index)
 
 void UAVObjectField::setValue(const QVariant& value, quint32 index)
 {
-    QMutexLocker locker(obj->getMutex());
+    UAVObject::WriteLocker locker(obj);
     // Check that index is not out of bounds
     if ( index >= numElements )
     {
@@ -1036,7 +1055,200 @@ void UAVObjectField::setValue(const QVariant& value, quint32 index)
 
 double UAVObjectField::getDouble(quint32 index)
 {
-    return getValue(index).toDouble();
+    // Enums and strings are converted from their text representation
+    if (!isNumeric())
+        return getValue(index).toDouble();
+
+    if ( index >= numElements )
+    {
+        return 0;
+    }
+    quint8 element[4];
+    if (type == BITFIELD)
+    {
+        obj->readData(element, offset + numBytesPerElement*(index/8), numBytesPerElement);
+        return elementAsDouble(type, element, index % 8);
+    }
+    obj->readData(element, offset + numBytesPerElement*index, numBytesPerElement);
+    return elementAsDouble(type, element, 0);
+}
+
+/**
+ * Copy elements of the field into a buffer, from a single copy of the field
+ * taken without blocking the writers. Enums are read as the index of the
+ * option, unlike getDouble() which converts them from their text, and
+ * strings as 0.
+ * @param dataOut Buffer receiving at least count values
+ * @param count Maximum number of elements to copy
+ * @param first Index of the first element to copy
+ * @returns The number of elements copied
+ */
+quint32 UAVObjectField::getDoubles(double* dataOut, quint32 count, quint32 first)
+{
+    if ( first >= numElements )
+    {
+        return 0;
+    }
+    QVarLengthArray<quint8, 256> field(getNumBytes());
+    obj->readData(field.data(), offset, field.size());
+    count = qMin(count, numElements - first);
+    for (quint32 n = 0; n < count; ++n)
+    {
+        quint32 index = first + n;
+        if (type == BITFIELD)
+            dataOut[n] = elementAsDouble(type, &field[numBytesPerElement*(index/8)], index % 8);
+        else
+            dataOut[n] = elementAsDouble(type, &field[numBytesPerElement*index], 0);
+    }
+    return count;
+}
+
+/**
+ * Same as getDoubles(), for float buffers. FLOAT32 fields are copied directly.
+ */
+quint32 UAVObjectField::getFloats(float* dataOut, quint32 count, quint32 first)
+{
+    if ( first >= numElements )
+    {
+        return 0;
+    }
+    count = qMin(count, numElements - first);
+    if (type == FLOAT32)
+    {
+        obj->readData((quint8*)dataOut, offset + numBytesPerElement*first, count*numBytesPerElement);
+        return count;
+    }
+    QVarLengthArray<quint8, 256> field(getNumBytes());
+    obj->readData(field.data(), offset, field.size());
+    for (quint32 n = 0; n < count; ++n)
+    {
+        quint32 index = first + n;
+        if (type == BITFIELD)
+            dataOut[n] = elementAsDouble(type, &field[numBytesPerElement*(index/8)], index % 8);
+        else
+            dataOut[n] = elementAsDouble(type, &field[numBytesPerElement*index], 0);
+    }
+    return count;
+}
+
+/**
+ * Decode the element stored at \a element, in a copy of the object data or
+ * in the data itself, in which case the caller must hold the object lock.
+ * @param bit Bit of the element within the byte for bitfields
+ */
+double UAVObjectField::elementAsDouble(FieldType type, const quint8* element, quint32 bit)
+{
+    switch (type)
+    {
+    case INT8:
+    {
+        qint8 tmpint8;
+        memcpy(&tmpint8, element, sizeof(tmpint8));
+        return tmpint8;
+    }
+    case INT16:
+    {
+        qint16 tmpint16;
+        memcpy(&tmpint16, element, sizeof(tmpint16));
+        return tmpint16;
+    }
+    case INT32:
+    {
+        qint32 tmpint32;
+        memcpy(&tmpint32, element, sizeof(tmpint32));
+        return tmpint32;
+    }
+    case UINT8:
+        return *element;
+    case UINT16:
+    {
+        quint16 tmpuint16;
+        memcpy(&tmpuint16, element, sizeof(tmpuint16));
+        return tmpuint16;
+    }
+    case UINT32:
+    {
+        quint32 tmpuint32;
+        memcpy(&tmpuint32, element, sizeof(tmpuint32));
+        return tmpuint32;
+    }
+    case FLOAT32:
+    {
+        float tmpfloat;
+        memcpy(&tmpfloat, element, sizeof(tmpfloat));
+        return tmpfloat;
+    }
+    case ENUM:
+        return *element;
+    case BITFIELD:
+        return (*element >> bit) & 1;
+    case STRING:
+        return 0;
+    }
+    return 0;
+}
+
+UAVObjectFieldHandle::UAVObjectFieldHandle() :
+    field(NULL), obj(NULL), element(NULL), type(UAVObjectField::STRING), index(0), bit(0)
+{
+}
+
+/**
+ * Create a handle on element \a index of \a field. The handle is invalid
+ * if the index is out of range.
+ */
+UAVObjectFieldHandle::UAVObjectFieldHandle(UAVObjectField* field, quint32 index) :
+    field(NULL), obj(NULL), element(NULL), type(UAVObjectField::STRING), index(0), bit(0)
+{
+    if (field == NULL || field->obj == NULL || field->data == NULL || index >= field->numElements)
+        return;
+
+    this->field = field;
+    this->obj = field->obj;
+    this->type = field->type;
+    this->index = index;
+    if (type == UAVObjectField::BITFIELD)
+    {
+        element = &field->data[field->offset + field->numBytesPerElement*(index/8)];
+        bit = index % 8;
+    }
+    else
+    {
+        element = &field->data[field->offset + field->numBytesPerElement*index];
+    }
+}
+
+/**
+ * Resolve a field element by name
+ * @param elementName Name of the element, or empty for the first element
+ * @returns The handle, invalid if the field or the element do not exist
+ */
+UAVObjectFieldHandle UAVObjectFieldHandle::resolve(UAVObject* obj, const QString& fieldName, const QString& elementName)
+{
+    if (obj == NULL)
+        return UAVObjectFieldHandle();
+    UAVObjectField* field = obj->getField(fieldName);
+    if (field == NULL)
+        return UAVObjectFieldHandle();
+    if (elementName.isEmpty())
+        return UAVObjectFieldHandle(field);
+
+    int index = field->getElementIndex(elementName);
+    if (index < 0)
+        return UAVObjectFieldHandle();
+    return UAVObjectFieldHandle(field, index);
+}
+
+/**
+ * Read a copy of the element, without blocking the writers
+ */
+double UAVObjectFieldHandle::getDouble() const
+{
+    if (field == NULL)
+        return 0;
+    quint8 value[4];
+    obj->readData(value, element - field->data, field->numBytesPerElement);
+    return UAVObjectField::elementAsDouble(type, value, bit);
 }
 
 void UAVObjectField::setDouble(double value, quint32 index)
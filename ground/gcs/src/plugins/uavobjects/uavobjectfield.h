@@ -36,10 +36,13 @@
 #include <QMap>
 
 class UAVObject;
+class UAVObjectFieldHandle;
 
 class UAVOBJECTS_EXPORT UAVObjectField: public QObject
 {
     Q_OBJECT
+    friend class UAVObjectFieldHandle;
+    friend class UAVObject;
 
 public:
     typedef enum { INT8 = 0, INT16, INT32, UINT8, UINT16, UINT32, FLOAT32, ENUM, BITFIELD, STRING } FieldType;
@@ -61,6 +64,7 @@ public:
     QString getUnits();
     quint32 getNumElements();
     QStringList getElementNames();
+    int getElementIndex(const QString& elementName);
     QStringList getOptions();
     qint32 pack(quint8* dataOut);
     qint32 unpack(const quint8* dataIn);
@@ -69,6 +73,8 @@ public:
     void setValue(const QVariant& data, quint32 index = 0);
     double getDouble(quint32 index = 0);
     void setDouble(double value, quint32 index = 0);
+    quint32 getDoubles(double* dataOut, quint32 count, quint32 first = 0);
+    quint32 getFloats(float* dataOut, quint32 count, quint32 first = 0);
     quint32 getDataOffset();
     quint32 getNumBytes();
     bool isNumeric();
@@ -94,10 +100,41 @@ protected:
     UAVObject* obj;
     QMap<quint32, QList<LimitStruct> > elementLimits;
     void clear();
+    qint32 packFrom(const quint8* source, quint8* dataOut);
     void constructorInitialize(const QString& name, const QString& units, FieldType type, const QStringList& elementNames, const QStringList& options, const QString &limits);
     void limitsInitialize(const QString &limits);
+    static double elementAsDouble(FieldType type, const quint8* element, quint32 bit);
+};
 
+/**
+ * @brief A reference to one element of a field, resolved once and read many
+ * times. The element address, type and index are computed when the handle is
+ * created so reading it involves neither a name lookup nor a QVariant.
+ *
+ * Numeric elements read as their value, enums as the index of the option and
+ * strings as 0, like UAVObjectField::getDoubles().
+ */
+class UAVOBJECTS_EXPORT UAVObjectFieldHandle
+{
+public:
+    UAVObjectFieldHandle();
+    UAVObjectFieldHandle(UAVObjectField* field, quint32 index = 0);
+    static UAVObjectFieldHandle resolve(UAVObject* obj, const QString& fieldName, const QString& elementName = QString());
+
+    bool isValid() const { return field != NULL; }
+    UAVObjectField* getField() const { return field; }
+    UAVObject* getObject() const { return obj; }
+    quint32 getIndex() const { return index; }
 
+    double getDouble() const;
+
+private:
+    UAVObjectField* field;
+    UAVObject* obj;
+    const quint8* element;
+    UAVObjectField::FieldType type;
+    quint32 index;
+    quint32 bit;
 };
 
 #endif // UAVOBJECTFIELD_H
@@ -31,7 +31,8 @@
 /**
  * Constructor
  */
-UAVObjectManager::UAVObjectManager()
+UAVObjectManager::UAVObjectManager() :
+    version(0)
 {
     mutex = new QMutex(QMutex::Recursive);
 }
@@ -75,6 +76,7 @@ bool UAVObjectManager::registerObject(UAVDataObject* obj)
                 QMap<quint32,UAVObject*> ppp;
                 ppp.insert(instidx,cobj);
                 objects[objID].insert(instidx,cobj);
+                invalidateSnapshot();
                 getObject(cobj->getObjID())->emitNewInstance(cobj);//TODO??
                 emit newInstance(cobj);
             }
@@ -87,6 +89,7 @@ bool UAVObjectManager::registerObject(UAVDataObject* obj)
         }
         // Add the actual object instance in the list
         objects[objID].insert(obj->getInstID(),obj);
+        invalidateSnapshot();
         getObject(objID)->emitNewInstance(obj);
         emit newInstance(obj);
         return true;
@@ -126,6 +129,7 @@ bool UAVObjectManager::unRegisterObject(UAVDataObject* obj)
         getObject(objects.value(objID).value(x)->getObjID())->emitInstanceRemoved(objects.value(objID).value(x));
         emit instanceRemoved(objects.value(objID).value(x));
         objects[objID].remove(x);
+        invalidateSnapshot();
     }
     return true;
 }
@@ -136,23 +140,82 @@ void UAVObjectManager::addObject(UAVObject* obj)
     QMap<quint32,UAVObject*> list;
     list.insert(obj->getInstID(),obj);
     objects.insert(obj->getObjID(),list);
+    objectIdsByName.insert(obj->getName(), obj->getObjID());
+    invalidateSnapshot();
     emit newObject(obj);
 }
 
 /**
- * Get all objects. A two dimentional QVector is returned. Objects are grouped by
- * instances of the same object type.
+ * Called with the mutex held whenever objects are added or removed
  */
-QVector< QVector<UAVObject*> > UAVObjectManager::getObjectsVector()
+void UAVObjectManager::invalidateSnapshot()
+{
+    ++version;
+    snapshot.clear();
+}
+
+/**
+ * Get an immutable snapshot of all the registered objects. The snapshot is
+ * shared by all callers until the set of objects changes.
+ */
+UAVObjectManager::SnapshotPtr UAVObjectManager::getSnapshot()
 {
     QMutexLocker locker(mutex);
-    QVector< QVector<UAVObject*> > vector;
-    foreach(ObjectMap map,objects.values())
+    if (snapshot.isNull())
     {
-        QVector<UAVObject*> vec = map.values().toVector();
-        vector.append(vec);
+        Snapshot* s = new Snapshot;
+        s->version = version;
+        foreach(const ObjectMap& map, objects)
+        {
+            s->objects.append(map.values().toVector());
+            if (map.isEmpty())
+                continue;
+            if (dynamic_cast<UAVDataObject*>(map.first()) != NULL)
+            {
+                QVector<UAVDataObject*> vec;
+                foreach(UAVObject* o, map)
+                {
+                    UAVDataObject* dobj = dynamic_cast<UAVDataObject*>(o);
+                    if(dobj)
+                        vec.append(dobj);
+                }
+                s->dataObjects.append(vec);
+            }
+            else if (dynamic_cast<UAVMetaObject*>(map.first()) != NULL)
+            {
+                QVector<UAVMetaObject*> vec;
+                foreach(UAVObject* o, map)
+                {
+                    UAVMetaObject* mobj = dynamic_cast<UAVMetaObject*>(o);
+                    if(mobj)
+                        vec.append(mobj);
+                }
+                s->metaObjects.append(vec);
+            }
+        }
+        snapshot = SnapshotPtr(s);
     }
-    return vector;
+    return snapshot;
+}
+
+/**
+ * Get the version of the set of registered objects. It changes every time
+ * objects are registered or unregistered.
+ */
+quint32 UAVObjectManager::getVersion()
+{
+    QMutexLocker locker(mutex);
+    return version;
+}
+
+/**
+ * Get all objects. A two dimentional QVector is returned. Objects are grouped by
+ * instances of the same object type. The vector is shared with the current
+ * snapshot, so this does not copy anything.
+ */
+QVector< QVector<UAVObject*> > UAVObjectManager::getObjectsVector()
+{
+    return getSnapshot()->objects;
 }
 
 QHash<quint32, QMap<quint32, UAVObject *> > UAVObjectManager::getObjects()
@@ -165,24 +228,7 @@ QHash<quint32, QMap<quint32, UAVObject *> > UAVObjectManager::getObjects()
  */
 QVector< QVector<UAVDataObject*> > UAVObjectManager::getDataObjectsVector()
 {
-    QMutexLocker locker(mutex);
-    QVector< QVector<UAVDataObject*> > vector;
-    foreach(ObjectMap map,objects.values())
-    {
-        UAVDataObject* obj = dynamic_cast<UAVDataObject*>(map.first());
-        if(obj!=NULL)
-        {
-            QVector<UAVDataObject*> vec;
-            foreach(UAVObject* o,map)
-            {
-                UAVDataObject* dobj = dynamic_cast<UAVDataObject*>(o);
-                if(dobj)
-                    vec.append(dobj);
-            }
-            vector.append(vec);
-        }
-     }
-    return vector;
+    return getSnapshot()->dataObjects;
 }
 
 /**
@@ -190,24 +236,7 @@ QVector< QVector<UAVDataObject*> > UAVObjectManager::getDataObjectsVector()
  */
 QVector <QVector<UAVMetaObject*> > UAVObjectManager::getMetaObjectsVector()
 {
-    QMutexLocker locker(mutex);
-    QVector< QVector<UAVMetaObject*> > vector;
-    foreach(ObjectMap map,objects.values())
-    {
-        UAVMetaObject* obj = dynamic_cast<UAVMetaObject*>(map.first());
-        if(obj!=NULL)
-        {
-            QVector<UAVMetaObject*> vec;
-            foreach(UAVObject* o,map)
-            {
-                UAVMetaObject* mobj = dynamic_cast<UAVMetaObject*>(o);
-                if(mobj)
-                    vec.append(mobj);
-            }
-            vector.append(vec);
-        }
-     }
-    return vector;
+    return getSnapshot()->metaObjects;
 }
 
 /**
@@ -234,17 +263,29 @@ UAVObject* UAVObjectManager::getObject(quint32 objId, quint32 instId)
 UAVObject* UAVObjectManager::getObject(const QString* name, quint32 objId, quint32 instId)
 {
     QMutexLocker locker(mutex);
+    const ObjectMap* map = findObjectMap(name, objId);
+    if(map != NULL)
+        return map->value(instId, NULL);
+    return NULL;
+}
+
+/**
+ * Find the instances of an object type by name, or by ID if \a name is NULL.
+ * Must be called with the mutex held.
+ */
+const UAVObjectManager::ObjectMap* UAVObjectManager::findObjectMap(const QString* name, quint32 objId) const
+{
     if(name != NULL)
     {
-        foreach(ObjectMap map,objects)
-        {
-            if(map.first()->getName().compare(name) == 0)
-                return map.value(instId,NULL);
-        }
+        QHash<QString, quint32>::const_iterator id = objectIdsByName.constFind(*name);
+        if(id == objectIdsByName.constEnd())
+            return NULL;
+        objId = id.value();
     }
-    else if(objects.contains(objId))
-        return objects.value(objId).value(instId);
-    return NULL;
+    QHash<quint32, ObjectMap>::const_iterator it = objects.constFind(objId);
+    if(it == objects.constEnd())
+        return NULL;
+    return &it.value();
 }
 
 /**
@@ -269,16 +310,9 @@ QVector<UAVObject*> UAVObjectManager::getObjectInstancesVector(quint32 objId)
 QVector<UAVObject*> UAVObjectManager::getObjectInstancesVector(const QString* name, quint32 objId)
 {
     QMutexLocker locker(mutex);
-    if(name != NULL)
-    {
-        foreach(ObjectMap map,objects)
-        {
-            if(map.first()->getName().compare(name) == 0)
-                return map.values().toVector();
-        }
-    }
-    else if(objects.contains(objId))
-        return objects.value(objId).values().toVector();
+    const ObjectMap* map = findObjectMap(name, objId);
+    if(map != NULL)
+        return map->values().toVector();
     return  QVector<UAVObject*>();
 }
 
@@ -304,15 +338,8 @@ qint32 UAVObjectManager::getNumInstances(quint32 objId)
 qint32 UAVObjectManager::getNumInstances(const QString* name, quint32 objId)
 {
     QMutexLocker locker(mutex);
-    if(name != NULL)
-    {
-        foreach(ObjectMap map,objects)
-        {
-            if(map.first()->getName().compare(name) == 0)
-                return map.count();
-        }
-    }
-    else if(objects.contains(objId))
-        return objects.value(objId).count();
+    const ObjectMap* map = findObjectMap(name, objId);
+    if(map != NULL)
+        return map->count();
     return -1;
 }
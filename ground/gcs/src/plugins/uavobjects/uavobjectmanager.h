@@ -37,6 +37,7 @@
 #include <QMutexLocker>
 #include <QVector>
 #include <QHash>
+#include <QSharedPointer>
 
 class UAVOBJECTS_EXPORT UAVObjectManager: public QObject
 {
@@ -46,7 +47,24 @@ public:
     UAVObjectManager();
     ~UAVObjectManager();
     typedef QMap<quint32,UAVObject*> ObjectMap;
+
+    /**
+     * Immutable view of all registered objects, grouped by instances of the
+     * same object type. It is rebuilt only when objects are registered or
+     * unregistered, so holding on to it is free; compare version with
+     * getVersion() to find out whether it is still current.
+     */
+    struct Snapshot {
+        quint32 version;
+        QVector< QVector<UAVObject*> > objects;
+        QVector< QVector<UAVDataObject*> > dataObjects;
+        QVector< QVector<UAVMetaObject*> > metaObjects;
+    };
+    typedef QSharedPointer<const Snapshot> SnapshotPtr;
+
     bool registerObject(UAVDataObject* obj);
+    SnapshotPtr getSnapshot();
+    quint32 getVersion();
     QVector< QVector<UAVObject*> > getObjectsVector();
     QHash<quint32, QMap<quint32,UAVObject*> > getObjects();
     QVector< QVector<UAVDataObject*> > getDataObjectsVector();
@@ -65,9 +83,15 @@ signals:
 private:
     static const quint32 MAX_INSTANCES = 1000;
     QHash<quint32, QMap<quint32,UAVObject*> > objects;
+    //! Object type ID by name, for both data and meta objects
+    QHash<QString, quint32> objectIdsByName;
+    SnapshotPtr snapshot;
+    quint32 version;
     QMutex* mutex;
 
     void addObject(UAVObject* obj);
+    void invalidateSnapshot();
+    const ObjectMap* findObjectMap(const QString* name, quint32 objId) const;
     UAVObject* getObject(const QString* name, quint32 objId, quint32 instId);
     QVector<UAVObject*> getObjectInstancesVector(const QString* name, quint32 objId);
     qint32 getNumInstances(const QString* name, quint32 objId);
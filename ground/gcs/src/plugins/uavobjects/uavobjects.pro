@@ -11,14 +11,16 @@ HEADERS += uavobjects_global.h \
     uavdataobject.h \
     uavobjectfield.h \
     uavobjectsinit.h \
-    uavobjectsplugin.h
+    uavobjectsplugin.h \
+    uavobjectupdatebridge.h
 
 SOURCES += uavobject.cpp \
     uavmetaobject.cpp \
     uavobjectmanager.cpp \
     uavdataobject.cpp \
     uavobjectfield.cpp \
-    uavobjectsplugin.cpp
+    uavobjectsplugin.cpp \
+    uavobjectupdatebridge.cpp
 
 OTHER_FILES += UAVObjects.pluginspec \
     UAVObjects.json
@@ -85,6 +87,7 @@ HEADERS += $$UAVOBJECT_SYNTHETICS/accels.h \
     $$UAVOBJECT_SYNTHETICS/inssettings.h \
     $$UAVOBJECT_SYNTHETICS/insstate.h \
     $$UAVOBJECT_SYNTHETICS/loitercommand.h \
+    $$UAVOBJECT_SYNTHETICS/loggingdownloadack.h \
     $$UAVOBJECT_SYNTHETICS/loggingsettings.h \
     $$UAVOBJECT_SYNTHETICS/loggingstats.h \
     $$UAVOBJECT_SYNTHETICS/magbias.h \
@@ -201,6 +204,7 @@ SOURCES += $$UAVOBJECT_SYNTHETICS/accels.cpp \
     $$UAVOBJECT_SYNTHETICS/inssettings.cpp \
     $$UAVOBJECT_SYNTHETICS/insstate.cpp \
     $$UAVOBJECT_SYNTHETICS/loitercommand.cpp \
+    $$UAVOBJECT_SYNTHETICS/loggingdownloadack.cpp \
     $$UAVOBJECT_SYNTHETICS/loggingsettings.cpp \
     $$UAVOBJECT_SYNTHETICS/loggingstats.cpp \
     $$UAVOBJECT_SYNTHETICS/magbias.cpp \
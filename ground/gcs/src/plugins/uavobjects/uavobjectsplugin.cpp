@@ -27,6 +27,7 @@
  */
 #include "uavobjectsplugin.h"
 #include "uavobjectsinit.h"
+#include "uavobjectupdatebridge.h"
 
 UAVObjectsPlugin::UAVObjectsPlugin()
 {
@@ -50,6 +51,8 @@ bool UAVObjectsPlugin::initialize(const QStringList & arguments, QString * error
     addAutoReleasedObject(objMngr);
     // Initialize UAVObjects
     UAVObjectsInitialize(objMngr);
+    // Create the bridge delivering coalesced updates to the GUI thread
+    addAutoReleasedObject(new UAVObjectUpdateBridge());
     // Done
     Q_UNUSED(arguments);
     Q_UNUSED(errorString);
@@ -32,6 +32,8 @@
  */
 #include "$(NAMELC).h"
 #include "uavobjectfield.h"
+#include <stddef.h>
+#include <string.h>
 
 const QString $(NAME)::NAME = QString("$(NAME)");
 const QString $(NAME)::DESCRIPTION = QString("$(DESCRIPTION)");
@@ -49,14 +51,12 @@ $(FIELDSINIT)
     initializeFields(fields, (quint8*)&data, NUMBYTES);
     // Set the default field values
     setDefaultFieldValues();
+    notifiedData = data;
     // Set the object description
     setDescription(DESCRIPTION);
 
     // Set the Category of this object type
     setCategory(CATEGORY);
-
-    connect(this, SIGNAL(objectUpdated(UAVObject*)),
-            SLOT(emitNotifications()));
 }
 
 /**
@@ -89,12 +89,13 @@ $(INITFIELDS)
 }
 
 /**
- * Get the object data fields
+ * Get a copy of the object data fields, without blocking the writers
  */
 $(NAME)::DataFields $(NAME)::getData()
 {
-    QMutexLocker locker(mutex);
-    return data;
+    DataFields snapshot;
+    readData((quint8*)&snapshot);
+    return snapshot;
 }
 
 /**
@@ -108,15 +109,28 @@ void $(NAME)::setData(const DataFields& data)
     // Update object if the access mode permits
     if ( UAVObject::GetGcsAccess(mdata) == ACCESS_READWRITE )
     {
-        this->data = data;
+        {
+            WriteLocker writeLocker(this);
+            this->data = data;
+        }
         emit objectUpdatedAuto(this); // trigger object updated event
         emit objectUpdated(this);
     }
 }
 
+/**
+ * Emit the change signals of the fields which changed since the last
+ * notification only
+ */
 void $(NAME)::emitNotifications()
 {
-    $(NOTIFY_PROPERTIES_CHANGED)
+    mutex->lock();
+    DataFields newData = data;
+    DataFields oldData = notifiedData;
+    notifiedData = data;
+    mutex->unlock();
+
+$(NOTIFY_PROPERTIES_CHANGED)
 }
 
 /**
@@ -80,11 +80,13 @@ $(PROPERTY_SETTERS)
 signals:
 $(PROPERTY_NOTIFICATIONS)
 
-private slots:
+protected:
     void emitNotifications();
 	
 private:
     DataFields data;
+    //! Data when the changed fields were last notified
+    DataFields notifiedData;
 
     void setDefaultFieldValues();
 
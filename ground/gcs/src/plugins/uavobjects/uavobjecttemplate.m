@@ -122,6 +122,15 @@ timestampAccumulator = 0;
 lastTimestamp = 0;
 
 while bufferIdx < (length(buffer) - 20)
+	%% Skip keyframes and the index
+	% Their payload starts with a marker beginning with "TLL". Keyframes only
+	% repeat the state of the objects and the index holds no packets.
+	if ~overo && isequal(buffer(bufferIdx+12:bufferIdx+14)', uint8('TLL'))
+		datasize = double(typecast(buffer(bufferIdx+4:bufferIdx+12-1), 'uint64'));
+		bufferIdx = bufferIdx + 12 + datasize;
+		continue
+	end
+
 	%% Read message header
 	% get sync field (0x3C, 1 byte)
 	if ~overo
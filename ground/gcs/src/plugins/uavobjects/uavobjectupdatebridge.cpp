@@ -0,0 +1,245 @@
+/**
+ ******************************************************************************
+ *
+ * @file       uavobjectupdatebridge.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @see        The GNU Public License (GPL) Version 3
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVObjectsPlugin UAVObjects Plugin
+ * @{
+ * @brief      Coalesces object updates from the I/O threads into batches
+ *             delivered to the GUI thread
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#include "uavobjectupdatebridge.h"
+#include <QThreadStorage>
+#include <QMutexLocker>
+
+namespace {
+struct MonotonicClock {
+    QElapsedTimer timer;
+    MonotonicClock() { timer.start(); }
+};
+}
+
+Q_GLOBAL_STATIC(MonotonicClock, monotonicClock)
+
+//! Arrival time of the data being decoded by the current thread, 0 if none
+static QThreadStorage<qint64> arrivalTime;
+
+/**
+ * Constructor. The bridge must be created in the GUI thread, which is where
+ * the updates are delivered.
+ */
+UAVObjectUpdateBridge::UAVObjectUpdateBridge(QObject *parent) :
+    QObject(parent),
+    deliveryScheduled(false),
+    maxDeliveryRate(DEFAULT_DELIVERY_RATE)
+{
+    deliveryTimer.setSingleShot(true);
+    connect(&deliveryTimer, SIGNAL(timeout()), this, SLOT(deliver()));
+    resetLatencyStats();
+}
+
+UAVObjectUpdateBridge::~UAVObjectUpdateBridge()
+{
+    foreach (UAVObject *obj, notifiers.keys())
+        disconnect(obj, SIGNAL(objectUpdated(UAVObject*)), this, SLOT(onObjectUpdated(UAVObject*)));
+}
+
+/**
+ * Connect \a member of \a receiver to coalesced updates of \a obj.
+ * The receiver must live in the GUI thread.
+ */
+bool UAVObjectUpdateBridge::connectObject(UAVObject *obj, const QObject *receiver, const char *member)
+{
+    if (obj == NULL)
+        return false;
+
+    UAVObjectUpdateNotifier *notifier = notifiers.value(obj);
+    if (notifier == NULL)
+    {
+        notifier = new UAVObjectUpdateNotifier(this);
+        notifiers.insert(obj, notifier);
+        connect(notifier, SIGNAL(destroyed(QObject*)), this, SLOT(onNotifierDestroyed(QObject*)));
+        // Direct connection, the slot only queues the object so it is safe
+        // to run it in whichever thread emits the update
+        connect(obj, SIGNAL(objectUpdated(UAVObject*)), this, SLOT(onObjectUpdated(UAVObject*)), Qt::DirectConnection);
+    }
+    return connect(notifier, SIGNAL(objectUpdated(UAVObject*)), receiver, member, Qt::UniqueConnection);
+}
+
+/**
+ * Disconnect \a receiver from the coalesced updates of \a obj. If \a member
+ * is 0 all the slots of the receiver are disconnected.
+ */
+bool UAVObjectUpdateBridge::disconnectObject(UAVObject *obj, const QObject *receiver, const char *member)
+{
+    UAVObjectUpdateNotifier *notifier = notifiers.value(obj);
+    if (notifier == NULL)
+        return false;
+
+    bool ret = disconnect(notifier, SIGNAL(objectUpdated(UAVObject*)), receiver, member);
+    if (notifier->receivers(SIGNAL(objectUpdated(UAVObject*))) == 0)
+        delete notifier;
+    return ret;
+}
+
+void UAVObjectUpdateBridge::onNotifierDestroyed(QObject *notifier)
+{
+    UAVObject *obj = notifiers.key(static_cast<UAVObjectUpdateNotifier *>(notifier));
+    if (obj == NULL)
+        return;
+    notifiers.remove(obj);
+    disconnect(obj, SIGNAL(objectUpdated(UAVObject*)), this, SLOT(onObjectUpdated(UAVObject*)));
+    QMutexLocker locker(&mutex);
+    pending.remove(obj);
+}
+
+/**
+ * Set the maximum number of batches delivered per second
+ */
+void UAVObjectUpdateBridge::setMaxDeliveryRate(int hz)
+{
+    maxDeliveryRate = qMax(1, hz);
+}
+
+/**
+ * Called in the thread which updated the object. Records the object as
+ * pending and makes sure a delivery is scheduled in the GUI thread, so there
+ * is at most one queued event per batch rather than one per update.
+ */
+void UAVObjectUpdateBridge::onObjectUpdated(UAVObject *obj)
+{
+    qint64 arrival = arrivalTime.hasLocalData() ? arrivalTime.localData() : 0;
+    if (arrival == 0)
+        arrival = timestamp();
+
+    QMutexLocker locker(&mutex);
+    ++updateCount;
+    if (!pending.contains(obj))
+        pending.insert(obj, arrival);
+    if (!deliveryScheduled)
+    {
+        deliveryScheduled = true;
+        QMetaObject::invokeMethod(this, "scheduleDelivery", Qt::QueuedConnection);
+    }
+}
+
+/**
+ * Deliver now if the previous batch is old enough, otherwise wait until
+ * the delivery rate allows it.
+ */
+void UAVObjectUpdateBridge::scheduleDelivery()
+{
+    qint64 minInterval = 1000 / maxDeliveryRate;
+    qint64 elapsed = lastDelivery.isValid() ? lastDelivery.elapsed() : minInterval;
+    if (elapsed >= minInterval)
+        deliver();
+    else if (!deliveryTimer.isActive())
+        deliveryTimer.start(minInterval - elapsed);
+}
+
+void UAVObjectUpdateBridge::deliver()
+{
+    QHash<UAVObject *, qint64> batch;
+    {
+        QMutexLocker locker(&mutex);
+        batch.swap(pending);
+        deliveryScheduled = false;
+    }
+    lastDelivery.start();
+    if (batch.isEmpty())
+        return;
+
+    qint64 now = timestamp();
+    QList<UAVObject *> delivered;
+    for (QHash<UAVObject *, qint64>::const_iterator it = batch.constBegin(); it != batch.constEnd(); ++it)
+    {
+        UAVObjectUpdateNotifier *notifier = notifiers.value(it.key());
+        if (notifier == NULL)
+            continue;
+
+        double latencyMs = (now - it.value()) / 1e6;
+        {
+            QMutexLocker locker(&mutex);
+            ++deliveryCount;
+            latencySumMs += latencyMs;
+            latencyMaxMs = qMax(latencyMaxMs, latencyMs);
+        }
+        emit notifier->objectUpdated(it.key());
+        delivered.append(it.key());
+    }
+
+    if (!delivered.isEmpty())
+    {
+        {
+            QMutexLocker locker(&mutex);
+            ++batchCount;
+        }
+        emit objectsUpdated(delivered);
+    }
+}
+
+/**
+ * Get the update, delivery and latency statistics since the last reset
+ */
+UAVObjectUpdateBridge::LatencyStats UAVObjectUpdateBridge::getLatencyStats()
+{
+    QMutexLocker locker(&mutex);
+    LatencyStats stats;
+    stats.updates = updateCount;
+    stats.deliveries = deliveryCount;
+    stats.batches = batchCount;
+    stats.meanLatencyMs = deliveryCount > 0 ? latencySumMs / deliveryCount : 0;
+    stats.maxLatencyMs = latencyMaxMs;
+    return stats;
+}
+
+void UAVObjectUpdateBridge::resetLatencyStats()
+{
+    QMutexLocker locker(&mutex);
+    updateCount = 0;
+    deliveryCount = 0;
+    batchCount = 0;
+    latencySumMs = 0;
+    latencyMaxMs = 0;
+}
+
+/**
+ * Monotonic time in nanoseconds, shared by the links and the bridge
+ */
+qint64 UAVObjectUpdateBridge::timestamp()
+{
+    return monotonicClock()->timer.nsecsElapsed();
+}
+
+/**
+ * Called by a link before decoding data which arrived at \a arrival (as
+ * returned by timestamp()). Updates emitted by the calling thread until
+ * clearArrival() are attributed to that arrival time.
+ */
+void UAVObjectUpdateBridge::markArrival(qint64 arrival)
+{
+    arrivalTime.setLocalData(arrival);
+}
+
+void UAVObjectUpdateBridge::clearArrival()
+{
+    arrivalTime.setLocalData(0);
+}
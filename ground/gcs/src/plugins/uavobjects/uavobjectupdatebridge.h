@@ -0,0 +1,130 @@
+/**
+ ******************************************************************************
+ *
+ * @file       uavobjectupdatebridge.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @see        The GNU Public License (GPL) Version 3
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVObjectsPlugin UAVObjects Plugin
+ * @{
+ * @brief      Coalesces object updates from the I/O threads into batches
+ *             delivered to the GUI thread
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#ifndef UAVOBJECTUPDATEBRIDGE_H
+#define UAVOBJECTUPDATEBRIDGE_H
+
+#include "uavobjects_global.h"
+#include "uavobject.h"
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QTimer>
+#include <QElapsedTimer>
+
+/**
+ * @brief Per object notifier living in the GUI thread. Emits objectUpdated()
+ * at most once per delivery batch, whatever the number of updates the object
+ * received in between.
+ */
+class UAVOBJECTS_EXPORT UAVObjectUpdateNotifier : public QObject
+{
+    Q_OBJECT
+    friend class UAVObjectUpdateBridge;
+
+public:
+    explicit UAVObjectUpdateNotifier(QObject *parent) : QObject(parent) {}
+
+signals:
+    void objectUpdated(UAVObject *obj);
+};
+
+/**
+ * @brief The UAVObjectUpdateBridge class collects objectUpdated() signals
+ * emitted in any thread and delivers the latest state of every updated object
+ * to the GUI thread in batches, at a bounded rate.
+ *
+ * Without it each update decoded in the telemetry thread reaches each GUI
+ * receiver as a separate queued event. Gadgets which only display the current
+ * state subscribe with connectObject() instead of connecting to the object.
+ *
+ * The time from arrival of the bytes carrying an update (as reported by the
+ * link through markArrival()) to delivery to the gadgets is tracked and can
+ * be read with getLatencyStats().
+ */
+class UAVOBJECTS_EXPORT UAVObjectUpdateBridge : public QObject
+{
+    Q_OBJECT
+
+public:
+    typedef struct {
+        quint32 updates;     //!< Updates received from the objects
+        quint32 deliveries;  //!< Objects delivered to the GUI thread
+        quint32 batches;     //!< Number of delivery batches
+        double meanLatencyMs;
+        double maxLatencyMs;
+    } LatencyStats;
+
+    explicit UAVObjectUpdateBridge(QObject *parent = 0);
+    ~UAVObjectUpdateBridge();
+
+    bool connectObject(UAVObject *obj, const QObject *receiver, const char *member);
+    bool disconnectObject(UAVObject *obj, const QObject *receiver, const char *member = 0);
+
+    void setMaxDeliveryRate(int hz);
+    int getMaxDeliveryRate() const { return maxDeliveryRate; }
+
+    LatencyStats getLatencyStats();
+    void resetLatencyStats();
+
+    static qint64 timestamp();
+    static void markArrival(qint64 arrival);
+    static void clearArrival();
+
+signals:
+    //! Emitted in the GUI thread once per batch with all the objects delivered
+    void objectsUpdated(const QList<UAVObject *> &objects);
+
+private slots:
+    void onObjectUpdated(UAVObject *obj);
+    void scheduleDelivery();
+    void deliver();
+    void onNotifierDestroyed(QObject *notifier);
+
+private:
+    static const int DEFAULT_DELIVERY_RATE = 50;
+
+    QMutex mutex;
+    //! Updated objects waiting for delivery and the arrival of their oldest pending update
+    QHash<UAVObject *, qint64> pending;
+    bool deliveryScheduled;
+
+    QHash<UAVObject *, UAVObjectUpdateNotifier *> notifiers;
+    QTimer deliveryTimer;
+    QElapsedTimer lastDelivery;
+    int maxDeliveryRate;
+
+    quint32 updateCount;
+    quint32 deliveryCount;
+    quint32 batchCount;
+    double latencySumMs;
+    double latencyMaxMs;
+};
+
+#endif // UAVOBJECTUPDATEBRIDGE_H
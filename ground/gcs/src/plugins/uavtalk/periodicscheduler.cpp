@@ -0,0 +1,143 @@
+/**
+ ******************************************************************************
+ * @file       periodicscheduler.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVTalkPlugin UAVTalk Plugin
+ * @{
+ * @brief Schedules the periodic updates of the telemetry objects
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "periodicscheduler.h"
+
+#include <algorithm>
+#include <limits.h>
+
+PeriodicScheduler::PeriodicScheduler() :
+    scheduled(0)
+{
+}
+
+/**
+ * Update item \a id every \a periodMs from \a firstDueMs on, or stop updating
+ * it when the period is 0. The ids are small integers, such as indices.
+ */
+void PeriodicScheduler::setPeriod(int id, qint32 periodMs, qint64 firstDueMs)
+{
+    if (id >= items.size())
+        items.resize(id + 1);
+
+    Item &item = items[id];
+    if (item.periodMs > 0)
+        scheduled--;
+    item.periodMs = qMax(periodMs, 0);
+    item.dueMs = firstDueMs;
+    item.generation++;
+
+    if (item.periodMs > 0) {
+        scheduled++;
+        push(id);
+    }
+
+    // Rescheduling leaves stale entries behind
+    if (heap.size() > 2 * scheduled + 16)
+        rebuild();
+}
+
+qint32 PeriodicScheduler::getPeriod(int id) const
+{
+    return id < items.size() ? items.at(id).periodMs : 0;
+}
+
+/**
+ * Time of the earliest update, or -1 when nothing is scheduled
+ */
+qint64 PeriodicScheduler::nextDueMs()
+{
+    dropStale();
+    return heap.isEmpty() ? -1 : heap.first().dueMs;
+}
+
+/**
+ * Take the earliest item due at \a nowMs, if any, and schedule its next
+ * update.
+ * @param id Set to the item to update
+ * @returns True when an item is due
+ */
+bool PeriodicScheduler::takeDue(qint64 nowMs, int *id)
+{
+    dropStale();
+    if (heap.isEmpty() || heap.first().dueMs > nowMs)
+        return false;
+
+    std::pop_heap(heap.begin(), heap.end());
+    *id = heap.last().id;
+    heap.removeLast();
+
+    Item &item = items[*id];
+    qint64 lateMs = nowMs - item.dueMs;
+    item.stats.updates++;
+    item.stats.jitterSumMs += lateMs;
+    item.stats.maxJitterMs = qMax(item.stats.maxJitterMs, (qint32) qMin(lateMs, (qint64) INT_MAX));
+
+    // Keep the phase, skipping the periods missed entirely
+    qint64 missed = lateMs / item.periodMs;
+    item.stats.missedUpdates += missed;
+    item.dueMs += (missed + 1) * item.periodMs;
+    push(*id);
+
+    return true;
+}
+
+void PeriodicScheduler::resetStats()
+{
+    for (int i = 0; i < items.size(); i++)
+        items[i].stats = Stats();
+}
+
+void PeriodicScheduler::push(int id)
+{
+    const Item &item = items.at(id);
+    Entry entry;
+    entry.dueMs = item.dueMs;
+    entry.id = id;
+    entry.generation = item.generation;
+    heap.append(entry);
+    std::push_heap(heap.begin(), heap.end());
+}
+
+/**
+ * Drop the stale entries from the top of the heap
+ */
+void PeriodicScheduler::dropStale()
+{
+    while (!heap.isEmpty() && heap.first().generation != items.at(heap.first().id).generation) {
+        std::pop_heap(heap.begin(), heap.end());
+        heap.removeLast();
+    }
+}
+
+void PeriodicScheduler::rebuild()
+{
+    heap.clear();
+    for (int id = 0; id < items.size(); id++) {
+        if (items.at(id).periodMs > 0)
+            push(id);
+    }
+}
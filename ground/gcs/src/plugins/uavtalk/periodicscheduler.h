@@ -0,0 +1,99 @@
+/**
+ ******************************************************************************
+ * @file       periodicscheduler.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVTalkPlugin UAVTalk Plugin
+ * @{
+ * @brief Schedules the periodic updates of the telemetry objects
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef PERIODICSCHEDULER_H
+#define PERIODICSCHEDULER_H
+
+#include <QtGlobal>
+#include <QVector>
+
+/**
+ * @brief The PeriodicScheduler class Keeps the next due time of items updated
+ * periodically in a min-heap, so that finding the due items costs as much as
+ * there are due items rather than as much as there are items. Times are in
+ * ms on any monotonic clock.
+ *
+ * Updates keep the phase of the schedule: an update done late does not delay
+ * the following ones, and the periods missed entirely are skipped and
+ * counted. The lateness of every update is kept as the jitter of its item.
+ */
+class PeriodicScheduler
+{
+public:
+    /**
+     * @brief The Stats struct Timing of the updates of an item
+     */
+    struct Stats {
+        Stats() : updates(0), missedUpdates(0), jitterSumMs(0), maxJitterMs(0) {}
+        quint32 updates;
+        quint32 missedUpdates;
+        qint64 jitterSumMs;
+        qint32 maxJitterMs;
+        double getMeanJitterMs() const {return updates > 0 ? (double) jitterSumMs / updates : 0;}
+    };
+
+    PeriodicScheduler();
+
+    void setPeriod(int id, qint32 periodMs, qint64 firstDueMs);
+    qint32 getPeriod(int id) const;
+    int count() const {return scheduled;}
+    bool isEmpty() const {return scheduled == 0;}
+    qint64 nextDueMs();
+
+    bool takeDue(qint64 nowMs, int *id);
+
+    const Stats &getStats(int id) const {return items.at(id).stats;}
+    int getNumItems() const {return items.size();}
+    void resetStats();
+
+private:
+    struct Item {
+        Item() : periodMs(0), dueMs(0), generation(0) {}
+        qint32 periodMs;
+        qint64 dueMs;
+        //! Incremented when rescheduled, older entries in the heap are stale
+        quint32 generation;
+        Stats stats;
+    };
+
+    struct Entry {
+        qint64 dueMs;
+        int id;
+        quint32 generation;
+        //! Heap ordering, the earliest entry on top
+        bool operator<(const Entry &other) const {return dueMs > other.dueMs;}
+    };
+
+    void push(int id);
+    void dropStale();
+    void rebuild();
+
+    QVector<Item> items;
+    QVector<Entry> heap;
+    int scheduled;
+};
+
+#endif // PERIODICSCHEDULER_H
@@ -0,0 +1,76 @@
+/**
+ ******************************************************************************
+ * @file       roundtripestimator.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVTalkPlugin UAVTalk Plugin
+ * @{
+ * @brief Estimates the round trip time of the telemetry transactions
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "roundtripestimator.h"
+
+#include <math.h>
+
+RoundTripEstimator::RoundTripEstimator(qint32 initialTimeoutMs, qint32 minTimeoutMs, qint32 maxTimeoutMs) :
+    initialTimeoutMs(initialTimeoutMs),
+    minTimeoutMs(minTimeoutMs),
+    maxTimeoutMs(maxTimeoutMs)
+{
+    reset();
+}
+
+/**
+ * Update the estimate with the round trip of a transaction answered without
+ * a retry
+ */
+void RoundTripEstimator::addSample(qint32 roundTripMs)
+{
+    double sample = qMax(roundTripMs, 0);
+    if (samples == 0) {
+        smoothedMs = sample;
+        variationMs = sample / 2;
+    } else {
+        variationMs = 0.75 * variationMs + 0.25 * fabs(smoothedMs - sample);
+        smoothedMs = 0.875 * smoothedMs + 0.125 * sample;
+    }
+    samples++;
+
+    double timeout = ceil(smoothedMs + qMax(4 * variationMs, 1.0));
+    timeoutMs = qBound(minTimeoutMs, (qint32) qMin(timeout, (double) maxTimeoutMs), maxTimeoutMs);
+}
+
+/**
+ * Double the timeout after a transaction timed out
+ */
+void RoundTripEstimator::backOff()
+{
+    timeoutMs = qMin(2 * timeoutMs, maxTimeoutMs);
+}
+
+/**
+ * Forget the samples, back to the initial timeout
+ */
+void RoundTripEstimator::reset()
+{
+    samples = 0;
+    smoothedMs = 0;
+    variationMs = 0;
+    timeoutMs = initialTimeoutMs;
+}
@@ -0,0 +1,64 @@
+/**
+ ******************************************************************************
+ * @file       roundtripestimator.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVTalkPlugin UAVTalk Plugin
+ * @{
+ * @brief Estimates the round trip time of the telemetry transactions
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef ROUNDTRIPESTIMATOR_H
+#define ROUNDTRIPESTIMATOR_H
+
+#include <QtGlobal>
+
+/**
+ * @brief The RoundTripEstimator class Smoothed round trip time of a link and
+ * its variation, and the timeout of the transactions derived from them as
+ * done by TCP (RFC 6298). Only the transactions answered without a retry are
+ * sampled, as the answers to the retries cannot be told apart. Every timeout
+ * doubles the timeout until the next sample.
+ */
+class RoundTripEstimator
+{
+public:
+    RoundTripEstimator(qint32 initialTimeoutMs, qint32 minTimeoutMs, qint32 maxTimeoutMs);
+
+    void addSample(qint32 roundTripMs);
+    void backOff();
+    void reset();
+
+    bool hasSamples() const {return samples > 0;}
+    double getSmoothedMs() const {return smoothedMs;}
+    double getVariationMs() const {return variationMs;}
+    qint32 getTimeoutMs() const {return timeoutMs;}
+
+private:
+    qint32 initialTimeoutMs;
+    qint32 minTimeoutMs;
+    qint32 maxTimeoutMs;
+
+    quint32 samples;
+    double smoothedMs;
+    double variationMs;
+    qint32 timeoutMs;
+};
+
+#endif // ROUNDTRIPESTIMATOR_H
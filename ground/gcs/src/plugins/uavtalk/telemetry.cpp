@@ -30,7 +30,6 @@
 #include "telemetry.h"
 #include "hwtaulink.h"
 #include "objectpersistence.h"
-#include <QTime>
 #include <QtGlobal>
 #include <stdlib.h>
 #include <QDebug>
@@ -76,11 +75,24 @@ public:
 /**
  * Constructor
  */
-Telemetry::Telemetry(UAVTalk* utalk, UAVObjectManager* objMngr)
+Telemetry::Telemetry(UAVTalk* utalk, UAVObjectManager* objMngr) :
+    txQueue(MAX_QUEUE_SIZE),
+    roundTrip(REQ_TIMEOUT_MS, MIN_REQ_TIMEOUT_MS, MAX_REQ_TIMEOUT_MS)
 {
     this->utalk = utalk;
     this->objMngr = objMngr;
     mutex = new QMutex(QMutex::Recursive);
+    // Setup the periodic timer, started as the objects are registered
+    clock.start();
+    updateTimer = new QTimer(this);
+    updateTimer->setTimerType(Qt::PreciseTimer);
+    updateTimer->setSingleShot(true);
+    connect(updateTimer, SIGNAL(timeout()), this, SLOT(processPeriodicUpdates()));
+    // Setup the timer resuming the transmit queue when paced
+    txPacingTimer = new QTimer(this);
+    txPacingTimer->setTimerType(Qt::PreciseTimer);
+    txPacingTimer->setSingleShot(true);
+    connect(txPacingTimer, SIGNAL(timeout()), this, SLOT(processPacedQueue()));
     // Process all objects in the list
     QVector< QVector<UAVObject*> > objs = objMngr->getObjectsVector();
     const int objSize = objs.size();
@@ -96,11 +108,8 @@ Telemetry::Telemetry(UAVTalk* utalk, UAVObjectManager* objMngr)
     connect(utalk, SIGNAL(nackReceived(UAVObject*)), this, SLOT(transactionFailure(UAVObject*)));
     // Get GCS stats object
     gcsStatsObj = GCSTelemetryStats::GetInstance(objMngr);
-    // Setup and start the periodic timer
-    timeToNextUpdateMs = 0;
-    updateTimer = new QTimer(this);
-    connect(updateTimer, SIGNAL(timeout()), this, SLOT(processPeriodicUpdates()));
-    updateTimer->start(1000);
+    // Start the periodic timer
+    startUpdateTimer();
     // Setup and start the stats timer
     txErrors = 0;
     txRetries = 0;
@@ -130,23 +139,13 @@ void Telemetry::registerObject(UAVObject* obj)
  */
 void Telemetry::addObject(UAVObject* obj)
 {
-    // Check if object type is already in the list
-    const QVector<ObjectTimeInfo>::iterator iterEnd = objList.end();
-    for (QVector<ObjectTimeInfo>::const_iterator iter = objList.constBegin(); iter != iterEnd; ++iter)
-    {
-        if (iter->obj->getObjID() == obj->getObjID())
-        {
-            // Object type (not instance!) is already in the list, do nothing
-            return;
-        }
-    }
+    // Object type (not instance!) is already in the list, do nothing
+    if (objIndex.contains(obj->getObjID()))
+        return;
 
     // If this point is reached, then the object type is new, let's add it
-    ObjectTimeInfo timeInfo;
-    timeInfo.obj = obj;
-    timeInfo.timeToNextUpdateMs = 0;
-    timeInfo.updatePeriodMs = 0;
-    objList.append(timeInfo);
+    objIndex.insert(obj->getObjID(), objList.size());
+    objList.append(obj);
 }
 
 /**
@@ -155,17 +154,31 @@ void Telemetry::addObject(UAVObject* obj)
 void Telemetry::setUpdatePeriod(UAVObject* obj, qint32 periodMs)
 {
     // Find object type (not instance!) and update its period
-    const quint32 objID = obj->getObjID();
+    QHash<quint32, int>::const_iterator iter = objIndex.constFind(obj->getObjID());
+    if (iter == objIndex.constEnd())
+        return;
 
-    const QVector<ObjectTimeInfo>::iterator iterEnd = objList.end();
-    for (QVector<ObjectTimeInfo>::iterator iter = objList.begin(); iter != iterEnd; ++iter)
-    {
-        if (iter->obj->getObjID() == objID)
-        {
-            iter->updatePeriodMs = periodMs;
-            iter->timeToNextUpdateMs = quint32((float)periodMs * (float)qrand() / (float)RAND_MAX); // avoid bunching of updates
-        }
-    }
+    // The object is updated again after every transaction, keep the phase of
+    // its updates unless its period changed
+    const int index = iter.value();
+    if (scheduler.getPeriod(index) == periodMs)
+        return;
+
+    qint64 firstDueMs = clock.elapsed() + qint64((float)periodMs * (float)qrand() / (float)RAND_MAX); // avoid bunching of updates
+    scheduler.setPeriod(index, periodMs, firstDueMs);
+    startUpdateTimer();
+}
+
+/**
+ * Start the timer for the next periodic update
+ */
+void Telemetry::startUpdateTimer()
+{
+    qint64 delayMs = MAX_UPDATE_PERIOD_MS;
+    qint64 nextDueMs = scheduler.nextDueMs();
+    if (nextDueMs >= 0)
+        delayMs = qBound((qint64) MIN_UPDATE_PERIOD_MS, nextDueMs - clock.elapsed(), (qint64) MAX_UPDATE_PERIOD_MS);
+    updateTimer->start(delayMs);
 }
 
 /**
@@ -349,8 +362,14 @@ bool Telemetry::updateTransactionMap(UAVObject* obj, bool request)
         ObjectTransactionInfo *transInfo = itr.value();
         // Remove this transaction as it is complete.
         transInfo->timer->stop();
+        if (!transInfo->timedOut)
+            roundTrip.addSample(clock.elapsed() - transInfo->sentMs);
         transMap.remove(key);
+        updateTransactionWindow();
         delete transInfo;
+        // The updates of the object held back during the transaction can be sent
+        if (!request)
+            txQueue.setBusy(obj, false);
         return true;
     }
     return false;
@@ -363,6 +382,8 @@ bool Telemetry::updateTransactionMap(UAVObject* obj, bool request)
 void Telemetry::transactionTimeout(ObjectTransactionInfo *transInfo)
 {
     transInfo->timer->stop();
+    transInfo->timedOut = true;
+    roundTrip.backOff();
     // Check if more retries are pending
     if (transInfo->retriesRemaining > 0)
     {
@@ -385,6 +406,7 @@ void Telemetry::transactionTimeout(ObjectTransactionInfo *transInfo)
  */
 void Telemetry::processObjectTransaction(ObjectTransactionInfo *transInfo)
 {
+    txBucket.consume(clock.elapsed(), transactionBytes(transInfo->obj, transInfo->objRequest, transInfo->allInstances));
 
     // Initiate transaction
     if (transInfo->objRequest)
@@ -398,53 +420,50 @@ void Telemetry::processObjectTransaction(ObjectTransactionInfo *transInfo)
     // Start timer if a response is expected
     if ( transInfo->objRequest || transInfo->acked )
     {
-        transInfo->timer->start(REQ_TIMEOUT_MS);
+        transInfo->sentMs = clock.elapsed();
+        transInfo->timer->start(roundTrip.getTimeoutMs());
     }
     else
     {
         // Stop tracking this transaction, since we're not expecting a response:
         transMap.remove(TransactionKey(transInfo->obj, transInfo->objRequest));
+        updateTransactionWindow();
         delete transInfo;
     }
 }
 
+/**
+ * Hold back the transactions expecting a response while the window of
+ * transactions in flight is full, the other events go on
+ */
+void Telemetry::updateTransactionWindow()
+{
+    txQueue.setWindowFull(transMap.size() >= MAX_TRANSACTIONS_IN_FLIGHT);
+}
+
 /**
  * Process the event received from an object we are following. This method
  * only enqueues objects for later processing
  */
 void Telemetry::processObjectUpdates(UAVObject* obj, EventMask event, bool allInstances, bool priority)
 {
-    // Push event into queue
-    ObjectQueueInfo objInfo;
+    // Push event into queue, the updates sent while a transaction of the
+    // object is in progress wait for it to complete
+    TransmitQueue::Entry objInfo;
     objInfo.obj = obj;
+    objInfo.objId = obj->getObjID();
     objInfo.event = event;
     objInfo.allInstances = allInstances;
-    if (priority)
-    {
-        if ( objPriorityQueue.length() < MAX_QUEUE_SIZE )
-        {
-            objPriorityQueue.enqueue(objInfo);
-        }
-        else
-        {
-            ++txErrors;
-            obj->emitTransactionCompleted(false);
-            obj->emitTransactionCompleted(false,false);
-            TELEMETRY_QXTLOG_DEBUG(QString(tr("Telemetry: priority event queue is full, event lost (%1)").arg(obj->getName())));
-        }
-    }
-    else
+    objInfo.priority = priority;
+    objInfo.waitsForTransaction = ( event == EV_UPDATED || event == EV_UPDATED_MANUAL || event == EV_UPDATED_PERIODIC );
+    objInfo.expectsResponse = ( event == EV_UPDATE_REQ ) ||
+            ( objInfo.waitsForTransaction && UAVObject::GetGcsTelemetryAcked(obj->getMetadata()) );
+    if ( !txQueue.enqueue(objInfo, clock.elapsed()) )
     {
-        if ( objQueue.length() < MAX_QUEUE_SIZE )
-        {
-            objQueue.enqueue(objInfo);
-        }
-        else
-        {
-            ++txErrors;
-            obj->emitTransactionCompleted(false,false);
-            obj->emitTransactionCompleted(false);
-        }
+        ++txErrors;
+        obj->emitTransactionCompleted(false);
+        obj->emitTransactionCompleted(false,false);
+        TELEMETRY_QXTLOG_DEBUG(QString(tr("Telemetry: event queue is full, event lost (%1)").arg(obj->getName())));
     }
     // Process the transaction queue
     processObjectQueue();
@@ -455,31 +474,41 @@ void Telemetry::processObjectUpdates(UAVObject* obj, EventMask event, bool allIn
  */
 void Telemetry::processObjectQueue()
 {
-    if (objQueue.length() > 1)
+    if (txQueue.size() > 1)
     {
         TELEMETRY_QXTLOG_DEBUG("[telemetry.cpp] **************** Object Queue above 1 in backlog ****************");
     }
-    // Get object information from queue (first the priority and then the regular queue)
-    ObjectQueueInfo objInfo;
-    if ( !objPriorityQueue.isEmpty() )
+    // Get object information from queue (first the priority and then the regular entries)
+    const TransmitQueue::Entry *next = txQueue.peek();
+    if ( next == NULL )
     {
-        objInfo = objPriorityQueue.dequeue();
-    }
-    else if ( !objQueue.isEmpty() )
-    {
-        objInfo = objQueue.dequeue();
+        return;
     }
-    else
+
+    // Hold the transactions back until the link has the bandwidth for them,
+    // meanwhile newer events of the same objects are coalesced into them
+    if ( txBucket.isLimited() && next->event != EV_UNPACKED )
     {
-        return;
+        qint64 delayMs = txBucket.delayMs(clock.elapsed(), transactionBytes(next->obj, next->event == EV_UPDATE_REQ, next->allInstances));
+        if ( delayMs > 0 )
+        {
+            if ( !txPacingTimer->isActive() )
+            {
+                txPacingTimer->start(delayMs);
+            }
+            return;
+        }
     }
 
+    TransmitQueue::Entry objInfo;
+    txQueue.take(clock.elapsed(), &objInfo);
+
     // Check if a connection has been established, only process GCSTelemetryStats updates
     // (used to establish the connection)
     GCSTelemetryStats::DataFields gcsStats = gcsStatsObj->getData();
     if ( gcsStats.Status != GCSTelemetryStats::STATUS_CONNECTED )
     {
-        objQueue.clear();
+        txQueue.clearRegular();
         if ( objInfo.obj->getObjID() != GCSTelemetryStats::OBJID &&
              objInfo.obj->getObjID() != HwTauLink::OBJID &&
              objInfo.obj->getObjID() != ObjectPersistence::OBJID )
@@ -523,6 +552,11 @@ void Telemetry::processObjectQueue()
             // Insert the transaction into the transaction map.
             TransactionKey key(objInfo.obj, transInfo->objRequest);
             transMap.insert(key, transInfo);
+            updateTransactionWindow();
+            if ( !transInfo->objRequest && transInfo->acked )
+            {
+                txQueue.setBusy(objInfo.obj, true);
+            }
             processObjectTransaction(transInfo);
         }
     }
@@ -564,54 +598,46 @@ void Telemetry::processPeriodicUpdates()
     // Stop timer
     updateTimer->stop();
 
-    // Iterate through each object and update its timer, if zero then transmit object.
-    // Also calculate smallest delay to next update (will be used for setting timeToNextUpdateMs)
-    qint32 minDelay = MAX_UPDATE_PERIOD_MS;
-    qint32 elapsedMs = 0;
-    QTime time;
-    qint32 offset;
-
-    const QVector<ObjectTimeInfo>::iterator objInfoEnd = objList.end();
-    for (QVector<ObjectTimeInfo>::iterator objinfo = objList.begin(); objinfo != objInfoEnd; ++objinfo)
+    // Send the objects due, at most once each so that slow sends cannot keep
+    // this loop running
+    int index;
+    int budget = scheduler.count();
+    while (budget-- > 0 && scheduler.takeDue(clock.elapsed(), &index))
     {
-        // If object is configured for periodic updates
-        // FixMe: This is an inefficient process as it depends on polling. It would be better to have
-        // this functionality be driven through timers.
-        if (objinfo->updatePeriodMs > 0)
-        {
-            objinfo->timeToNextUpdateMs -= timeToNextUpdateMs;
-            // Check if time for the next update
-            if (objinfo->timeToNextUpdateMs <= 0)
-            {
-                // Reset timer
-                offset = (-objinfo->timeToNextUpdateMs) % objinfo->updatePeriodMs;
-                objinfo->timeToNextUpdateMs = objinfo->updatePeriodMs - offset;
-                // Send object
-                time.start();
-                processObjectUpdates(objinfo->obj, EV_UPDATED_PERIODIC, true, false);
-                elapsedMs = time.elapsed();
-                // Update timeToNextUpdateMs with the elapsed delay of sending the object;
-                timeToNextUpdateMs += elapsedMs;
-            }
-            // Update minimum delay
-            if (objinfo->timeToNextUpdateMs < minDelay)
-            {
-                minDelay = objinfo->timeToNextUpdateMs;
-            }
-        }
+        processObjectUpdates(objList[index], EV_UPDATED_PERIODIC, true, false);
     }
 
-    // Check if delay for the next update is too short
-    if (minDelay < MIN_UPDATE_PERIOD_MS)
+    // Restart timer
+    startUpdateTimer();
+}
+
+/**
+ * @brief Telemetry::processPacedQueue Send the transactions held back by the
+ * rate limit as the link has the bandwidth for them
+ */
+void Telemetry::processPacedQueue()
+{
+    QMutexLocker locker(mutex);
+
+    int budget = txQueue.size();
+    while ( budget-- > 0 && txQueue.peek() != NULL && !txPacingTimer->isActive() )
     {
-        minDelay = MIN_UPDATE_PERIOD_MS;
+        processObjectQueue();
     }
+}
 
-    // Done
-    timeToNextUpdateMs = minDelay;
-
-    // Restart timer
-    updateTimer->start(timeToNextUpdateMs);
+/**
+ * Bytes sent on the link by a transaction, for the rate limit
+ */
+quint32 Telemetry::transactionBytes(UAVObject* obj, bool objRequest, bool allInstances)
+{
+    quint32 packetBytes = UAVTalk::MAX_HEADER_LENGTH + UAVTalk::CHECKSUM_LENGTH;
+    if ( objRequest )
+    {
+        return packetBytes;
+    }
+    quint32 instances = allInstances ? qMax(objMngr->getNumInstances(obj->getObjID()), 1) : 1;
+    return instances * (packetBytes + obj->getNumBytes());
 }
 
 Telemetry::TelemetryStats Telemetry::getStats()
@@ -632,6 +658,38 @@ Telemetry::TelemetryStats Telemetry::getStats()
     stats.txErrors = utalkStats.txErrors + txErrors;
     stats.rxErrors = utalkStats.rxErrors;
     stats.txRetries = txRetries;
+    stats.txInFlight = transMap.size();
+    stats.roundTripMs = roundTrip.getSmoothedMs();
+    stats.transactionTimeoutMs = roundTrip.getTimeoutMs();
+
+    // Time waited in the transmit queue
+    const QHash<quint32, TransmitQueue::WaitStats> &waitStats = txQueue.getWaitStats();
+    for (QHash<quint32, TransmitQueue::WaitStats>::const_iterator iter = waitStats.constBegin(); iter != waitStats.constEnd(); ++iter)
+    {
+        QueueWaitStats queueWait;
+        queueWait.objId = iter.key();
+        queueWait.transactions = iter.value().taken;
+        queueWait.coalesced = iter.value().coalesced;
+        queueWait.meanWaitMs = iter.value().getMeanWaitMs();
+        queueWait.maxWaitMs = iter.value().maxWaitMs;
+        stats.queueWaits.append(queueWait);
+    }
+
+    // Timing of the periodic updates
+    for (int index = 0; index < scheduler.getNumItems(); ++index)
+    {
+        const PeriodicScheduler::Stats &schedulerStats = scheduler.getStats(index);
+        if (scheduler.getPeriod(index) <= 0 && schedulerStats.updates == 0)
+            continue;
+        PeriodicUpdateStats updateStats;
+        updateStats.objId = objList[index]->getObjID();
+        updateStats.updatePeriodMs = scheduler.getPeriod(index);
+        updateStats.updates = schedulerStats.updates;
+        updateStats.missedUpdates = schedulerStats.missedUpdates;
+        updateStats.meanJitterMs = schedulerStats.getMeanJitterMs();
+        updateStats.maxJitterMs = schedulerStats.maxJitterMs;
+        stats.periodicUpdates.append(updateStats);
+    }
 
     // Done
     return stats;
@@ -643,6 +701,25 @@ void Telemetry::resetStats()
     utalk->resetStats();
     txErrors = 0;
     txRetries = 0;
+    scheduler.resetStats();
+    txQueue.resetStats();
+}
+
+/**
+ * Limit the bytes sent to the link to \a bytesPerSecond, 0 to send as fast as
+ * the events come. While the link is busy, newer events of the queued objects
+ * are coalesced into the transactions waiting.
+ */
+void Telemetry::setTxRateLimit(quint32 bytesPerSecond)
+{
+    QMutexLocker locker(mutex);
+    quint32 burstBytes = qMax(bytesPerSecond * TX_BURST_MS / 1000, (quint32) UAVTalk::MAX_PACKET_LENGTH);
+    txBucket.setRate(bytesPerSecond, burstBytes);
+    if ( !txBucket.isLimited() )
+    {
+        txPacingTimer->stop();
+        processPacedQueue();
+    }
 }
 
 void Telemetry::objectUpdatedAuto(UAVObject* obj)
@@ -700,6 +777,8 @@ ObjectTransactionInfo::ObjectTransactionInfo(QObject* parent):QObject(parent)
     objRequest = false;
     retriesRemaining = 0;
     acked = false;
+    sentMs = 0;
+    timedOut = false;
     telem = 0;
     // Setup transaction timer
     timer = new QTimer(this);
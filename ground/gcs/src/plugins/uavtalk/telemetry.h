@@ -33,11 +33,16 @@
 #include "uavtalk.h"
 #include "uavobjectmanager.h"
 #include "gcstelemetrystats.h"
+#include "periodicscheduler.h"
+#include "transmitqueue.h"
+#include "roundtripestimator.h"
 #include <QMutex>
 #include <QMutexLocker>
 #include <QTimer>
-#include <QQueue>
 #include <QMap>
+#include <QHash>
+#include <QList>
+#include <QElapsedTimer>
 
 class TransactionKey;
 
@@ -52,6 +57,9 @@ public:
     bool objRequest;
     qint32 retriesRemaining;
     bool acked;
+    qint64 sentMs;
+    //! Answers to retried transactions are not round trip samples
+    bool timedOut;
     QPointer<class Telemetry>telem;
     QTimer* timer;
 private slots:
@@ -63,6 +71,31 @@ class Telemetry: public QObject
     Q_OBJECT
 
 public:
+    /**
+     * Timing of the periodic updates of an object, the jitter is how late
+     * the updates were sent
+     */
+    typedef struct {
+        quint32 objId;
+        qint32 updatePeriodMs;
+        quint32 updates;
+        quint32 missedUpdates;
+        double meanJitterMs;
+        qint32 maxJitterMs;
+    } PeriodicUpdateStats;
+
+    /**
+     * Time the transactions of an object waited in the transmit queue, and
+     * events coalesced into the pending transactions
+     */
+    typedef struct {
+        quint32 objId;
+        quint32 transactions;
+        quint32 coalesced;
+        double meanWaitMs;
+        qint32 maxWaitMs;
+    } QueueWaitStats;
+
     typedef struct {
         quint32 txBytes;
         quint32 rxBytes;
@@ -73,23 +106,37 @@ public:
         quint32 txErrors;
         quint32 rxErrors;
         quint32 txRetries;
+        QList<PeriodicUpdateStats> periodicUpdates;
+        QList<QueueWaitStats> queueWaits;
+        quint32 txInFlight;
+        double roundTripMs;
+        qint32 transactionTimeoutMs;
     } TelemetryStats;
 
     Telemetry(UAVTalk* utalk, UAVObjectManager* objMngr);
     ~Telemetry();
     TelemetryStats getStats();
     void resetStats();
+    void setTxRateLimit(quint32 bytesPerSecond);
     void transactionTimeout(ObjectTransactionInfo *info);
 
 signals:
 
 private:
     // Constants
+    //! Timeout until the round trip of the link is known, and its bounds
     static const int REQ_TIMEOUT_MS = 250;
+    static const int MIN_REQ_TIMEOUT_MS = 100;
+    static const int MAX_REQ_TIMEOUT_MS = 2000;
+    //! Transactions waiting for a response at once
+    static const int MAX_TRANSACTIONS_IN_FLIGHT = 8;
     static const int MAX_RETRIES = 2;
     static const int MAX_UPDATE_PERIOD_MS = 1000;
     static const int MIN_UPDATE_PERIOD_MS = 1;
-    static const int MAX_QUEUE_SIZE = 20;
+    //! Distinct object instances and events pending, events of the same ones are coalesced
+    static const int MAX_QUEUE_SIZE = 256;
+    //! Time to send at the rate limit, as bursts
+    static const int TX_BURST_MS = 100;
 
     // Types
     /**
@@ -104,30 +151,23 @@ private:
         EV_UPDATE_REQ = 0x010       /** Request to update object data */
     } EventMask;
 
-    typedef struct {
-        UAVObject* obj;
-        qint32 updatePeriodMs;      /** Update period in ms or 0 if no periodic updates are needed */
-        qint32 timeToNextUpdateMs;  /** Time delay to the next update */
-    } ObjectTimeInfo;
-
-    typedef struct {
-        UAVObject* obj;
-        EventMask event;
-        bool allInstances;
-    } ObjectQueueInfo;
-
     // Variables
     UAVObjectManager* objMngr;
     UAVTalk* utalk;
     GCSTelemetryStats* gcsStatsObj;
-    QVector<ObjectTimeInfo> objList;
-    QQueue<ObjectQueueInfo> objQueue;
-    QQueue<ObjectQueueInfo> objPriorityQueue;
+    //! Object types with periodic updates, indexed by their id in the scheduler
+    QVector<UAVObject*> objList;
+    QHash<quint32, int> objIndex;
+    PeriodicScheduler scheduler;
+    QElapsedTimer clock;
+    TransmitQueue txQueue;
+    TokenBucket txBucket;
+    QTimer* txPacingTimer;
+    RoundTripEstimator roundTrip;
     QMap<TransactionKey, ObjectTransactionInfo*>transMap;
     QMutex* mutex;
     QTimer* updateTimer;
     QTimer* statsTimer;
-    qint32 timeToNextUpdateMs;
     quint32 txErrors;
     quint32 txRetries;
 
@@ -135,12 +175,15 @@ private:
     void registerObject(UAVObject* obj);
     void addObject(UAVObject* obj);
     void setUpdatePeriod(UAVObject* obj, qint32 periodMs);
+    void startUpdateTimer();
     void connectToObjectInstances(UAVObject* obj, quint32 eventMask);
     void updateObject(UAVObject* obj, quint32 eventMask);
     void processObjectUpdates(UAVObject* obj, EventMask event, bool allInstances, bool priority);
     void processObjectTransaction(ObjectTransactionInfo *transInfo);
     void processObjectQueue();
     bool updateTransactionMap(UAVObject* obj, bool request);
+    quint32 transactionBytes(UAVObject* obj, bool objRequest, bool allInstances);
+    void updateTransactionWindow();
 
 
 private slots:
@@ -153,6 +196,7 @@ private slots:
     void newObject(UAVObject* obj);
     void newInstance(UAVObject* obj);
     void processPeriodicUpdates();
+    void processPacedQueue();
     void transactionSuccess(UAVObject* obj);
     void transactionFailure(UAVObject* obj);
     void transactionRequestCompleted(UAVObject* obj);
@@ -66,6 +66,13 @@ void TelemetryManager::onStart()
 {
     utalk = new UAVTalk(device, objMngr);
     telemetry = new Telemetry(utalk, objMngr);
+
+    // Pace the transmissions to serial links, 10 bits per byte on the wire
+    bool ok;
+    qint32 baudRate = device->property("baudRate").toInt(&ok);
+    if (ok && baudRate > 0)
+        telemetry->setTxRateLimit(baudRate / 10);
+
     telemetryMon = new TelemetryMonitor(objMngr, telemetry, sessions);
     connect(telemetryMon, SIGNAL(connected()), this, SLOT(onConnect()));
     connect(telemetryMon, SIGNAL(disconnected()), this, SLOT(onDisconnect()));
@@ -0,0 +1,17 @@
+# Benchmark of the scheduler of the periodic telemetry updates.
+# Set PERIODICSCHEDULER_BENCH_OBJECTS to the number of scheduled objects,
+# 500 by default.
+
+QT += testlib
+QT -= gui
+TARGET = periodicschedulerbenchmark
+CONFIG += console testcase
+CONFIG -= app_bundle
+TEMPLATE = app
+
+include(../../../../../gcs.pri)
+
+INCLUDEPATH *= ../..
+
+SOURCES += tst_periodicschedulerbenchmark.cpp \
+    ../../periodicscheduler.cpp
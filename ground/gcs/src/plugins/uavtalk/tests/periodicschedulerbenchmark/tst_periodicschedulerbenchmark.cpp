@@ -0,0 +1,271 @@
+/**
+ ******************************************************************************
+ * @file       tst_periodicschedulerbenchmark.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVTalkPlugin UAVTalk Plugin
+ * @{
+ * @brief Schedules the periodic updates of hundreds of objects at mixed
+ * rates with a timer firing late, polling all the objects as done before or
+ * in the heap of the scheduler, and checks the updates keep to their periods
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <QtTest/QtTest>
+#include <QElapsedTimer>
+
+#include "periodicscheduler.h"
+
+class tst_PeriodicSchedulerBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void schedule_data();
+    void schedule();
+    void reschedulingKeepsPhase();
+    void unscheduling();
+
+private:
+    int m_objects;
+};
+
+//! Simulated time of the benchmark
+static const qint64 DURATION_MS = 600000;
+//! Most the update timer fires late
+static const int TIMER_LATENCY_MS = 2;
+static const int MIN_UPDATE_PERIOD_MS = 1;
+static const int MAX_UPDATE_PERIOD_MS = 1000;
+
+//! Mixed rates, as set by the metadata of the objects, 0 for the objects
+//! only sent on change
+static qint32 periodOf(int object)
+{
+    static const qint32 periods[] = {0, 5, 0, 10, 20, 0, 50, 100, 0, 250, 1000, 0, 5000};
+    return periods[object % (sizeof(periods) / sizeof(periods[0]))];
+}
+
+//! Updates expected from all the objects over the benchmark
+static quint32 expectedUpdates(int objects)
+{
+    quint32 updates = 0;
+    for (int i = 0; i < objects; i++) {
+        if (periodOf(i) > 0)
+            updates += DURATION_MS / periodOf(i);
+    }
+    return updates;
+}
+
+/**
+ * Updates sent polling all the objects every time the timer fires, as done
+ * before: the time to the next update of every object is counted down by the
+ * delay the timer was started with, however late it fired
+ */
+static quint32 pollObjects(int objects, int *timerEvents)
+{
+    QVector<qint32> periodMs(objects);
+    QVector<qint32> timeToNextUpdateMs(objects);
+    for (int i = 0; i < objects; i++) {
+        periodMs[i] = periodOf(i);
+        timeToNextUpdateMs[i] = periodMs[i] > 0 ? qrand() % periodMs[i] : 0;
+    }
+
+    quint32 updates = 0;
+    qint32 delayMs = 0;
+    *timerEvents = 0;
+    for (qint64 nowMs = 0; nowMs < DURATION_MS; (*timerEvents)++) {
+        qint32 minDelay = MAX_UPDATE_PERIOD_MS;
+        for (int i = 0; i < objects; i++) {
+            if (periodMs[i] > 0) {
+                timeToNextUpdateMs[i] -= delayMs;
+                if (timeToNextUpdateMs[i] <= 0) {
+                    qint32 offset = (-timeToNextUpdateMs[i]) % periodMs[i];
+                    timeToNextUpdateMs[i] = periodMs[i] - offset;
+                    updates++;
+                }
+                minDelay = qMin(minDelay, timeToNextUpdateMs[i]);
+            }
+        }
+        delayMs = qMax(minDelay, MIN_UPDATE_PERIOD_MS);
+        nowMs += delayMs + qrand() % (TIMER_LATENCY_MS + 1);
+    }
+
+    return updates;
+}
+
+/**
+ * Updates sent taking the due objects from the scheduler
+ */
+static quint32 scheduleObjects(PeriodicScheduler &scheduler, int objects, int *timerEvents)
+{
+    for (int i = 0; i < objects; i++) {
+        if (periodOf(i) > 0)
+            scheduler.setPeriod(i, periodOf(i), qrand() % periodOf(i));
+    }
+
+    quint32 updates = 0;
+    *timerEvents = 0;
+    for (qint64 nowMs = 0; nowMs < DURATION_MS; (*timerEvents)++) {
+        int id;
+        int budget = scheduler.count();
+        while (budget-- > 0 && scheduler.takeDue(nowMs, &id))
+            updates++;
+
+        qint64 delayMs = qBound((qint64) MIN_UPDATE_PERIOD_MS, scheduler.nextDueMs() - nowMs, (qint64) MAX_UPDATE_PERIOD_MS);
+        nowMs += delayMs + qrand() % (TIMER_LATENCY_MS + 1);
+    }
+
+    return updates;
+}
+
+void tst_PeriodicSchedulerBenchmark::initTestCase()
+{
+    m_objects = qgetenv("PERIODICSCHEDULER_BENCH_OBJECTS").toInt();
+    if (m_objects <= 0)
+        m_objects = 500;
+}
+
+void tst_PeriodicSchedulerBenchmark::schedule_data()
+{
+    QTest::addColumn<int>("objects");
+
+    QTest::newRow("50") << 50;
+    QTest::newRow(qPrintable(QString::number(m_objects))) << m_objects;
+}
+
+void tst_PeriodicSchedulerBenchmark::schedule()
+{
+    QFETCH(int, objects);
+
+    double expected = expectedUpdates(objects);
+    int pollEvents, scheduleEvents;
+
+    qsrand(1);
+    QElapsedTimer timer;
+    timer.start();
+    quint32 polledUpdates = pollObjects(objects, &pollEvents);
+    double pollNs = timer.nsecsElapsed() / (double) polledUpdates;
+
+    qsrand(1);
+    PeriodicScheduler scheduler;
+    timer.start();
+    quint32 scheduledUpdates = scheduleObjects(scheduler, objects, &scheduleEvents);
+    double scheduleNs = timer.nsecsElapsed() / (double) scheduledUpdates;
+
+    double worstMeanJitterMs = 0;
+    qint32 worstMaxJitterMs = 0;
+    for (int i = 0; i < objects; i++) {
+        const PeriodicScheduler::Stats &stats = scheduler.getStats(i);
+        worstMeanJitterMs = qMax(worstMeanJitterMs, stats.getMeanJitterMs());
+        worstMaxJitterMs = qMax(worstMaxJitterMs, stats.maxJitterMs);
+    }
+
+    qDebug("%4d objects: polled %5.1f%% of the updates in %6d timer events, %5.0f ns/update",
+           objects, 100 * polledUpdates / expected, pollEvents, pollNs);
+    qDebug("%4d objects: scheduled %5.1f%% of the updates in %6d timer events, %5.0f ns/update, jitter mean %4.2f ms max %d ms",
+           objects, 100 * scheduledUpdates / expected, scheduleEvents, scheduleNs, worstMeanJitterMs, worstMaxJitterMs);
+
+    // Every period of every object is either updated or counted as missed,
+    // and no update is later than the timer
+    for (int i = 0; i < objects; i++) {
+        const PeriodicScheduler::Stats &stats = scheduler.getStats(i);
+        qint64 periods = periodOf(i) > 0 ? DURATION_MS / periodOf(i) : 0;
+        QVERIFY(qAbs((qint64) (stats.updates + stats.missedUpdates) - periods) <= 1);
+        QVERIFY(stats.maxJitterMs <= TIMER_LATENCY_MS);
+    }
+
+    // The timer firing late slows down the polled updates, not the scheduled ones
+    QVERIFY(scheduledUpdates >= polledUpdates);
+    QVERIFY(scheduledUpdates >= expected - objects);
+}
+
+/**
+ * Late updates do not shift the following ones, periods missed entirely are
+ * skipped, and setting the period again restarts the schedule
+ */
+void tst_PeriodicSchedulerBenchmark::reschedulingKeepsPhase()
+{
+    PeriodicScheduler scheduler;
+    scheduler.setPeriod(3, 10, 5);
+    QCOMPARE(scheduler.count(), 1);
+    QCOMPARE(scheduler.getPeriod(3), 10);
+    QCOMPARE(scheduler.getPeriod(2), 0);
+    QCOMPARE(scheduler.nextDueMs(), (qint64) 5);
+
+    int id = -1;
+    QVERIFY(!scheduler.takeDue(4, &id));
+    QVERIFY(scheduler.takeDue(7, &id));
+    QCOMPARE(id, 3);
+    QVERIFY(!scheduler.takeDue(7, &id));
+    QCOMPARE(scheduler.nextDueMs(), (qint64) 15);
+
+    // Due at 15, taken at 38: the updates due at 25 and 35 are missed
+    QVERIFY(scheduler.takeDue(38, &id));
+    QCOMPARE(scheduler.nextDueMs(), (qint64) 45);
+    QCOMPARE(scheduler.getStats(3).updates, (quint32) 2);
+    QCOMPARE(scheduler.getStats(3).missedUpdates, (quint32) 2);
+    QCOMPARE(scheduler.getStats(3).maxJitterMs, 23);
+    QCOMPARE(scheduler.getStats(3).getMeanJitterMs(), 12.5);
+
+    scheduler.setPeriod(3, 100, 50);
+    QCOMPARE(scheduler.count(), 1);
+    QVERIFY(!scheduler.takeDue(49, &id));
+    QVERIFY(scheduler.takeDue(50, &id));
+    QCOMPARE(scheduler.nextDueMs(), (qint64) 150);
+
+    scheduler.resetStats();
+    QCOMPARE(scheduler.getStats(3).updates, (quint32) 0);
+}
+
+/**
+ * Items with a period of 0 are not updated, and the stale entries left by
+ * rescheduling do not pile up
+ */
+void tst_PeriodicSchedulerBenchmark::unscheduling()
+{
+    PeriodicScheduler scheduler;
+    QCOMPARE(scheduler.nextDueMs(), (qint64) -1);
+
+    scheduler.setPeriod(0, 10, 0);
+    scheduler.setPeriod(1, 20, 0);
+    scheduler.setPeriod(1, 0, 0);
+    QCOMPARE(scheduler.count(), 1);
+
+    int id;
+    for (qint64 nowMs = 0; nowMs < 100; nowMs += 10) {
+        QVERIFY(scheduler.takeDue(nowMs, &id));
+        QCOMPARE(id, 0);
+        QVERIFY(!scheduler.takeDue(nowMs, &id));
+    }
+
+    for (int i = 0; i < 10000; i++)
+        scheduler.setPeriod(i % 7, 1 + i % 5, i);
+    QCOMPARE(scheduler.count(), 7);
+
+    scheduler.setPeriod(0, 0, 0);
+    for (int i = 1; i < 7; i++)
+        scheduler.setPeriod(i, 0, 0);
+    QVERIFY(scheduler.isEmpty());
+    QCOMPARE(scheduler.nextDueMs(), (qint64) -1);
+    QVERIFY(!scheduler.takeDue(1000000, &id));
+}
+
+QTEST_MAIN(tst_PeriodicSchedulerBenchmark)
+
+#include "tst_periodicschedulerbenchmark.moc"
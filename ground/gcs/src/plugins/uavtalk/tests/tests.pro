@@ -0,0 +1,6 @@
+TEMPLATE = subdirs
+
+SUBDIRS = uavtalkbenchmark \
+    periodicschedulerbenchmark \
+    transmitqueuebenchmark \
+    transactionwindowbenchmark
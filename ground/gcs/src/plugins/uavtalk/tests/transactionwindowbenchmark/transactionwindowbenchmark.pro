@@ -0,0 +1,18 @@
+# Simulates uploading settings objects over a radio link with latency and
+# packet loss, with several acked transactions in flight and adaptive
+# timeouts or as done before.
+# Set TRANSACTIONWINDOW_BENCH_OBJECTS to the objects uploaded, 60 by default.
+
+QT += testlib
+QT -= gui
+TARGET = transactionwindowbenchmark
+CONFIG += console testcase
+CONFIG -= app_bundle
+TEMPLATE = app
+
+include(../../../../../gcs.pri)
+
+INCLUDEPATH *= ../..
+
+SOURCES += tst_transactionwindowbenchmark.cpp \
+    ../../roundtripestimator.cpp
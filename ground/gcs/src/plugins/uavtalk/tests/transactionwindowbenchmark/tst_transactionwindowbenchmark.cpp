@@ -0,0 +1,284 @@
+/**
+ ******************************************************************************
+ * @file       tst_transactionwindowbenchmark.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVTalkPlugin UAVTalk Plugin
+ * @{
+ * @brief Uploads settings objects over a simulated radio link with latency
+ * and packet loss, all at once with a fixed timeout as the settings import
+ * did, one at a time as the setup wizard did, or paced with a window of acked
+ * transactions and adaptive timeouts, and checks the round trip estimator
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <QtTest/QtTest>
+#include <QMap>
+#include <math.h>
+
+#include "roundtripestimator.h"
+
+class tst_TransactionWindowBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void upload_data();
+    void upload();
+    void roundTripEstimate();
+
+private:
+    int m_objects;
+};
+
+//! 57600 baud radio in each direction
+static const double LINK_BYTES_PER_SECOND = 5760;
+//! Time on air and in the modems, each way
+static const int LATENCY_MS = 50;
+//! Settings object and its header
+static const quint32 OBJECT_BYTES = 161;
+static const quint32 ACK_BYTES = 11;
+
+//! As in Telemetry
+static const int REQ_TIMEOUT_MS = 250;
+static const int MIN_REQ_TIMEOUT_MS = 100;
+static const int MAX_REQ_TIMEOUT_MS = 2000;
+static const int MAX_RETRIES = 2;
+static const int MAX_TRANSACTIONS_IN_FLIGHT = 8;
+//! Pacing of the sends to the link, bytes sent at once
+static const double BURST_BYTES = 576;
+
+/**
+ * @brief The Link struct One direction of a serial radio link, delivering the
+ * packets not lost in order after their bytes went through and the latency
+ */
+struct Link {
+    Link() : freeMs(0), bytesSent(0) {}
+
+    void send(qint64 nowMs, quint32 bytes, int object, int lossPermille) {
+        freeMs = qMax(freeMs, (double) nowMs) + bytes * 1000 / LINK_BYTES_PER_SECOND;
+        bytesSent += bytes;
+        if (qrand() % 1000 < lossPermille)
+            return;
+        arrivalsMs.append((qint64) ceil(freeMs) + LATENCY_MS);
+        objects.append(object);
+    }
+
+    bool receive(qint64 nowMs, int *object) {
+        if (arrivalsMs.isEmpty() || arrivalsMs.first() > nowMs)
+            return false;
+        arrivalsMs.removeFirst();
+        *object = objects.takeFirst();
+        return true;
+    }
+
+    double freeMs;
+    quint64 bytesSent;
+    QList<qint64> arrivalsMs;
+    QList<int> objects;
+};
+
+struct Upload {
+    Upload() : durationMs(0), retries(0), failures(0), bytesSent(0) {}
+    qint64 durationMs;
+    int retries;
+    int failures;
+    quint64 bytesSent;
+};
+
+struct Transaction {
+    qint64 sentMs;
+    qint64 deadlineMs;
+    int retriesRemaining;
+    bool timedOut;
+};
+
+/**
+ * Upload acked objects, with at most \a window transactions in flight, paced
+ * to the link and with the timeout following the round trip when \a adaptive
+ */
+static Upload uploadObjects(int objects, int window, bool adaptive, int lossPermille)
+{
+    Link uplink, downlink;
+    RoundTripEstimator roundTrip(REQ_TIMEOUT_MS, MIN_REQ_TIMEOUT_MS, MAX_REQ_TIMEOUT_MS);
+    QMap<int, Transaction> inFlight;
+    double tokens = BURST_BYTES;
+    int next = 0;
+    int completed = 0;
+    Upload result;
+
+    qint64 nowMs;
+    for (nowMs = 0; completed < objects; nowMs++) {
+        if (adaptive)
+            tokens = qMin(tokens + LINK_BYTES_PER_SECOND / 1000, BURST_BYTES);
+        qint32 timeoutMs = adaptive ? roundTrip.getTimeoutMs() : REQ_TIMEOUT_MS;
+
+        // The autopilot acks the objects it receives
+        int object;
+        while (uplink.receive(nowMs, &object))
+            downlink.send(nowMs, ACK_BYTES, object, lossPermille);
+
+        while (downlink.receive(nowMs, &object)) {
+            QMap<int, Transaction>::iterator iter = inFlight.find(object);
+            if (iter == inFlight.end())
+                continue;
+            if (!iter.value().timedOut)
+                roundTrip.addSample(nowMs - iter.value().sentMs);
+            inFlight.erase(iter);
+            completed++;
+        }
+
+        QMap<int, Transaction>::iterator iter = inFlight.begin();
+        while (iter != inFlight.end()) {
+            Transaction &transaction = iter.value();
+            if (transaction.deadlineMs > nowMs) {
+                ++iter;
+                continue;
+            }
+            transaction.timedOut = true;
+            if (adaptive) {
+                roundTrip.backOff();
+                timeoutMs = roundTrip.getTimeoutMs();
+            }
+            if (transaction.retriesRemaining > 0) {
+                transaction.retriesRemaining--;
+                transaction.sentMs = nowMs;
+                transaction.deadlineMs = nowMs + timeoutMs;
+                uplink.send(nowMs, OBJECT_BYTES, iter.key(), lossPermille);
+                tokens -= OBJECT_BYTES;
+                result.retries++;
+                ++iter;
+            } else {
+                iter = inFlight.erase(iter);
+                completed++;
+                result.failures++;
+            }
+        }
+
+        while (next < objects && inFlight.size() < window && (!adaptive || tokens >= OBJECT_BYTES)) {
+            Transaction transaction;
+            transaction.sentMs = nowMs;
+            transaction.deadlineMs = nowMs + timeoutMs;
+            transaction.retriesRemaining = MAX_RETRIES;
+            transaction.timedOut = false;
+            inFlight.insert(next, transaction);
+            uplink.send(nowMs, OBJECT_BYTES, next, lossPermille);
+            tokens -= OBJECT_BYTES;
+            next++;
+        }
+    }
+
+    result.durationMs = nowMs;
+    result.bytesSent = uplink.bytesSent;
+    return result;
+}
+
+void tst_TransactionWindowBenchmark::initTestCase()
+{
+    m_objects = qgetenv("TRANSACTIONWINDOW_BENCH_OBJECTS").toInt();
+    if (m_objects <= 0)
+        m_objects = 60;
+}
+
+void tst_TransactionWindowBenchmark::upload_data()
+{
+    QTest::addColumn<int>("lossPermille");
+
+    QTest::newRow("no loss") << 0;
+    QTest::newRow("2% loss") << 20;
+    QTest::newRow("10% loss") << 100;
+}
+
+void tst_TransactionWindowBenchmark::upload()
+{
+    QFETCH(int, lossPermille);
+
+    qsrand(1);
+    Upload allAtOnce = uploadObjects(m_objects, m_objects, false, lossPermille);
+    qsrand(1);
+    Upload oneAtATime = uploadObjects(m_objects, 1, false, lossPermille);
+    qsrand(1);
+    Upload windowed = uploadObjects(m_objects, MAX_TRANSACTIONS_IN_FLIGHT, true, lossPermille);
+
+    const Upload *uploads[] = {&allAtOnce, &oneAtATime, &windowed};
+    const char *names[] = {"all at once, fixed timeout", "one at a time, fixed timeout", "window, adaptive timeout"};
+    for (int i = 0; i < 3; i++) {
+        qDebug("%4.1f%% loss, %-28s: %6lld ms, %4d retries, %3d failed, %6llu bytes sent", lossPermille / 10.0, names[i],
+               uploads[i]->durationMs, uploads[i]->retries, uploads[i]->failures, uploads[i]->bytesSent);
+    }
+
+    // The window keeps the link busy without timing out on the queued objects
+    QVERIFY(windowed.durationMs < oneAtATime.durationMs);
+    QVERIFY(windowed.failures <= allAtOnce.failures);
+    QVERIFY(windowed.retries <= allAtOnce.retries);
+    if (lossPermille == 0) {
+        QCOMPARE(windowed.failures, 0);
+        QCOMPARE(windowed.retries, 0);
+        QVERIFY(windowed.durationMs < m_objects * OBJECT_BYTES * 1000 / LINK_BYTES_PER_SECOND + 4 * LATENCY_MS);
+    }
+}
+
+/**
+ * The timeout follows the round trip and its variation within its bounds,
+ * and backs off on timeouts
+ */
+void tst_TransactionWindowBenchmark::roundTripEstimate()
+{
+    RoundTripEstimator roundTrip(250, 100, 2000);
+    QVERIFY(!roundTrip.hasSamples());
+    QCOMPARE(roundTrip.getTimeoutMs(), 250);
+
+    // Timeout of the first sample is 3 times the round trip
+    roundTrip.addSample(200);
+    QCOMPARE(roundTrip.getSmoothedMs(), 200.0);
+    QCOMPARE(roundTrip.getVariationMs(), 100.0);
+    QCOMPARE(roundTrip.getTimeoutMs(), 600);
+
+    // A steady round trip brings the timeout down to it
+    for (int i = 0; i < 100; i++)
+        roundTrip.addSample(200);
+    QVERIFY(fabs(roundTrip.getSmoothedMs() - 200) < 1e-6);
+    QVERIFY(roundTrip.getTimeoutMs() >= 200 && roundTrip.getTimeoutMs() <= 202);
+
+    // Jitter raises it
+    for (int i = 0; i < 100; i++)
+        roundTrip.addSample(i % 2 ? 150 : 250);
+    QVERIFY(roundTrip.getTimeoutMs() > 350);
+
+    roundTrip.backOff();
+    roundTrip.backOff();
+    roundTrip.backOff();
+    QCOMPARE(roundTrip.getTimeoutMs(), 2000);
+
+    // Within the bounds
+    for (int i = 0; i < 100; i++)
+        roundTrip.addSample(5);
+    QCOMPARE(roundTrip.getTimeoutMs(), 100);
+    for (int i = 0; i < 100; i++)
+        roundTrip.addSample(5000);
+    QCOMPARE(roundTrip.getTimeoutMs(), 2000);
+
+    roundTrip.reset();
+    QVERIFY(!roundTrip.hasSamples());
+    QCOMPARE(roundTrip.getTimeoutMs(), 250);
+}
+
+QTEST_MAIN(tst_TransactionWindowBenchmark)
+
+#include "tst_transactionwindowbenchmark.moc"
@@ -0,0 +1,16 @@
+# Benchmark of the telemetry transmit queue on a saturated link.
+# Set TRANSMITQUEUE_BENCH_SECONDS to the simulated time, 60 s by default.
+
+QT += testlib
+QT -= gui
+TARGET = transmitqueuebenchmark
+CONFIG += console testcase
+CONFIG -= app_bundle
+TEMPLATE = app
+
+include(../../../../../gcs.pri)
+
+INCLUDEPATH *= ../..
+
+SOURCES += tst_transmitqueuebenchmark.cpp \
+    ../../transmitqueue.cpp
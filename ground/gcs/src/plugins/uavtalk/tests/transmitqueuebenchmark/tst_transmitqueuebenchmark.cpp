@@ -0,0 +1,369 @@
+/**
+ ******************************************************************************
+ * @file       tst_transmitqueuebenchmark.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVTalkPlugin UAVTalk Plugin
+ * @{
+ * @brief Sends a slider moving at 100 Hz and periodic objects over a serial
+ * link too slow for them, queued in the serial buffer as done before or
+ * coalesced in the transmit queue and paced to the link, and checks the
+ * queue and the token bucket
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <QtTest/QtTest>
+#include <QElapsedTimer>
+
+#include "transmitqueue.h"
+
+class tst_TransmitQueueBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void saturatedLink_data();
+    void saturatedLink();
+    void coalescing();
+    void busyObjects();
+    void windowFull();
+    void tokenBucket();
+
+private:
+    int m_seconds;
+};
+
+//! 57600 baud serial link
+static const quint32 LINK_BYTES_PER_SECOND = 5760;
+static const quint32 BURST_BYTES = 576;
+//! Header and checksum of a packet
+static const quint32 PACKET_BYTES = 11;
+//! Settings object moved by the slider
+static const quint32 SLIDER_BYTES = 100;
+static const int SLIDER_PERIOD_MS = 10;
+static const quint32 PERIODIC_BYTES = 40;
+static const int PERIODIC_PERIOD_MS = 200;
+
+//! Distinct fake objects, only used as keys
+static UAVObject *fakeObject(int i)
+{
+    return reinterpret_cast<UAVObject *>((quintptr) (i + 1) * 16);
+}
+
+/**
+ * @brief The Latency struct Time from a change of the slider to the first
+ * packet carrying it, or a newer value, out of the link, and bytes sent with
+ * positions already replaced
+ */
+struct Latency {
+    Latency() : sum(0), max(0), count(0), sentBytes(0), staleBytes(0), lost(0) {}
+    void sent(const QVector<qint64> &changes, int value, int *delivered, qint64 doneMs, quint32 bytes) {
+        sentBytes += bytes;
+        if (value <= *delivered) {
+            staleBytes += bytes;
+            return;
+        }
+        for (int i = *delivered + 1; i <= value; i++) {
+            qint64 latency = doneMs - changes.at(i);
+            sum += latency;
+            max = qMax(max, latency);
+            count++;
+        }
+        *delivered = value;
+    }
+    double getMean() const {return count > 0 ? (double) sum / count : 0;}
+    qint64 sum;
+    qint64 max;
+    int count;
+    quint64 sentBytes;
+    quint64 staleBytes;
+    int lost;
+};
+
+/**
+ * Every event written to the serial buffer as it comes, as done before
+ */
+static Latency sendToBuffer(int seconds, int periodicObjects)
+{
+    QVector<qint64> changes;
+    Latency latency;
+    int delivered = -1;
+    double linkFreeMs = 0;
+
+    for (qint64 nowMs = 0; nowMs < seconds * 1000; nowMs++) {
+        if (nowMs % SLIDER_PERIOD_MS == 0) {
+            changes.append(nowMs);
+            double startMs = qMax(linkFreeMs, (double) nowMs);
+            linkFreeMs = startMs + (SLIDER_BYTES + PACKET_BYTES) * 1000.0 / LINK_BYTES_PER_SECOND;
+            latency.sent(changes, changes.size() - 1, &delivered, (qint64) linkFreeMs, SLIDER_BYTES + PACKET_BYTES);
+            // Already replaced by the next position when it goes out
+            if (startMs >= nowMs + SLIDER_PERIOD_MS)
+                latency.staleBytes += SLIDER_BYTES + PACKET_BYTES;
+        }
+        for (int i = 0; i < periodicObjects; i++) {
+            if ((nowMs + i * 7) % PERIODIC_PERIOD_MS == 0)
+                linkFreeMs = qMax(linkFreeMs, (double) nowMs) + (PERIODIC_BYTES + PACKET_BYTES) * 1000.0 / LINK_BYTES_PER_SECOND;
+        }
+    }
+
+    return latency;
+}
+
+/**
+ * The events coalesced in the transmit queue and paced to the link, the
+ * slider object is packed when it is sent
+ */
+static Latency sendFromQueue(int seconds, int periodicObjects, TransmitQueue &queue)
+{
+    QVector<qint64> changes;
+    Latency latency;
+    int delivered = -1;
+    TokenBucket bucket;
+    bucket.setRate(LINK_BYTES_PER_SECOND, BURST_BYTES);
+
+    TransmitQueue::Entry slider;
+    slider.obj = fakeObject(0);
+    slider.objId = 0;
+    slider.priority = true;
+
+    for (qint64 nowMs = 0; nowMs < seconds * 1000; nowMs++) {
+        if (nowMs % SLIDER_PERIOD_MS == 0) {
+            changes.append(nowMs);
+            if (!queue.enqueue(slider, nowMs))
+                latency.lost++;
+        }
+        for (int i = 0; i < periodicObjects; i++) {
+            if ((nowMs + i * 7) % PERIODIC_PERIOD_MS == 0) {
+                TransmitQueue::Entry periodic;
+                periodic.obj = fakeObject(i + 1);
+                periodic.objId = i + 1;
+                if (!queue.enqueue(periodic, nowMs))
+                    latency.lost++;
+            }
+        }
+
+        const TransmitQueue::Entry *next;
+        while ((next = queue.peek()) != 0) {
+            quint32 bytes = PACKET_BYTES + (next->objId == 0 ? SLIDER_BYTES : PERIODIC_BYTES);
+            if (bucket.delayMs(nowMs, bytes) > 0)
+                break;
+            TransmitQueue::Entry entry;
+            queue.take(nowMs, &entry);
+            bucket.consume(nowMs, bytes);
+            if (entry.objId == 0)
+                latency.sent(changes, changes.size() - 1, &delivered, nowMs + bytes * 1000 / LINK_BYTES_PER_SECOND, bytes);
+            else
+                latency.sentBytes += bytes;
+        }
+    }
+
+    return latency;
+}
+
+void tst_TransmitQueueBenchmark::initTestCase()
+{
+    m_seconds = qgetenv("TRANSMITQUEUE_BENCH_SECONDS").toInt();
+    if (m_seconds <= 0)
+        m_seconds = 60;
+}
+
+void tst_TransmitQueueBenchmark::saturatedLink_data()
+{
+    QTest::addColumn<int>("periodicObjects");
+
+    QTest::newRow("0") << 0;
+    QTest::newRow("10") << 10;
+    QTest::newRow("100") << 100;
+}
+
+void tst_TransmitQueueBenchmark::saturatedLink()
+{
+    QFETCH(int, periodicObjects);
+
+    Latency buffered = sendToBuffer(m_seconds, periodicObjects);
+
+    TransmitQueue queue(256);
+    QElapsedTimer timer;
+    timer.start();
+    Latency queued = sendFromQueue(m_seconds, periodicObjects, queue);
+    double queueNs = timer.nsecsElapsed() / (double) (m_seconds * 1000);
+
+    const TransmitQueue::WaitStats &sliderStats = queue.getWaitStats().value(0);
+    qDebug("%3d periodic objects: buffered slider latency mean %8.0f ms max %8lld ms, %5.1f%% of the bytes stale",
+           periodicObjects, buffered.getMean(), buffered.max, 100.0 * buffered.staleBytes / qMax(buffered.sentBytes, (quint64) 1));
+    qDebug("%3d periodic objects: queued   slider latency mean %8.0f ms max %8lld ms, %5.1f%% of the bytes stale, %u coalesced, wait max %d ms, %.0f ns/ms",
+           periodicObjects, queued.getMean(), queued.max, 100.0 * queued.staleBytes / qMax(queued.sentBytes, (quint64) 1),
+           sliderStats.coalesced, sliderStats.maxWaitMs, queueNs);
+
+    // The buffered latency grows with the backlog, the queued one is bounded
+    // by a round of the queue, and no stale copy of the slider is sent
+    QCOMPARE(queued.lost, 0);
+    QCOMPARE(queued.staleBytes, (quint64) 0);
+    QVERIFY(queued.max < 1000);
+    QVERIFY(queued.max < buffered.max);
+    QVERIFY(queued.sentBytes <= (quint64) m_seconds * LINK_BYTES_PER_SECOND + BURST_BYTES);
+    QVERIFY(sliderStats.coalesced > 0);
+}
+
+/**
+ * Events of the same object instance and event are coalesced, keeping their
+ * place in the queue, and the priority entries are taken first
+ */
+void tst_TransmitQueueBenchmark::coalescing()
+{
+    TransmitQueue queue(3);
+    TransmitQueue::Entry entry;
+
+    for (int i = 0; i < 3; i++) {
+        entry.obj = fakeObject(i);
+        entry.objId = 100 + i;
+        entry.event = 2;
+        QVERIFY(queue.enqueue(entry, i));
+    }
+    QCOMPARE(queue.size(), 3);
+
+    // Same object and event, the first one becomes a priority entry for all
+    // the instances
+    entry.obj = fakeObject(0);
+    entry.objId = 100;
+    entry.allInstances = true;
+    entry.priority = true;
+    QVERIFY(queue.enqueue(entry, 10));
+    QCOMPARE(queue.size(), 3);
+
+    // New event, the queue is full
+    entry.event = 16;
+    QVERIFY(!queue.enqueue(entry, 11));
+
+    QCOMPARE(queue.peek()->obj, fakeObject(0));
+    QVERIFY(queue.take(20, &entry));
+    QCOMPARE(entry.obj, fakeObject(0));
+    QVERIFY(entry.allInstances);
+    QVERIFY(entry.priority);
+    QCOMPARE(entry.queuedMs, (qint64) 0);
+    QCOMPARE(queue.getWaitStats().value(100).taken, (quint32) 1);
+    QCOMPARE(queue.getWaitStats().value(100).coalesced, (quint32) 1);
+    QCOMPARE(queue.getWaitStats().value(100).maxWaitMs, 20);
+
+    QVERIFY(queue.take(21, &entry));
+    QCOMPARE(entry.obj, fakeObject(1));
+    QCOMPARE(queue.getWaitStats().value(101).getMeanWaitMs(), 20.0);
+
+    queue.clearRegular();
+    QVERIFY(queue.isEmpty());
+    QVERIFY(queue.peek() == 0);
+    QVERIFY(!queue.take(30, &entry));
+
+    queue.resetStats();
+    QVERIFY(queue.getWaitStats().isEmpty());
+}
+
+/**
+ * The sends of a busy object wait for it without blocking the other objects,
+ * its requests are taken
+ */
+void tst_TransmitQueueBenchmark::busyObjects()
+{
+    TransmitQueue queue(10);
+    TransmitQueue::Entry entry;
+
+    entry.obj = fakeObject(0);
+    entry.event = 2;
+    entry.waitsForTransaction = true;
+    QVERIFY(queue.enqueue(entry, 0));
+    entry.event = 16;
+    entry.waitsForTransaction = false;
+    QVERIFY(queue.enqueue(entry, 0));
+    entry.obj = fakeObject(1);
+    entry.event = 2;
+    entry.waitsForTransaction = true;
+    QVERIFY(queue.enqueue(entry, 0));
+
+    queue.setBusy(fakeObject(0), true);
+    QVERIFY(queue.take(1, &entry));
+    QCOMPARE(entry.obj, fakeObject(0));
+    QCOMPARE(entry.event, 16);
+    QVERIFY(queue.take(1, &entry));
+    QCOMPARE(entry.obj, fakeObject(1));
+    QVERIFY(queue.peek() == 0);
+    QCOMPARE(queue.size(), 1);
+
+    queue.setBusy(fakeObject(0), false);
+    QVERIFY(queue.take(2, &entry));
+    QCOMPARE(entry.obj, fakeObject(0));
+    QCOMPARE(entry.event, 2);
+    QVERIFY(queue.isEmpty());
+}
+
+/**
+ * While the window is full, only the entries not expecting a response are
+ * taken
+ */
+void tst_TransmitQueueBenchmark::windowFull()
+{
+    TransmitQueue queue(10);
+    TransmitQueue::Entry entry;
+
+    entry.obj = fakeObject(0);
+    entry.event = 2;
+    entry.expectsResponse = true;
+    QVERIFY(queue.enqueue(entry, 0));
+    entry.obj = fakeObject(1);
+    entry.event = 1;
+    entry.expectsResponse = false;
+    QVERIFY(queue.enqueue(entry, 0));
+
+    queue.setWindowFull(true);
+    QVERIFY(queue.take(1, &entry));
+    QCOMPARE(entry.obj, fakeObject(1));
+    QVERIFY(queue.peek() == 0);
+
+    queue.setWindowFull(false);
+    QVERIFY(queue.take(2, &entry));
+    QCOMPARE(entry.obj, fakeObject(0));
+    QVERIFY(entry.expectsResponse);
+}
+
+/**
+ * The bucket lets a burst through, then paces to the rate
+ */
+void tst_TransmitQueueBenchmark::tokenBucket()
+{
+    TokenBucket bucket;
+    QVERIFY(!bucket.isLimited());
+    QCOMPARE(bucket.delayMs(0, 100000), (qint64) 0);
+
+    bucket.setRate(1000, 100);
+    QVERIFY(bucket.isLimited());
+    QCOMPARE(bucket.delayMs(0, 100), (qint64) 0);
+    bucket.consume(0, 100);
+    QCOMPARE(bucket.delayMs(0, 50), (qint64) 50);
+    QCOMPARE(bucket.delayMs(30, 50), (qint64) 20);
+    QCOMPARE(bucket.delayMs(50, 50), (qint64) 0);
+
+    // Larger than the bucket, sent once the bucket is full, then in debt
+    QCOMPARE(bucket.delayMs(50, 300), (qint64) 50);
+    QCOMPARE(bucket.delayMs(1000, 300), (qint64) 0);
+    bucket.consume(1000, 300);
+    QCOMPARE(bucket.delayMs(1000, 10), (qint64) 210);
+}
+
+QTEST_MAIN(tst_TransmitQueueBenchmark)
+
+#include "tst_transmitqueuebenchmark.moc"
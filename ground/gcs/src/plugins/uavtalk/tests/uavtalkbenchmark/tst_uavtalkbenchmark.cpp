@@ -0,0 +1,197 @@
+/**
+ ******************************************************************************
+ * @file       tst_uavtalkbenchmark.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVTalkPlugin UAVTalk Plugin
+ * @{
+ * @brief Checks that the block and byte-wise UAVTalk receive paths agree
+ * and measures their throughput in packets per second
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <QtTest/QtTest>
+#include <QBuffer>
+#include <QFile>
+#include <QElapsedTimer>
+
+#include <extensionsystem/pluginmanager.h>
+#include "uavtalk/uavtalk.h"
+#include "uavobjectmanager.h"
+#include "uavobjectsinit.h"
+
+class tst_UAVTalkBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void blockMatchesByteParser();
+    void byteThroughput();
+    void blockThroughput();
+
+private:
+    QByteArray loadCapturedStream(const QString &fileName);
+    QByteArray syntheticStream(int repeats);
+    UAVTalk::ComStats parseBytes(UAVObjectManager *objMngr);
+    UAVTalk::ComStats parseBlocks(UAVObjectManager *objMngr, int blockSize);
+    void reportRate(const char *label, quint32 packets, qint64 nsecs);
+
+    ExtensionSystem::PluginManager *m_pm;
+    UAVObjectManager *m_objMngr;
+    QByteArray m_stream;
+};
+
+void tst_UAVTalkBenchmark::initTestCase()
+{
+    m_pm = new ExtensionSystem::PluginManager();
+    m_objMngr = new UAVObjectManager();
+    UAVObjectsInitialize(m_objMngr);
+
+    QString logName = QString::fromLocal8Bit(qgetenv("UAVTALK_BENCH_LOG"));
+    if (logName.isEmpty())
+        m_stream = syntheticStream(500);
+    else
+        m_stream = loadCapturedStream(logName);
+    QVERIFY(m_stream.size() > 0);
+}
+
+void tst_UAVTalkBenchmark::cleanupTestCase()
+{
+    delete m_objMngr;
+    delete m_pm;
+}
+
+/**
+ * Extract the raw telemetry stream from a .tll log, dropping the text header
+ * and the per-packet timestamp and size fields.
+ */
+QByteArray tst_UAVTalkBenchmark::loadCapturedStream(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+
+    QByteArray line;
+    do {
+        line = file.readLine();
+    } while (line != "##\n" && !file.atEnd());
+
+    QByteArray stream;
+    while (file.bytesAvailable() > (qint64)(sizeof(quint32) + sizeof(qint64))) {
+        quint32 timeStamp;
+        qint64 dataSize;
+        file.read((char *) &timeStamp, sizeof(timeStamp));
+        file.read((char *) &dataSize, sizeof(dataSize));
+        if (dataSize < 1 || dataSize > file.bytesAvailable())
+            break;
+        stream.append(file.read(dataSize));
+    }
+    return stream;
+}
+
+/**
+ * Serialize every registered data object \a repeats times, with a little
+ * line noise between rounds so that the resync paths are exercised too.
+ */
+QByteArray tst_UAVTalkBenchmark::syntheticStream(int repeats)
+{
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    UAVTalk talk(&buffer, m_objMngr);
+
+    QVector< QVector<UAVDataObject*> > objects = m_objMngr->getDataObjectsVector();
+    for (int i = 0; i < repeats; i++) {
+        foreach (QVector<UAVDataObject*> instances, objects)
+            foreach (UAVDataObject *obj, instances)
+                talk.sendObject(obj, false, false);
+        buffer.write("\x3c\x20\xff", 3);
+    }
+    return buffer.data();
+}
+
+UAVTalk::ComStats tst_UAVTalkBenchmark::parseBytes(UAVObjectManager *objMngr)
+{
+    QBuffer idle;
+    UAVTalk talk(&idle, objMngr);
+    const quint8 *data = (const quint8 *) m_stream.constData();
+    for (int i = 0; i < m_stream.size(); i++)
+        talk.processInputByte(data[i]);
+    return talk.getStats();
+}
+
+UAVTalk::ComStats tst_UAVTalkBenchmark::parseBlocks(UAVObjectManager *objMngr, int blockSize)
+{
+    QBuffer idle;
+    UAVTalk talk(&idle, objMngr);
+    const quint8 *data = (const quint8 *) m_stream.constData();
+    for (int pos = 0; pos < m_stream.size(); pos += blockSize)
+        talk.processInputBlock(&data[pos], qMin(blockSize, m_stream.size() - pos));
+    return talk.getStats();
+}
+
+void tst_UAVTalkBenchmark::reportRate(const char *label, quint32 packets, qint64 nsecs)
+{
+    qDebug("%s: %u packets in %.3f ms, %.0f packets/s", label, packets,
+           nsecs / 1e6, packets / (nsecs / 1e9));
+}
+
+void tst_UAVTalkBenchmark::blockMatchesByteParser()
+{
+    UAVTalk::ComStats expected = parseBytes(m_objMngr);
+    QVERIFY(expected.rxObjects > 0);
+
+    // Odd block sizes make packets straddle block boundaries
+    const int blockSizes[] = { 1, 7, 64, 333, 4096 };
+    for (unsigned i = 0; i < sizeof(blockSizes) / sizeof(blockSizes[0]); i++) {
+        UAVTalk::ComStats stats = parseBlocks(m_objMngr, blockSizes[i]);
+        QCOMPARE(stats.rxBytes, expected.rxBytes);
+        QCOMPARE(stats.rxObjects, expected.rxObjects);
+        QCOMPARE(stats.rxObjectBytes, expected.rxObjectBytes);
+        QCOMPARE(stats.rxErrors, expected.rxErrors);
+    }
+}
+
+void tst_UAVTalkBenchmark::byteThroughput()
+{
+    QElapsedTimer timer;
+    timer.start();
+    UAVTalk::ComStats stats = parseBytes(m_objMngr);
+    reportRate("byte-wise", stats.rxObjects, timer.nsecsElapsed());
+
+    QBENCHMARK {
+        parseBytes(m_objMngr);
+    }
+}
+
+void tst_UAVTalkBenchmark::blockThroughput()
+{
+    QElapsedTimer timer;
+    timer.start();
+    UAVTalk::ComStats stats = parseBlocks(m_objMngr, 4096);
+    reportRate("block", stats.rxObjects, timer.nsecsElapsed());
+
+    QBENCHMARK {
+        parseBlocks(m_objMngr, 4096);
+    }
+}
+
+QTEST_MAIN(tst_UAVTalkBenchmark)
+
+#include "tst_uavtalkbenchmark.moc"
@@ -0,0 +1,18 @@
+# Throughput benchmark for the UAVTalk receive path.
+# Set UAVTALK_BENCH_LOG to a .tll file to benchmark a captured stream,
+# otherwise a synthetic stream of all known objects is used.
+
+QT += testlib network
+QT -= gui
+TARGET = uavtalkbenchmark
+CONFIG += console testcase
+CONFIG -= app_bundle
+TEMPLATE = app
+
+include(../../../../../gcs.pri)
+
+INCLUDEPATH *= $$GCS_SOURCE_TREE/src/plugins
+LIBS += -L$$GCS_PLUGIN_PATH/TauLabs
+include(../../uavtalk.pri)
+
+SOURCES += tst_uavtalkbenchmark.cpp
@@ -0,0 +1,200 @@
+/**
+ ******************************************************************************
+ * @file       transmitqueue.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVTalkPlugin UAVTalk Plugin
+ * @{
+ * @brief Queues the telemetry transactions and paces them to the link
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "transmitqueue.h"
+
+#include <limits.h>
+#include <math.h>
+
+TransmitQueue::TransmitQueue(int maxSize) :
+    maxSize(maxSize),
+    windowFull(false)
+{
+}
+
+/**
+ * Queue a transaction, or coalesce it into the pending one of the same object
+ * instance and event. A priority event moves the pending entry to the
+ * priority entries.
+ * @returns False when the queue is full
+ */
+bool TransmitQueue::enqueue(const Entry &entry, qint64 nowMs)
+{
+    Key key(entry.obj, entry.event);
+    QHash<Key, Entry>::iterator iter = pending.find(key);
+    if (iter != pending.end()) {
+        Entry &queued = iter.value();
+        queued.allInstances = queued.allInstances || entry.allInstances;
+        queued.waitsForTransaction = queued.waitsForTransaction || entry.waitsForTransaction;
+        queued.expectsResponse = queued.expectsResponse || entry.expectsResponse;
+        if (entry.priority && !queued.priority) {
+            queued.priority = true;
+            order[0].removeOne(key);
+            order[1].append(key);
+        }
+        waitStats[entry.objId].coalesced++;
+        return true;
+    }
+
+    if (pending.size() >= maxSize)
+        return false;
+
+    Entry queued = entry;
+    queued.queuedMs = nowMs;
+    pending.insert(key, queued);
+    order[queued.priority ? 1 : 0].append(key);
+    return true;
+}
+
+/**
+ * Next entry taken, or NULL when the queue is empty or all the entries wait
+ * for busy objects or the window
+ */
+const TransmitQueue::Entry *TransmitQueue::peek() const
+{
+    int level, position;
+    if (!findNext(&level, &position))
+        return 0;
+    return &pending.find(order[level].at(position)).value();
+}
+
+/**
+ * Take the next entry out of the queue, keeping the time it waited
+ * @returns False when there is no entry to take
+ */
+bool TransmitQueue::take(qint64 nowMs, Entry *entry)
+{
+    int level, position;
+    if (!findNext(&level, &position))
+        return false;
+
+    Key key = order[level].takeAt(position);
+    *entry = pending.take(key);
+
+    WaitStats &stats = waitStats[entry->objId];
+    qint64 waitMs = nowMs - entry->queuedMs;
+    stats.taken++;
+    stats.waitSumMs += waitMs;
+    stats.maxWaitMs = qMax(stats.maxWaitMs, (qint32) qMin(waitMs, (qint64) INT_MAX));
+    return true;
+}
+
+/**
+ * Drop the regular entries, keeping the priority ones
+ */
+void TransmitQueue::clearRegular()
+{
+    foreach (const Key &key, order[0])
+        pending.remove(key);
+    order[0].clear();
+}
+
+/**
+ * Mark an object busy while a transaction for it is in progress
+ */
+void TransmitQueue::setBusy(UAVObject *obj, bool isBusy)
+{
+    if (isBusy)
+        busy.insert(obj);
+    else
+        busy.remove(obj);
+}
+
+void TransmitQueue::resetStats()
+{
+    waitStats.clear();
+}
+
+bool TransmitQueue::findNext(int *level, int *position) const
+{
+    for (*level = 1; *level >= 0; (*level)--) {
+        const QList<Key> &keys = order[*level];
+        for (*position = 0; *position < keys.size(); (*position)++) {
+            const Key &key = keys.at(*position);
+            if (!windowFull && (busy.isEmpty() || !busy.contains(key.first)))
+                return true;
+            const Entry &entry = pending.find(key).value();
+            if ((!windowFull || !entry.expectsResponse) &&
+                (!entry.waitsForTransaction || !busy.contains(key.first)))
+                return true;
+        }
+    }
+    return false;
+}
+
+TokenBucket::TokenBucket() :
+    rate(0), burst(0), tokens(0), lastMs(0)
+{
+}
+
+/**
+ * Limit the bytes sent to \a bytesPerSecond, starting with a full bucket of
+ * \a burstBytes
+ */
+void TokenBucket::setRate(quint32 bytesPerSecond, quint32 burstBytes)
+{
+    rate = bytesPerSecond;
+    burst = burstBytes;
+    tokens = burst;
+    lastMs = 0;
+}
+
+/**
+ * Time to wait before sending \a bytes, 0 when they can be sent now. Sends
+ * larger than the bucket wait for a full bucket.
+ */
+qint64 TokenBucket::delayMs(qint64 nowMs, quint32 bytes)
+{
+    if (rate == 0)
+        return 0;
+
+    refill(nowMs);
+    double needed = qMin(bytes, burst);
+    if (tokens >= needed)
+        return 0;
+    return (qint64) ceil((needed - tokens) * 1000 / rate);
+}
+
+/**
+ * Account for \a bytes sent, the bucket may go into debt for sends larger
+ * than the tokens left
+ */
+void TokenBucket::consume(qint64 nowMs, quint32 bytes)
+{
+    if (rate == 0)
+        return;
+
+    refill(nowMs);
+    tokens -= bytes;
+}
+
+void TokenBucket::refill(qint64 nowMs)
+{
+    if (nowMs > lastMs) {
+        tokens = qMin(tokens + (double) (nowMs - lastMs) * rate / 1000, (double) burst);
+        lastMs = nowMs;
+    }
+}
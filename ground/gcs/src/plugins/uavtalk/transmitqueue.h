@@ -0,0 +1,136 @@
+/**
+ ******************************************************************************
+ * @file       transmitqueue.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVTalkPlugin UAVTalk Plugin
+ * @{
+ * @brief Queues the telemetry transactions and paces them to the link
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef TRANSMITQUEUE_H
+#define TRANSMITQUEUE_H
+
+#include <QtGlobal>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QSet>
+
+class UAVObject;
+
+/**
+ * @brief The TransmitQueue class Transactions waiting to be sent, at most one
+ * per object instance and event. The objects are packed when the transaction
+ * is sent, so an event coalesced into the pending one is sent with the newest
+ * data, and the entry keeps its place in the queue.
+ *
+ * The priority entries are taken first. The entries waiting for the
+ * transaction of their object are skipped while the object is busy, and the
+ * entries expecting a response while the window of transactions in flight is
+ * full, so that they are neither lost nor block the other entries. Times are
+ * in ms on any monotonic clock.
+ */
+class TransmitQueue
+{
+public:
+    struct Entry {
+        Entry() : obj(0), objId(0), event(0), allInstances(false), priority(false),
+            waitsForTransaction(false), expectsResponse(false), queuedMs(0) {}
+        UAVObject *obj;
+        quint32 objId;
+        int event;
+        bool allInstances;
+        bool priority;
+        //! Not taken while the object is busy
+        bool waitsForTransaction;
+        //! Not taken while the window is full
+        bool expectsResponse;
+        //! Time the oldest of the coalesced events was queued
+        qint64 queuedMs;
+    };
+
+    /**
+     * @brief The WaitStats struct Time the entries of an object waited in the queue
+     */
+    struct WaitStats {
+        WaitStats() : taken(0), coalesced(0), waitSumMs(0), maxWaitMs(0) {}
+        quint32 taken;
+        quint32 coalesced;
+        qint64 waitSumMs;
+        qint32 maxWaitMs;
+        double getMeanWaitMs() const {return taken > 0 ? (double) waitSumMs / taken : 0;}
+    };
+
+    TransmitQueue(int maxSize);
+
+    bool enqueue(const Entry &entry, qint64 nowMs);
+    const Entry *peek() const;
+    bool take(qint64 nowMs, Entry *entry);
+    void clearRegular();
+
+    int size() const {return pending.size();}
+    bool isEmpty() const {return pending.isEmpty();}
+
+    void setBusy(UAVObject *obj, bool isBusy);
+    void setWindowFull(bool isFull) {windowFull = isFull;}
+
+    const QHash<quint32, WaitStats> &getWaitStats() const {return waitStats;}
+    void resetStats();
+
+private:
+    typedef QPair<UAVObject *, int> Key;
+
+    bool findNext(int *level, int *position) const;
+
+    int maxSize;
+    QHash<Key, Entry> pending;
+    //! Order of the regular and priority entries
+    QList<Key> order[2];
+    QSet<UAVObject *> busy;
+    bool windowFull;
+    QHash<quint32, WaitStats> waitStats;
+};
+
+/**
+ * @brief The TokenBucket class Paces the bytes sent to a rate, letting bursts
+ * of up to the bucket size through. A rate of 0 does not limit.
+ */
+class TokenBucket
+{
+public:
+    TokenBucket();
+
+    void setRate(quint32 bytesPerSecond, quint32 burstBytes);
+    quint32 getRate() const {return rate;}
+    bool isLimited() const {return rate > 0;}
+
+    qint64 delayMs(qint64 nowMs, quint32 bytes);
+    void consume(qint64 nowMs, quint32 bytes);
+
+private:
+    void refill(qint64 nowMs);
+
+    quint32 rate;
+    quint32 burst;
+    double tokens;
+    qint64 lastMs;
+};
+
+#endif // TRANSMITQUEUE_H
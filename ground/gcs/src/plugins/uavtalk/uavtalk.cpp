@@ -26,6 +26,7 @@
  * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
  */
 #include "uavtalk.h"
+#include "uavobjectupdatebridge.h"
 #include <QtEndian>
 #include <QDebug>
 #include <extensionsystem/pluginmanager.h>
@@ -38,7 +39,6 @@
   #define UAVTALK_QXTLOG_DEBUG(...)
 #endif	// UAVTALK_DEBUG
 
-#define SYNC_VAL 0x3C
 
 const quint8 UAVTalk::crc_table[256] = {
     0x00, 0x07, 0x0e, 0x09, 0x1c, 0x1b, 0x12, 0x15, 0x38, 0x3f, 0x36, 0x31, 0x24, 0x23, 0x2a, 0x2d,
@@ -59,6 +59,26 @@ const quint8 UAVTalk::crc_table[256] = {
     0xde, 0xd9, 0xd0, 0xd7, 0xc2, 0xc5, 0xcc, 0xcb, 0xe6, 0xe1, 0xe8, 0xef, 0xfa, 0xfd, 0xf4, 0xf3
 };
 
+namespace {
+/**
+ * Lookup tables for the slice-by-4 CRC. Since the CRC has no input or output
+ * XOR it is linear, so the CRC of four bytes can be computed as the XOR of
+ * four independent lookups: slice[n][x] is the table applied n+1 times to x.
+ */
+struct CrcSliceTables {
+    quint8 slice[4][256];
+
+    explicit CrcSliceTables(const quint8 *table)
+    {
+        for (int i = 0; i < 256; i++) {
+            slice[0][i] = table[i];
+            for (int n = 1; n < 4; n++)
+                slice[n][i] = table[slice[n - 1][i]];
+        }
+    }
+};
+}
+
 
 /**
  * Constructor
@@ -76,10 +96,11 @@ UAVTalk::UAVTalk(QIODevice* iodev, UAVObjectManager* objMngr)
 
     memset(&stats, 0, sizeof(ComStats));
 
+    directSource = qobject_cast<UAVTalkDirectSource *>(iodev);
     connect(io, SIGNAL(readyRead()), this, SLOT(processInputStream()));
     ExtensionSystem::PluginManager *pm = ExtensionSystem::PluginManager::instance();
     Core::Internal::GeneralSettings * settings=pm->getObject<Core::Internal::GeneralSettings>();
-    useUDPMirror=settings->useUDPMirror();
+    useUDPMirror=settings && settings->useUDPMirror();
     UAVTALK_QXTLOG_DEBUG(QString("[uavtalk.cpp  ] Use UDP:%0").arg(useUDPMirror));
     if(useUDPMirror)
     {
@@ -123,17 +144,31 @@ UAVTalk::ComStats UAVTalk::getStats()
  */
 void UAVTalk::processInputStream()
 {
-    quint8 tmp;
-
-    if (io && io->isReadable()) {
+    if (io && io->isReadable() && directSource) {
+        // Parse the bytes in place, without copying them
+        directSource->parseBlocks(this);
+    } else if (io && io->isReadable()) {
         while (io->bytesAvailable() > 0)
         {
-            io->read((char*)&tmp, 1);
-            processInputByte(tmp);
+            qint64 length = io->read((char*)rxBlockBuffer, RX_BLOCK_SIZE);
+            if (length <= 0)
+                break;
+            parseBlock(rxBlockBuffer, length);
         }
     }
 }
 
+/**
+ * Parse a block of received bytes, timestamping their arrival so that the
+ * update bridge can measure the latency to the gadgets
+ */
+void UAVTalk::parseBlock(const quint8 *data, qint64 length)
+{
+    UAVObjectUpdateBridge::markArrival(UAVObjectUpdateBridge::timestamp());
+    processInputBlock(data, length);
+    UAVObjectUpdateBridge::clearArrival();
+}
+
 void UAVTalk::dummyUDPRead()
 {
     QUdpSocket *socket=qobject_cast<QUdpSocket*>(sender());
@@ -199,6 +234,144 @@ bool UAVTalk::objectTransaction(UAVObject* obj, quint8 type, bool allInstances)
     }
 }
 
+/**
+ * Process a block of bytes from the telemetry stream.
+ *
+ * Whenever the receiver is waiting for a sync byte and a complete packet is
+ * available in the block, the packet is validated and decoded in one pass
+ * by processInputPacket(). Packets which straddle the end of the block are
+ * handed to the byte-wise state machine, which carries them over to the next
+ * block. Both paths produce the same objects, statistics and resync points.
+ * \param[in] data Received bytes
+ * \param[in] length Number of bytes in \a data
+ */
+void UAVTalk::processInputBlock(const quint8 *data, qint64 length)
+{
+    qint64 pos = 0;
+
+    while (pos < length)
+    {
+        // Finish off a packet started in a previous block
+        if (rxState != STATE_SYNC)
+        {
+            processInputByte(data[pos++]);
+            continue;
+        }
+
+        // Skip everything up to the next sync byte
+        const quint8 *sync = (const quint8 *)memchr(&data[pos], SYNC_VAL, length - pos);
+        qint64 skipped = (sync == NULL) ? (length - pos) : (sync - &data[pos]);
+        stats.rxBytes += skipped;
+        pos += skipped;
+        if (sync == NULL)
+            break;
+
+        qint64 consumed = processInputPacket(&data[pos], length - pos);
+        if (consumed > 0)
+            pos += consumed;
+        else
+            processInputByte(data[pos++]);
+    }
+}
+
+/**
+ * Decode a packet which starts with a sync byte at the beginning of \a data.
+ *
+ * Performs the same checks in the same order as the state machine in
+ * processInputByte() and consumes the same number of bytes when one of them
+ * fails, so that resynchronisation happens at the same place.
+ * \param[in] data Received bytes, starting with a sync byte
+ * \param[in] length Number of bytes in \a data
+ * \return Number of bytes consumed, or 0 if the block ends before the packet
+ * could be decided and the state machine has to take over
+ */
+qint64 UAVTalk::processInputPacket(const quint8 *data, qint64 length)
+{
+    if (length < 4)
+        return 0;
+
+    // Check the type, a bad type byte is consumed along with the sync byte
+    if ((data[1] & TYPE_MASK) != TYPE_VER)
+    {
+        stats.rxBytes += 2;
+        return 2;
+    }
+    rxType = data[1];
+
+    packetSize = qFromLittleEndian<quint16>(&data[2]);
+    if (packetSize < MIN_HEADER_LENGTH || packetSize > MAX_HEADER_LENGTH + MAX_PAYLOAD_LENGTH)
+    {
+        stats.rxBytes += 4;
+        return 4;
+    }
+
+    if (length < MIN_HEADER_LENGTH)
+        return 0;
+
+    rxObjId = qFromLittleEndian<quint32>(&data[4]);
+    UAVObject *rxObj = objMngr->getObject(rxObjId);
+    if (rxObj == NULL && rxType != TYPE_OBJ_REQ)
+    {
+        stats.rxBytes += MIN_HEADER_LENGTH;
+        stats.rxErrors++;
+        return MIN_HEADER_LENGTH;
+    }
+
+    qint32 instLength = 0;
+    qint32 headerLength = MIN_HEADER_LENGTH;
+    if (rxObj != NULL)
+    {
+        if (rxType == TYPE_OBJ_REQ || rxType == TYPE_ACK || rxType == TYPE_NACK)
+            rxLength = 0;
+        else
+            rxLength = rxObj->getNumBytes();
+
+        instLength = rxObj->isSingleInstance() ? 0 : 2;
+        if (rxLength >= MAX_PAYLOAD_LENGTH || MIN_HEADER_LENGTH + instLength + rxLength != packetSize)
+        {
+            // Oversize object or mismatched packet size
+            stats.rxBytes += MIN_HEADER_LENGTH;
+            stats.rxErrors++;
+            return MIN_HEADER_LENGTH;
+        }
+        headerLength += instLength;
+    }
+
+    // A request for an unknown object has its checksum right after the
+    // object ID, whatever the size field says. The previous rxLength is
+    // kept, as in the state machine.
+    qint32 checksumPos = (rxObj == NULL) ? MIN_HEADER_LENGTH : packetSize;
+    if (length < checksumPos + CHECKSUM_LENGTH)
+        return 0;
+
+    stats.rxBytes += checksumPos + CHECKSUM_LENGTH;
+
+    if (updateCRC(0, data, checksumPos) != data[checksumPos] || checksumPos != packetSize)
+    {   // packet error - faulty CRC or mismatched packet size
+        stats.rxErrors++;
+        return checksumPos + CHECKSUM_LENGTH;
+    }
+
+    if (instLength > 0)
+        rxInstId = qFromLittleEndian<quint16>(&data[MIN_HEADER_LENGTH]);
+    else
+        rxInstId = 0;
+    if (rxObj != NULL)
+        memcpy(rxBuffer, &data[headerLength], rxLength);
+
+    mutex->lock();
+        receiveObject(rxType, rxObjId, rxInstId, rxBuffer, rxLength);
+        if(useUDPMirror)
+        {
+            udpSocketTx->writeDatagram((const char*)data,packetSize+CHECKSUM_LENGTH,QHostAddress::LocalHost,udpSocketRx->localPort());
+        }
+        stats.rxObjectBytes += rxLength;
+        stats.rxObjects++;
+    mutex->unlock();
+
+    return packetSize + CHECKSUM_LENGTH;
+}
+
 /**
  * Process a byte from the telemetry stream.
  * \param[in] rxbyte Received byte
@@ -855,6 +1028,16 @@ quint8 UAVTalk::updateCRC(quint8 crc, const quint8 data)
 }
 quint8 UAVTalk::updateCRC(quint8 crc, const quint8* data, qint32 length)
 {
+    static const CrcSliceTables tables(crc_table);
+
+    // Fold in four bytes at a time, then finish byte by byte
+    while (length >= 4)
+    {
+        crc = tables.slice[3][crc ^ data[0]] ^ tables.slice[2][data[1]] ^
+              tables.slice[1][data[2]] ^ tables.slice[0][data[3]];
+        data += 4;
+        length -= 4;
+    }
     while (length--)
         crc = crc_table[crc ^ *data++];
     return crc;
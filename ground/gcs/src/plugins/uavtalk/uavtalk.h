@@ -38,6 +38,24 @@
 #include "uavtalk_global.h"
 #include <QtNetwork/QUdpSocket>
 
+class UAVTalk;
+
+/**
+ * Interface of the devices which can lend their received bytes to the
+ * parser in place, such as a memory mapped log, instead of having them
+ * copied out with read(). The device is found with qobject_cast, so it must
+ * list the interface with Q_INTERFACES.
+ */
+class UAVTALK_EXPORT UAVTalkDirectSource
+{
+public:
+    virtual ~UAVTalkDirectSource() {}
+    //! Pass every received byte to UAVTalk::parseBlock(), returns the number of bytes parsed
+    virtual qint64 parseBlocks(UAVTalk *parser) = 0;
+};
+
+Q_DECLARE_INTERFACE(UAVTalkDirectSource, "org.taulabs.UAVTalkDirectSource")
+
 class UAVTALK_EXPORT UAVTalk: public QObject
 {
     Q_OBJECT
@@ -62,20 +80,14 @@ public:
     void resetStats();
 
     bool processInputByte(quint8 rxbyte);
+    void processInputBlock(const quint8 *data, qint64 length);
+    void parseBlock(const quint8 *data, qint64 length);
 
-signals:
-    // The only signals we send to the upper level are when we
-    // either receive an ACK or a NACK for a request.
-    void ackReceived(UAVObject* obj);
-    void nackReceived(UAVObject* obj);
-
-private slots:
-    void processInputStream(void);
-    void dummyUDPRead();
-
-protected:
+    static quint8 updateCRC(quint8 crc, const quint8 data);
+    static quint8 updateCRC(quint8 crc, const quint8* data, qint32 length);
 
-    // Constants
+    // Protocol constants, also used by tools which frame packets themselves
+    static const quint8 SYNC_VAL = 0x3C;
     static const int TYPE_MASK = 0xF8;
     static const int TYPE_VER = 0x20;
     static const int TYPE_OBJ = (TYPE_VER | 0x00);
@@ -96,7 +108,19 @@ protected:
     static const quint16 ALL_INSTANCES = 0xFFFF;
     static const quint16 OBJID_NOTFOUND = 0x0000;
 
+signals:
+    // The only signals we send to the upper level are when we
+    // either receive an ACK or a NACK for a request.
+    void ackReceived(UAVObject* obj);
+    void nackReceived(UAVObject* obj);
+
+private slots:
+    void processInputStream(void);
+    void dummyUDPRead();
+
+protected:
     static const int TX_BUFFER_SIZE = 2*1024;
+    static const int RX_BLOCK_SIZE = 4*1024;
     static const quint8 crc_table[256];
 
     // Types
@@ -104,10 +128,12 @@ protected:
 
     // Variables
     QPointer<QIODevice> io;
+    UAVTalkDirectSource *directSource;
     UAVObjectManager* objMngr;
     QMutex* mutex;
     quint8 rxBuffer[MAX_PACKET_LENGTH];
     quint8 txBuffer[MAX_PACKET_LENGTH];
+    quint8 rxBlockBuffer[RX_BLOCK_SIZE];
     // Variables used by the receive state machine
     quint8 rxTmpBuffer[4];
     quint8 rxType;
@@ -128,14 +154,13 @@ protected:
     QByteArray rxDataArray;
 
     // Methods
+    qint64 processInputPacket(const quint8 *data, qint64 length);
     bool objectTransaction(UAVObject* obj, quint8 type, bool allInstances);
     virtual bool receiveObject(quint8 type, quint32 objId, quint16 instId, quint8* data, qint32 length);
     UAVObject* updateObject(quint32 objId, quint16 instId, quint8* data);
     bool transmitNack(quint32 objId);
     bool transmitObject(UAVObject* obj, quint8 type, bool allInstances);
     bool transmitSingleObject(UAVObject* obj, quint8 type, bool allInstances);
-    quint8 updateCRC(quint8 crc, const quint8 data);
-    quint8 updateCRC(quint8 crc, const quint8* data, qint32 length);
 };
 
 #endif // UAVTALK_H
@@ -9,12 +9,18 @@ HEADERS += uavtalk.h \
     telemetrymonitor.h \
     telemetrymanager.h \
     uavtalk_global.h \
-    telemetry.h
+    telemetry.h \
+    periodicscheduler.h \
+    transmitqueue.h \
+    roundtripestimator.h
 SOURCES += uavtalk.cpp \
     uavtalkplugin.cpp \
     telemetrymonitor.cpp \
     telemetrymanager.cpp \
-    telemetry.cpp
+    telemetry.cpp \
+    periodicscheduler.cpp \
+    transmitqueue.cpp \
+    roundtripestimator.cpp
 DEFINES += UAVTALK_LIBRARY
 OTHER_FILES += UAVTalk.pluginspec \
     UAVTalk.json
\ No newline at end of file
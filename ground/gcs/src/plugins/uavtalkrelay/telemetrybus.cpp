@@ -0,0 +1,283 @@
+/**
+ ******************************************************************************
+ * @file       telemetrybus.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVTalk relay plugin
+ * @{
+ *
+ * @brief Shares the decoded object updates with the other processes of the host
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "telemetrybus.h"
+
+#include <QAtomicInt>
+#include <string.h>
+
+//! "TLTB" in little endian
+static const quint32 MAGIC = 0x42544c54;
+static const quint32 VERSION = 1;
+static const quint32 HEADER_SIZE = 64;
+static const quint32 ALIGNMENT = 8;
+static const quint32 MIN_CAPACITY = 4096;
+static const quint32 MAX_CAPACITY = 1 << 30;
+
+struct BusHeader {
+    quint32 magic;
+    quint32 version;
+    quint32 capacity;
+    quint32 headerSize;
+    QBasicAtomicInt reserved;
+    QBasicAtomicInt committed;
+    quint32 padding[10];
+};
+
+struct RecordHeader {
+    quint32 size;
+    quint32 objId;
+    quint16 instId;
+    quint16 length;
+    quint32 timestampMs;
+};
+
+Q_STATIC_ASSERT(sizeof(BusHeader) == HEADER_SIZE);
+Q_STATIC_ASSERT(sizeof(RecordHeader) % ALIGNMENT == 0);
+
+TelemetryBusWriter::TelemetryBusWriter() :
+    memory(0), capacity(0), position(0), published(0)
+{
+}
+
+TelemetryBusWriter::~TelemetryBusWriter()
+{
+    close();
+}
+
+/**
+ * Create or take over the bus at \a path, with a ring of at least \a capacity
+ * bytes. The readers of a previous writer with the same ring keep their place.
+ */
+bool TelemetryBusWriter::open(const QString &path, quint32 capacity)
+{
+    close();
+
+    quint32 size = MIN_CAPACITY;
+    while (size < capacity && size < MAX_CAPACITY)
+        size <<= 1;
+
+    file.setFileName(path);
+    if (!file.open(QIODevice::ReadWrite))
+        return false;
+    if (file.size() != HEADER_SIZE + size && !file.resize(HEADER_SIZE + size)) {
+        file.close();
+        return false;
+    }
+    memory = file.map(0, HEADER_SIZE + size);
+    if (!memory) {
+        file.close();
+        return false;
+    }
+
+    BusHeader *header = (BusHeader *) memory;
+    if (header->magic != MAGIC || header->version != VERSION ||
+            header->capacity != size || header->headerSize != HEADER_SIZE) {
+        memset(memory, 0, HEADER_SIZE);
+        header->version = VERSION;
+        header->capacity = size;
+        header->headerSize = HEADER_SIZE;
+        header->magic = MAGIC;
+    }
+
+    position = header->committed.load();
+    quint32 reserved = header->reserved.load();
+    if (reserved != position) {
+        // A previous writer stopped in the middle of a record, move on by
+        // more than the ring so that its readers resync
+        position = reserved + size;
+        header->reserved.fetchAndStoreOrdered(position);
+        header->committed.storeRelease(position);
+    }
+
+    this->capacity = size;
+    published = 0;
+    return true;
+}
+
+void TelemetryBusWriter::close()
+{
+    if (memory)
+        file.unmap(memory);
+    memory = 0;
+    file.close();
+}
+
+/**
+ * Append an update to the ring, overwriting the oldest ones
+ * @return false if the bus is not open or the data does not fit
+ */
+bool TelemetryBusWriter::publish(quint32 objId, quint16 instId, quint32 timestampMs, const quint8 *data, quint16 length)
+{
+    quint32 size = (sizeof(RecordHeader) + length + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    if (!memory || objId == 0 || size > capacity / 2)
+        return false;
+
+    BusHeader *header = (BusHeader *) memory;
+    uchar *ring = memory + HEADER_SIZE;
+    quint32 offset = position & (capacity - 1);
+    quint32 padding = offset + size > capacity ? capacity - offset : 0;
+
+    // Claim the oldest bytes before overwriting them
+    header->reserved.fetchAndStoreOrdered(position + padding + size);
+
+    if (padding > 0) {
+        RecordHeader pad = RecordHeader();
+        pad.size = padding;
+        memcpy(ring + offset, &pad, qMin((quint32) sizeof(pad), padding));
+        offset = 0;
+    }
+
+    RecordHeader record;
+    record.size = size;
+    record.objId = objId;
+    record.instId = instId;
+    record.length = length;
+    record.timestampMs = timestampMs;
+    memcpy(ring + offset, &record, sizeof(record));
+    memcpy(ring + offset + sizeof(record), data, length);
+
+    position += padding + size;
+    header->committed.storeRelease(position);
+    published++;
+    return true;
+}
+
+TelemetryBusReader::TelemetryBusReader() :
+    memory(0), capacity(0), position(0), received(0), filtered(0), overruns(0)
+{
+}
+
+TelemetryBusReader::~TelemetryBusReader()
+{
+    close();
+}
+
+/**
+ * Attach to the bus at \a path, which must have been created by a writer
+ */
+bool TelemetryBusReader::open(const QString &path)
+{
+    close();
+
+    // Mapped read and write for the ordered reads of the header, the ring is
+    // never written to
+    file.setFileName(path);
+    if (!file.open(QIODevice::ReadWrite))
+        return false;
+    qint64 size = file.size();
+    if (size >= HEADER_SIZE)
+        memory = file.map(0, size);
+    if (!memory) {
+        file.close();
+        return false;
+    }
+
+    BusHeader *header = (BusHeader *) memory;
+    capacity = header->capacity;
+    if (header->magic != MAGIC || header->version != VERSION || header->headerSize != HEADER_SIZE ||
+            capacity < MIN_CAPACITY || (capacity & (capacity - 1)) != 0 || HEADER_SIZE + capacity > size) {
+        close();
+        return false;
+    }
+
+    position = header->committed.loadAcquire();
+    received = 0;
+    filtered = 0;
+    overruns = 0;
+    return true;
+}
+
+void TelemetryBusReader::close()
+{
+    if (memory)
+        file.unmap(memory);
+    memory = 0;
+    file.close();
+}
+
+/**
+ * Copy the next update of the filtered objects
+ * @return false once all the published updates were read
+ */
+bool TelemetryBusReader::read(Update *update)
+{
+    if (!memory)
+        return false;
+
+    BusHeader *header = (BusHeader *) memory;
+    const uchar *ring = memory + HEADER_SIZE;
+
+    forever {
+        quint32 committed = header->committed.loadAcquire();
+        quint32 available = committed - position;
+        if (available == 0)
+            return false;
+        if (available > capacity) {
+            overruns++;
+            position = committed;
+            return false;
+        }
+
+        // The padding at the end of the ring may be shorter than a header
+        quint32 offset = position & (capacity - 1);
+        RecordHeader record = RecordHeader();
+        memcpy(&record, ring + offset, qMin((quint32) sizeof(record), capacity - offset));
+
+        bool valid = record.size >= ALIGNMENT && record.size % ALIGNMENT == 0 &&
+                record.size <= available && record.size <= capacity - offset;
+        bool wanted = valid && record.objId != 0 && (filter.isEmpty() || filter.contains(record.objId));
+        if (wanted) {
+            valid = record.size >= sizeof(record) + record.length;
+            if (valid) {
+                update->data.resize(record.length);
+                memcpy(update->data.data(), ring + offset + sizeof(record), record.length);
+            }
+        }
+
+        // The copy is only whole if the writer did not claim its bytes meanwhile
+        if ((quint32) (header->reserved.fetchAndAddOrdered(0) - position) > capacity || !valid) {
+            overruns++;
+            position = header->committed.loadAcquire();
+            continue;
+        }
+
+        position += record.size;
+        if (record.objId == 0)
+            continue;
+        if (!wanted) {
+            filtered++;
+            continue;
+        }
+
+        update->objId = record.objId;
+        update->instId = record.instId;
+        update->timestampMs = record.timestampMs;
+        received++;
+        return true;
+    }
+}
@@ -0,0 +1,128 @@
+/**
+ ******************************************************************************
+ * @file       telemetrybus.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVTalk relay plugin
+ * @{
+ *
+ * @brief Shares the decoded object updates with the other processes of the host
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef TELEMETRYBUS_H
+#define TELEMETRYBUS_H
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QFile>
+#include <QSet>
+#include <QString>
+
+/*
+ * The bus is a memory mapped file holding a header and a ring of records,
+ * written by a single process and read by any number of others, which never
+ * write to it nor wait for each other:
+ *
+ *   header, 64 bytes, in the byte order of the host
+ *     u32 magic, u32 version, u32 capacity, u32 header size,
+ *     u32 reserved, u32 committed, padding
+ *   ring, capacity bytes, a power of two
+ *     records aligned on 8 bytes:
+ *       u32 size, u32 object id, u16 instance id, u16 data length,
+ *       u32 timestamp in ms, packed object data, padding
+ *
+ * The reserved and committed counters are byte positions in the stream of
+ * records, wrapping at 2^32, and the offset of a record in the ring is its
+ * position modulo the capacity. A record with the object id 0 pads the end of
+ * the ring. The writer advances reserved before overwriting the oldest
+ * records and committed once the new record is complete. A reader copies a
+ * record and then checks the writer did not reserve its bytes meanwhile,
+ * otherwise the reader was lapped and skips to the newest record.
+ */
+
+/**
+ * @brief The TelemetryBusWriter class Publishes the object updates to the bus
+ */
+class TelemetryBusWriter
+{
+public:
+    TelemetryBusWriter();
+    ~TelemetryBusWriter();
+
+    bool open(const QString &path, quint32 capacity);
+    void close();
+    bool isOpen() const {return memory != 0;}
+
+    bool publish(quint32 objId, quint16 instId, quint32 timestampMs, const quint8 *data, quint16 length);
+
+    quint32 getCapacity() const {return capacity;}
+    quint32 getPublished() const {return published;}
+
+private:
+    QFile file;
+    uchar *memory;
+    quint32 capacity;
+    //! Position of the next record, only moved by this writer
+    quint32 position;
+    quint32 published;
+};
+
+/**
+ * @brief The TelemetryBusReader class Subscribes to the object updates of the
+ * bus, from the newest one when opened. Only the updates of the objects in the
+ * filter are copied, all of them with an empty filter.
+ */
+class TelemetryBusReader
+{
+public:
+    struct Update {
+        Update() : objId(0), instId(0), timestampMs(0) {}
+        quint32 objId;
+        quint16 instId;
+        quint32 timestampMs;
+        QByteArray data;
+    };
+
+    TelemetryBusReader();
+    ~TelemetryBusReader();
+
+    bool open(const QString &path);
+    void close();
+    bool isOpen() const {return memory != 0;}
+
+    void setFilter(const QSet<quint32> &objIds) {filter = objIds;}
+    bool read(Update *update);
+
+    quint32 getReceived() const {return received;}
+    quint32 getFiltered() const {return filtered;}
+    quint32 getOverruns() const {return overruns;}
+
+private:
+    QFile file;
+    uchar *memory;
+    quint32 capacity;
+    quint32 position;
+    QSet<quint32> filter;
+    quint32 received;
+    quint32 filtered;
+    //! Times the reader was lapped by the writer and lost updates
+    quint32 overruns;
+};
+
+#endif // TELEMETRYBUS_H
@@ -0,0 +1,129 @@
+/**
+ ******************************************************************************
+ * @file       telemetrybusrelay.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVTalk relay plugin
+ * @{
+ *
+ * @brief Publishes the objects to the telemetry bus of the host, or updates
+ * them from it
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "telemetrybusrelay.h"
+#include <QDir>
+#include <QDebug>
+
+//! Ring of the published updates, a few seconds of a fast link
+static const quint32 BUS_CAPACITY = 1 << 20;
+//! Period the subscriber reads the bus at
+static const int READ_PERIOD_MS = 10;
+
+TelemetryBusRelay::TelemetryBusRelay(UAVObjectManager *ObjMngr, UavTalkRelayComon::busMode mode, QString path) :
+    m_ObjMngr(ObjMngr), m_Mode(UavTalkRelayComon::BusOff)
+{
+    clock.start();
+    connect(&readTimer, SIGNAL(timeout()), this, SLOT(readBus()));
+
+    QVector< QVector<UAVObject*> > list = m_ObjMngr->getObjectsVector();
+    foreach (QVector<UAVObject*> instances, list) {
+        foreach (UAVObject *obj, instances)
+            connectObject(obj);
+    }
+    connect(m_ObjMngr, SIGNAL(newObject(UAVObject*)), this, SLOT(newObject(UAVObject*)));
+    connect(m_ObjMngr, SIGNAL(newInstance(UAVObject*)), this, SLOT(newObject(UAVObject*)));
+
+    setMode(mode, path);
+}
+
+TelemetryBusRelay::~TelemetryBusRelay()
+{
+    writer.close();
+    reader.close();
+}
+
+QString TelemetryBusRelay::defaultPath()
+{
+    return QDir::tempPath() + "/taulabs-telemetrybus";
+}
+
+/**
+ * Publish to or subscribe to the bus at \a path, or leave it
+ */
+void TelemetryBusRelay::setMode(UavTalkRelayComon::busMode mode, QString path)
+{
+    if (path.isEmpty())
+        path = defaultPath();
+
+    readTimer.stop();
+    writer.close();
+    reader.close();
+    m_Mode = mode;
+    m_Path = path;
+
+    switch (mode) {
+    case UavTalkRelayComon::BusPublish:
+        if (!writer.open(m_Path, BUS_CAPACITY))
+            qDebug() << __FUNCTION__ << "could not publish to" << m_Path;
+        break;
+    case UavTalkRelayComon::BusSubscribe:
+        // Attached on the first read, once the publisher created the bus
+        readTimer.start(READ_PERIOD_MS);
+        break;
+    default:
+        break;
+    }
+}
+
+void TelemetryBusRelay::connectObject(UAVObject *obj)
+{
+    connect(obj, SIGNAL(objectUpdated(UAVObject*)), this, SLOT(publishObject(UAVObject*)));
+}
+
+void TelemetryBusRelay::newObject(UAVObject *obj)
+{
+    connectObject(obj);
+}
+
+void TelemetryBusRelay::publishObject(UAVObject *obj)
+{
+    if (!writer.isOpen())
+        return;
+
+    packBuffer.resize(obj->getNumBytes());
+    obj->pack(packBuffer.data());
+    writer.publish(obj->getObjID(), obj->getInstID(), clock.elapsed(), packBuffer.constData(), packBuffer.size());
+}
+
+/**
+ * Unpack the updates published since the last read into the objects, the
+ * updates of the instances not known here are dropped
+ */
+void TelemetryBusRelay::readBus()
+{
+    if (!reader.isOpen() && !reader.open(m_Path))
+        return;
+
+    TelemetryBusReader::Update update;
+    while (reader.read(&update)) {
+        UAVObject *obj = m_ObjMngr->getObject(update.objId, update.instId);
+        if (obj && (quint32) update.data.size() == obj->getNumBytes())
+            obj->unpack((const quint8 *) update.data.constData());
+    }
+}
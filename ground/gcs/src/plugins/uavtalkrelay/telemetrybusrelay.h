@@ -0,0 +1,73 @@
+/**
+ ******************************************************************************
+ * @file       telemetrybusrelay.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVTalk relay plugin
+ * @{
+ *
+ * @brief Publishes the objects to the telemetry bus of the host, or updates
+ * them from it
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#ifndef TELEMETRYBUSRELAY_H
+#define TELEMETRYBUSRELAY_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QVector>
+#include "uavobjectmanager.h"
+#include "uavtalkrelay_global.h"
+#include "telemetrybus.h"
+
+/**
+ * @brief The TelemetryBusRelay class The GCS owning the link publishes every
+ * object update to the bus once, and the other processes of the host read
+ * them from it without parsing the link again. A subscribing GCS unpacks the
+ * updates into its objects as if they came from its own link.
+ */
+class TelemetryBusRelay: public QObject
+{
+    Q_OBJECT
+public:
+    TelemetryBusRelay(UAVObjectManager *ObjMngr, UavTalkRelayComon::busMode mode, QString path);
+    ~TelemetryBusRelay();
+
+    void setMode(UavTalkRelayComon::busMode mode, QString path);
+    static QString defaultPath();
+
+private slots:
+    void newObject(UAVObject *obj);
+    void publishObject(UAVObject *obj);
+    void readBus();
+
+private:
+    void connectObject(UAVObject *obj);
+
+    UAVObjectManager *m_ObjMngr;
+    UavTalkRelayComon::busMode m_Mode;
+    QString m_Path;
+    TelemetryBusWriter writer;
+    TelemetryBusReader reader;
+    QTimer readTimer;
+    QElapsedTimer clock;
+    QVector<quint8> packBuffer;
+};
+
+#endif // TELEMETRYBUSRELAY_H
@@ -0,0 +1,18 @@
+# Fan-out of the object updates to several consumers of the host, each parsing
+# the UAVTalk stream or reading the telemetry bus, and checks the readers of
+# the bus filter, resync once lapped and never see a torn update.
+# Set TELEMETRYBUS_BENCH_UPDATES to the updates published, 200000 by default.
+
+QT += testlib
+QT -= gui
+TARGET = telemetrybusbenchmark
+CONFIG += console testcase
+CONFIG -= app_bundle
+TEMPLATE = app
+
+include(../../../../../gcs.pri)
+
+INCLUDEPATH *= ../..
+
+SOURCES += tst_telemetrybusbenchmark.cpp \
+    ../../telemetrybus.cpp
@@ -0,0 +1,426 @@
+/**
+ ******************************************************************************
+ * @file       tst_telemetrybusbenchmark.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVTalk relay plugin
+ * @{
+ *
+ * @brief Fans the object updates out to several consumers of the host, each
+ * parsing the UAVTalk stream as done before or reading the telemetry bus, and
+ * checks the readers filter, resync once lapped and never see a torn update
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <QtTest/QtTest>
+#include <QElapsedTimer>
+#include <QTemporaryFile>
+#include <QThread>
+
+#include "telemetrybus.h"
+
+class tst_TelemetryBusBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void fanOut_data();
+    void fanOut();
+    void filter();
+    void lapped();
+    void concurrentReaders();
+
+private:
+    int m_updates;
+};
+
+//! Objects of the stream and their sizes
+static const int OBJECTS = 20;
+static const int MAX_LENGTH = 200;
+//! Updates published between two reads of the consumers
+static const int UPDATES_PER_READ = 100;
+static const quint32 CAPACITY = 1 << 20;
+
+static quint8 crcTable[256];
+
+static void initCrcTable()
+{
+    for (int i = 0; i < 256; i++) {
+        quint8 crc = i;
+        for (int j = 0; j < 8; j++)
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+        crcTable[i] = crc;
+    }
+}
+
+static quint32 objectId(int object)
+{
+    return 0x1000 + object * 0x10;
+}
+
+static quint16 objectLength(int object)
+{
+    return 16 + object * (MAX_LENGTH - 16) / (OBJECTS - 1);
+}
+
+/**
+ * Frame an update as UAVTalk does: sync, type, length, object and instance
+ * ids, data and CRC
+ */
+static void appendFrame(QByteArray *stream, quint32 objId, quint16 instId, const quint8 *data, quint16 length)
+{
+    quint8 header[10];
+    quint16 frameLength = sizeof(header) + length;
+    header[0] = 0x3C;
+    header[1] = 0x20;
+    memcpy(&header[2], &frameLength, 2);
+    memcpy(&header[4], &objId, 4);
+    memcpy(&header[8], &instId, 2);
+
+    quint8 crc = 0;
+    for (unsigned i = 0; i < sizeof(header); i++)
+        crc = crcTable[crc ^ header[i]];
+    for (int i = 0; i < length; i++)
+        crc = crcTable[crc ^ data[i]];
+
+    stream->append((const char *) header, sizeof(header));
+    stream->append((const char *) data, length);
+    stream->append((char) crc);
+}
+
+/**
+ * @brief The StreamParser struct A consumer of the relayed stream, parsing it
+ * byte by byte and checking the CRC before copying the object data
+ */
+struct StreamParser {
+    StreamParser() : state(0), received(0) {}
+
+    void parse(const QByteArray &stream) {
+        for (int i = 0; i < stream.size(); i++) {
+            quint8 byte = stream.at(i);
+            if (state == 0) {
+                if (byte != 0x3C)
+                    continue;
+                crc = 0;
+                count = 0;
+                state = 1;
+            }
+            if (state == 1) {
+                crc = crcTable[crc ^ byte];
+                header[count++] = byte;
+                if (count == sizeof(header)) {
+                    memcpy(&length, &header[2], 2);
+                    memcpy(&objId, &header[4], 4);
+                    memcpy(&instId, &header[8], 2);
+                    length -= sizeof(header);
+                    data.resize(length);
+                    count = 0;
+                    state = length > 0 ? 2 : 3;
+                }
+            } else if (state == 2) {
+                crc = crcTable[crc ^ byte];
+                data[count++] = byte;
+                if (count == length)
+                    state = 3;
+            } else {
+                if (byte == crc)
+                    received++;
+                state = 0;
+            }
+        }
+    }
+
+    int state;
+    quint8 header[10];
+    int count;
+    quint8 crc;
+    quint16 length;
+    quint32 objId;
+    quint16 instId;
+    QByteArray data;
+    quint32 received;
+};
+
+void tst_TelemetryBusBenchmark::initTestCase()
+{
+    initCrcTable();
+    m_updates = qgetenv("TELEMETRYBUS_BENCH_UPDATES").toInt();
+    if (m_updates <= 0)
+        m_updates = 200000;
+}
+
+void tst_TelemetryBusBenchmark::fanOut_data()
+{
+    QTest::addColumn<int>("consumers");
+
+    QTest::newRow("1") << 1;
+    QTest::newRow("2") << 2;
+    QTest::newRow("4") << 4;
+    QTest::newRow("8") << 8;
+}
+
+void tst_TelemetryBusBenchmark::fanOut()
+{
+    QFETCH(int, consumers);
+
+    quint8 data[MAX_LENGTH];
+    for (int i = 0; i < MAX_LENGTH; i++)
+        data[i] = i;
+
+    // Relayed stream, framed once and parsed by every consumer
+    QElapsedTimer timer;
+    timer.start();
+    QByteArray stream;
+    QVector<StreamParser> parsers(consumers);
+    for (int i = 0; i < m_updates; i += UPDATES_PER_READ) {
+        for (int j = i; j < i + UPDATES_PER_READ && j < m_updates; j++)
+            appendFrame(&stream, objectId(j % OBJECTS), 0, data, objectLength(j % OBJECTS));
+        for (int k = 0; k < consumers; k++)
+            parsers[k].parse(stream);
+        stream.clear();
+    }
+    qint64 streamNs = timer.nsecsElapsed();
+
+    // Bus, written once and copied by every reader
+    QTemporaryFile busFile;
+    QVERIFY(busFile.open());
+    TelemetryBusWriter writer;
+    QVERIFY(writer.open(busFile.fileName(), CAPACITY));
+    QVector<TelemetryBusReader *> readers;
+    for (int k = 0; k < consumers; k++) {
+        readers.append(new TelemetryBusReader());
+        QVERIFY(readers[k]->open(busFile.fileName()));
+    }
+
+    timer.start();
+    TelemetryBusReader::Update update;
+    for (int i = 0; i < m_updates; i += UPDATES_PER_READ) {
+        for (int j = i; j < i + UPDATES_PER_READ && j < m_updates; j++)
+            writer.publish(objectId(j % OBJECTS), 0, j, data, objectLength(j % OBJECTS));
+        for (int k = 0; k < consumers; k++) {
+            while (readers[k]->read(&update))
+                ;
+        }
+    }
+    qint64 busNs = timer.nsecsElapsed();
+
+    qDebug("%d consumers: stream parsed %7.1f ns/update, bus read %6.1f ns/update", consumers,
+           (double) streamNs / m_updates, (double) busNs / m_updates);
+
+    QCOMPARE(writer.getPublished(), (quint32) m_updates);
+    for (int k = 0; k < consumers; k++) {
+        QCOMPARE(parsers[k].received, (quint32) m_updates);
+        QCOMPARE(readers[k]->getReceived(), (quint32) m_updates);
+        QCOMPARE(readers[k]->getOverruns(), (quint32) 0);
+        delete readers[k];
+    }
+    QVERIFY(busNs < streamNs);
+}
+
+/**
+ * Only the updates of the filtered objects are copied
+ */
+void tst_TelemetryBusBenchmark::filter()
+{
+    QTemporaryFile busFile;
+    QVERIFY(busFile.open());
+    TelemetryBusWriter writer;
+    QVERIFY(writer.open(busFile.fileName(), 4096));
+    QCOMPARE(writer.getCapacity(), (quint32) 4096);
+
+    TelemetryBusReader all, some;
+    QVERIFY(all.open(busFile.fileName()));
+    QVERIFY(some.open(busFile.fileName()));
+    QSet<quint32> objIds;
+    objIds << objectId(3) << objectId(7);
+    some.setFilter(objIds);
+
+    quint8 data[MAX_LENGTH] = {0};
+    TelemetryBusReader::Update update;
+    for (int i = 0; i < 1000; i++) {
+        data[0] = i;
+        QVERIFY(writer.publish(objectId(i % OBJECTS), i % 3, i, data, objectLength(i % OBJECTS)));
+        if (i % 10 != 9)
+            continue;
+
+        while (all.read(&update))
+            ;
+        int seen = 0;
+        while (some.read(&update)) {
+            QVERIFY(objIds.contains(update.objId));
+            QCOMPARE(update.data.size(), (int) objectLength((update.objId - 0x1000) / 0x10));
+            QCOMPARE((quint8) update.data.at(0), (quint8) update.timestampMs);
+            QCOMPARE(update.instId, (quint16) (update.timestampMs % 3));
+            seen++;
+        }
+        QCOMPARE(seen, i % 20 < 10 ? 2 : 0);
+    }
+
+    QCOMPARE(all.getReceived(), (quint32) 1000);
+    QCOMPARE(some.getReceived(), (quint32) 100);
+    QCOMPARE(some.getFiltered(), (quint32) 900);
+    QCOMPARE(some.getOverruns(), (quint32) 0);
+
+    // Too large for the ring
+    QVERIFY(!writer.publish(objectId(0), 0, 0, data, 4096));
+}
+
+/**
+ * A reader lapped by the writer skips to the newest update and goes on
+ */
+void tst_TelemetryBusBenchmark::lapped()
+{
+    QTemporaryFile busFile;
+    QVERIFY(busFile.open());
+    TelemetryBusWriter writer;
+    QVERIFY(writer.open(busFile.fileName(), 4096));
+    TelemetryBusReader reader;
+    QVERIFY(reader.open(busFile.fileName()));
+
+    quint8 data[64] = {0};
+    for (int i = 0; i < 200; i++)
+        QVERIFY(writer.publish(objectId(1), 0, i, data, sizeof(data)));
+
+    TelemetryBusReader::Update update;
+    QVERIFY(!reader.read(&update));
+    QCOMPARE(reader.getOverruns(), (quint32) 1);
+
+    for (int i = 200; i < 210; i++)
+        QVERIFY(writer.publish(objectId(1), 0, i, data, sizeof(data)));
+    for (int i = 200; i < 210; i++) {
+        QVERIFY(reader.read(&update));
+        QCOMPARE(update.timestampMs, (quint32) i);
+    }
+    QVERIFY(!reader.read(&update));
+
+    // A new writer carries on, its reader keeps its place
+    writer.close();
+    QVERIFY(writer.open(busFile.fileName(), 4096));
+    QVERIFY(writer.publish(objectId(2), 0, 210, data, sizeof(data)));
+    QVERIFY(reader.read(&update));
+    QCOMPARE(update.objId, objectId(2));
+    QCOMPARE(reader.getOverruns(), (quint32) 1);
+}
+
+/**
+ * @brief The PublisherThread class Publishes updates whose data and ids follow
+ * their sequence number
+ */
+class PublisherThread : public QThread
+{
+public:
+    PublisherThread(TelemetryBusWriter *writer, int updates) : writer(writer), updates(updates) {}
+
+    void run() {
+        quint8 data[MAX_LENGTH];
+        for (int seq = 0; seq < updates; seq++) {
+            int length = 8 + seq % 64;
+            for (int i = 0; i < length; i++)
+                data[i] = seq * 7 + i;
+            writer->publish(objectId(seq % OBJECTS), seq, seq, data, length);
+            // Let the readers in on a single core too, after bursts of 32
+            // updates and of 224 updates lapping them
+            if (seq % 256 == 31 || seq % 256 == 255)
+                yieldCurrentThread();
+        }
+    }
+
+private:
+    TelemetryBusWriter *writer;
+    int updates;
+};
+
+/**
+ * @brief The ReaderThread class Reads until the publisher is done and counts
+ * the updates not matching their sequence number
+ */
+class ReaderThread : public QThread
+{
+public:
+    ReaderThread(TelemetryBusReader *reader, QAtomicInt *done) : received(0), torn(0), reader(reader), done(done) {}
+
+    void run() {
+        TelemetryBusReader::Update update;
+        qint64 last = -1;
+        forever {
+            bool finished = done->loadAcquire();
+            while (reader->read(&update)) {
+                quint32 seq = update.timestampMs;
+                bool intact = (qint64) seq > last && update.objId == objectId(seq % OBJECTS) &&
+                        update.instId == (quint16) seq && update.data.size() == (int) (8 + seq % 64);
+                for (int i = 0; intact && i < update.data.size(); i++)
+                    intact = (quint8) update.data.at(i) == (quint8) (seq * 7 + i);
+                if (!intact)
+                    torn++;
+                last = seq;
+                received++;
+            }
+            if (finished)
+                return;
+            yieldCurrentThread();
+        }
+    }
+
+    int received;
+    int torn;
+
+private:
+    TelemetryBusReader *reader;
+    QAtomicInt *done;
+};
+
+/**
+ * Readers racing a writer lapping them on a small ring only see whole updates
+ */
+void tst_TelemetryBusBenchmark::concurrentReaders()
+{
+    QTemporaryFile busFile;
+    QVERIFY(busFile.open());
+    TelemetryBusWriter writer;
+    QVERIFY(writer.open(busFile.fileName(), 4096));
+
+    const int readerCount = 3;
+    QAtomicInt done(0);
+    TelemetryBusReader readers[readerCount];
+    ReaderThread *threads[readerCount];
+    for (int k = 0; k < readerCount; k++) {
+        QVERIFY(readers[k].open(busFile.fileName()));
+        threads[k] = new ReaderThread(&readers[k], &done);
+        threads[k]->start();
+    }
+
+    PublisherThread publisher(&writer, m_updates * 5);
+    publisher.start();
+    publisher.wait();
+    done.storeRelease(1);
+
+    for (int k = 0; k < readerCount; k++) {
+        threads[k]->wait();
+        qDebug("Reader %d: %d of %d updates read, %u overruns", k, threads[k]->received, m_updates * 5,
+               readers[k].getOverruns());
+        QCOMPARE(threads[k]->torn, 0);
+        QVERIFY(threads[k]->received > 0);
+        QCOMPARE((quint32) threads[k]->received, readers[k].getReceived());
+        delete threads[k];
+    }
+}
+
+QTEST_MAIN(tst_TelemetryBusBenchmark)
+
+#include "tst_telemetrybusbenchmark.moc"
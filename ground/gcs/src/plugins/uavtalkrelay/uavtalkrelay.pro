@@ -9,12 +9,16 @@ HEADERS += \
     uavtalkrelay_global.h \
     uavtalkrelay.h \
     uavtalkrelayoptionspage.h \
-    filtereduavtalk.h
+    filtereduavtalk.h \
+    telemetrybus.h \
+    telemetrybusrelay.h
 SOURCES += \
     uavtalkrelayplugin.cpp \
     uavtalkrelay.cpp \
     uavtalkrelayoptionspage.cpp \
-    filtereduavtalk.cpp
+    filtereduavtalk.cpp \
+    telemetrybus.cpp \
+    telemetrybusrelay.cpp
 
 FORMS += uavtalkrelayoptionspage.ui
 DEFINES += UAVTALKRELAY_LIBRARY
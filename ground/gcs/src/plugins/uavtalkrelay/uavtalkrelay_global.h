@@ -43,6 +43,7 @@ class UAVTALKRELAY_EXPORT UavTalkRelayComon:public QObject
     Q_OBJECT
 public:
     typedef enum {ReadOnly,WriteOnly,ReadWrite,None} accessType;
+    typedef enum {BusOff,BusPublish,BusSubscribe} busMode;
 };
 
 #endif // UAVTALKRELAY_GLOBAL_H
@@ -71,6 +71,12 @@ QWidget *UavTalkRelayOptionsPage::createPage(QWidget *parent)
 
     m_page->ListeningPort->setValue(m_config->m_Port);
     m_page->ListeningInterface->setText(m_config->m_IpAddress);
+    m_page->cbTelemetryBus->addItem("Off",UavTalkRelayComon::BusOff);
+    m_page->cbTelemetryBus->addItem("Publish the telemetry",UavTalkRelayComon::BusPublish);
+    m_page->cbTelemetryBus->addItem("Subscribe to the telemetry",UavTalkRelayComon::BusSubscribe);
+    m_page->cbTelemetryBus->setCurrentIndex(m_page->cbTelemetryBus->findData(m_config->m_BusMode));
+    m_page->TelemetryBusPath->setText(m_config->m_BusPath);
+    m_page->TelemetryBusPath->setPlaceholderText(TelemetryBusRelay::defaultPath());
     foreach(QString host,m_config->rules.keys())
     {
         foreach(quint32 uavo,m_config->rules.value(host).keys())
@@ -95,6 +101,8 @@ void UavTalkRelayOptionsPage::apply()
 {
     m_config->m_Port=m_page->ListeningPort->value();
     m_config->m_IpAddress=m_page->ListeningInterface->text();
+    m_config->m_BusMode=(UavTalkRelayComon::busMode)m_page->cbTelemetryBus->itemData(m_page->cbTelemetryBus->currentIndex()).toInt();
+    m_config->m_BusPath=m_page->TelemetryBusPath->text();
     m_config->rules.clear();
     for(int i=0;i < m_page->twRules->rowCount();++i)
     {
@@ -34,8 +34,9 @@
 #include "uavobjectmanager.h"
 static const QString VERSION = "1.0.0";
 
-UavTalkRelayPlugin::UavTalkRelayPlugin() : relay(0), m_IpAddress(""),
-    m_Port(2000), m_DefaultRule(UavTalkRelayComon::ReadWrite)
+UavTalkRelayPlugin::UavTalkRelayPlugin() : relay(0), bus(0), m_IpAddress(""),
+    m_Port(2000), m_DefaultRule(UavTalkRelayComon::ReadWrite),
+    m_BusMode(UavTalkRelayComon::BusOff)
 {
 }
 
@@ -65,6 +66,8 @@ bool UavTalkRelayPlugin::initialize(const QStringList & arguments, QString * err
     UAVObjectManager * objMngr = pm->getObject<UAVObjectManager>();
     relay=new UavTalkRelay(objMngr,m_IpAddress,m_Port,rules,m_DefaultRule);
     addAutoReleasedObject(relay);
+    bus=new TelemetryBusRelay(objMngr,m_BusMode,m_BusPath);
+    addAutoReleasedObject(bus);
     return true;
 }
 
@@ -80,6 +83,8 @@ void UavTalkRelayPlugin::readConfig(QSettings *qSettings, UAVConfigInfo *configI
     m_IpAddress = (qSettings->value(QLatin1String("ListeningInterface"),m_IpAddress).toString());
     m_Port = (qSettings->value(QLatin1String("ListeningPort"), m_Port).toInt());
     m_DefaultRule=(UavTalkRelayComon::accessType)qSettings->value(QLatin1String("Defaul Rule"),m_DefaultRule).toInt();
+    m_BusMode=(UavTalkRelayComon::busMode)qSettings->value(QLatin1String("TelemetryBus"),m_BusMode).toInt();
+    m_BusPath = (qSettings->value(QLatin1String("TelemetryBusPath"),m_BusPath).toString());
     qSettings->endGroup();
     int size=qSettings->beginReadArray(QLatin1String("Rule"));
     for(int i=0;i < size;++i)
@@ -115,6 +120,8 @@ void UavTalkRelayPlugin::saveConfig(QSettings *qSettings, UAVConfigInfo *configI
     qSettings->setValue(QLatin1String("ListeningInterface"), m_IpAddress);
     qSettings->setValue(QLatin1String("ListeningPort"), m_Port);
     qSettings->setValue(QLatin1String("Default Rule"),m_DefaultRule);
+    qSettings->setValue(QLatin1String("TelemetryBus"),m_BusMode);
+    qSettings->setValue(QLatin1String("TelemetryBusPath"),m_BusPath);
     qSettings->endGroup();
     qSettings->beginWriteArray(QLatin1String("Rule"));
     int index=0;
@@ -135,4 +142,6 @@ void UavTalkRelayPlugin::saveConfig(QSettings *qSettings, UAVConfigInfo *configI
     relay->setPort(m_Port);
     relay->setRules(rules);
     relay->restartServer();
+    Q_ASSERT(bus);
+    bus->setMode(m_BusMode,m_BusPath);
 }
@@ -28,6 +28,7 @@
 #define UAVTALKRELAYPLUGIN_H
 
 #include "uavtalkrelay.h"
+#include "telemetrybusrelay.h"
 
 #include <extensionsystem/iplugin.h>
 #include <extensionsystem/pluginmanager.h>
@@ -57,10 +58,13 @@ private:
     QHash<QString,QHash<quint32,UavTalkRelayComon::accessType> > rules;
     ExtensionSystem::PluginManager* plMngr;
     UavTalkRelay * relay;
+    TelemetryBusRelay * bus;
     UavTalkRelayOptionsPage * mop;
     QString m_IpAddress;
     int m_Port;
     UavTalkRelayComon::accessType m_DefaultRule;
+    UavTalkRelayComon::busMode m_BusMode;
+    QString m_BusPath;
 };
 
 #endif // UAVTALKPRELAYLUGIN_H
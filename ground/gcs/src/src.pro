@@ -4,4 +4,5 @@ CONFIG   += ordered
 SUBDIRS = \
     libs \
     app \
-    plugins
+    plugins \
+    tools
@@ -0,0 +1,359 @@
+/**
+ ******************************************************************************
+ *
+ * @file       logconverter.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @brief      Converts a telemetry log to one column file per object field
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "logconverter.h"
+#include "mappedlog.h"
+#include "uavtalk/uavtalk.h"
+#include "uavobjectmanager.h"
+#include <QtConcurrent/QtConcurrent>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QtEndian>
+#include <string.h>
+
+//! Records framed by each task of the first pass
+static const int RECORDS_PER_CHUNK = 16384;
+//! Samples gathered in memory before being appended to the column files
+static const int SAMPLES_PER_WRITE = 4096;
+//! Payload bytes read at once when the log cannot be mapped
+static const qint64 BYTES_PER_BATCH = 256 * 1024 * 1024;
+
+LogConverter::LogConverter(UAVObjectManager *objMngr) :
+    objMngr(objMngr),
+    threadCount(QThread::idealThreadCount())
+{
+    memset(&stats, 0, sizeof(stats));
+
+    // The field layouts are read once here, the worker threads never touch
+    // the objects
+    foreach (QVector<UAVObject *> instances, objMngr->getObjectsVector()) {
+        UAVObject *obj = instances.first();
+        Layout layout;
+        layout.name = obj->getName();
+        layout.objId = obj->getObjID();
+        layout.singleInstance = obj->isSingleInstance();
+        layout.dataLength = obj->getNumBytes();
+        foreach (UAVObjectField *field, obj->getFields()) {
+            Column column;
+            column.name = field->getName();
+            column.type = field->getTypeAsString();
+            if (field->getType() == UAVObjectField::ENUM)
+                column.options = field->getOptions();
+            column.elements = field->getNumElements();
+            column.offset = field->getDataOffset();
+            column.bytes = field->getNumBytes();
+            layout.columns.append(column);
+        }
+        layouts.insert(layout.objId, layout);
+    }
+}
+
+/**
+ * Find the packets in a run of records and sort them by object. Packets
+ * which do not pass the checks of the UAVTalk parser are counted and
+ * dropped, and the search resumes on the next sync byte.
+ */
+void LogConverter::frameRecords(Chunk *chunk, const Record *records, int count) const
+{
+    chunk->packetCount = 0;
+    chunk->unknownPackets = 0;
+    chunk->invalidPackets = 0;
+    chunk->skippedBytes = 0;
+
+    for (int r = 0; r < count; r++) {
+        const quint8 *data = (const quint8 *) records[r].payload.constData();
+        const qint64 size = records[r].payload.size();
+        qint64 pos = 0;
+        while (pos + UAVTalk::MIN_HEADER_LENGTH + UAVTalk::CHECKSUM_LENGTH <= size) {
+            const quint8 *packet = data + pos;
+            if (packet[0] != UAVTalk::SYNC_VAL) {
+                chunk->skippedBytes++;
+                pos++;
+                continue;
+            }
+
+            quint8 type = packet[1];
+            quint16 length = qFromLittleEndian<quint16>(packet + 2);
+            if ((type & UAVTalk::TYPE_MASK) != UAVTalk::TYPE_VER || length < UAVTalk::MIN_HEADER_LENGTH ||
+                    length > UAVTalk::MAX_HEADER_LENGTH + UAVTalk::MAX_PAYLOAD_LENGTH ||
+                    pos + length + UAVTalk::CHECKSUM_LENGTH > size) {
+                chunk->skippedBytes++;
+                pos++;
+                continue;
+            }
+
+            // Requests and acknowledgements carry no object data
+            if (type != UAVTalk::TYPE_OBJ && type != UAVTalk::TYPE_OBJ_ACK) {
+                pos += length + UAVTalk::CHECKSUM_LENGTH;
+                continue;
+            }
+
+            if (UAVTalk::updateCRC(0, packet, length) != packet[length]) {
+                chunk->invalidPackets++;
+                chunk->skippedBytes++;
+                pos++;
+                continue;
+            }
+            pos += length + UAVTalk::CHECKSUM_LENGTH;
+
+            quint32 objId = qFromLittleEndian<quint32>(packet + 4);
+            QHash<quint32, Layout>::const_iterator layout = layouts.constFind(objId);
+            if (layout == layouts.constEnd()) {
+                chunk->unknownPackets++;
+                continue;
+            }
+            quint32 headerLength = UAVTalk::MIN_HEADER_LENGTH + (layout->singleInstance ? 0 : 2);
+            if (headerLength + layout->dataLength != length) {
+                chunk->invalidPackets++;
+                continue;
+            }
+
+            Packet p = { packet, records[r].timestamp };
+            chunk->packets[objId].append(p);
+            chunk->packetCount++;
+        }
+        chunk->skippedBytes += size - pos;
+    }
+}
+
+/**
+ * Write the columns of one object
+ * @param append Set to add the packets after those of a previous batch
+ */
+bool LogConverter::writeObject(const Layout *layout, const QVector<Packet> &packets, const QString &outputDir, bool append) const
+{
+    QDir dir(outputDir);
+    if (!dir.mkpath(layout->name) || !dir.cd(layout->name))
+        return false;
+
+    const QIODevice::OpenMode mode = QIODevice::WriteOnly | (append ? QIODevice::Append : QIODevice::Truncate);
+    const int numColumns = layout->columns.size();
+    QFile timestampFile(dir.filePath("timestamp.bin"));
+    QFile instanceFile(dir.filePath("instance.bin"));
+    QVector<QFile *> columnFiles(numColumns);
+    bool ok = timestampFile.open(mode);
+    if (!layout->singleInstance)
+        ok &= instanceFile.open(mode);
+    for (int c = 0; c < numColumns; c++) {
+        columnFiles[c] = new QFile(dir.filePath(layout->columns[c].name + ".bin"));
+        ok &= columnFiles[c]->open(mode);
+    }
+
+    // Gather a batch of samples per column so each file gets large writes
+    const quint32 headerLength = UAVTalk::MIN_HEADER_LENGTH + (layout->singleInstance ? 0 : 2);
+    QVector<quint32> timestamps(SAMPLES_PER_WRITE);
+    QVector<quint16> instances(SAMPLES_PER_WRITE);
+    QVector<QByteArray> columns(numColumns);
+    for (int c = 0; c < numColumns; c++)
+        columns[c].resize(SAMPLES_PER_WRITE * layout->columns[c].bytes);
+
+    for (int first = 0; ok && first < packets.size(); first += SAMPLES_PER_WRITE) {
+        const int count = qMin(SAMPLES_PER_WRITE, packets.size() - first);
+        for (int i = 0; i < count; i++) {
+            const Packet &packet = packets[first + i];
+            timestamps[i] = qToLittleEndian(packet.timestamp);
+            if (!layout->singleInstance)
+                memcpy(&instances[i], packet.data + UAVTalk::MIN_HEADER_LENGTH, sizeof(quint16));
+            const quint8 *data = packet.data + headerLength;
+            for (int c = 0; c < numColumns; c++) {
+                const Column &column = layout->columns[c];
+                memcpy(columns[c].data() + i * column.bytes, data + column.offset, column.bytes);
+            }
+        }
+
+        ok &= timestampFile.write((const char *) timestamps.constData(), count * sizeof(quint32)) == count * (qint64) sizeof(quint32);
+        if (!layout->singleInstance)
+            ok &= instanceFile.write((const char *) instances.constData(), count * sizeof(quint16)) == count * (qint64) sizeof(quint16);
+        for (int c = 0; c < numColumns; c++) {
+            qint64 bytes = (qint64) count * layout->columns[c].bytes;
+            ok &= columnFiles[c]->write(columns[c].constData(), bytes) == bytes;
+        }
+    }
+    qDeleteAll(columnFiles);
+    return ok;
+}
+
+/**
+ * Write the schema of one object, once all its columns are written
+ */
+bool LogConverter::writeSchema(const Layout *layout, qint64 samples, const QString &outputDir) const
+{
+    QJsonArray columnList;
+    foreach (const Column &column, layout->columns) {
+        QJsonObject entry;
+        entry["name"] = column.name;
+        entry["type"] = column.type;
+        entry["elements"] = (int) column.elements;
+        entry["bytes"] = (int) column.bytes;
+        entry["file"] = column.name + ".bin";
+        if (!column.options.isEmpty())
+            entry["options"] = QJsonArray::fromStringList(column.options);
+        columnList.append(entry);
+    }
+    QJsonObject schema;
+    schema["name"] = layout->name;
+    schema["id"] = QString("0x%1").arg(layout->objId, 8, 16, QChar('0'));
+    schema["samples"] = samples;
+    schema["singleInstance"] = layout->singleInstance;
+    schema["columns"] = columnList;
+
+    QFile schemaFile(QDir(outputDir).filePath(layout->name + "/schema.json"));
+    if (!schemaFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    return schemaFile.write(QJsonDocument(schema).toJson()) > 0;
+}
+
+/**
+ * Convert a log
+ * @return false if the log cannot be read or the columns cannot be written,
+ * see getErrorString()
+ */
+bool LogConverter::convert(const QString &logPath, const QString &outputDir)
+{
+    memset(&stats, 0, sizeof(stats));
+    errorString.clear();
+
+    QFile file(logPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        errorString = QString("Cannot open %1: %2").arg(logPath).arg(file.errorString());
+        return false;
+    }
+
+    // Skip the text header, as LogFile does
+    qint64 dataStart = 0;
+    for (int line = 0; line < 14 && !file.atEnd(); line++) {
+        if (file.readLine().trimmed() == "##") {
+            dataStart = file.pos();
+            break;
+        }
+    }
+
+    MappedLog log;
+    if (!log.open(&file, dataStart)) {
+        errorString = QString("Cannot read %1").arg(logPath);
+        return false;
+    }
+    if (!QDir().mkpath(outputDir)) {
+        errorString = QString("Cannot create %1").arg(outputDir);
+        return false;
+    }
+
+    pool.setMaxThreadCount(qMax(threadCount, 1));
+
+    // A mapped log is converted at once, as its payloads are not copied.
+    // Otherwise the payloads are read in batches which fit in memory, and
+    // each batch is appended to the columns.
+    const qint64 batchBytes = log.isMapped() ? log.getIndex().getDataEnd() : BYTES_PER_BATCH;
+    QHash<quint32, qint64> samples;
+    while (!log.atEnd()) {
+        QVector<Record> records;
+        if (log.isMapped())
+            records.reserve(log.getIndex().getRecordCount());
+        qint64 bytes = 0;
+        while (!log.atEnd() && bytes < batchBytes) {
+            Record record;
+            bool keyframe;
+            record.timestamp = log.getNextTimestamp();
+            if (!log.next(&record.payload, &keyframe)) {
+                errorString = QString("Cannot read %1: %2").arg(logPath).arg(file.errorString());
+                return false;
+            }
+            if (!keyframe)
+                records.append(record);
+            bytes += record.payload.size();
+        }
+        stats.bytes += bytes;
+        stats.records += records.size();
+
+        if (!convertBatch(records, outputDir, &samples))
+            return false;
+    }
+
+    bool ok = true;
+    for (QHash<quint32, qint64>::const_iterator it = samples.constBegin(); it != samples.constEnd(); ++it) {
+        if (!writeSchema(&layouts[it.key()], it.value(), outputDir)) {
+            errorString = QString("Cannot write the schema of %1").arg(layouts[it.key()].name);
+            ok = false;
+        }
+    }
+    stats.objects = samples.size();
+    return ok;
+}
+
+/**
+ * Convert a batch of records, appending the samples of the objects already
+ * written by the previous batches
+ * @param samples Samples written so far of each object, updated
+ */
+bool LogConverter::convertBatch(const QVector<Record> &records, const QString &outputDir, QHash<quint32, qint64> *samples)
+{
+    // First pass, locate the packets
+    int numChunks = (records.size() + RECORDS_PER_CHUNK - 1) / RECORDS_PER_CHUNK;
+    QVector<Chunk> chunks(numChunks);
+    QList<QFuture<void> > framing;
+    for (int i = 0; i < numChunks; i++) {
+        int first = i * RECORDS_PER_CHUNK;
+        int count = qMin(RECORDS_PER_CHUNK, records.size() - first);
+        framing += QtConcurrent::run(&pool, this, &LogConverter::frameRecords, &chunks[i], records.constData() + first, count);
+    }
+    for (int i = 0; i < framing.size(); i++)
+        framing[i].waitForFinished();
+
+    // Put the packets of each object together, in log order
+    QHash<quint32, QVector<Packet> > packets;
+    for (int i = 0; i < numChunks; i++) {
+        Chunk &chunk = chunks[i];
+        stats.packets += chunk.packetCount;
+        stats.unknownPackets += chunk.unknownPackets;
+        stats.invalidPackets += chunk.invalidPackets;
+        stats.skippedBytes += chunk.skippedBytes;
+        for (QHash<quint32, QVector<Packet> >::iterator it = chunk.packets.begin(); it != chunk.packets.end(); ++it) {
+            if (i == 0 || !packets.contains(it.key()))
+                packets.insert(it.key(), it.value());
+            else
+                packets[it.key()] += it.value();
+        }
+        chunk.packets.clear();
+    }
+
+    // Second pass, write the columns of each object
+    QList<QFuture<bool> > writing;
+    QList<quint32> objIds = packets.keys();
+    foreach (quint32 objId, objIds)
+        writing += QtConcurrent::run(&pool, this, &LogConverter::writeObject, &layouts[objId], packets[objId], outputDir, samples->contains(objId));
+    bool ok = true;
+    for (int i = 0; i < writing.size(); i++) {
+        if (!writing[i].result()) {
+            errorString = QString("Cannot write the columns of %1").arg(layouts[objIds[i]].name);
+            ok = false;
+        }
+        (*samples)[objIds[i]] += packets[objIds[i]].size();
+    }
+    return ok;
+}
@@ -0,0 +1,125 @@
+/**
+ ******************************************************************************
+ *
+ * @file       logconverter.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @brief      Converts a telemetry log to one column file per object field
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef LOGCONVERTER_H
+#define LOGCONVERTER_H
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QVector>
+#include <QThreadPool>
+
+class UAVObjectManager;
+
+/**
+ * @brief Converts a .tll log to columns.
+ *
+ * Every logged object gets a directory under the output directory holding
+ * timestamp.bin (uint32 ms), instance.bin (uint16, multi instance objects
+ * only) and one <Field>.bin per field. A field column is the raw little
+ * endian field data of every sample one after the other, so it can be
+ * memory mapped as an array of samples x elements of the field type.
+ * schema.json describes the columns.
+ *
+ * The conversion runs in two parallel passes over a memory mapping of the
+ * log: the records are split among the threads to locate and check the
+ * packets, then the objects are split among the threads to write their
+ * columns. When the log cannot be mapped, it is read and converted in
+ * batches which fit in memory. Keyframes are skipped when the log has an
+ * index, as they only repeat the state of the objects.
+ */
+class LogConverter
+{
+public:
+    typedef struct {
+        qint64 records;
+        qint64 bytes;           //!< Record payload bytes
+        qint64 packets;         //!< Object packets converted
+        qint64 unknownPackets;  //!< Packets of objects missing from this GCS
+        qint64 invalidPackets;  //!< Packets with a bad checksum or size
+        qint64 skippedBytes;    //!< Bytes outside of any packet
+        int objects;            //!< Objects with at least one sample
+    } Stats;
+
+    explicit LogConverter(UAVObjectManager *objMngr);
+
+    void setThreadCount(int threads) { threadCount = threads; }
+    bool convert(const QString &logPath, const QString &outputDir);
+    const Stats &getStats() const { return stats; }
+    const QString &getErrorString() const { return errorString; }
+
+private:
+    struct Column {
+        QString name;
+        QString type;
+        QStringList options;
+        quint32 elements;
+        quint32 offset;
+        quint32 bytes;
+    };
+
+    struct Layout {
+        QString name;
+        quint32 objId;
+        bool singleInstance;
+        quint32 dataLength;
+        QVector<Column> columns;
+    };
+
+    struct Packet {
+        const quint8 *data;
+        quint32 timestamp;
+    };
+
+    struct Record {
+        QByteArray payload;
+        quint32 timestamp;
+    };
+
+    struct Chunk {
+        QHash<quint32, QVector<Packet> > packets;
+        qint64 packetCount;
+        qint64 unknownPackets;
+        qint64 invalidPackets;
+        qint64 skippedBytes;
+    };
+
+    void frameRecords(Chunk *chunk, const Record *records, int count) const;
+    bool convertBatch(const QVector<Record> &records, const QString &outputDir, QHash<quint32, qint64> *samples);
+    bool writeObject(const Layout *layout, const QVector<Packet> &packets, const QString &outputDir, bool append) const;
+    bool writeSchema(const Layout *layout, qint64 samples, const QString &outputDir) const;
+
+    UAVObjectManager *objMngr;
+    QHash<quint32, Layout> layouts;
+    int threadCount;
+    //! Runs the conversion tasks, limited to threadCount without touching the global pool
+    QThreadPool pool;
+    Stats stats;
+    QString errorString;
+};
+
+#endif // LOGCONVERTER_H
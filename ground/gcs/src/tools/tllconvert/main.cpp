@@ -0,0 +1,90 @@
+/**
+ ******************************************************************************
+ *
+ * @file       main.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @brief      Command line converter of telemetry logs to column files
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <stdio.h>
+
+#include "uavobjectmanager.h"
+#include "uavobjectsinit.h"
+#include "logconverter.h"
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("tllconvert");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Converts a Tau Labs telemetry log (.tll) to one directory per object "
+                                     "holding a raw little endian column per field and a schema.json.");
+    parser.addHelpOption();
+    QCommandLineOption outputOption(QStringList() << "o" << "output",
+                                    "Output directory, <log name>_columns by default.", "directory");
+    QCommandLineOption threadsOption(QStringList() << "j" << "threads",
+                                     "Number of decoding threads, one per core by default.", "threads");
+    parser.addOption(outputOption);
+    parser.addOption(threadsOption);
+    parser.addPositionalArgument("log", "Telemetry log to convert.");
+    parser.process(app);
+
+    if (parser.positionalArguments().size() != 1)
+        parser.showHelp(1);
+
+    QString logPath = parser.positionalArguments().first();
+    QString outputDir = parser.value(outputOption);
+    if (outputDir.isEmpty()) {
+        QFileInfo info(logPath);
+        outputDir = info.absolutePath() + "/" + info.completeBaseName() + "_columns";
+    }
+
+    UAVObjectManager objMngr;
+    UAVObjectsInitialize(&objMngr);
+
+    LogConverter converter(&objMngr);
+    if (parser.isSet(threadsOption))
+        converter.setThreadCount(parser.value(threadsOption).toInt());
+
+    QElapsedTimer timer;
+    timer.start();
+    bool ok = converter.convert(logPath, outputDir);
+    double seconds = timer.elapsed() / 1000.0;
+
+    const LogConverter::Stats &stats = converter.getStats();
+    fprintf(stderr, "%lld records, %lld packets of %d objects converted in %.1f s (%.1f MB/s)\n",
+            stats.records, stats.packets, stats.objects, seconds,
+            seconds > 0 ? stats.bytes / 1048576.0 / seconds : 0.0);
+    if (stats.unknownPackets > 0 || stats.invalidPackets > 0)
+        fprintf(stderr, "%lld packets of unknown objects, %lld invalid packets, %lld bytes skipped\n",
+                stats.unknownPackets, stats.invalidPackets, stats.skippedBytes);
+
+    if (!ok) {
+        fprintf(stderr, "%s\n", qPrintable(converter.getErrorString()));
+        return 1;
+    }
+    return 0;
+}
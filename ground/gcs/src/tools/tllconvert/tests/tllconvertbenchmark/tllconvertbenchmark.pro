@@ -0,0 +1,25 @@
+# Conversion rate, in MB/s and samples/s, of a log of every object to
+# columns with one thread and with one thread per core. The size of the
+# generated log, 2 GB by default, can be set in MB with the
+# LOGCONVERT_BENCH_MB environment variable.
+
+QT += testlib network concurrent
+QT -= gui
+TARGET = tllconvertbenchmark
+CONFIG += console testcase
+CONFIG -= app_bundle
+TEMPLATE = app
+
+include(../../../../../gcs.pri)
+
+INCLUDEPATH *= $$GCS_SOURCE_TREE/src/plugins $$GCS_SOURCE_TREE/src/plugins/logging ../..
+LIBS += -L$$GCS_PLUGIN_PATH/TauLabs
+include(../../../../plugins/uavtalk/uavtalk.pri)
+
+HEADERS += ../../logconverter.h \
+    $$GCS_SOURCE_TREE/src/plugins/logging/logindex.h \
+    $$GCS_SOURCE_TREE/src/plugins/logging/mappedlog.h
+SOURCES += tst_tllconvertbenchmark.cpp \
+    ../../logconverter.cpp \
+    $$GCS_SOURCE_TREE/src/plugins/logging/logindex.cpp \
+    $$GCS_SOURCE_TREE/src/plugins/logging/mappedlog.cpp
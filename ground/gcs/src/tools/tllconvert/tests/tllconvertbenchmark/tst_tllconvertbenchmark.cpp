@@ -0,0 +1,225 @@
+/**
+ ******************************************************************************
+ * @file       tst_tllconvertbenchmark.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2015
+ * @brief Generates a large log of every object with random data, converts it
+ * to columns with one thread and with one thread per core and checks the
+ * columns hold the logged data
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <QtTest/QtTest>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QBuffer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+
+#include <extensionsystem/pluginmanager.h>
+#include "uavtalk/uavtalk.h"
+#include "uavobjectmanager.h"
+#include "uavobjectsinit.h"
+#include "logindex.h"
+#include "logconverter.h"
+
+class tst_TllConvertBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void convertSingleThread();
+    void convertAllCores();
+    void columnsMatchLog();
+
+private:
+    void convert(int threads, const QString &outputDir);
+
+    ExtensionSystem::PluginManager *m_pm;
+    UAVObjectManager *m_objMngr;
+    QTemporaryDir m_dir;
+    QString m_path;
+    qint64 m_packets;
+    quint32 m_rounds;
+    //! Logged data of every instance, by object name
+    QHash<QString, QVector<QByteArray> > m_data;
+};
+
+//! Time between two rounds of updates of all the objects
+static const quint32 ROUND_PERIOD_MS = 10;
+
+void tst_TllConvertBenchmark::initTestCase()
+{
+    m_pm = new ExtensionSystem::PluginManager();
+    m_objMngr = new UAVObjectManager();
+    UAVObjectsInitialize(m_objMngr);
+    QVERIFY(m_dir.isValid());
+
+    qint64 targetSize = qgetenv("LOGCONVERT_BENCH_MB").toLongLong();
+    if (targetSize <= 0)
+        targetSize = 2048;
+    targetSize *= 1024 * 1024;
+
+    // One packet of every instance with random data, as logged one per record
+    qsrand(1);
+    QBuffer packets;
+    packets.open(QIODevice::WriteOnly);
+    UAVTalk talk(&packets, m_objMngr);
+    QVector<qint64> packetEnds;
+    foreach (QVector<UAVDataObject*> instances, m_objMngr->getDataObjectsVector()) {
+        foreach (UAVDataObject *obj, instances) {
+            QByteArray data(obj->getNumBytes(), 0);
+            for (int i = 0; i < data.size(); i++)
+                data[i] = (char) qrand();
+            obj->unpack((const quint8 *) data.constData());
+            m_data[obj->getName()].append(data);
+            talk.sendObject(obj, false, false);
+            packetEnds.append(packets.pos());
+        }
+    }
+    const QByteArray &stream = packets.data();
+
+    m_path = m_dir.path() + "/convert.tll";
+    QFile file(m_path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("Tau Labs git hash:\nbenchmark\n0000\n##\n");
+
+    LogIndex index;
+    quint32 timestamp = 0;
+    m_rounds = 0;
+    while (file.pos() < targetSize) {
+        qint64 start = 0;
+        foreach (qint64 end, packetEnds) {
+            qint64 size = end - start;
+            index.addRecord(timestamp, file.pos());
+            file.write((char *) &timestamp, sizeof(timestamp));
+            file.write((char *) &size, sizeof(size));
+            file.write(stream.constData() + start, size);
+            start = end;
+        }
+        timestamp += ROUND_PERIOD_MS;
+        m_rounds++;
+    }
+    m_packets = (qint64) m_rounds * packetEnds.size();
+
+    QByteArray indexPayload = index.serialize(file.pos());
+    qint64 indexSize = indexPayload.size();
+    file.write((char *) &timestamp, sizeof(timestamp));
+    file.write((char *) &indexSize, sizeof(indexSize));
+    file.write(indexPayload);
+    qDebug("Log of %lld packets of %d objects, %.0f MB", m_packets, m_data.size(), file.size() / 1048576.0);
+}
+
+void tst_TllConvertBenchmark::cleanupTestCase()
+{
+    delete m_objMngr;
+    delete m_pm;
+}
+
+void tst_TllConvertBenchmark::convert(int threads, const QString &outputDir)
+{
+    LogConverter converter(m_objMngr);
+    converter.setThreadCount(threads);
+
+    QElapsedTimer timer;
+    timer.start();
+    QVERIFY2(converter.convert(m_path, outputDir), qPrintable(converter.getErrorString()));
+    qint64 nsecs = timer.nsecsElapsed();
+
+    const LogConverter::Stats &stats = converter.getStats();
+    qDebug("%d threads: %.0f MB in %.0f ms, %.1f MB/s, %.2f M samples/s", threads,
+           stats.bytes / 1048576.0, nsecs / 1e6, stats.bytes / 1048576.0 / (nsecs / 1e9),
+           stats.packets / 1e6 / (nsecs / 1e9));
+
+    QCOMPARE(stats.packets, m_packets);
+    QCOMPARE(stats.objects, m_data.size());
+    QCOMPARE(stats.unknownPackets, (qint64) 0);
+    QCOMPARE(stats.invalidPackets, (qint64) 0);
+    QCOMPARE(stats.skippedBytes, (qint64) 0);
+}
+
+void tst_TllConvertBenchmark::convertSingleThread()
+{
+    convert(1, m_dir.path() + "/single");
+}
+
+void tst_TllConvertBenchmark::convertAllCores()
+{
+    convert(QThread::idealThreadCount(), m_dir.path() + "/columns");
+}
+
+/**
+ * Map the columns of every object and check them against the logged data
+ */
+void tst_TllConvertBenchmark::columnsMatchLog()
+{
+    QDir columns(m_dir.path() + "/columns");
+    for (QHash<QString, QVector<QByteArray> >::const_iterator it = m_data.constBegin(); it != m_data.constEnd(); ++it) {
+        QDir dir(columns.filePath(it.key()));
+        const QVector<QByteArray> &instances = it.value();
+        quint32 samples = m_rounds * instances.size();
+
+        QFile schemaFile(dir.filePath("schema.json"));
+        QVERIFY(schemaFile.open(QIODevice::ReadOnly));
+        QJsonObject schema = QJsonDocument::fromJson(schemaFile.readAll()).object();
+        QCOMPARE(schema["name"].toString(), it.key());
+        QCOMPARE((quint32) schema["samples"].toInt(), samples);
+
+        QFile timestampFile(dir.filePath("timestamp.bin"));
+        QVERIFY(timestampFile.open(QIODevice::ReadOnly));
+        QCOMPARE(timestampFile.size(), (qint64) (samples * sizeof(quint32)));
+        const quint32 *timestamps = (const quint32 *) timestampFile.map(0, timestampFile.size());
+        QVERIFY(timestamps != NULL);
+        QCOMPARE(timestamps[0], (quint32) 0);
+        QCOMPARE(timestamps[samples - 1], (m_rounds - 1) * ROUND_PERIOD_MS);
+
+        QFile instanceFile(dir.filePath("instance.bin"));
+        QCOMPARE(instanceFile.exists(), !schema["singleInstance"].toBool());
+        if (instanceFile.exists()) {
+            QVERIFY(instanceFile.open(QIODevice::ReadOnly));
+            const quint16 *instanceIds = (const quint16 *) instanceFile.map(0, instanceFile.size());
+            QVERIFY(instanceIds != NULL);
+            QCOMPARE(instanceIds[samples - 1], (quint16) (instances.size() - 1));
+        }
+
+        UAVObject *obj = m_objMngr->getObject(it.key());
+        foreach (const QJsonValue &value, schema["columns"].toArray()) {
+            QJsonObject column = value.toObject();
+            UAVObjectField *field = obj->getField(column["name"].toString());
+            QVERIFY(field != NULL);
+            quint32 bytes = column["bytes"].toInt();
+            QCOMPARE(bytes, field->getNumBytes());
+
+            QFile columnFile(dir.filePath(column["file"].toString()));
+            QVERIFY(columnFile.open(QIODevice::ReadOnly));
+            QCOMPARE(columnFile.size(), (qint64) samples * bytes);
+            const uchar *data = columnFile.map(0, columnFile.size());
+            QVERIFY(data != NULL);
+            for (quint32 sample = 0; sample < samples; sample += qMax(samples / 97, (quint32) 1)) {
+                const QByteArray &logged = instances[sample % instances.size()];
+                QVERIFY(memcmp(data + (qint64) sample * bytes, logged.constData() + field->getDataOffset(), bytes) == 0);
+            }
+        }
+    }
+}
+
+QTEST_MAIN(tst_TllConvertBenchmark)
+
+#include "tst_tllconvertbenchmark.moc"
@@ -0,0 +1,29 @@
+# Command line converter of telemetry logs to column files, see logconverter.h
+
+include(../../../gcs.pri)
+
+TEMPLATE = app
+TARGET = tllconvert
+DESTDIR = $$GCS_APP_PATH
+QT += network concurrent
+QT -= gui
+CONFIG += console
+CONFIG -= app_bundle
+
+include(../../rpath.pri)
+
+# The uavobjects and uavtalk plugins are linked as libraries
+INCLUDEPATH *= $$GCS_SOURCE_TREE/src/plugins $$GCS_SOURCE_TREE/src/plugins/logging
+LIBS += -L$$GCS_PLUGIN_PATH/TauLabs
+include(../../plugins/uavtalk/uavtalk.pri)
+linux-* {
+    QMAKE_LFLAGS += \'-Wl,-rpath,\$\$ORIGIN/../$$GCS_LIBRARY_BASENAME/taulabs/plugins/TauLabs\'
+}
+
+HEADERS += logconverter.h \
+    $$GCS_SOURCE_TREE/src/plugins/logging/logindex.h \
+    $$GCS_SOURCE_TREE/src/plugins/logging/mappedlog.h
+SOURCES += main.cpp \
+    logconverter.cpp \
+    $$GCS_SOURCE_TREE/src/plugins/logging/logindex.cpp \
+    $$GCS_SOURCE_TREE/src/plugins/logging/mappedlog.cpp
@@ -139,8 +139,9 @@ bool UAVObjectGeneratorGCS::process_object(ObjectInfo* info)
             propertiesImpl +=
                     QString("%1 %2::get%3(quint32 index) const\n"
                             "{\n"
-                            "   QMutexLocker locker(mutex);\n"
-                            "   return data.%3[index];\n"
+                            "   %1 value;\n"
+                            "   readData((quint8*)&value, offsetof(DataFields, %3) + index * sizeof(value), sizeof(value));\n"
+                            "   return value;\n"
                             "}\n")
                     .arg(type).arg(info->name).arg(field->name);
             propertySetters +=
@@ -149,10 +150,14 @@ bool UAVObjectGeneratorGCS::process_object(ObjectInfo* info)
             propertiesImpl +=
                     QString("void %1::set%2(quint32 index, %3 value)\n"
                             "{\n"
-                            "   mutex->lock();\n"
-                            "   bool changed = data.%2[index] != value;\n"
-                            "   data.%2[index] = value;\n"
-                            "   mutex->unlock();\n"
+                            "   bool changed;\n"
+                            "   {\n"
+                            "       WriteLocker locker(this);\n"
+                            "       data.%2[index] = value;\n"
+                            "       changed = notifiedData.%2[index] != value;\n"
+                            "       if (changed)\n"
+                            "           notifiedData.%2[index] = value;\n"
+                            "   }\n"
                             "   if (changed) emit %2Changed(index,value);\n"
                             "}\n\n")
                     .arg(info->name).arg(field->name).arg(type);
@@ -170,8 +175,9 @@ bool UAVObjectGeneratorGCS::process_object(ObjectInfo* info)
                 propertiesImpl +=
                         QString("%1 %2::get%3_%4() const\n"
                                 "{\n"
-                                "   QMutexLocker locker(mutex);\n"
-                                "   return data.%3[%5];\n"
+                                "   %1 value;\n"
+                                "   readData((quint8*)&value, offsetof(DataFields, %3) + %5 * sizeof(value), sizeof(value));\n"
+                                "   return value;\n"
                                 "}\n")
                         .arg(type).arg(info->name).arg(field->name).arg(elementName).arg(elementIndex);
                 propertySetters +=
@@ -180,19 +186,24 @@ bool UAVObjectGeneratorGCS::process_object(ObjectInfo* info)
                 propertiesImpl +=
                         QString("void %1::set%2_%3(%4 value)\n"
                                 "{\n"
-                                "   mutex->lock();\n"
-                                "   bool changed = data.%2[%5] != value;\n"
-                                "   data.%2[%5] = value;\n"
-                                "   mutex->unlock();\n"
+                                "   bool changed;\n"
+                                "   {\n"
+                                "       WriteLocker locker(this);\n"
+                                "       data.%2[%5] = value;\n"
+                                "       changed = notifiedData.%2[%5] != value;\n"
+                                "       if (changed)\n"
+                                "           notifiedData.%2[%5] = value;\n"
+                                "   }\n"
                                 "   if (changed) emit %2_%3Changed(value);\n"
                                 "}\n\n")
                         .arg(info->name).arg(field->name).arg(elementName).arg(type).arg(elementIndex);
                 propertyNotifications +=
                         QString("    void %1_%2Changed(%3 value);\n")
                         .arg(field->name).arg(elementName).arg(type);
+                // Compare the packed values, so that a NaN left as it was is not a change
                 propertyNotificationsImpl +=
-                        QString("        //if (data.%1[%2] != oldData.%1[%2])\n"
-                                "            emit %1_%3Changed(data.%1[%2]);\n")
+                        QString("    if (memcmp(&newData.%1[%2], &oldData.%1[%2], sizeof(newData.%1[%2])) != 0)\n"
+                                "        emit %1_%3Changed(newData.%1[%2]);\n")
                         .arg(field->name).arg(elementIndex).arg(elementName);
             }
         } else {
@@ -204,8 +215,9 @@ bool UAVObjectGeneratorGCS::process_object(ObjectInfo* info)
             propertiesImpl +=
                     QString("%1 %2::get%3() const\n"
                             "{\n"
-                            "   QMutexLocker locker(mutex);\n"
-                            "   return data.%3;\n"
+                            "   %1 value;\n"
+                            "   readData((quint8*)&value, offsetof(DataFields, %3), sizeof(value));\n"
+                            "   return value;\n"
                             "}\n")
                     .arg(type).arg(info->name).arg(field->name);
             propertySetters +=
@@ -214,10 +226,14 @@ bool UAVObjectGeneratorGCS::process_object(ObjectInfo* info)
             propertiesImpl +=
                     QString("void %1::set%2(%3 value)\n"
                             "{\n"
-                            "   mutex->lock();\n"
-                            "   bool changed = data.%2 != value;\n"
-                            "   data.%2 = value;\n"
-                            "   mutex->unlock();\n"
+                            "   bool changed;\n"
+                            "   {\n"
+                            "       WriteLocker locker(this);\n"
+                            "       data.%2 = value;\n"
+                            "       changed = notifiedData.%2 != value;\n"
+                            "       if (changed)\n"
+                            "           notifiedData.%2 = value;\n"
+                            "   }\n"
                             "   if (changed) emit %2Changed(value);\n"
                             "}\n\n")
                     .arg(info->name).arg(field->name).arg(type);
@@ -225,8 +241,8 @@ bool UAVObjectGeneratorGCS::process_object(ObjectInfo* info)
                     QString("    void %1Changed(%2 value);\n")
                     .arg(field->name).arg(type);
             propertyNotificationsImpl +=
-                    QString("        //if (data.%1 != oldData.%1)\n"
-                            "            emit %1Changed(data.%1);\n")
+                    QString("    if (memcmp(&newData.%1, &oldData.%1, sizeof(newData.%1)) != 0)\n"
+                            "        emit %1Changed(newData.%1);\n")
                     .arg(field->name);
         }
     }
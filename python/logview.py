@@ -138,6 +138,15 @@ def main():
                         # Got a log record header.  Unpack it.
                         log_hdr = LogHeader._make(struct.unpack(log_hdr_fmt, log_hdr_data))
 
+                        # Keyframes and the index of the log start with a marker
+                        # beginning with "TLL". Keyframes only repeat the state of
+                        # the objects and the index holds no packets, so skip both.
+                        marker = fd.read(min(log_hdr.size, 3))
+                        if marker == 'TLL':
+                            fd.seek(log_hdr.size - len(marker), os.SEEK_CUR)
+                            continue
+                        fd.seek(-len(marker), os.SEEK_CUR)
+
                         # Set the baseline timestamp from the first record in the log file
                         if base_time is None:
                             base_time = log_hdr.time
@@ -8,3 +8,4 @@ from . import uavo_collection
 from . import uavo_list
 from . import uavtalk
 from . import telemetry
+from . import telemetrybus
@@ -0,0 +1,112 @@
+import mmap
+import os
+import struct
+import tempfile
+
+class TelemetryBus():
+	"""
+	Subscribes to the object updates a GCS publishes to the telemetry bus of the
+	host, see telemetrybus.h in the UAVTalk relay plugin. The updates are read
+	from shared memory as they were decoded by the GCS, without parsing the link
+	again.
+
+	The reader never writes to the bus and relies on the loads of the host not
+	being reordered, as on x86.
+	"""
+
+	MAGIC = 0x42544c54
+	VERSION = 1
+	HEADER_FMT = "=IIIIII"
+	RECORD_FMT = "=IIHHI"
+
+	def __init__(self, uavo_defs, path=None, obj_ids=None):
+		"""
+		Attach to the bus at path, by default the one of the GCS. Only the
+		updates of the objects in obj_ids are decoded, all of them when None.
+		"""
+
+		self.uavo_defs = uavo_defs
+		if path is None:
+			path = os.path.join(tempfile.gettempdir(), "taulabs-telemetrybus")
+
+		self.file = open(path, "rb")
+		self.map = mmap.mmap(self.file.fileno(), 0, access=mmap.ACCESS_READ)
+
+		(magic, version, self.capacity, self.header_size, reserved, committed) = \
+			struct.unpack_from(TelemetryBus.HEADER_FMT, self.map, 0)
+		if magic != TelemetryBus.MAGIC or version != TelemetryBus.VERSION:
+			raise IOError("Not a telemetry bus: " + path)
+
+		self.record_size = struct.calcsize(TelemetryBus.RECORD_FMT)
+		self.position = committed
+		self.overruns = 0
+		self.set_filter(obj_ids)
+
+	def close(self):
+		self.map.close()
+		self.file.close()
+
+	def set_filter(self, obj_ids):
+		""" Only decode the updates of these object ids, or all of them when None """
+
+		self.filter = None if obj_ids is None else set(obj_ids)
+
+	def __reserved(self):
+		return struct.unpack_from("=I", self.map, 16)[0]
+
+	def __committed(self):
+		return struct.unpack_from("=I", self.map, 20)[0]
+
+	def read(self):
+		"""
+		Return the updates published since the last read, as UAVO instances
+		stamped with the time of the GCS
+		"""
+
+		updates = []
+		ring = self.header_size
+
+		while True:
+			committed = self.__committed()
+			available = (committed - self.position) & 0xffffffff
+			if available == 0:
+				return updates
+			if available > self.capacity:
+				# Lapped by the GCS, skip to the newest update
+				self.overruns += 1
+				self.position = committed
+				return updates
+
+			offset = self.position & (self.capacity - 1)
+			if self.capacity - offset < self.record_size:
+				# Padding at the end of the ring
+				(size, obj_id) = struct.unpack_from("=II", self.map, ring + offset)
+				inst_id = length = timestamp = 0
+			else:
+				(size, obj_id, inst_id, length, timestamp) = \
+					struct.unpack_from(TelemetryBus.RECORD_FMT, self.map, ring + offset)
+
+			valid = size >= 8 and size % 8 == 0 and size <= available and size <= self.capacity - offset
+			wanted = valid and obj_id != 0 and (self.filter is None or obj_id in self.filter)
+			if wanted:
+				valid = size >= self.record_size + length
+				start = ring + offset + self.record_size
+				data = self.map[start:start + length]
+
+			# The copy is only whole if the GCS did not claim its bytes meanwhile
+			if ((self.__reserved() - self.position) & 0xffffffff) > self.capacity or not valid:
+				self.overruns += 1
+				self.position = self.__committed()
+				continue
+
+			self.position = (self.position + size) & 0xffffffff
+			if not wanted:
+				continue
+
+			uavo_key = '{0:08x}'.format(obj_id)
+			if not uavo_key in self.uavo_defs:
+				continue
+			uavo_def = self.uavo_defs[uavo_key]
+			if not uavo_def.meta['is_single_inst']:
+				data = struct.pack("<H", inst_id) + data
+			updates.append(uavo_def.instance_from_bytes(data, timestamp=timestamp))